@@ -1,4 +1,5 @@
 #pragma once
+#include "contradium/pbd/pbd_collision_shape.h"
 #include "contradium/pbd/pbd_solver.h"
 
 namespace contradium {}
@@ -0,0 +1,321 @@
+#include "contradium/pbd/pbd_collision_shape.h"
+#include <random>
+
+namespace contradium {
+
+namespace {
+
+// FNV-1a over raw bytes.
+uint64_t HashBytes(const void *data, size_t size, uint64_t hash) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// Position of a uniform random number in [0, 1) from the raw output of the generator, the same on every platform.
+float UniformFloat(std::mt19937 &rng) {
+  return static_cast<float>(rng() >> 8) * (1.0f / 16777216.0f);
+}
+
+// Accepted points hashed by cells of the spacing, a point is accepted if none lies closer than spacing.
+class SampleGrid {
+ public:
+  explicit SampleGrid(float spacing) : spacing_(spacing) {
+  }
+
+  bool Free(const Vector3<float> &point) const {
+    Eigen::Vector3i cell = Cell(point);
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dz = -1; dz <= 1; dz++) {
+          auto it = cells_.find(Key(cell + Eigen::Vector3i{dx, dy, dz}));
+          if (it == cells_.end()) {
+            continue;
+          }
+          for (const Vector3<float> &other : it->second) {
+            if ((other - point).squaredNorm() < spacing_ * spacing_) {
+              return false;
+            }
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  void Insert(const Vector3<float> &point) {
+    cells_[Key(Cell(point))].push_back(point);
+  }
+
+ private:
+  Eigen::Vector3i Cell(const Vector3<float> &point) const {
+    return (point / spacing_).array().floor().cast<int>();
+  }
+
+  static uint64_t Key(const Eigen::Vector3i &cell) {
+    return (static_cast<uint64_t>(cell[0] & 0x1fffff) << 42) | (static_cast<uint64_t>(cell[1] & 0x1fffff) << 21) |
+           static_cast<uint64_t>(cell[2] & 0x1fffff);
+  }
+
+  float spacing_;
+  std::unordered_map<uint64_t, std::vector<Vector3<float>>> cells_;
+};
+
+}  // namespace
+
+CollisionShape::CollisionShape(const Mesh<float> &mesh)
+    : type_(COLLISION_SHAPE_TYPE_MESH),
+      points_(mesh.Positions(), mesh.Positions() + mesh.NumVertices()),
+      mesh_(mesh),
+      mesh_sdf_(VertexBufferView{mesh.Positions()}, mesh.NumVertices(), mesh.Indices(), mesh.NumIndices()),
+      content_hash_(MeshContentHash(mesh)) {
+  for (const Vector3<float> &point : points_) {
+    bounds_.Expand(point);
+  }
+}
+
+CollisionShape::CollisionShape(CollisionShapeType type) : type_(type) {
+}
+
+std::shared_ptr<const CollisionShape> CollisionShape::CreateSphere(float radius) {
+  std::shared_ptr<CollisionShape> shape(new CollisionShape(COLLISION_SHAPE_TYPE_SPHERE));
+  shape->points_ = {Vector3<float>::Zero()};
+  shape->bounds_ = AABB{Vector3<float>::Zero()};
+  shape->radius_ = radius;
+  shape->sphere_sdf_.radius = radius;
+  return shape;
+}
+
+std::shared_ptr<const CollisionShape> CollisionShape::CreateBox(const Vector3<float> &half_extent) {
+  std::shared_ptr<CollisionShape> shape(new CollisionShape(COLLISION_SHAPE_TYPE_BOX));
+  for (int corner = 0; corner < 8; corner++) {
+    shape->points_.emplace_back(corner & 1 ? half_extent[0] : -half_extent[0],
+                                corner & 2 ? half_extent[1] : -half_extent[1],
+                                corner & 4 ? half_extent[2] : -half_extent[2]);
+  }
+  shape->bounds_.lower_bound = -half_extent;
+  shape->bounds_.upper_bound = half_extent;
+  shape->box_sdf_.half_extent = half_extent;
+  return shape;
+}
+
+std::shared_ptr<const CollisionShape> CollisionShape::CreateCapsule(float half_height, float radius) {
+  std::shared_ptr<CollisionShape> shape(new CollisionShape(COLLISION_SHAPE_TYPE_CAPSULE));
+  shape->points_ = {Vector3<float>{0.0f, -half_height, 0.0f}, Vector3<float>{0.0f, half_height, 0.0f}};
+  shape->bounds_.lower_bound = shape->points_[0];
+  shape->bounds_.upper_bound = shape->points_[1];
+  shape->radius_ = radius;
+  shape->capsule_sdf_.A = shape->points_[0];
+  shape->capsule_sdf_.B = shape->points_[1];
+  shape->capsule_sdf_.radius = radius;
+  return shape;
+}
+
+std::shared_ptr<const CollisionShape> CollisionShape::CreatePlane() {
+  return std::shared_ptr<CollisionShape>(new CollisionShape(COLLISION_SHAPE_TYPE_PLANE));
+}
+
+CollisionShapeType CollisionShape::Type() const {
+  return type_;
+}
+
+const std::vector<Vector3<float>> &CollisionShape::Points() const {
+  return points_;
+}
+
+float CollisionShape::Radius() const {
+  return radius_;
+}
+
+const AABB &CollisionShape::Bounds() const {
+  return bounds_;
+}
+
+const std::vector<Vector3<float>> &CollisionShape::SamplePoints(float spacing) const {
+  if (type_ != COLLISION_SHAPE_TYPE_MESH) {
+    return points_;
+  }
+  std::lock_guard<std::mutex> lock(sample_mutex_);
+  auto &sample_set = sample_sets_[spacing];
+  if (!sample_set) {
+    sample_set = std::make_unique<const std::vector<Vector3<float>>>(SampleSurface(mesh_, spacing));
+  }
+  return *sample_set;
+}
+
+void CollisionShape::SDF(const Vector3<float> &position,
+                         const Matrix3<float> &R,
+                         const Vector3<float> &t,
+                         float *sdf,
+                         Vector3<float> *gradient) const {
+  if (type_ == COLLISION_SHAPE_TYPE_MESH) {
+    MeshSDFRef(mesh_sdf_).SDF(position, R, t, sdf, gradient, nullptr);
+    return;
+  }
+  Vector3<float> p = R.transpose() * (position - t);
+  Eigen::RowVector3<float> jacobian;
+  switch (type_) {
+    case COLLISION_SHAPE_TYPE_SPHERE:
+      *sdf = sphere_sdf_(p).value();
+      jacobian = sphere_sdf_.Jacobian(p);
+      break;
+    case COLLISION_SHAPE_TYPE_BOX:
+      *sdf = box_sdf_(p).value();
+      jacobian = box_sdf_.Jacobian(p);
+      break;
+    case COLLISION_SHAPE_TYPE_CAPSULE:
+      *sdf = capsule_sdf_(p).value();
+      jacobian = capsule_sdf_.Jacobian(p);
+      break;
+    default:
+      *sdf = plane_sdf_(p).value();
+      jacobian = plane_sdf_.Jacobian(p);
+      break;
+  }
+  // On the center of a sphere or the axis of a capsule any direction is as good as another.
+  if (jacobian.squaredNorm() == 0.0f) {
+    jacobian = Eigen::RowVector3<float>{0.0f, 1.0f, 0.0f};
+  }
+  *gradient = R * jacobian.transpose();
+}
+
+const Mesh<float> &CollisionShape::GetMesh() const {
+  return mesh_;
+}
+
+const MeshSDF &CollisionShape::GetMeshSDF() const {
+  return mesh_sdf_;
+}
+
+uint64_t CollisionShape::ContentHash() const {
+  return content_hash_;
+}
+
+bool CollisionShape::HasMesh(const Mesh<float> &mesh) const {
+  return type_ == COLLISION_SHAPE_TYPE_MESH && mesh.NumVertices() == mesh_.NumVertices() &&
+         mesh.NumIndices() == mesh_.NumIndices() &&
+         std::equal(mesh.Positions(), mesh.Positions() + mesh.NumVertices(), mesh_.Positions()) &&
+         std::equal(mesh.Indices(), mesh.Indices() + mesh.NumIndices(), mesh_.Indices());
+}
+
+uint64_t MeshContentHash(const Mesh<float> &mesh) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  hash = HashBytes(mesh.Positions(), mesh.NumVertices() * sizeof(Vector3<float>), hash);
+  return HashBytes(mesh.Indices(), mesh.NumIndices() * sizeof(uint32_t), hash);
+}
+
+std::vector<Vector3<float>> SampleSurface(const Mesh<float> &mesh, float spacing, float sharp_angle) {
+  if (!(spacing > 0.0f)) {
+    throw std::runtime_error("[SampleSurface] spacing must be positive");
+  }
+  const Vector3<float> *positions = mesh.Positions();
+  const uint32_t *indices = mesh.Indices();
+  size_t num_triangles = mesh.NumIndices() / 3;
+
+  // Weld the vertices by position.
+  std::map<std::tuple<float, float, float>, int> welded_ids;
+  std::vector<int> welded(mesh.NumVertices());
+  for (size_t v = 0; v < mesh.NumVertices(); v++) {
+    auto key = std::make_tuple(positions[v][0], positions[v][1], positions[v][2]);
+    welded[v] = welded_ids.emplace(key, welded_ids.size()).first->second;
+  }
+
+  // Face normals around every edge. Faces without area have no normal and are left out, as if they were not there.
+  std::map<std::pair<int, int>, std::vector<Vector3<float>>> edge_normals;
+  std::map<std::pair<int, int>, std::pair<uint32_t, uint32_t>> edge_vertices;
+  for (size_t f = 0; f < num_triangles; f++) {
+    const uint32_t *triangle = indices + 3 * f;
+    Vector3<float> e1 = positions[triangle[1]] - positions[triangle[0]];
+    Vector3<float> e2 = positions[triangle[2]] - positions[triangle[0]];
+    Vector3<float> normal = e1.cross(e2);
+    float length = normal.norm();
+    if (!(length > 1e-6f * e1.norm() * e2.norm())) {
+      continue;
+    }
+    normal /= length;
+    for (int e = 0; e < 3; e++) {
+      uint32_t u = triangle[e];
+      uint32_t v = triangle[(e + 1) % 3];
+      std::pair<int, int> key = std::minmax(welded[u], welded[v]);
+      edge_normals[key].push_back(normal);
+      edge_vertices.emplace(key, std::make_pair(u, v));
+    }
+  }
+
+  // Sharp edges, and the corners where they end, branch or bend by more than sharp_angle.
+  float cos_sharp = std::cos(sharp_angle);
+  std::vector<std::pair<uint32_t, uint32_t>> sharp_edges;
+  std::vector<int> sharp_degrees(welded_ids.size(), 0);
+  std::vector<Vector3<float>> sharp_directions(welded_ids.size(), Vector3<float>::Zero());
+  std::vector<bool> corners(welded_ids.size(), false);
+  for (const auto &edge : edge_normals) {
+    const std::vector<Vector3<float>> &normals = edge.second;
+    if (normals.size() == 2 && normals[0].dot(normals[1]) >= cos_sharp) {
+      continue;
+    }
+    auto [u, v] = edge_vertices.at(edge.first);
+    sharp_edges.emplace_back(u, v);
+    for (auto [end, other] : {std::make_pair(u, v), std::make_pair(v, u)}) {
+      Vector3<float> direction = (positions[other] - positions[end]).normalized();
+      int w = welded[end];
+      if (sharp_degrees[w]++ == 1 && -direction.dot(sharp_directions[w]) < cos_sharp) {
+        corners[w] = true;
+      }
+      sharp_directions[w] = direction;
+    }
+  }
+
+  std::vector<Vector3<float>> samples;
+  SampleGrid grid(spacing);
+  for (const auto &key_id : welded_ids) {
+    int w = key_id.second;
+    if (corners[w] || sharp_degrees[w] == 1 || sharp_degrees[w] > 2) {
+      Vector3<float> corner{std::get<0>(key_id.first), std::get<1>(key_id.first), std::get<2>(key_id.first)};
+      samples.push_back(corner);
+      grid.Insert(corner);
+    }
+  }
+  // Points along the edges in steps of a quarter spacing, kept where free like the face samples below.
+  for (auto [u, v] : sharp_edges) {
+    const Vector3<float> &p0 = positions[u];
+    const Vector3<float> &p1 = positions[v];
+    int num_steps = std::ceil(4.0f * (p1 - p0).norm() / spacing);
+    for (int j = 0; j <= num_steps; j++) {
+      Vector3<float> point = p0 + (p1 - p0) * (static_cast<float>(j) / num_steps);
+      if (grid.Free(point)) {
+        samples.push_back(point);
+        grid.Insert(point);
+      }
+    }
+  }
+
+  // Dart throwing over candidates drawn by area, in a shuffled order.
+  std::mt19937 rng(0x5eed);
+  std::vector<Vector3<float>> candidates;
+  for (size_t f = 0; f < num_triangles; f++) {
+    const Vector3<float> &a = positions[indices[3 * f]];
+    const Vector3<float> &b = positions[indices[3 * f + 1]];
+    const Vector3<float> &c = positions[indices[3 * f + 2]];
+    float area = 0.5f * (b - a).cross(c - a).norm();
+    int num_candidates = std::ceil(16.0f * area / (spacing * spacing));
+    for (int k = 0; k < num_candidates; k++) {
+      float s = std::sqrt(UniformFloat(rng));
+      float t = UniformFloat(rng);
+      candidates.push_back((1.0f - s) * a + s * (1.0f - t) * b + s * t * c);
+    }
+  }
+  for (size_t k = candidates.size(); k > 1; k--) {
+    std::swap(candidates[k - 1], candidates[rng() % k]);
+  }
+  for (const Vector3<float> &candidate : candidates) {
+    if (grid.Free(candidate)) {
+      samples.push_back(candidate);
+      grid.Insert(candidate);
+    }
+  }
+  return samples;
+}
+
+}  // namespace contradium
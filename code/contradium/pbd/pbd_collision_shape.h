@@ -0,0 +1,84 @@
+#pragma once
+#include "contradium/pbd/pbd_util.h"
+
+namespace contradium {
+
+typedef enum CollisionShapeType {
+  COLLISION_SHAPE_TYPE_MESH = 0,
+  COLLISION_SHAPE_TYPE_SPHERE = 1,
+  COLLISION_SHAPE_TYPE_BOX = 2,
+  COLLISION_SHAPE_TYPE_CAPSULE = 3,
+  COLLISION_SHAPE_TYPE_PLANE = 4,
+} CollisionShapeType;
+
+// Collision geometry of a rigid body, a mesh with its signed distance field or an analytic primitive. Bodies refer to
+// it through a shared_ptr, so one shape built once serves every body of the same geometry and lives as long as any of
+// them.
+class CollisionShape {
+ public:
+  explicit CollisionShape(const Mesh<float> &mesh);
+
+  // Primitives around the body origin, the capsule along the local y axis. The plane bounds the half space below
+  // local y = 0 and is unbounded, it is meant for static bodies.
+  static std::shared_ptr<const CollisionShape> CreateSphere(float radius);
+  static std::shared_ptr<const CollisionShape> CreateBox(const Vector3<float> &half_extent);
+  static std::shared_ptr<const CollisionShape> CreateCapsule(float half_height, float radius);
+  static std::shared_ptr<const CollisionShape> CreatePlane();
+
+  CollisionShapeType Type() const;
+
+  // Points tested against the SDF of other bodies, each the center of a ball of Radius(). The vertices of a mesh,
+  // the corners of a box, the center of a sphere, the end points of a capsule and none for a plane.
+  const std::vector<Vector3<float>> &Points() const;
+  float Radius() const;
+  // Box around Points() in shape coordinates, without the radius. It holds every vertex of a mesh, so it bounds the
+  // shape whichever points a body is tested with. Empty for a plane.
+  const AABB &Bounds() const;
+
+  // Points of a mesh to test instead, see SampleSurface. Built on first use of a spacing and kept with the shape, so
+  // every body of the shape shares them. Primitives return Points().
+  const std::vector<Vector3<float>> &SamplePoints(float spacing) const;
+
+  // Signed distance and its gradient at position, with the shape rotated by R and moved by t.
+  void SDF(const Vector3<float> &position,
+           const Matrix3<float> &R,
+           const Vector3<float> &t,
+           float *sdf,
+           Vector3<float> *gradient) const;
+
+  // Empty for primitives.
+  const Mesh<float> &GetMesh() const;
+  const MeshSDF &GetMeshSDF() const;
+
+  // Hash of the vertex positions and indices, meshes that may be equal have equal hashes.
+  uint64_t ContentHash() const;
+  bool HasMesh(const Mesh<float> &mesh) const;
+
+ private:
+  explicit CollisionShape(CollisionShapeType type);
+
+  CollisionShapeType type_;
+  std::vector<Vector3<float>> points_;
+  float radius_{0.0f};
+  AABB bounds_;
+  Mesh<float> mesh_;
+  MeshSDF mesh_sdf_;
+  SphereSDF<float> sphere_sdf_;
+  BoxSDF<float> box_sdf_;
+  CapsuleSDF<float> capsule_sdf_;
+  PlaneSDF<float> plane_sdf_;
+  uint64_t content_hash_{0};
+  mutable std::mutex sample_mutex_;
+  mutable std::map<float, std::unique_ptr<const std::vector<Vector3<float>>>> sample_sets_;
+};
+
+uint64_t MeshContentHash(const Mesh<float> &mesh);
+
+// Contact points of a closed or open mesh whose cost follows spacing instead of the mesh resolution. The sharp
+// features come first: the open edges and those whose faces meet at more than sharp_angle radians, with the corners
+// where they end, branch or bend and points along them. A Poisson disk sampling of the faces follows. No point but
+// the corners is closer than spacing to any other. Vertices at equal positions are treated as one, so split render
+// meshes work as well.
+std::vector<Vector3<float>> SampleSurface(const Mesh<float> &mesh, float spacing, float sharp_angle = 0.5f);
+
+}  // namespace contradium
@@ -2,191 +2,927 @@
 
 namespace contradium {
 
+namespace {
+
+bool Overlap(const AABB &a, const AABB &b) {
+  return a.lower_bound[0] <= b.upper_bound[0] && b.lower_bound[0] <= a.upper_bound[0] &&
+         a.lower_bound[1] <= b.upper_bound[1] && b.lower_bound[1] <= a.upper_bound[1] &&
+         a.lower_bound[2] <= b.upper_bound[2] && b.lower_bound[2] <= a.upper_bound[2];
+}
+
+// Whether a ball of radius around point reaches into aabb.
+bool Reaches(const AABB &aabb, const Vector3<float> &point, float radius) {
+  if (radius == 0.0f) {
+    return aabb.Contain(point);
+  }
+  Vector3<float> nearest = point.cwiseMax(aabb.lower_bound).cwiseMin(aabb.upper_bound);
+  return (point - nearest).squaredNorm() <= radius * radius;
+}
+
+// An ordered pair (A, B) tests the points of B against the SDF of A. The points of a sphere, and capsule pairs solved
+// in closed form, are exact in one order already, the other one is skipped. A plane has no points. Two boxes test their
+// corners in both orders, and their edges against each other in the first one, see BoxEdgeContact.
+bool TestsPointsOf(CollisionShapeType type_a, CollisionShapeType type_b, int a, int b) {
+  if (type_b == COLLISION_SHAPE_TYPE_PLANE) {
+    return false;
+  }
+  if (type_a == COLLISION_SHAPE_TYPE_SPHERE) {
+    return type_b == COLLISION_SHAPE_TYPE_SPHERE && a < b;
+  }
+  if (type_a == COLLISION_SHAPE_TYPE_CAPSULE && type_b == COLLISION_SHAPE_TYPE_CAPSULE) {
+    return a < b;
+  }
+  return true;
+}
+
+// Closest points of the segments p0 p1 and q0 q1.
+void ClosestSegmentPoints(const Vector3<float> &p0,
+                          const Vector3<float> &p1,
+                          const Vector3<float> &q0,
+                          const Vector3<float> &q1,
+                          Vector3<float> *p,
+                          Vector3<float> *q) {
+  Vector3<float> d1 = p1 - p0;
+  Vector3<float> d2 = q1 - q0;
+  Vector3<float> r = p0 - q0;
+  float a = d1.squaredNorm();
+  float e = d2.squaredNorm();
+  float f = d2.dot(r);
+  float s = 0.0f;
+  float t = 0.0f;
+  if (a <= 1e-12f && e <= 1e-12f) {
+    // Both segments are points.
+  } else if (a <= 1e-12f) {
+    t = std::clamp(f / e, 0.0f, 1.0f);
+  } else {
+    float c = d1.dot(r);
+    if (e <= 1e-12f) {
+      s = std::clamp(-c / a, 0.0f, 1.0f);
+    } else {
+      float b = d1.dot(d2);
+      float denom = a * e - b * b;
+      if (denom > 0.0f) {
+        s = std::clamp((b * f - c * e) / denom, 0.0f, 1.0f);
+      }
+      t = (b * s + f) / e;
+      if (t < 0.0f) {
+        t = 0.0f;
+        s = std::clamp(-c / a, 0.0f, 1.0f);
+      } else if (t > 1.0f) {
+        t = 1.0f;
+        s = std::clamp((b - c) / a, 0.0f, 1.0f);
+      }
+    }
+  }
+  *p = p0 + s * d1;
+  *q = q0 + t * d2;
+}
+
+// Edge against edge contact of two boxes, found by the separating axis test. Crossed boxes can overlap with no corner
+// inside the other box, so the corner tests miss them. Returns false when the boxes are apart or a face axis overlaps
+// least, the corners against the faces hold the contact then. edge_pair tells the two edge directions apart, p_B is
+// the point of the edge of B inside A, n the normal from A to B and C the overlap along it.
+bool BoxEdgeContact(const Vector3<float> &t_A,
+                    const Matrix3<float> &R_A,
+                    const Vector3<float> &h_A,
+                    const Vector3<float> &t_B,
+                    const Matrix3<float> &R_B,
+                    const Vector3<float> &h_B,
+                    int *edge_pair,
+                    Vector3<float> *p_B,
+                    Vector3<float> *n,
+                    float *C) {
+  Vector3<float> d = t_B - t_A;
+  auto overlap = [&](const Vector3<float> &axis) {
+    return h_A.dot((R_A.transpose() * axis).cwiseAbs()) + h_B.dot((R_B.transpose() * axis).cwiseAbs()) -
+           std::abs(axis.dot(d));
+  };
+  float face_overlap = std::numeric_limits<float>::max();
+  for (int i = 0; i < 3; i++) {
+    face_overlap = std::min({face_overlap, overlap(R_A.col(i)), overlap(R_B.col(i))});
+  }
+  if (face_overlap < 0.0f) {
+    return false;
+  }
+  float edge_overlap = std::numeric_limits<float>::max();
+  int best = -1;
+  Vector3<float> best_axis;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      Vector3<float> axis = R_A.col(i).cross(R_B.col(j));
+      float length = axis.norm();
+      // Parallel edges, a face axis separates them as well.
+      if (length < 1e-4f) {
+        continue;
+      }
+      axis /= length;
+      float axis_overlap = overlap(axis);
+      if (axis_overlap < 0.0f) {
+        return false;
+      }
+      if (axis_overlap < edge_overlap) {
+        edge_overlap = axis_overlap;
+        best = i * 3 + j;
+        best_axis = axis;
+      }
+    }
+  }
+  // Faces win unless an edge pair overlaps clearly less, so boxes resting face on face keep their corner contacts.
+  if (best < 0 || edge_overlap >= 0.95f * face_overlap) {
+    return false;
+  }
+  Vector3<float> normal = best_axis.dot(d) < 0.0f ? Vector3<float>(-best_axis) : best_axis;
+  int i = best / 3;
+  int j = best % 3;
+  // The edge of A furthest along the normal and the edge of B furthest against it.
+  Vector3<float> center_A = t_A;
+  Vector3<float> center_B = t_B;
+  for (int k = 0; k < 3; k++) {
+    if (k != i) {
+      center_A += (normal.dot(R_A.col(k)) > 0.0f ? h_A[k] : -h_A[k]) * R_A.col(k);
+    }
+    if (k != j) {
+      center_B += (normal.dot(R_B.col(k)) < 0.0f ? h_B[k] : -h_B[k]) * R_B.col(k);
+    }
+  }
+  Vector3<float> p_A;
+  ClosestSegmentPoints(center_A - h_A[i] * R_A.col(i), center_A + h_A[i] * R_A.col(i), center_B - h_B[j] * R_B.col(j),
+                       center_B + h_B[j] * R_B.col(j), &p_A, p_B);
+  *edge_pair = best;
+  *n = normal;
+  *C = edge_overlap;
+  return true;
+}
+
+}  // namespace
+
+PBDSolver::PBDSolver(ThreadPool *thread_pool) : thread_pool_(thread_pool) {
+}
+
+std::shared_ptr<const CollisionShape> PBDSolver::GetShape(const Mesh<float> &mesh) {
+  uint64_t hash = MeshContentHash(mesh);
+  auto it = shape_cache_.find(hash);
+  if (it != shape_cache_.end()) {
+    std::shared_ptr<const CollisionShape> shape = it->second.lock();
+    if (shape && shape->HasMesh(mesh)) {
+      return shape;
+    }
+  }
+  auto shape = std::make_shared<const CollisionShape>(mesh);
+  // A live shape of another mesh with the same hash keeps its place, the new one is just not shared.
+  if (it == shape_cache_.end() || it->second.expired()) {
+    shape_cache_[hash] = shape;
+  }
+  return shape;
+}
+
 int PBDSolver::AddEntity(const Mesh<float> &mesh,
                          const Vector3<float> &x,
                          const Quaternion<float> &q,
                          float mass,
                          float inertia) {
-  RigidEntity entity;
-  entity.mesh = mesh;
-  entity.mesh_sdf = MeshSDF{VertexBufferView{mesh.Positions()}, mesh.NumVertices(), mesh.Indices(), mesh.NumIndices()};
-  entity.x_ = x;
-  entity.q_ = q;
-  entity.mass_ = mass;
-  entity.inertia_ = inertia;
-  if (entity.mass_) {
-    entity.inv_mass_ = 1.0f / entity.mass_;
-  } else {
-    entity.inv_mass_ = 0.0f;
-  }
+  return AddEntity(GetShape(mesh), x, q, mass, inertia);
+}
 
-  if (entity.inertia_) {
-    entity.inv_inertia_ = 1.0f / entity.inertia_;
-  } else {
-    entity.inv_inertia_ = 0.0f;
+int PBDSolver::AddEntity(std::shared_ptr<const CollisionShape> shape,
+                         const Vector3<float> &x,
+                         const Quaternion<float> &q,
+                         float mass,
+                         float inertia) {
+  int entity_index = shapes_.size();
+  int entity_id = entity_indices_.size();
+  points_.push_back(&shape->Points());
+  shapes_.push_back(std::move(shape));
+  mass_.push_back(0.0f);
+  inv_mass_.push_back(0.0f);
+  inertia_.push_back(0.0f);
+  inv_inertia_.push_back(0.0f);
+  x_.push_back(x);
+  q_.push_back(q);
+  v_.push_back(Vector3<float>{0.0f, 0.0f, 0.0f});
+  w_.push_back(Vector3<float>{0.0f, 0.0f, 0.0f});
+  sleeping_.push_back(false);
+  rest_steps_.push_back(0);
+  sleep_islands_.push_back(0);
+  entity_ids_.push_back(entity_id);
+  entity_indices_.push_back(entity_index);
+  SetMass(entity_id, mass);
+  SetInertia(entity_id, inertia);
+
+  sweep_order_.push_back(entity_index);
+  UpdateVertexOffsets();
+  return entity_id;
+}
+
+void PBDSolver::RemoveEntity(int rigid_entity_id) {
+  // Whatever rested on the body has to fall.
+  WakeEntity(rigid_entity_id);
+  int entity_index = EntityIndex(rigid_entity_id);
+  int last = shapes_.size() - 1;
+  auto move_last = [&](auto &values) {
+    values[entity_index] = std::move(values[last]);
+    values.pop_back();
+  };
+  move_last(shapes_);
+  move_last(points_);
+  move_last(mass_);
+  move_last(inv_mass_);
+  move_last(inertia_);
+  move_last(inv_inertia_);
+  move_last(x_);
+  move_last(q_);
+  move_last(v_);
+  move_last(w_);
+  move_last(sleeping_);
+  move_last(rest_steps_);
+  move_last(sleep_islands_);
+  move_last(entity_ids_);
+  if (entity_index != last) {
+    entity_indices_[entity_ids_[entity_index]] = entity_index;
   }
+  entity_indices_[rigid_entity_id] = -1;
+
+  sweep_order_.erase(std::find(sweep_order_.begin(), sweep_order_.end(), entity_index));
+  std::replace(sweep_order_.begin(), sweep_order_.end(), last, entity_index);
+  UpdateVertexOffsets();
+}
 
-  entity.v_ = Vector3<float>{0.0f, 0.0f, 0.0f};
-  entity.w_ = Vector3<float>{0.0f, 0.0f, 0.0f};
+int PBDSolver::NumEntities() const {
+  return shapes_.size();
+}
 
-  int entity_id = rigid_entity_id_counter_++;
-  rigid_entities_[entity_id] = entity;
-  return entity_id;
+int PBDSolver::EntityIndex(int rigid_entity_id) const {
+  int entity_index = entity_indices_.at(rigid_entity_id);
+  if (entity_index < 0) {
+    throw std::out_of_range("[PBDSolver] entity was removed");
+  }
+  return entity_index;
+}
+
+void PBDSolver::UpdateVertexOffsets() {
+  int num_entity = shapes_.size();
+  vertex_offsets_.resize(num_entity + 1);
+  vertex_offsets_[0] = 0;
+  for (int i = 0; i < num_entity; i++) {
+    vertex_offsets_[i + 1] = vertex_offsets_[i] + points_[i]->size();
+  }
+  r_.resize(vertex_offsets_.back());
+  x_new_.resize(num_entity);
+  q_new_.resize(num_entity);
+  delta_x_.resize(num_entity);
+  delta_theta_.resize(num_entity);
+  num_contacts_.resize(num_entity);
+  aabbs_.resize(num_entity);
+  // The vertices of every body moved in r_.
+  bounds_valid_.assign(num_entity, false);
+  island_parents_.resize(num_entity);
+  island_indices_.resize(num_entity);
 }
 
+// A static body wakes the sleepers at its old pose and again those at its new one.
 void PBDSolver::SetPosition(int rigid_entity_id, const Vector3<float> &x) {
-  rigid_entities_.at(rigid_entity_id).x_ = x;
+  WakeEntity(rigid_entity_id);
+  x_[EntityIndex(rigid_entity_id)] = x;
+  WakeEntity(rigid_entity_id);
 }
 
 void PBDSolver::SetOrientation(int rigid_entity_id, const Quaternion<float> &q) {
-  rigid_entities_.at(rigid_entity_id).q_ = q;
+  WakeEntity(rigid_entity_id);
+  q_[EntityIndex(rigid_entity_id)] = q;
+  WakeEntity(rigid_entity_id);
 }
 
 void PBDSolver::SetMass(int rigid_entity_id, float mass) {
-  rigid_entities_.at(rigid_entity_id).mass_ = mass;
+  WakeEntity(rigid_entity_id);
+  int entity_index = EntityIndex(rigid_entity_id);
+  mass_[entity_index] = mass;
   if (mass) {
-    rigid_entities_.at(rigid_entity_id).inv_mass_ = 1.0f / mass;
+    inv_mass_[entity_index] = 1.0f / mass;
   } else {
-    rigid_entities_.at(rigid_entity_id).inv_mass_ = 0.0f;
+    inv_mass_[entity_index] = 0.0f;
   }
 }
 
 void PBDSolver::SetInertia(int rigid_entity_id, float inertia) {
-  rigid_entities_.at(rigid_entity_id).inertia_ = inertia;
+  WakeEntity(rigid_entity_id);
+  int entity_index = EntityIndex(rigid_entity_id);
+  inertia_[entity_index] = inertia;
   if (inertia) {
-    rigid_entities_.at(rigid_entity_id).inv_inertia_ = 1.0f / inertia;
+    inv_inertia_[entity_index] = 1.0f / inertia;
   } else {
-    rigid_entities_.at(rigid_entity_id).inv_inertia_ = 0.0f;
+    inv_inertia_[entity_index] = 0.0f;
   }
 }
 
+void PBDSolver::SetSampleSpacing(int rigid_entity_id, float spacing) {
+  WakeEntity(rigid_entity_id);
+  int entity_index = EntityIndex(rigid_entity_id);
+  const CollisionShape &shape = *shapes_[entity_index];
+  points_[entity_index] = spacing > 0.0f ? &shape.SamplePoints(spacing) : &shape.Points();
+  UpdateVertexOffsets();
+  // Cached contacts of its old points would warm start the wrong ones.
+  contact_cache_.erase(std::remove_if(contact_cache_.begin(), contact_cache_.end(),
+                                      [rigid_entity_id](const CachedContact &cached) {
+                                        return cached.entity_b == rigid_entity_id;
+                                      }),
+                       contact_cache_.end());
+}
+
 void PBDSolver::SetVelocity(int rigid_entity_id, const Vector3<float> &v) {
-  rigid_entities_.at(rigid_entity_id).v_ = v;
+  WakeEntity(rigid_entity_id);
+  v_[EntityIndex(rigid_entity_id)] = v;
 }
 
 void PBDSolver::SetAngularVelocity(int rigid_entity_id, const Vector3<float> &w) {
-  rigid_entities_.at(rigid_entity_id).w_ = w;
+  WakeEntity(rigid_entity_id);
+  w_[EntityIndex(rigid_entity_id)] = w;
 }
 
-const PBDSolver::RigidEntity &PBDSolver::GetEntity(int rigid_entity_id) const {
-  return rigid_entities_.at(rigid_entity_id);
+const Vector3<float> &PBDSolver::GetPosition(int rigid_entity_id) const {
+  return x_[EntityIndex(rigid_entity_id)];
 }
 
-namespace {
-struct PBDStepHelper {
-  PBDSolver::RigidEntity &entity;
-  Vector3<float> x_new;
-  Quaternion<float> q_new;
-  Vector3<float> delta_x;
-  Vector3<float> delta_theta;
-  int num_contacts{0};
-
-  PBDStepHelper(PBDSolver::RigidEntity &e)
-      : entity(e), x_new(e.x_), q_new(e.q_), delta_x(Vector3<float>::Zero()), delta_theta(Vector3<float>::Zero()) {
-  }
-};
-}  // namespace
+const Quaternion<float> &PBDSolver::GetOrientation(int rigid_entity_id) const {
+  return q_[EntityIndex(rigid_entity_id)];
+}
+
+PBDSolver::RigidEntity PBDSolver::GetEntity(int rigid_entity_id) const {
+  int i = EntityIndex(rigid_entity_id);
+  return RigidEntity{shapes_[i], mass_[i], inv_mass_[i], inertia_[i], inv_inertia_[i], x_[i], q_[i], v_[i], w_[i]};
+}
+
+bool PBDSolver::IsSleeping(int rigid_entity_id) const {
+  return sleeping_[EntityIndex(rigid_entity_id)];
+}
+
+void PBDSolver::WakeEntity(int rigid_entity_id) {
+  int entity_index = EntityIndex(rigid_entity_id);
+  if (sleeping_[entity_index]) {
+    waking_islands_.push_back(sleep_islands_[entity_index]);
+  } else if (IsStatic(entity_index)) {
+    // A static body never sleeps and is never paired with sleeping ones, those resting on it are found by bounds.
+    AABB aabb = Bounds(entity_index, x_[entity_index], q_[entity_index]);
+    for (size_t i = 0; i < sleeping_.size(); i++) {
+      if (sleeping_[i] && Overlap(aabb, Bounds(i, x_[i], q_[i]))) {
+        waking_islands_.push_back(sleep_islands_[i]);
+      }
+    }
+  }
+  WakeIslands();
+}
+
+const PBDSettings &PBDSolver::GetSettings() const {
+  return settings_;
+}
+
+void PBDSolver::SetSettings(const PBDSettings &settings) {
+  settings_ = settings;
+  // Without sleeping nothing would wake the bodies that are asleep already.
+  if (settings_.sleep_linear_velocity <= 0.0f || settings_.sleep_angular_velocity <= 0.0f) {
+    for (size_t i = 0; i < sleeping_.size(); i++) {
+      if (sleeping_[i]) {
+        waking_islands_.push_back(sleep_islands_[i]);
+      }
+    }
+    WakeIslands();
+  }
+}
+
+const PBDStatistics &PBDSolver::GetStatistics() const {
+  return statistics_;
+}
+
+bool PBDSolver::CachedContact::operator<(const CachedContact &other) const {
+  return std::tie(entity_a, entity_b, vertex) < std::tie(other.entity_a, other.entity_b, other.vertex);
+}
+
+// Insertion sort of sweep_order_ by the lower x bounds, split into the moving bodies and the resting ones. The moving
+// bodies are swept against each other, and both lists are swept against each other in the order of their lower
+// bounds, so pairs of two resting bodies are never visited. Appends both orders (A, B) and (B, A) of every overlapping
+// pair and sorts them, the contacts of A against the vertices of B are reduced in that order.
+void PBDSolver::SweepAndPrune() {
+  for (size_t i = 1; i < sweep_order_.size(); i++) {
+    int index = sweep_order_[i];
+    float lower = aabbs_[index].lower_bound[0];
+    size_t j = i;
+    for (; j > 0 && aabbs_[sweep_order_[j - 1]].lower_bound[0] > lower; j--) {
+      sweep_order_[j] = sweep_order_[j - 1];
+    }
+    sweep_order_[j] = index;
+  }
+  moving_order_.clear();
+  resting_order_.clear();
+  for (int index : sweep_order_) {
+    (Moves(index) ? moving_order_ : resting_order_).push_back(index);
+  }
+  pairs_.clear();
+  auto add_pair = [&](int a, int b) {
+    if (Overlap(aabbs_[a], aabbs_[b])) {
+      pairs_.emplace_back(a, b);
+      pairs_.emplace_back(b, a);
+    }
+  };
+  for (size_t i = 0; i < moving_order_.size(); i++) {
+    const AABB &aabb = aabbs_[moving_order_[i]];
+    for (size_t j = i + 1; j < moving_order_.size() && aabbs_[moving_order_[j]].lower_bound[0] <= aabb.upper_bound[0];
+         j++) {
+      add_pair(moving_order_[i], moving_order_[j]);
+    }
+  }
+  // The body with the lower bound further left finds the other one.
+  size_t m = 0;
+  size_t r = 0;
+  while (m < moving_order_.size() && r < resting_order_.size()) {
+    bool moving_first = aabbs_[moving_order_[m]].lower_bound[0] <= aabbs_[resting_order_[r]].lower_bound[0];
+    const std::vector<int> &others = moving_first ? resting_order_ : moving_order_;
+    int index = moving_first ? moving_order_[m++] : resting_order_[r++];
+    float upper = aabbs_[index].upper_bound[0];
+    for (size_t k = moving_first ? r : m; k < others.size() && aabbs_[others[k]].lower_bound[0] <= upper; k++) {
+      add_pair(index, others[k]);
+    }
+  }
+  std::sort(pairs_.begin(), pairs_.end());
+}
+
+AABB PBDSolver::Bounds(int entity_index, const Vector3<float> &x, const Quaternion<float> &q, Vector3<float> *r) const {
+  if (r) {
+    const std::vector<Vector3<float>> &points = *points_[entity_index];
+    for (size_t k = 0; k < points.size(); k++) {
+      r[k] = q * points[k] + x;
+    }
+  }
+  const CollisionShape &shape = *shapes_[entity_index];
+  AABB aabb{};
+  if (shape.Type() == COLLISION_SHAPE_TYPE_PLANE) {
+    aabb.lower_bound = Vector3<float>::Constant(std::numeric_limits<float>::lowest());
+    aabb.upper_bound = Vector3<float>::Constant(std::numeric_limits<float>::max());
+    // The half space is bounded along its normal only, when that is an axis.
+    Vector3<float> normal = q * Vector3<float>::UnitY();
+    for (int axis = 0; axis < 3; axis++) {
+      if (normal[axis] > 1.0f - 1e-6f) {
+        aabb.upper_bound[axis] = x[axis];
+      } else if (normal[axis] < -1.0f + 1e-6f) {
+        aabb.lower_bound[axis] = x[axis];
+      }
+    }
+    return aabb;
+  }
+  // The box of the whole shape turned with the body, its points may be a sparse sample of the surface.
+  Vector3<float> center = q * shape.Bounds().Center() + x;
+  Vector3<float> half_extent = q.toRotationMatrix().cwiseAbs() * (0.5f * shape.Bounds().Size()) +
+                               Vector3<float>::Constant(shape.Radius());
+  aabb.lower_bound = center - half_extent;
+  aabb.upper_bound = center + half_extent;
+  return aabb;
+}
+
+bool PBDSolver::IsStatic(int entity_index) const {
+  return inv_mass_[entity_index] == 0.0f && inv_inertia_[entity_index] == 0.0f;
+}
+
+bool PBDSolver::ReceivesCorrections(int entity_index) const {
+  return !sleeping_[entity_index] && !IsStatic(entity_index);
+}
+
+bool PBDSolver::Moves(int entity_index) const {
+  if (sleeping_[entity_index]) {
+    return false;
+  }
+  return !IsStatic(entity_index) || (v_[entity_index].array() != 0.0f).any() ||
+         (w_[entity_index].array() != 0.0f).any();
+}
+
+int PBDSolver::FindIsland(int entity_index) {
+  while (island_parents_[entity_index] != entity_index) {
+    island_parents_[entity_index] = island_parents_[island_parents_[entity_index]];
+    entity_index = island_parents_[entity_index];
+  }
+  return entity_index;
+}
+
+void PBDSolver::UniteIslands(int entity_a, int entity_b) {
+  entity_a = FindIsland(entity_a);
+  entity_b = FindIsland(entity_b);
+  if (entity_a != entity_b) {
+    island_parents_[std::max(entity_a, entity_b)] = std::min(entity_a, entity_b);
+  }
+}
+
+// Bodies that receive corrections are joined by the pairs between them, and every pair goes to the island of a body
+// it corrects. A counting sort keeps the pairs of an island in their order.
+void PBDSolver::GroupPairsByIsland() {
+  int num_entity = shapes_.size();
+  for (int i = 0; i < num_entity; i++) {
+    island_parents_[i] = i;
+    island_indices_[i] = -1;
+  }
+  for (const auto &pair : pairs_) {
+    if (ReceivesCorrections(pair.first) && ReceivesCorrections(pair.second)) {
+      UniteIslands(pair.first, pair.second);
+    }
+  }
+  island_offsets_.assign(1, 0);
+  pair_islands_.resize(pairs_.size());
+  for (size_t pair_index = 0; pair_index < pairs_.size(); pair_index++) {
+    int a = pairs_[pair_index].first;
+    int b = pairs_[pair_index].second;
+    int island = -1;
+    if (ReceivesCorrections(a) || ReceivesCorrections(b)) {
+      int root = FindIsland(ReceivesCorrections(a) ? a : b);
+      if (island_indices_[root] < 0) {
+        island_indices_[root] = island_offsets_.size() - 1;
+        island_offsets_.push_back(0);
+      }
+      island = island_indices_[root];
+      island_offsets_[island + 1]++;
+    }
+    pair_islands_[pair_index] = island;
+  }
+  int num_islands = island_offsets_.size() - 1;
+  for (int island = 0; island < num_islands; island++) {
+    island_offsets_[island + 1] += island_offsets_[island];
+  }
+  island_pairs_.resize(island_offsets_.back());
+  for (size_t pair_index = 0; pair_index < pairs_.size(); pair_index++) {
+    if (pair_islands_[pair_index] >= 0) {
+      island_pairs_[island_offsets_[pair_islands_[pair_index]]++] = pair_index;
+    }
+  }
+  for (int island = num_islands; island > 0; island--) {
+    island_offsets_[island] = island_offsets_[island - 1];
+  }
+  island_offsets_[0] = 0;
+  island_residuals_.resize(num_islands);
+}
+
+void PBDSolver::WakeIslands() {
+  std::sort(waking_islands_.begin(), waking_islands_.end());
+  waking_islands_.erase(std::unique(waking_islands_.begin(), waking_islands_.end()), waking_islands_.end());
+  if (waking_islands_.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < sleeping_.size(); i++) {
+    if (sleeping_[i] && std::binary_search(waking_islands_.begin(), waking_islands_.end(), sleep_islands_[i])) {
+      sleeping_[i] = false;
+      rest_steps_[i] = 0;
+    }
+  }
+  waking_islands_.clear();
+}
+
+// Islands of the bodies that receive corrections, joined by the contacts of the step. An island falls asleep once
+// every body in it stayed below both velocity thresholds for settings_.sleep_steps steps in a row.
+void PBDSolver::UpdateSleep() {
+  WakeIslands();
+  int num_entity = shapes_.size();
+  for (int i = 0; i < num_entity; i++) {
+    island_parents_[i] = i;
+    island_indices_[i] = std::numeric_limits<int>::max();
+  }
+  for (const CachedContact &contact : step_contacts_) {
+    if (contact.active && ReceivesCorrections(contact.entity_a) && ReceivesCorrections(contact.entity_b)) {
+      UniteIslands(contact.entity_a, contact.entity_b);
+    }
+  }
+  bool sleep = settings_.sleep_linear_velocity > 0.0f && settings_.sleep_angular_velocity > 0.0f;
+  for (int i = 0; i < num_entity; i++) {
+    if (!ReceivesCorrections(i)) {
+      continue;
+    }
+    int root = FindIsland(i);
+    if (root == i) {
+      statistics_.islands++;
+    }
+    if (sleep) {
+      bool at_rest = v_[i].norm() < settings_.sleep_linear_velocity && w_[i].norm() < settings_.sleep_angular_velocity;
+      rest_steps_[i] = at_rest ? rest_steps_[i] + 1 : 0;
+      // Fewest rest steps of the island, kept at its root.
+      island_indices_[root] = std::min(island_indices_[root], rest_steps_[i]);
+    }
+  }
+  if (sleep) {
+    bool fell_asleep = false;
+    for (int i = 0; i < num_entity; i++) {
+      if (ReceivesCorrections(i) && island_indices_[FindIsland(i)] >= settings_.sleep_steps) {
+        sleeping_[i] = true;
+        sleep_islands_[i] = next_sleep_island_ + FindIsland(i);
+        v_[i] = Vector3<float>::Zero();
+        w_[i] = Vector3<float>::Zero();
+        bounds_valid_[i] = false;
+        fell_asleep = true;
+      }
+    }
+    if (fell_asleep) {
+      next_sleep_island_ += num_entity;
+    }
+  }
+  for (int i = 0; i < num_entity; i++) {
+    statistics_.sleeping_entities += sleeping_[i];
+  }
+}
+
+void PBDSolver::WarmStart() {
+  int num_entity = shapes_.size();
+  float warm_start = settings_.warm_start;
+  for (int i = 0; i < num_entity; i++) {
+    delta_x_[i] = Vector3<float>::Zero();
+    delta_theta_[i] = Vector3<float>::Zero();
+  }
+  for (const CachedContact &cached : contact_cache_) {
+    int a = entity_indices_[cached.entity_a];
+    int b = entity_indices_[cached.entity_b];
+    if (a < 0 || b < 0) {
+      continue;
+    }
+    CachedContact contact{a,
+                          b,
+                          cached.vertex,
+                          false,
+                          warm_start * cached.delta_x_A,
+                          warm_start * cached.delta_theta_A,
+                          warm_start * cached.delta_x_B,
+                          warm_start * cached.delta_theta_B};
+    delta_x_[a] += contact.delta_x_A;
+    delta_theta_[a] += contact.delta_theta_A;
+    delta_x_[b] += contact.delta_x_B;
+    delta_theta_[b] += contact.delta_theta_B;
+    step_contacts_.push_back(contact);
+  }
+  std::sort(step_contacts_.begin(), step_contacts_.end());
+
+  for (int i = 0; i < num_entity; i++) {
+    if (!ReceivesCorrections(i)) {
+      continue;
+    }
+    x_new_[i] += delta_x_[i];
+    if (delta_theta_[i].norm() > 1e-6f) {
+      Eigen::AngleAxis<float> angle_axis(delta_theta_[i].norm(), delta_theta_[i].normalized());
+      Quaternion<float> delta_q{angle_axis};
+      q_new_[i] = (delta_q * q_new_[i]).normalized();
+    }
+  }
+}
+
+// The contacts of the pairs come in the order of step_contacts_ already, so this is a linear merge. Every contact of
+// the iteration gets its share of the averaged corrections its bodies received, if they received any.
+void PBDSolver::AccumulateContacts(bool applied) {
+  merged_contacts_.clear();
+  size_t cached_index = 0;
+  for (size_t pair_index = 0; pair_index < pairs_.size(); pair_index++) {
+    int a = pairs_[pair_index].first;
+    int b = pairs_[pair_index].second;
+    for (const Contact &contact : pair_contacts_[pair_index]) {
+      CachedContact key{a, b, contact.vertex};
+      for (; cached_index < step_contacts_.size() && step_contacts_[cached_index] < key; cached_index++) {
+        merged_contacts_.push_back(step_contacts_[cached_index]);
+      }
+      if (cached_index < step_contacts_.size() && !(key < step_contacts_[cached_index])) {
+        merged_contacts_.push_back(step_contacts_[cached_index++]);
+      } else {
+        merged_contacts_.push_back(key);
+      }
+      CachedContact &merged = merged_contacts_.back();
+      merged.active = true;
+      if (applied && num_contacts_[a] > 0) {
+        merged.delta_x_A += contact.delta_x_A / num_contacts_[a];
+        merged.delta_theta_A += contact.delta_theta_A / num_contacts_[a];
+      }
+      if (applied && num_contacts_[b] > 0) {
+        merged.delta_x_B += contact.delta_x_B / num_contacts_[b];
+        merged.delta_theta_B += contact.delta_theta_B / num_contacts_[b];
+      }
+    }
+  }
+  merged_contacts_.insert(merged_contacts_.end(), step_contacts_.begin() + cached_index, step_contacts_.end());
+  std::swap(step_contacts_, merged_contacts_);
+}
 
 void PBDSolver::Step(float dt) {
   Vector3<float> gravity{0.0f, -9.81f, 0.0f};
+  int num_entity = shapes_.size();
 
-  std::vector<PBDStepHelper> step_helper_;
-
-  for (auto &[id, entity] : rigid_entities_) {
-    if (entity.mass_) {
+  for (int i = 0; i < num_entity; i++) {
+    if (sleeping_[i]) {
+      x_new_[i] = x_[i];
+      q_new_[i] = q_[i];
+      continue;
+    }
+    if (mass_[i]) {
       // Semi-implicit Euler integration
-      entity.v_ += dt * gravity;
+      v_[i] += dt * gravity;
     }
 
-    step_helper_.emplace_back(entity);
-    auto &helper = step_helper_.back();
-
-    helper.x_new = entity.x_ + dt * entity.v_;
+    x_new_[i] = x_[i] + dt * v_[i];
+    q_new_[i] = q_[i];
 
-    if (entity.w_.norm() > 1e-6f) {
-      Eigen::AngleAxis<float> angle_axis(dt * entity.w_.norm(), entity.w_.normalized());
+    if (w_[i].norm() > 1e-6f) {
+      Eigen::AngleAxis<float> angle_axis(dt * w_[i].norm(), w_[i].normalized());
       Quaternion<float> delta_q{angle_axis};
-      helper.q_new = (delta_q * entity.q_).normalized();
+      q_new_[i] = (delta_q * q_[i]).normalized();
     }
   }
 
-  for (int step = 0; step < 20; step++) {
-    for (auto &helper : step_helper_) {
-      helper.delta_x = Vector3<float>::Zero();
-      helper.delta_theta = Vector3<float>::Zero();
-      helper.num_contacts = 0;
+  step_contacts_.clear();
+  if (settings_.warm_start > 0.0f) {
+    WarmStart();
+  }
+
+  statistics_ = PBDStatistics{};
+  for (int iteration = 0; iteration < settings_.max_iterations; iteration++) {
+    ParallelForEach(thread_pool_, num_entity, 1, [&](int i) {
+      delta_x_[i] = Vector3<float>::Zero();
+      delta_theta_[i] = Vector3<float>::Zero();
+      num_contacts_[i] = 0;
+      // A sleeping body keeps the vertices and bounds it was last given.
+      if (sleeping_[i] && bounds_valid_[i]) {
+        return;
+      }
+      bounds_valid_[i] = sleeping_[i];
+      aabbs_[i] = Bounds(i, x_new_[i], q_new_[i], r_.data() + vertex_offsets_[i]);
+    });
+
+    SweepAndPrune();
+    // Nothing touches, and nothing will in the iterations left.
+    if (pairs_.empty()) {
+      statistics_.iterations = iteration + 1;
+      AccumulateContacts(false);
+      break;
+    }
+    if (pair_contacts_.size() < pairs_.size()) {
+      pair_contacts_.resize(pairs_.size());
     }
 
-    for (int i = 0; i < step_helper_.size(); i++) {
-      MeshSDFRef mesh_sdf = step_helper_[i].entity.mesh_sdf;
-      Matrix<float, 3, 3> R = step_helper_[i].q_new.toRotationMatrix();
-      Vector3<float> t = step_helper_[i].x_new;
-      AABB aabb_A;
-      for (int k = 0; k < step_helper_[i].entity.mesh.NumVertices(); k++) {
-        Vector3<float> p_A = step_helper_[i].entity.mesh.Positions()[k];
-        Vector3<float> r_A = step_helper_[i].q_new * p_A + step_helper_[i].x_new;
-        aabb_A.Expand(r_A);
+    ParallelForEach(thread_pool_, pairs_.size(), 1, [&](int pair_index) {
+      int a = pairs_[pair_index].first;
+      int b = pairs_[pair_index].second;
+      std::vector<Contact> &contacts = pair_contacts_[pair_index];
+      contacts.clear();
+      const CollisionShape &shape_a = *shapes_[a];
+      const CollisionShape &shape_b = *shapes_[b];
+      if (!TestsPointsOf(shape_a.Type(), shape_b.Type(), a, b)) {
+        return;
       }
+      // r_B is the deepest point of B and n the outward normal of A, B reaches C into A along it.
+      auto add_contact = [&](int vertex, const Vector3<float> &r_B, const Vector3<float> &n, float C) {
+        Vector3<float> r_A = r_B + C * n;
+        Vector3<float> grad_theta_A = (r_A - x_new_[a]).cross(n);
+        Vector3<float> grad_theta_B = (r_B - x_new_[b]).cross(-n);
+        float denom = n.dot(inv_mass_[a] * n) + n.dot(inv_mass_[b] * n) +
+                      grad_theta_A.dot(inv_inertia_[a] * grad_theta_A) +
+                      grad_theta_B.dot(inv_inertia_[b] * grad_theta_B);
+        float coeff = -C / denom;
+        contacts.push_back(Contact{vertex, C, coeff * inv_mass_[a] * n, coeff * inv_inertia_[a] * grad_theta_A,
+                                   coeff * inv_mass_[b] * -n, coeff * inv_inertia_[b] * grad_theta_B});
+      };
 
-      auto &helper_A = step_helper_[i];
-      for (int j = 0; j < step_helper_.size(); j++) {
-        if (j == i) {
-          continue;
+      if (shape_a.Type() == COLLISION_SHAPE_TYPE_CAPSULE && shape_b.Type() == COLLISION_SHAPE_TYPE_CAPSULE) {
+        Vector3<float> p_A;
+        Vector3<float> p_B;
+        ClosestSegmentPoints(r_[vertex_offsets_[a]], r_[vertex_offsets_[a] + 1], r_[vertex_offsets_[b]],
+                             r_[vertex_offsets_[b] + 1], &p_A, &p_B);
+        float distance = (p_B - p_A).norm();
+        float C = shape_a.Radius() + shape_b.Radius() - distance;
+        if (C > 0.0f) {
+          Vector3<float> n = distance > 0.0f ? Vector3<float>((p_B - p_A) / distance) : Vector3<float>::UnitY();
+          add_contact(0, p_B - shape_b.Radius() * n, n, C);
         }
+        return;
+      }
 
-        auto &helper_B = step_helper_[j];
+      // Every point of B, with the ball around it, against the SDF of A.
+      Matrix<float, 3, 3> R = q_new_[a].toRotationMatrix();
+      Vector3<float> t = x_new_[a];
+      float radius = shape_b.Radius();
+      auto test_point = [&](int vertex, const Vector3<float> &point) {
+        if (!Reaches(aabbs_[a], point, radius)) {
+          return;
+        }
+        float sdf;
+        Vector3<float> n;
+        shape_a.SDF(point, R, t, &sdf, &n);
+        float C = radius - sdf;
+        if (C > 0.0f) {
+          add_contact(vertex, point - radius * n, n, C);
+        }
+      };
+      for (int k = vertex_offsets_[b]; k < vertex_offsets_[b + 1]; k++) {
+        test_point(k - vertex_offsets_[b], r_[k]);
+      }
+      // The ends of a capsule miss a box or mesh across its middle, the axis in between is sampled at most a radius
+      // apart. Its samples follow the two ends, so the vertices of the pair stay in order.
+      if (shape_b.Type() == COLLISION_SHAPE_TYPE_CAPSULE && shape_a.Type() != COLLISION_SHAPE_TYPE_PLANE &&
+          radius > 0.0f) {
+        const Vector3<float> &p0 = r_[vertex_offsets_[b]];
+        const Vector3<float> &p1 = r_[vertex_offsets_[b] + 1];
+        int num_segments = std::max(1, static_cast<int>(std::ceil((p1 - p0).norm() / radius)));
+        for (int s = 1; s < num_segments; s++) {
+          test_point(1 + s, p0 + (p1 - p0) * (static_cast<float>(s) / num_segments));
+        }
+      }
+      // Crossed boxes meet edge to edge, the deepest edge pair follows the eight corners. It is found once per pair.
+      if (shape_a.Type() == COLLISION_SHAPE_TYPE_BOX && shape_b.Type() == COLLISION_SHAPE_TYPE_BOX && a < b) {
+        int edge_pair;
+        Vector3<float> p_B;
+        Vector3<float> n;
+        float C;
+        if (BoxEdgeContact(t, R, shape_a.Bounds().upper_bound, x_new_[b], q_new_[b].toRotationMatrix(),
+                           shape_b.Bounds().upper_bound, &edge_pair, &p_B, &n, &C)) {
+          add_contact(8 + edge_pair, p_B, n, C);
+        }
+      }
+    });
 
-        for (int k = 0; k < helper_B.entity.mesh.NumVertices(); k++) {
-          Vector3<float> p_B = helper_B.entity.mesh.Positions()[k];
-          Vector3<float> r_B = helper_B.q_new * p_B + helper_B.x_new;
-          if (!aabb_A.Contain(r_B)) {
-            continue;
+    // Every body is corrected by the pairs of its island only, summed in the order of the pairs and their vertices.
+    GroupPairsByIsland();
+    int num_islands = island_offsets_.size() - 1;
+    ParallelForEach(thread_pool_, num_islands, 1, [&](int island) {
+      float island_residual = 0.0f;
+      for (int k = island_offsets_[island]; k < island_offsets_[island + 1]; k++) {
+        int pair_index = island_pairs_[k];
+        int a = pairs_[pair_index].first;
+        int b = pairs_[pair_index].second;
+        bool receives_a = ReceivesCorrections(a);
+        bool receives_b = ReceivesCorrections(b);
+        for (const Contact &contact : pair_contacts_[pair_index]) {
+          island_residual = std::max(island_residual, contact.penetration);
+          if (receives_a) {
+            num_contacts_[a]++;
+            delta_x_[a] += contact.delta_x_A;
+            delta_theta_[a] += contact.delta_theta_A;
           }
-          float sdf;
-          Vector3<float> jacobian;
-          mesh_sdf.SDF(r_B, R, t, &sdf, &jacobian, nullptr);
-          if (sdf < 0.0f) {
-            Vector3<float> r_A = r_B - sdf * jacobian;
-            float C = -sdf;
-            const Vector3<float> &n = jacobian;
-            Vector3<float> grad_theta_A = (r_A - helper_A.x_new).cross(n);
-            Vector3<float> grad_theta_B = (r_B - helper_B.x_new).cross(-n);
-            float denom = n.dot(helper_A.entity.inv_mass_ * n) + n.dot(helper_B.entity.inv_mass_ * n) +
-                          grad_theta_A.dot(helper_A.entity.inv_inertia_ * grad_theta_A) +
-                          grad_theta_B.dot(helper_B.entity.inv_inertia_ * grad_theta_B);
-            float coeff = -C / denom;
-            helper_A.num_contacts++;
-            helper_B.num_contacts++;
-            helper_A.delta_x += coeff * helper_A.entity.inv_mass_ * n;
-            helper_A.delta_theta += coeff * helper_A.entity.inv_inertia_ * grad_theta_A;
-            helper_B.delta_x += coeff * helper_B.entity.inv_mass_ * -n;
-            helper_B.delta_theta += coeff * helper_B.entity.inv_inertia_ * grad_theta_B;
+          if (receives_b) {
+            num_contacts_[b]++;
+            delta_x_[b] += contact.delta_x_B;
+            delta_theta_[b] += contact.delta_theta_B;
           }
         }
       }
+      island_residuals_[island] = island_residual;
+    });
+    float residual = 0.0f;
+    for (int island = 0; island < num_islands; island++) {
+      residual = std::max(residual, island_residuals_[island]);
+    }
+    // Sleeping bodies stay put for the rest of the step, their islands wake up at its end.
+    for (size_t pair_index = 0; pair_index < pairs_.size(); pair_index++) {
+      if (pair_contacts_[pair_index].empty()) {
+        continue;
+      }
+      for (int i : {pairs_[pair_index].first, pairs_[pair_index].second}) {
+        if (sleeping_[i]) {
+          waking_islands_.push_back(sleep_islands_[i]);
+        }
+      }
+    }
+    statistics_.iterations = iteration + 1;
+    statistics_.residual = residual;
+    if (residual < settings_.tolerance) {
+      AccumulateContacts(false);
+      break;
     }
+    AccumulateContacts(true);
 
-    for (auto &helper : step_helper_) {
-      if (helper.num_contacts > 0) {
-        helper.x_new += helper.delta_x / helper.num_contacts;
-        if (helper.delta_theta.norm() > 1e-6f) {
-          Eigen::AngleAxis<float> angle_axis(helper.delta_theta.norm() / helper.num_contacts,
-                                             helper.delta_theta.normalized());
+    ParallelForEach(thread_pool_, num_entity, 64, [&](int i) {
+      if (num_contacts_[i] > 0) {
+        x_new_[i] += delta_x_[i] / num_contacts_[i];
+        if (delta_theta_[i].norm() > 1e-6f) {
+          Eigen::AngleAxis<float> angle_axis(delta_theta_[i].norm() / num_contacts_[i], delta_theta_[i].normalized());
           Quaternion<float> delta_q{angle_axis};
-          helper.q_new = (delta_q * helper.q_new).normalized();
+          q_new_[i] = (delta_q * q_new_[i]).normalized();
         }
       }
+    });
+  }
+
+  // The contacts found during the step, with their bodies as ids, are the cache of the next step.
+  merged_contacts_.clear();
+  for (CachedContact contact : step_contacts_) {
+    if (contact.active) {
+      contact.entity_a = entity_ids_[contact.entity_a];
+      contact.entity_b = entity_ids_[contact.entity_b];
+      statistics_.contacts++;
+      if (std::binary_search(contact_cache_.begin(), contact_cache_.end(), contact)) {
+        statistics_.persistent_contacts++;
+      }
+      merged_contacts_.push_back(contact);
     }
   }
+  std::sort(merged_contacts_.begin(), merged_contacts_.end());
+  std::swap(contact_cache_, merged_contacts_);
 
-  for (auto &helper : step_helper_) {
-    helper.entity.v_ = (helper.x_new - helper.entity.x_) / dt;
-    auto delta_q = helper.q_new * helper.entity.q_.conjugate();
+  for (int i = 0; i < num_entity; i++) {
+    if (sleeping_[i]) {
+      continue;
+    }
+    v_[i] = (x_new_[i] - x_[i]) / dt;
+    auto delta_q = q_new_[i] * q_[i].conjugate();
     Eigen::AngleAxis<float> angle_axis(delta_q);
-    helper.entity.w_ = angle_axis.axis() * angle_axis.angle() / dt;
-    helper.entity.x_ = helper.x_new;
-    helper.entity.q_ = helper.q_new;
+    w_[i] = angle_axis.axis() * angle_axis.angle() / dt;
+    x_[i] = x_new_[i];
+    q_[i] = q_new_[i];
   }
+
+  UpdateSleep();
 }
 
 }  // namespace contradium
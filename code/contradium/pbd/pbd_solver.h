@@ -1,13 +1,17 @@
 #pragma once
+#include "contradium/pbd/pbd_collision_shape.h"
 #include "contradium/pbd/pbd_util.h"
 
 namespace contradium {
 
 class PBDSolver {
  public:
+  // thread_pool may be null to run single threaded, the result is the same either way.
+  explicit PBDSolver(ThreadPool *thread_pool = nullptr);
+
+  // Copy of the state of one body.
   struct RigidEntity {
-    Mesh<float> mesh;
-    MeshSDF mesh_sdf;
+    std::shared_ptr<const CollisionShape> shape;
     float mass_;
     float inv_mass_;
     float inertia_;
@@ -18,11 +22,22 @@ class PBDSolver {
     Vector3<float> w_;
   };
 
+  // The shape of mesh, built on first use and shared by every body added with an equal mesh while any of them is left.
+  std::shared_ptr<const CollisionShape> GetShape(const Mesh<float> &mesh);
+
   int AddEntity(const Mesh<float> &mesh,
                 const Vector3<float> &x = {0.0f, 0.0f, 0.0f},
                 const Quaternion<float> &q = {1.0f, 0.0f, 0.0f, 0.0f},
                 float mass = 1.0f,
                 float inertia = 1.0f);
+  int AddEntity(std::shared_ptr<const CollisionShape> shape,
+                const Vector3<float> &x = {0.0f, 0.0f, 0.0f},
+                const Quaternion<float> &q = {1.0f, 0.0f, 0.0f, 0.0f},
+                float mass = 1.0f,
+                float inertia = 1.0f);
+  // Ids of the other bodies stay valid, the last body takes the storage slot of the removed one.
+  void RemoveEntity(int rigid_entity_id);
+  int NumEntities() const;
 
   void SetPosition(int rigid_entity_id, const Vector3<float> &x);
   void SetOrientation(int rigid_entity_id, const Quaternion<float> &q);
@@ -30,12 +45,146 @@ class PBDSolver {
   void SetInertia(int rigid_entity_id, float inertia);
   void SetVelocity(int rigid_entity_id, const Vector3<float> &v);
   void SetAngularVelocity(int rigid_entity_id, const Vector3<float> &w);
-  const RigidEntity &GetEntity(int rigid_entity_id) const;
+  // Tests the surface samples of the shape at spacing against other bodies instead of all its points, 0 goes back to
+  // all points. The broad phase still bounds the whole shape. See CollisionShape::SamplePoints.
+  void SetSampleSpacing(int rigid_entity_id, float spacing);
+  const Vector3<float> &GetPosition(int rigid_entity_id) const;
+  const Quaternion<float> &GetOrientation(int rigid_entity_id) const;
+  RigidEntity GetEntity(int rigid_entity_id) const;
+
+  // A sleeping body is neither integrated nor tested against other sleeping or static bodies. Its island wakes up
+  // when a moving body touches it, and setting the state of any of its bodies wakes it right away. So does setting the
+  // state of a static body it overlaps before or after the change, or removing that body.
+  bool IsSleeping(int rigid_entity_id) const;
+  void WakeEntity(int rigid_entity_id);
+
+  const PBDSettings &GetSettings() const;
+  // Turning sleeping off wakes every sleeping body.
+  void SetSettings(const PBDSettings &settings);
+
+  // Iterations, residual and contacts of the last Step.
+  const PBDStatistics &GetStatistics() const;
+
+  // Every iteration bounds the entities once, pairs them by sweep and prune, and generates the contacts of the
+  // overlapping pairs in parallel. Bodies that do not move are not swept against each other, and the step ends at the
+  // first iteration without pairs. The corrections are then summed pair by pair in storage order, so a step does not
+  // depend on the thread count. The sums run in parallel over islands, the bodies joined by the pairs. All buffers of
+  // the step persist between steps and only grow with the scene. See PBDSettings for early termination, warm starting
+  // and sleeping, all off by default.
   void Step(float dt);
 
  private:
-  std::map<int, RigidEntity> rigid_entities_;
-  int rigid_entity_id_counter_{0};
+  // Corrections of one vertex of B inside A.
+  struct Contact {
+    int vertex;
+    float penetration;
+    Vector3<float> delta_x_A;
+    Vector3<float> delta_theta_A;
+    Vector3<float> delta_x_B;
+    Vector3<float> delta_theta_B;
+  };
+
+  // Corrections one contact received over a step, as far as they were applied after averaging. Bodies are storage
+  // indices during a step and ids in the cache between steps. Warm started contacts stay inactive until found again.
+  struct CachedContact {
+    int entity_a;
+    int entity_b;
+    int vertex;
+    bool active{false};
+    Vector3<float> delta_x_A{Vector3<float>::Zero()};
+    Vector3<float> delta_theta_A{Vector3<float>::Zero()};
+    Vector3<float> delta_x_B{Vector3<float>::Zero()};
+    Vector3<float> delta_theta_B{Vector3<float>::Zero()};
+
+    bool operator<(const CachedContact &other) const;
+  };
+
+  // Storage index of a live id, throws std::out_of_range otherwise.
+  int EntityIndex(int rigid_entity_id) const;
+  // Offsets of the points of every body in r_, after adding or removing bodies or changing their points.
+  void UpdateVertexOffsets();
+  // Bounds of the shape of a body at x and q. The points it is tested with are stored in r unless it is null.
+  AABB Bounds(int entity_index, const Vector3<float> &x, const Quaternion<float> &q, Vector3<float> *r = nullptr) const;
+  // Neither sleeping nor static at rest, pairs without a moving body are skipped.
+  bool Moves(int entity_index) const;
+  bool IsStatic(int entity_index) const;
+  bool ReceivesCorrections(int entity_index) const;
+  void SweepAndPrune();
+  // Union-find over island_parents_, the root is the smallest storage index of the island.
+  int FindIsland(int entity_index);
+  void UniteIslands(int entity_a, int entity_b);
+  // Fills island_offsets_ and island_pairs_ from pairs_.
+  void GroupPairsByIsland();
+  // Wakes every body of the sleeping islands in waking_islands_.
+  void WakeIslands();
+  void UpdateSleep();
+  // Applies the cached corrections of the last step scaled by settings_.warm_start and seeds step_contacts_ with them.
+  void WarmStart();
+  // Merges the contacts of an iteration into step_contacts_, with their corrections if they were applied.
+  void AccumulateContacts(bool applied);
+
+  ThreadPool *thread_pool_;
+  PBDSettings settings_;
+  PBDStatistics statistics_;
+
+  // Body state, one element per body in storage order.
+  std::vector<std::shared_ptr<const CollisionShape>> shapes_;
+  // Points of the shape the body is tested with, owned by the shape.
+  std::vector<const std::vector<Vector3<float>> *> points_;
+  std::vector<float> mass_;
+  std::vector<float> inv_mass_;
+  std::vector<float> inertia_;
+  std::vector<float> inv_inertia_;
+  std::vector<Vector3<float>> x_;
+  std::vector<Quaternion<float>> q_;
+  std::vector<Vector3<float>> v_;
+  std::vector<Vector3<float>> w_;
+  std::vector<char> sleeping_;
+  // Steps in a row the body stayed below the sleep thresholds.
+  std::vector<int> rest_steps_;
+  // Label of the island a sleeping body fell asleep with.
+  std::vector<int64_t> sleep_islands_;
+  std::vector<int> entity_ids_;
+  // Storage index of every id ever handed out, -1 once removed.
+  std::vector<int> entity_indices_;
+
+  // Equal meshes share one shape, looked up by content hash.
+  std::unordered_map<uint64_t, std::weak_ptr<const CollisionShape>> shape_cache_;
+
+  // State of the step.
+  std::vector<Vector3<float>> x_new_;
+  std::vector<Quaternion<float>> q_new_;
+  std::vector<Vector3<float>> delta_x_;
+  std::vector<Vector3<float>> delta_theta_;
+  std::vector<int> num_contacts_;
+  std::vector<AABB> aabbs_;
+  // Points of all bodies at x_new_ and q_new_, those of body i start at vertex_offsets_[i].
+  std::vector<Vector3<float>> r_;
+  std::vector<int> vertex_offsets_;
+  // Storage indices sorted by the lower x bound of the last iteration. Kept across steps, so sorting the next bounds
+  // is close to linear while the bodies move little.
+  std::vector<int> sweep_order_;
+  // sweep_order_ split by Moves, both still sorted.
+  std::vector<int> moving_order_;
+  std::vector<int> resting_order_;
+  std::vector<std::pair<int, int>> pairs_;
+  std::vector<std::vector<Contact>> pair_contacts_;
+  // Sorted by bodies and vertex, step_contacts_ with storage indices and contact_cache_ with ids.
+  std::vector<CachedContact> step_contacts_;
+  std::vector<CachedContact> merged_contacts_;
+  std::vector<CachedContact> contact_cache_;
+  // Set once the points of a sleeping body are in r_.
+  std::vector<char> bounds_valid_;
+  std::vector<int> island_parents_;
+  std::vector<int> island_indices_;
+  // Pairs of island i are island_pairs_[island_offsets_[i]] up to island_offsets_[i + 1], -1 in pair_islands_ for
+  // pairs that correct no body.
+  std::vector<int> pair_islands_;
+  std::vector<int> island_offsets_;
+  std::vector<int> island_pairs_;
+  std::vector<float> island_residuals_;
+  std::vector<int64_t> waking_islands_;
+  int64_t next_sleep_island_{0};
 };
 
 }  // namespace contradium
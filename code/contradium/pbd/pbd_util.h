@@ -1,4 +1,30 @@
 #pragma once
 #include "contradium/core/core.h"
 
-namespace contradium {}
+namespace contradium {
+
+// Iteration control of PBDSolver::Step. Iterations stop early once the deepest penetration found is below tolerance,
+// 0 runs max_iterations every step. Contacts are cached from one step to the next by body pair and vertex, and
+// warm_start is the fraction of the corrections a cached contact received in the last step that is applied before the
+// first iteration, so resting contacts start out resolved. 0 starts every step from the predicted positions. Islands
+// of touching bodies fall asleep once all their bodies stayed below both sleep velocities for sleep_steps steps, 0
+// keeps every body awake.
+struct PBDSettings {
+  int max_iterations{20};
+  float tolerance{0.0f};
+  float warm_start{0.0f};
+  float sleep_linear_velocity{0.0f};
+  float sleep_angular_velocity{0.0f};
+  int sleep_steps{30};
+};
+
+struct PBDStatistics {
+  int iterations{0};
+  float residual{0.0f};       // deepest penetration found at the last iteration
+  int contacts{0};            // body pairs and vertices found in contact during the step
+  int persistent_contacts{0};  // of those, contacts that were already cached from the last step
+  int islands{0};              // islands of awake bodies, one that touches none is an island of its own
+  int sleeping_entities{0};
+};
+
+}  // namespace contradium
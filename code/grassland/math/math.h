@@ -3,8 +3,12 @@
 #include "grassland/math/math_basics.h"
 #include "grassland/math/math_ccd.h"
 #include "grassland/math/math_mesh.h"
+#include "grassland/math/math_mesh_optimizer.h"
 #include "grassland/math/math_mesh_sdf.h"
+#include "grassland/math/math_mesh_simplifier.h"
+#include "grassland/math/math_meshlet.h"
 #include "grassland/math/math_polynomial.h"
+#include "grassland/math/math_quantization.h"
 #include "grassland/math/math_ray.h"
 #include "grassland/math/math_spd_projection.h"
 #include "grassland/math/math_static_collision.h"
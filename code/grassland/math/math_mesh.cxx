@@ -1,4 +1,6 @@
 #include "grassland/math/math_mesh.h"
+
+#include "grassland/math/math_mesh_optimizer.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
@@ -569,6 +571,59 @@ int Mesh<Scalar>::MakeCollisionMesh() {
   return MergeVertices();
 }
 
+template <typename Scalar>
+int Mesh<Scalar>::OptimizeVertexOrder(uint32_t cache_size, Scalar overdraw_threshold) {
+  if (num_indices_ < 3 || num_indices_ % 3) {
+    return -1;
+  }
+  std::vector<uint32_t> triangle_order = OptimizeVertexCache(indices_.data(), num_indices_, num_vertices_, cache_size);
+  triangle_order = OptimizeOverdraw(indices_.data(), num_indices_, positions_.data(), num_vertices_, triangle_order,
+                                    overdraw_threshold, cache_size);
+
+  std::vector<uint32_t> new_indices(num_indices_);
+  for (size_t i = 0; i < triangle_order.size(); i++) {
+    for (int j = 0; j < 3; j++) {
+      new_indices[i * 3 + j] = indices_[triangle_order[i] * 3 + j];
+    }
+  }
+  if (!material_ids_.empty()) {
+    std::vector<int> new_material_ids(triangle_order.size());
+    for (size_t i = 0; i < triangle_order.size(); i++) {
+      new_material_ids[i] = material_ids_[triangle_order[i]];
+    }
+    material_ids_ = new_material_ids;
+  }
+
+  size_t num_unique_vertices = 0;
+  std::vector<uint32_t> remap =
+      OptimizeVertexFetch(new_indices.data(), num_indices_, num_vertices_, &num_unique_vertices);
+  for (auto &index : new_indices) {
+    index = remap[index];
+  }
+
+  auto remap_stream = [&remap, num_unique_vertices](auto &stream) {
+    if (stream.empty()) {
+      return;
+    }
+    std::remove_reference_t<decltype(stream)> new_stream(num_unique_vertices);
+    for (size_t i = 0; i < remap.size(); i++) {
+      if (remap[i] != ~0u) {
+        new_stream[remap[i]] = stream[i];
+      }
+    }
+    stream = new_stream;
+  };
+  remap_stream(positions_);
+  remap_stream(normals_);
+  remap_stream(tangents_);
+  remap_stream(tex_coords_);
+  remap_stream(signals_);
+
+  indices_ = new_indices;
+  num_vertices_ = num_unique_vertices;
+  return 0;
+}
+
 template <typename Scalar>
 Mesh<Scalar> Mesh<Scalar>::Transformed(const Matrix<Scalar, 3, 4> &transform) const {
   Mesh<Scalar> mesh = *this;
@@ -122,6 +122,10 @@ class Mesh {
 
   int MakeCollisionMesh();
 
+  // Reorder triangles for the post-transform vertex cache and overdraw, then renumber vertices in first-use order
+  // for the pre-transform vertex fetch. Unreferenced vertices are dropped.
+  int OptimizeVertexOrder(uint32_t cache_size = 16, Scalar overdraw_threshold = 1.05);
+
   Mesh<Scalar> Transformed(const Matrix<Scalar, 3, 4> &transform) const;
 
   // Material data structure from OBJ/MTL
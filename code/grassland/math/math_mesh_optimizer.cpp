@@ -0,0 +1,325 @@
+#include "grassland/math/math_mesh_optimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace grassland {
+
+namespace {
+
+struct TriangleAdjacency {
+  std::vector<uint32_t> first;
+  std::vector<uint32_t> count;
+  std::vector<uint32_t> triangles;
+
+  TriangleAdjacency(const uint32_t *indices, size_t num_indices, size_t num_vertices) {
+    first.resize(num_vertices + 1, 0);
+    count.resize(num_vertices, 0);
+    for (size_t i = 0; i < num_indices; i++) {
+      count[indices[i]]++;
+    }
+    for (size_t i = 0; i < num_vertices; i++) {
+      first[i + 1] = first[i] + count[i];
+    }
+    triangles.resize(num_indices);
+    std::vector<uint32_t> fill = first;
+    for (size_t i = 0; i < num_indices; i++) {
+      triangles[fill[indices[i]]++] = i / 3;
+    }
+  }
+};
+
+struct FIFOCacheSimulator {
+  std::vector<uint32_t> timestamps;
+  uint32_t cache_size;
+  uint32_t time;
+
+  FIFOCacheSimulator(size_t num_vertices, uint32_t cache_size)
+      : timestamps(num_vertices, 0), cache_size(cache_size), time(cache_size + 1) {
+  }
+
+  // Returns 1 if the vertex is a cache miss.
+  uint32_t Touch(uint32_t v) {
+    if (time - timestamps[v] > cache_size) {
+      timestamps[v] = time++;
+      return 1;
+    }
+    return 0;
+  }
+
+  void Flush() {
+    time += cache_size + 1;
+  }
+};
+
+}  // namespace
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t *indices,
+                                         size_t num_indices,
+                                         size_t num_vertices,
+                                         uint32_t cache_size) {
+  VertexCacheStatistics statistics;
+  if (num_indices < 3) {
+    return statistics;
+  }
+  FIFOCacheSimulator cache(num_vertices, cache_size);
+  std::vector<uint8_t> used(num_vertices, 0);
+  uint32_t num_used = 0;
+  for (size_t i = 0; i < num_indices; i++) {
+    uint32_t v = indices[i];
+    statistics.vertices_transformed += cache.Touch(v);
+    if (!used[v]) {
+      used[v] = 1;
+      num_used++;
+    }
+  }
+  statistics.acmr = static_cast<float>(statistics.vertices_transformed) / static_cast<float>(num_indices / 3);
+  statistics.atvr = static_cast<float>(statistics.vertices_transformed) / static_cast<float>(num_used);
+  return statistics;
+}
+
+std::vector<uint32_t> OptimizeVertexCache(const uint32_t *indices,
+                                          size_t num_indices,
+                                          size_t num_vertices,
+                                          uint32_t cache_size) {
+  size_t num_triangles = num_indices / 3;
+  std::vector<uint32_t> order;
+  order.reserve(num_triangles);
+  if (!num_triangles) {
+    return order;
+  }
+
+  TriangleAdjacency adjacency(indices, num_indices, num_vertices);
+  std::vector<uint32_t> live_triangles = adjacency.count;
+  std::vector<uint32_t> cache_timestamps(num_vertices, 0);
+  std::vector<uint8_t> emitted(num_triangles, 0);
+  std::vector<uint32_t> dead_end_stack;
+  std::vector<uint32_t> candidates;
+  dead_end_stack.reserve(num_indices);
+
+  uint32_t time = cache_size + 1;
+  uint32_t cursor = 0;
+  int64_t fanning_vertex = -1;
+  for (uint32_t v = 0; v < num_vertices; v++) {
+    if (live_triangles[v]) {
+      fanning_vertex = v;
+      break;
+    }
+  }
+
+  while (fanning_vertex >= 0) {
+    candidates.clear();
+    uint32_t f = static_cast<uint32_t>(fanning_vertex);
+    for (uint32_t i = adjacency.first[f]; i < adjacency.first[f + 1]; i++) {
+      uint32_t t = adjacency.triangles[i];
+      if (emitted[t]) {
+        continue;
+      }
+      emitted[t] = 1;
+      order.push_back(t);
+      for (int j = 0; j < 3; j++) {
+        uint32_t v = indices[t * 3 + j];
+        dead_end_stack.push_back(v);
+        candidates.push_back(v);
+        live_triangles[v]--;
+        if (time - cache_timestamps[v] > cache_size) {
+          cache_timestamps[v] = time++;
+        }
+      }
+    }
+
+    // Prefer the candidate that is still in the cache and stays there after emitting all its live triangles.
+    fanning_vertex = -1;
+    int64_t best_priority = -1;
+    for (uint32_t v : candidates) {
+      if (!live_triangles[v]) {
+        continue;
+      }
+      int64_t priority = 0;
+      if (time - cache_timestamps[v] + 2 * live_triangles[v] <= cache_size) {
+        priority = time - cache_timestamps[v];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        fanning_vertex = v;
+      }
+    }
+
+    if (fanning_vertex < 0) {
+      while (!dead_end_stack.empty()) {
+        uint32_t v = dead_end_stack.back();
+        dead_end_stack.pop_back();
+        if (live_triangles[v]) {
+          fanning_vertex = v;
+          break;
+        }
+      }
+    }
+
+    if (fanning_vertex < 0) {
+      while (cursor < num_vertices) {
+        if (live_triangles[cursor]) {
+          fanning_vertex = cursor;
+          break;
+        }
+        cursor++;
+      }
+    }
+  }
+
+  return order;
+}
+
+template <typename Scalar>
+std::vector<uint32_t> OptimizeOverdraw(const uint32_t *indices,
+                                       size_t num_indices,
+                                       const Vector3<Scalar> *positions,
+                                       size_t num_vertices,
+                                       const std::vector<uint32_t> &triangle_order,
+                                       Scalar threshold,
+                                       uint32_t cache_size) {
+  size_t num_triangles = triangle_order.size();
+  if (num_triangles < 2 || num_triangles != num_indices / 3) {
+    return triangle_order;
+  }
+
+  auto triangle_vertex = [&](size_t i, int j) { return indices[triangle_order[i] * 3 + j]; };
+
+  // Hard boundaries: triangles where the cache-optimized order jumped to an unrelated region (all three misses).
+  std::vector<uint32_t> cluster_begins;
+  {
+    FIFOCacheSimulator cache(num_vertices, cache_size);
+    for (size_t i = 0; i < num_triangles; i++) {
+      uint32_t misses = cache.Touch(triangle_vertex(i, 0)) + cache.Touch(triangle_vertex(i, 1)) +
+                        cache.Touch(triangle_vertex(i, 2));
+      if (misses == 3 || i == 0) {
+        cluster_begins.push_back(i);
+      }
+    }
+  }
+  cluster_begins.push_back(num_triangles);
+
+  // Soft boundaries: cut a hard cluster wherever the running ACMR drops below the scaled cluster ACMR.
+  std::vector<uint32_t> soft_begins;
+  {
+    FIFOCacheSimulator cache(num_vertices, cache_size);
+    for (size_t c = 0; c + 1 < cluster_begins.size(); c++) {
+      uint32_t begin = cluster_begins[c];
+      uint32_t end = cluster_begins[c + 1];
+      cache.Flush();
+      uint32_t cluster_misses = 0;
+      for (uint32_t i = begin; i < end; i++) {
+        cluster_misses += cache.Touch(triangle_vertex(i, 0)) + cache.Touch(triangle_vertex(i, 1)) +
+                          cache.Touch(triangle_vertex(i, 2));
+      }
+      Scalar cluster_threshold = threshold * static_cast<Scalar>(cluster_misses) / static_cast<Scalar>(end - begin);
+
+      cache.Flush();
+      soft_begins.push_back(begin);
+      uint32_t start = begin;
+      uint32_t running_misses = 0;
+      for (uint32_t i = begin; i < end; i++) {
+        running_misses += cache.Touch(triangle_vertex(i, 0)) + cache.Touch(triangle_vertex(i, 1)) +
+                          cache.Touch(triangle_vertex(i, 2));
+        if (i + 1 < end && running_misses <= static_cast<Scalar>(i - start + 1) * cluster_threshold) {
+          soft_begins.push_back(i + 1);
+          start = i + 1;
+          running_misses = 0;
+          cache.Flush();
+        }
+      }
+    }
+  }
+  soft_begins.push_back(num_triangles);
+
+  Vector3<Scalar> mesh_centroid = Vector3<Scalar>::Zero();
+  Scalar mesh_area = 0;
+  size_t num_clusters = soft_begins.size() - 1;
+  std::vector<Scalar> sort_keys(num_clusters);
+  for (size_t c = 0; c < num_clusters; c++) {
+    for (uint32_t i = soft_begins[c]; i < soft_begins[c + 1]; i++) {
+      const Vector3<Scalar> &p0 = positions[triangle_vertex(i, 0)];
+      const Vector3<Scalar> &p1 = positions[triangle_vertex(i, 1)];
+      const Vector3<Scalar> &p2 = positions[triangle_vertex(i, 2)];
+      Scalar area = (p1 - p0).cross(p2 - p0).norm();
+      mesh_centroid += (p0 + p1 + p2) * (area / 3);
+      mesh_area += area;
+    }
+  }
+  if (mesh_area > 0) {
+    mesh_centroid /= mesh_area;
+  }
+
+  for (size_t c = 0; c < num_clusters; c++) {
+    Vector3<Scalar> centroid = Vector3<Scalar>::Zero();
+    Vector3<Scalar> normal = Vector3<Scalar>::Zero();
+    Scalar area_sum = 0;
+    for (uint32_t i = soft_begins[c]; i < soft_begins[c + 1]; i++) {
+      const Vector3<Scalar> &p0 = positions[triangle_vertex(i, 0)];
+      const Vector3<Scalar> &p1 = positions[triangle_vertex(i, 1)];
+      const Vector3<Scalar> &p2 = positions[triangle_vertex(i, 2)];
+      Vector3<Scalar> n = (p1 - p0).cross(p2 - p0);
+      Scalar area = n.norm();
+      centroid += (p0 + p1 + p2) * (area / 3);
+      normal += n;
+      area_sum += area;
+    }
+    if (area_sum > 0) {
+      centroid /= area_sum;
+    }
+    Scalar normal_length = normal.norm();
+    if (normal_length > 0) {
+      normal /= normal_length;
+    }
+    sort_keys[c] = (centroid - mesh_centroid).dot(normal);
+  }
+
+  std::vector<uint32_t> cluster_order(num_clusters);
+  std::iota(cluster_order.begin(), cluster_order.end(), 0);
+  std::stable_sort(cluster_order.begin(), cluster_order.end(),
+                   [&sort_keys](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+  std::vector<uint32_t> result;
+  result.reserve(num_triangles);
+  for (uint32_t c : cluster_order) {
+    for (uint32_t i = soft_begins[c]; i < soft_begins[c + 1]; i++) {
+      result.push_back(triangle_order[i]);
+    }
+  }
+  return result;
+}
+
+template std::vector<uint32_t> OptimizeOverdraw<float>(const uint32_t *indices,
+                                                       size_t num_indices,
+                                                       const Vector3<float> *positions,
+                                                       size_t num_vertices,
+                                                       const std::vector<uint32_t> &triangle_order,
+                                                       float threshold,
+                                                       uint32_t cache_size);
+template std::vector<uint32_t> OptimizeOverdraw<double>(const uint32_t *indices,
+                                                        size_t num_indices,
+                                                        const Vector3<double> *positions,
+                                                        size_t num_vertices,
+                                                        const std::vector<uint32_t> &triangle_order,
+                                                        double threshold,
+                                                        uint32_t cache_size);
+
+std::vector<uint32_t> OptimizeVertexFetch(const uint32_t *indices,
+                                          size_t num_indices,
+                                          size_t num_vertices,
+                                          size_t *num_unique_vertices) {
+  std::vector<uint32_t> remap(num_vertices, ~0u);
+  uint32_t next_vertex = 0;
+  for (size_t i = 0; i < num_indices; i++) {
+    uint32_t v = indices[i];
+    if (remap[v] == ~0u) {
+      remap[v] = next_vertex++;
+    }
+  }
+  if (num_unique_vertices) {
+    *num_unique_vertices = next_vertex;
+  }
+  return remap;
+}
+
+}  // namespace grassland
@@ -0,0 +1,45 @@
+#pragma once
+#include "grassland/math/math_util.h"
+
+namespace grassland {
+
+struct VertexCacheStatistics {
+  uint32_t vertices_transformed{0};  // vertex shader invocations under a simulated FIFO post-transform cache
+  float acmr{0.0f};                  // average cache miss ratio, transformed vertices per triangle (0.5 ~ 3.0)
+  float atvr{0.0f};                  // average transformed vertex ratio, transformed vertices per used vertex (>= 1.0)
+};
+
+// Simulate a FIFO post-transform vertex cache of the given size over the index stream.
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t *indices,
+                                         size_t num_indices,
+                                         size_t num_vertices,
+                                         uint32_t cache_size = 16);
+
+// Tipsify (Sander et al. 2007) triangle ordering for the post-transform vertex cache.
+// Returns the new triangle order, i.e. result[i] is the old index of the i-th emitted triangle.
+std::vector<uint32_t> OptimizeVertexCache(const uint32_t *indices,
+                                          size_t num_indices,
+                                          size_t num_vertices,
+                                          uint32_t cache_size = 16);
+
+// Split a cache-optimized triangle order into clusters and sort the clusters front-to-back from the outside of the
+// mesh, so that occluders are drawn first. Clusters are only cut where the local ACMR stays within threshold times
+// the ACMR of the surrounding run, so the vertex cache efficiency is mostly kept. triangle_order must hold every one of
+// the num_indices / 3 triangles, otherwise it is returned as it is.
+template <typename Scalar>
+std::vector<uint32_t> OptimizeOverdraw(const uint32_t *indices,
+                                       size_t num_indices,
+                                       const Vector3<Scalar> *positions,
+                                       size_t num_vertices,
+                                       const std::vector<uint32_t> &triangle_order,
+                                       Scalar threshold = 1.05,
+                                       uint32_t cache_size = 16);
+
+// Renumber the vertices in the order they are first referenced by the index stream.
+// Returns a remap table from old vertex index to new vertex index, unreferenced vertices are mapped to ~0u.
+std::vector<uint32_t> OptimizeVertexFetch(const uint32_t *indices,
+                                          size_t num_indices,
+                                          size_t num_vertices,
+                                          size_t *num_unique_vertices = nullptr);
+
+}  // namespace grassland
@@ -0,0 +1,430 @@
+#include "grassland/math/math_mesh_simplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <queue>
+#include <unordered_map>
+
+namespace grassland {
+
+namespace {
+
+struct Quadric {
+  // Symmetric 4x4 plane quadric, upper triangle.
+  double a00{0}, a01{0}, a02{0}, a03{0};
+  double a11{0}, a12{0}, a13{0};
+  double a22{0}, a23{0};
+  double a33{0};
+
+  static Quadric FromPlane(const Vector3<double> &n, double d) {
+    Quadric q;
+    q.a00 = n[0] * n[0];
+    q.a01 = n[0] * n[1];
+    q.a02 = n[0] * n[2];
+    q.a03 = n[0] * d;
+    q.a11 = n[1] * n[1];
+    q.a12 = n[1] * n[2];
+    q.a13 = n[1] * d;
+    q.a22 = n[2] * n[2];
+    q.a23 = n[2] * d;
+    q.a33 = d * d;
+    return q;
+  }
+
+  Quadric &operator+=(const Quadric &q) {
+    a00 += q.a00;
+    a01 += q.a01;
+    a02 += q.a02;
+    a03 += q.a03;
+    a11 += q.a11;
+    a12 += q.a12;
+    a13 += q.a13;
+    a22 += q.a22;
+    a23 += q.a23;
+    a33 += q.a33;
+    return *this;
+  }
+
+  double Evaluate(const Vector3<double> &p) const {
+    double x = p[0], y = p[1], z = p[2];
+    double result = a00 * x * x + a11 * y * y + a22 * z * z + a33;
+    result += 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z);
+    result += 2.0 * (a03 * x + a13 * y + a23 * z);
+    return std::max(result, 0.0);
+  }
+};
+
+struct Collapse {
+  double cost;
+  uint32_t from;
+  uint32_t to;
+  uint32_t from_version;
+  uint32_t to_version;
+
+  bool operator>(const Collapse &other) const {
+    return cost > other.cost;
+  }
+};
+
+constexpr uint32_t kNoVertex = ~0u;
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+  if (a > b) {
+    std::swap(a, b);
+  }
+  return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+}  // namespace
+
+template <typename Scalar>
+std::vector<uint32_t> SimplifyMesh(const uint32_t *indices,
+                                   size_t num_indices,
+                                   const Vector3<Scalar> *positions,
+                                   size_t num_vertices,
+                                   size_t target_index_count,
+                                   Scalar target_error,
+                                   Scalar *result_error) {
+  size_t num_triangles = num_indices / 3;
+  std::vector<uint32_t> triangles(indices, indices + num_triangles * 3);
+  std::vector<Vector3<double>> points(num_vertices);
+  for (size_t i = 0; i < num_vertices; i++) {
+    points[i] = positions[i].template cast<double>();
+  }
+
+  std::vector<Quadric> quadrics(num_vertices);
+  std::vector<std::vector<uint32_t>> vertex_triangles(num_vertices);
+  std::unordered_map<uint64_t, uint32_t> edge_counts;
+  for (uint32_t t = 0; t < num_triangles; t++) {
+    const uint32_t *tri = &triangles[t * 3];
+    Vector3<double> n = (points[tri[1]] - points[tri[0]]).cross(points[tri[2]] - points[tri[0]]);
+    double length = n.norm();
+    if (length > 0) {
+      n /= length;
+    }
+    Quadric q = Quadric::FromPlane(n, -n.dot(points[tri[0]]));
+    for (int j = 0; j < 3; j++) {
+      quadrics[tri[j]] += q;
+      vertex_triangles[tri[j]].push_back(t);
+      edge_counts[EdgeKey(tri[j], tri[(j + 1) % 3])]++;
+    }
+  }
+
+  // Border edges belong to one triangle. A vertex on exactly two of them may slide along the border onto one of its
+  // border neighbors. Vertices on more border edges or on a non-manifold edge are locked.
+  std::vector<uint8_t> locked(num_vertices, 0);
+  std::vector<uint32_t> num_border_edges(num_vertices, 0);
+  std::vector<std::array<uint32_t, 2>> border_neighbors(num_vertices, {kNoVertex, kNoVertex});
+  for (auto &[key, count] : edge_counts) {
+    uint32_t a = key >> 32;
+    uint32_t b = key & 0xffffffffu;
+    if (count > 2) {
+      locked[a] = 1;
+      locked[b] = 1;
+    } else if (count == 1) {
+      for (auto [v, other] : {std::make_pair(a, b), std::make_pair(b, a)}) {
+        if (num_border_edges[v] < 2) {
+          border_neighbors[v][num_border_edges[v]] = other;
+        }
+        num_border_edges[v]++;
+      }
+    }
+  }
+  for (uint32_t v = 0; v < num_vertices; v++) {
+    if (num_border_edges[v] != 0 && num_border_edges[v] != 2) {
+      locked[v] = 1;
+    }
+  }
+  // The plane through a border edge perpendicular to its triangle keeps the border in shape.
+  for (uint32_t t = 0; t < num_triangles; t++) {
+    const uint32_t *tri = &triangles[t * 3];
+    Vector3<double> n = (points[tri[1]] - points[tri[0]]).cross(points[tri[2]] - points[tri[0]]);
+    for (int j = 0; j < 3; j++) {
+      uint32_t a = tri[j];
+      uint32_t b = tri[(j + 1) % 3];
+      if (edge_counts[EdgeKey(a, b)] != 1) {
+        continue;
+      }
+      Vector3<double> border_normal = (points[b] - points[a]).cross(n);
+      double length = border_normal.norm();
+      if (length > 0) {
+        border_normal /= length;
+        Quadric q = Quadric::FromPlane(border_normal, -border_normal.dot(points[a]));
+        quadrics[a] += q;
+        quadrics[b] += q;
+      }
+    }
+  }
+
+  // An attribute seam of a split mesh is a border on both sides at the same positions. A seam vertex only moves
+  // together with its twin on the other side, onto the twin of its target, so that no crack opens between the sides.
+  // Border vertices sharing their position in any other way are locked.
+  std::vector<uint32_t> twin(num_vertices, kNoVertex);
+  {
+    std::vector<uint32_t> by_position;
+    for (uint32_t v = 0; v < num_vertices; v++) {
+      if (!vertex_triangles[v].empty()) {
+        by_position.push_back(v);
+      }
+    }
+    auto position_less = [&points](uint32_t a, uint32_t b) {
+      return std::lexicographical_compare(points[a].data(), points[a].data() + 3, points[b].data(),
+                                          points[b].data() + 3);
+    };
+    std::sort(by_position.begin(), by_position.end(), position_less);
+    for (size_t begin = 0, end = 0; begin < by_position.size(); begin = end) {
+      while (end < by_position.size() && points[by_position[end]] == points[by_position[begin]]) {
+        end++;
+      }
+      if (end - begin == 2 && num_border_edges[by_position[begin]] == 2 &&
+          num_border_edges[by_position[begin + 1]] == 2) {
+        twin[by_position[begin]] = by_position[begin + 1];
+        twin[by_position[begin + 1]] = by_position[begin];
+      } else if (end - begin > 1) {
+        for (size_t i = begin; i < end; i++) {
+          if (num_border_edges[by_position[i]]) {
+            locked[by_position[i]] = 1;
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<uint8_t> triangle_alive(num_triangles, 1);
+  size_t alive_triangle_count = num_triangles;
+  std::vector<uint8_t> vertex_alive(num_vertices, 1);
+  std::vector<uint32_t> versions(num_vertices, 0);
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+  // Where the twin of a seam vertex goes when the vertex collapses onto to, kNoVertex if it cannot follow.
+  auto twin_target = [&](uint32_t from, uint32_t to) {
+    for (uint32_t neighbor : border_neighbors[twin[from]]) {
+      if (neighbor != kNoVertex && points[neighbor] == points[to]) {
+        return neighbor;
+      }
+    }
+    return kNoVertex;
+  };
+
+  // Cost of collapsing from onto to, including the twin collapse of a seam, negative if the border forbids it.
+  auto collapse_cost = [&](uint32_t from, uint32_t to) {
+    if (locked[from]) {
+      return -1.0;
+    }
+    if (num_border_edges[from] && border_neighbors[from][0] != to && border_neighbors[from][1] != to) {
+      return -1.0;
+    }
+    Quadric q = quadrics[from];
+    q += quadrics[to];
+    double cost = q.Evaluate(points[to]);
+    if (twin[from] != kNoVertex) {
+      uint32_t twin_to = twin_target(from, to);
+      if (locked[twin[from]] || twin_to == kNoVertex) {
+        return -1.0;
+      }
+      Quadric twin_q = quadrics[twin[from]];
+      twin_q += quadrics[twin_to];
+      cost += twin_q.Evaluate(points[twin_to]);
+    }
+    return cost;
+  };
+
+  auto push_collapse = [&](uint32_t from, uint32_t to) {
+    double cost = collapse_cost(from, to);
+    if (cost >= 0.0) {
+      heap.push({cost, from, to, versions[from], versions[to]});
+    }
+  };
+
+  for (uint32_t t = 0; t < num_triangles; t++) {
+    for (int j = 0; j < 3; j++) {
+      uint32_t a = triangles[t * 3 + j];
+      uint32_t b = triangles[t * 3 + (j + 1) % 3];
+      push_collapse(a, b);
+      push_collapse(b, a);
+    }
+  }
+
+  std::vector<uint32_t> from_ring;
+  std::vector<uint32_t> to_ring;
+  auto collect_ring = [&](uint32_t v, std::vector<uint32_t> &ring) {
+    ring.clear();
+    for (uint32_t t : vertex_triangles[v]) {
+      if (!triangle_alive[t]) {
+        continue;
+      }
+      for (int j = 0; j < 3; j++) {
+        if (triangles[t * 3 + j] != v) {
+          ring.push_back(triangles[t * 3 + j]);
+        }
+      }
+    }
+    std::sort(ring.begin(), ring.end());
+    ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+  };
+
+  // A collapse is rejected if it breaks the link condition (the two endpoints may only share the opposite vertices of
+  // the edge, one on a border) or if it would flip or degenerate any triangle that survives it. A border may not
+  // shrink below a triangle.
+  auto collapse_valid = [&](uint32_t from, uint32_t to) {
+    if (num_border_edges[from]) {
+      uint32_t other = border_neighbors[from][0] == to ? border_neighbors[from][1] : border_neighbors[from][0];
+      if (border_neighbors[to][0] == other || border_neighbors[to][1] == other) {
+        return false;
+      }
+    }
+    collect_ring(from, from_ring);
+    collect_ring(to, to_ring);
+    size_t num_shared = 0;
+    for (size_t i = 0, j = 0; i < from_ring.size() && j < to_ring.size();) {
+      if (from_ring[i] < to_ring[j]) {
+        i++;
+      } else if (from_ring[i] > to_ring[j]) {
+        j++;
+      } else {
+        num_shared++;
+        i++;
+        j++;
+      }
+    }
+
+    size_t num_edge_triangles = 0;
+    for (uint32_t t : vertex_triangles[from]) {
+      if (!triangle_alive[t]) {
+        continue;
+      }
+      const uint32_t *tri = &triangles[t * 3];
+      if (tri[0] == to || tri[1] == to || tri[2] == to) {
+        num_edge_triangles++;
+        continue;
+      }
+      Vector3<double> p[3], q[3];
+      for (int j = 0; j < 3; j++) {
+        p[j] = points[tri[j]];
+        q[j] = tri[j] == from ? points[to] : points[tri[j]];
+      }
+      Vector3<double> n0 = (p[1] - p[0]).cross(p[2] - p[0]);
+      Vector3<double> n1 = (q[1] - q[0]).cross(q[2] - q[0]);
+      double l0 = n0.norm();
+      double l1 = n1.norm();
+      if (l1 <= 1e-12 * std::max(l0, 1e-30) || n0.dot(n1) < 0.2 * l0 * l1) {
+        return false;
+      }
+    }
+    return num_edge_triangles > 0 && num_shared == num_edge_triangles;
+  };
+
+  auto apply_collapse = [&](uint32_t from, uint32_t to) {
+    for (uint32_t t : vertex_triangles[from]) {
+      if (!triangle_alive[t]) {
+        continue;
+      }
+      uint32_t *tri = &triangles[t * 3];
+      if (tri[0] == to || tri[1] == to || tri[2] == to) {
+        triangle_alive[t] = 0;
+        alive_triangle_count--;
+        continue;
+      }
+      for (int j = 0; j < 3; j++) {
+        if (tri[j] == from) {
+          tri[j] = to;
+        }
+      }
+      vertex_triangles[to].push_back(t);
+    }
+    vertex_triangles[from].clear();
+    vertex_alive[from] = 0;
+    quadrics[to] += quadrics[from];
+    versions[to]++;
+    // The border now runs from to straight to the other border neighbor of from.
+    if (num_border_edges[from]) {
+      uint32_t other = border_neighbors[from][0] == to ? border_neighbors[from][1] : border_neighbors[from][0];
+      std::replace(border_neighbors[to].begin(), border_neighbors[to].end(), from, other);
+      std::replace(border_neighbors[other].begin(), border_neighbors[other].end(), from, to);
+    }
+
+    auto &to_triangles = vertex_triangles[to];
+    to_triangles.erase(std::remove_if(to_triangles.begin(), to_triangles.end(),
+                                      [&triangle_alive](uint32_t t) { return !triangle_alive[t]; }),
+                       to_triangles.end());
+    for (uint32_t t : to_triangles) {
+      for (int j = 0; j < 3; j++) {
+        uint32_t v = triangles[t * 3 + j];
+        if (v != to) {
+          push_collapse(v, to);
+          push_collapse(to, v);
+        }
+      }
+    }
+  };
+
+  double max_cost = 0.0;
+  double max_allowed_cost = static_cast<double>(target_error) * static_cast<double>(target_error);
+  if (target_error >= std::numeric_limits<Scalar>::max()) {
+    max_allowed_cost = std::numeric_limits<double>::max();
+  }
+
+  while (alive_triangle_count * 3 > target_index_count && !heap.empty()) {
+    Collapse collapse = heap.top();
+    heap.pop();
+    if (!vertex_alive[collapse.from] || !vertex_alive[collapse.to] ||
+        versions[collapse.from] != collapse.from_version || versions[collapse.to] != collapse.to_version) {
+      continue;
+    }
+    if (collapse.cost > max_allowed_cost) {
+      break;
+    }
+    uint32_t from = collapse.from;
+    uint32_t to = collapse.to;
+    // The other side of a seam may have changed since the collapse was pushed, it goes back in with its new cost.
+    double cost = collapse_cost(from, to);
+    if (cost < 0.0) {
+      continue;
+    }
+    if (cost > collapse.cost) {
+      heap.push({cost, from, to, collapse.from_version, collapse.to_version});
+      continue;
+    }
+    uint32_t twin_from = twin[from];
+    uint32_t twin_to = twin_from == kNoVertex ? kNoVertex : twin_target(from, to);
+    if (!collapse_valid(from, to) || (twin_from != kNoVertex && !collapse_valid(twin_from, twin_to))) {
+      continue;
+    }
+
+    apply_collapse(from, to);
+    if (twin_from != kNoVertex) {
+      apply_collapse(twin_from, twin_to);
+    }
+    max_cost = std::max(max_cost, collapse.cost);
+  }
+
+  if (result_error) {
+    *result_error = static_cast<Scalar>(std::sqrt(max_cost));
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(alive_triangle_count * 3);
+  for (uint32_t t = 0; t < num_triangles; t++) {
+    if (triangle_alive[t]) {
+      result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+    }
+  }
+  return result;
+}
+
+template std::vector<uint32_t> SimplifyMesh<float>(const uint32_t *indices,
+                                                   size_t num_indices,
+                                                   const Vector3<float> *positions,
+                                                   size_t num_vertices,
+                                                   size_t target_index_count,
+                                                   float target_error,
+                                                   float *result_error);
+template std::vector<uint32_t> SimplifyMesh<double>(const uint32_t *indices,
+                                                    size_t num_indices,
+                                                    const Vector3<double> *positions,
+                                                    size_t num_vertices,
+                                                    size_t target_index_count,
+                                                    double target_error,
+                                                    double *result_error);
+
+}  // namespace grassland
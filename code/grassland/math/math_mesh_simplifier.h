@@ -0,0 +1,22 @@
+#pragma once
+#include "grassland/math/math_util.h"
+
+namespace grassland {
+
+// Quadric error metric (Garland and Heckbert 1997) simplification by half-edge collapses.
+// Vertices are only ever collapsed onto existing vertices, so the result indexes the same vertex buffer and every
+// attribute stream stays valid. A border vertex only slides along its border onto a neighbor on the same border, and
+// the two sides of an attribute seam of a split mesh (borders at identical positions) collapse together so that no
+// crack opens. Border corners, vertices shared by more than two sides and non-manifold vertices are kept in place.
+// Stops when the triangle count reaches target_index_count / 3 or when the next collapse would exceed target_error,
+// measured as a distance in the units of the positions. The largest error introduced is written to result_error.
+template <typename Scalar>
+std::vector<uint32_t> SimplifyMesh(const uint32_t *indices,
+                                   size_t num_indices,
+                                   const Vector3<Scalar> *positions,
+                                   size_t num_vertices,
+                                   size_t target_index_count,
+                                   Scalar target_error = std::numeric_limits<Scalar>::max(),
+                                   Scalar *result_error = nullptr);
+
+}  // namespace grassland
@@ -0,0 +1,194 @@
+#include "grassland/math/math_meshlet.h"
+
+#include <algorithm>
+
+namespace grassland {
+
+namespace {
+
+template <typename Scalar>
+void ComputeMeshletBounds(const uint32_t *indices,
+                          const Vector3<Scalar> *positions,
+                          const std::vector<uint32_t> &triangles,
+                          Meshlet *meshlet) {
+  Vector3<float> lower = Vector3<float>::Constant(std::numeric_limits<float>::max());
+  Vector3<float> upper = Vector3<float>::Constant(std::numeric_limits<float>::lowest());
+  for (uint32_t t : triangles) {
+    for (int j = 0; j < 3; j++) {
+      Vector3<float> p = positions[indices[t * 3 + j]].template cast<float>();
+      lower = lower.cwiseMin(p);
+      upper = upper.cwiseMax(p);
+    }
+  }
+  meshlet->center = (lower + upper) * 0.5f;
+  meshlet->radius = 0.0f;
+  for (uint32_t t : triangles) {
+    for (int j = 0; j < 3; j++) {
+      Vector3<float> p = positions[indices[t * 3 + j]].template cast<float>();
+      meshlet->radius = std::max(meshlet->radius, (p - meshlet->center).norm());
+    }
+  }
+
+  Vector3<float> axis = Vector3<float>::Zero();
+  std::vector<Vector3<float>> normals;
+  normals.reserve(triangles.size());
+  for (uint32_t t : triangles) {
+    Vector3<float> p0 = positions[indices[t * 3]].template cast<float>();
+    Vector3<float> p1 = positions[indices[t * 3 + 1]].template cast<float>();
+    Vector3<float> p2 = positions[indices[t * 3 + 2]].template cast<float>();
+    Vector3<float> n = (p1 - p0).cross(p2 - p0);
+    float length = n.norm();
+    if (length > 0.0f) {
+      normals.push_back(n / length);
+      axis += n / length;
+    }
+  }
+  float axis_length = axis.norm();
+  meshlet->cone_axis = axis_length > 0.0f ? Vector3<float>(axis / axis_length) : Vector3<float>::UnitZ();
+  float min_dot = axis_length > 0.0f ? 1.0f : -1.0f;
+  for (auto &n : normals) {
+    min_dot = std::min(min_dot, n.dot(meshlet->cone_axis));
+  }
+  // A cone wider than a hemisphere can never be entirely backfacing.
+  meshlet->cone_cutoff = min_dot <= 0.0f ? 1.0f : std::sqrt(1.0f - min_dot * min_dot);
+}
+
+}  // namespace
+
+template <typename Scalar>
+std::vector<Meshlet> BuildMeshlets(const uint32_t *indices,
+                                   size_t num_indices,
+                                   const Vector3<Scalar> *positions,
+                                   size_t num_vertices,
+                                   std::vector<uint32_t> *triangle_order,
+                                   uint32_t max_vertices,
+                                   uint32_t max_triangles) {
+  size_t num_triangles = num_indices / 3;
+  std::vector<Meshlet> meshlets;
+  triangle_order->clear();
+  triangle_order->reserve(num_triangles);
+
+  std::vector<uint32_t> adjacency_first(num_vertices + 1, 0);
+  for (size_t i = 0; i < num_triangles * 3; i++) {
+    adjacency_first[indices[i] + 1]++;
+  }
+  for (size_t i = 0; i < num_vertices; i++) {
+    adjacency_first[i + 1] += adjacency_first[i];
+  }
+  std::vector<uint32_t> adjacency(num_triangles * 3);
+  {
+    std::vector<uint32_t> fill(adjacency_first.begin(), adjacency_first.end() - 1);
+    for (size_t i = 0; i < num_triangles * 3; i++) {
+      adjacency[fill[indices[i]]++] = i / 3;
+    }
+  }
+
+  std::vector<uint8_t> assigned(num_triangles, 0);
+  std::vector<uint32_t> vertex_meshlet(num_vertices, ~0u);  // meshlet that last referenced the vertex
+  std::vector<uint32_t> candidate_meshlet(num_triangles, ~0u);
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> meshlet_triangles;
+  size_t cursor = 0;
+
+  while (true) {
+    while (cursor < num_triangles && assigned[cursor]) {
+      cursor++;
+    }
+    if (cursor == num_triangles) {
+      break;
+    }
+
+    uint32_t meshlet_id = static_cast<uint32_t>(meshlets.size());
+    uint32_t vertex_count = 0;
+    Vector3<float> centroid = Vector3<float>::Zero();
+    meshlet_triangles.clear();
+    candidates.clear();
+
+    auto add_triangle = [&](uint32_t t) {
+      assigned[t] = 1;
+      meshlet_triangles.push_back(t);
+      Vector3<float> triangle_center = Vector3<float>::Zero();
+      for (int j = 0; j < 3; j++) {
+        uint32_t v = indices[t * 3 + j];
+        triangle_center += positions[v].template cast<float>() / 3.0f;
+        if (vertex_meshlet[v] != meshlet_id) {
+          vertex_meshlet[v] = meshlet_id;
+          vertex_count++;
+        }
+        for (uint32_t k = adjacency_first[v]; k < adjacency_first[v + 1]; k++) {
+          uint32_t neighbor = adjacency[k];
+          if (!assigned[neighbor] && candidate_meshlet[neighbor] != meshlet_id) {
+            candidate_meshlet[neighbor] = meshlet_id;
+            candidates.push_back(neighbor);
+          }
+        }
+      }
+      centroid += (triangle_center - centroid) / static_cast<float>(meshlet_triangles.size());
+    };
+
+    add_triangle(static_cast<uint32_t>(cursor));
+    while (meshlet_triangles.size() < max_triangles) {
+      int64_t best = -1;
+      uint32_t best_new_vertices = 4;
+      float best_distance = std::numeric_limits<float>::max();
+      size_t num_alive = 0;
+      for (size_t i = 0; i < candidates.size(); i++) {
+        uint32_t t = candidates[i];
+        if (assigned[t]) {
+          continue;
+        }
+        candidates[num_alive++] = t;
+        uint32_t new_vertices = 0;
+        Vector3<float> triangle_center = Vector3<float>::Zero();
+        for (int j = 0; j < 3; j++) {
+          uint32_t v = indices[t * 3 + j];
+          new_vertices += vertex_meshlet[v] != meshlet_id;
+          triangle_center += positions[v].template cast<float>() / 3.0f;
+        }
+        if (vertex_count + new_vertices > max_vertices) {
+          continue;
+        }
+        float distance = (triangle_center - centroid).squaredNorm();
+        if (new_vertices < best_new_vertices || (new_vertices == best_new_vertices && distance < best_distance)) {
+          best = t;
+          best_new_vertices = new_vertices;
+          best_distance = distance;
+        }
+      }
+      candidates.resize(num_alive);
+      if (best < 0) {
+        break;
+      }
+      add_triangle(static_cast<uint32_t>(best));
+    }
+
+    // The input order within the meshlet, such as that of OptimizeVertexCache, is kept.
+    std::sort(meshlet_triangles.begin(), meshlet_triangles.end());
+    Meshlet meshlet{};
+    meshlet.triangle_offset = static_cast<uint32_t>(triangle_order->size());
+    meshlet.triangle_count = static_cast<uint32_t>(meshlet_triangles.size());
+    meshlet.vertex_count = vertex_count;
+    ComputeMeshletBounds(indices, positions, meshlet_triangles, &meshlet);
+    meshlets.push_back(meshlet);
+    triangle_order->insert(triangle_order->end(), meshlet_triangles.begin(), meshlet_triangles.end());
+  }
+
+  return meshlets;
+}
+
+template std::vector<Meshlet> BuildMeshlets<float>(const uint32_t *indices,
+                                                   size_t num_indices,
+                                                   const Vector3<float> *positions,
+                                                   size_t num_vertices,
+                                                   std::vector<uint32_t> *triangle_order,
+                                                   uint32_t max_vertices,
+                                                   uint32_t max_triangles);
+template std::vector<Meshlet> BuildMeshlets<double>(const uint32_t *indices,
+                                                    size_t num_indices,
+                                                    const Vector3<double> *positions,
+                                                    size_t num_vertices,
+                                                    std::vector<uint32_t> *triangle_order,
+                                                    uint32_t max_vertices,
+                                                    uint32_t max_triangles);
+
+}  // namespace grassland
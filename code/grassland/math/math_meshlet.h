@@ -0,0 +1,51 @@
+#pragma once
+#include "grassland/math/math_util.h"
+
+namespace grassland {
+
+struct Meshlet {
+  uint32_t triangle_offset;  // first triangle of the meshlet in the reordered triangle list
+  uint32_t triangle_count;
+  uint32_t vertex_count;
+  Vector3<float> center;  // bounding sphere
+  float radius;
+  Vector3<float> cone_axis;  // average facing direction
+  float cone_cutoff;         // sine of the normal cone half angle, 1 if the cone is too wide to ever cull
+};
+
+// Greedily grow clusters of adjacent triangles with at most max_vertices unique vertices and max_triangles triangles,
+// preferring triangles that add the fewest new vertices and stay close to the cluster. triangle_order receives the
+// new triangle order in which every meshlet covers a contiguous range. Meshlets start at the first triangle left over
+// and keep the input order of their triangles. A vertex cache optimized input still loses some of its cache hits,
+// since a meshlet gathers its triangles by adjacency rather than along the cache order and cuts it at its borders.
+template <typename Scalar>
+std::vector<Meshlet> BuildMeshlets(const uint32_t *indices,
+                                   size_t num_indices,
+                                   const Vector3<Scalar> *positions,
+                                   size_t num_vertices,
+                                   std::vector<uint32_t> *triangle_order,
+                                   uint32_t max_vertices = 64,
+                                   uint32_t max_triangles = 124);
+
+// Conservative visibility of a meshlet, in the space its bounds are expressed in.
+// frustum_planes are (n, d) with n . x + d >= 0 inside, normals not necessarily normalized.
+LM_DEVICE_FUNC inline bool MeshletInFrustum(const Meshlet &meshlet,
+                                            const Vector4<float> *frustum_planes,
+                                            int num_planes) {
+  for (int i = 0; i < num_planes; i++) {
+    const Vector4<float> &plane = frustum_planes[i];
+    float n = plane.template head<3>().norm();
+    if (plane.template head<3>().dot(meshlet.center) + plane[3] < -meshlet.radius * n) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// True if every triangle of the meshlet faces away from the eye.
+LM_DEVICE_FUNC inline bool MeshletBackfacing(const Meshlet &meshlet, const Vector3<float> &eye) {
+  Vector3<float> view = meshlet.center - eye;
+  return view.dot(meshlet.cone_axis) >= meshlet.cone_cutoff * view.norm() + meshlet.radius;
+}
+
+}  // namespace grassland
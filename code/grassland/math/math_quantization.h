@@ -0,0 +1,107 @@
+#pragma once
+#include <cstring>
+
+#include "grassland/math/math_util.h"
+
+namespace grassland {
+
+LM_DEVICE_FUNC inline uint16_t QuantizeUnorm16(float x) {
+  x = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+  return static_cast<uint16_t>(x * 65535.0f + 0.5f);
+}
+
+LM_DEVICE_FUNC inline float DequantizeUnorm16(uint16_t q) {
+  return static_cast<float>(q) * (1.0f / 65535.0f);
+}
+
+// Octahedral mapping of a unit vector (Meyer et al. 2010), two 16-bit unorm components packed as x | y << 16.
+LM_DEVICE_FUNC inline uint32_t EncodeOctahedral16(const Vector3<float> &v) {
+  float l1 = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+  if (l1 <= 0.0f) {
+    return QuantizeUnorm16(0.5f) | (static_cast<uint32_t>(QuantizeUnorm16(0.5f)) << 16);
+  }
+  float x = v[0] / l1;
+  float y = v[1] / l1;
+  if (v[2] < 0.0f) {
+    float wrapped_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float wrapped_y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = wrapped_x;
+    y = wrapped_y;
+  }
+  return QuantizeUnorm16(x * 0.5f + 0.5f) | (static_cast<uint32_t>(QuantizeUnorm16(y * 0.5f + 0.5f)) << 16);
+}
+
+LM_DEVICE_FUNC inline Vector3<float> DecodeOctahedral16(uint32_t packed) {
+  float x = DequantizeUnorm16(packed & 0xffffu) * 2.0f - 1.0f;
+  float y = DequantizeUnorm16(packed >> 16) * 2.0f - 1.0f;
+  Vector3<float> v{x, y, 1.0f - fabsf(x) - fabsf(y)};
+  float t = v[2] < 0.0f ? -v[2] : 0.0f;
+  v[0] += v[0] >= 0.0f ? -t : t;
+  v[1] += v[1] >= 0.0f ? -t : t;
+  return v.normalized();
+}
+
+// IEEE 754 binary16 conversion with round-to-nearest-even, matching f16tof32/f32tof16 in HLSL.
+LM_DEVICE_FUNC inline uint16_t FloatToHalf(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  uint32_t sign = (x >> 16) & 0x8000u;
+  uint32_t mantissa = x & 0x7fffffu;
+  int exponent = static_cast<int>((x >> 23) & 0xffu);
+  if (exponent == 0xff) {
+    return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+  }
+  exponent = exponent - 127 + 15;
+  if (exponent >= 0x1f) {
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    mantissa |= 0x800000u;
+    uint32_t shift = static_cast<uint32_t>(14 - exponent);
+    uint32_t half_mantissa = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1u);
+    uint32_t halfway = 1u << (shift - 1u);
+    if (remainder > halfway || (remainder == halfway && (half_mantissa & 1u))) {
+      half_mantissa++;
+    }
+    return static_cast<uint16_t>(sign | half_mantissa);
+  }
+  uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+  uint32_t remainder = mantissa & 0x1fffu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+    half++;
+  }
+  return static_cast<uint16_t>(half);
+}
+
+LM_DEVICE_FUNC inline float HalfToFloat(uint16_t h) {
+  uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+  uint32_t exponent = (h >> 10) & 0x1fu;
+  uint32_t mantissa = h & 0x3ffu;
+  uint32_t x;
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      x = sign;
+    } else {
+      int e = -14;
+      while (!(mantissa & 0x400u)) {
+        mantissa <<= 1;
+        e--;
+      }
+      mantissa &= 0x3ffu;
+      x = sign | (static_cast<uint32_t>(e + 127) << 23) | (mantissa << 13);
+    }
+  } else if (exponent == 0x1f) {
+    x = sign | 0x7f800000u | (mantissa << 13);
+  } else {
+    x = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+}  // namespace grassland
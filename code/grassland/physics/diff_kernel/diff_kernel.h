@@ -1,8 +1,10 @@
 #pragma once
 #include "grassland/physics/diff_kernel/dk_basics.h"
+#include "grassland/physics/diff_kernel/dk_batch_evaluator.h"
 #include "grassland/physics/diff_kernel/dk_dihedral_angle.h"
 #include "grassland/physics/diff_kernel/dk_elastic_models.h"
 #include "grassland/physics/diff_kernel/dk_fem_elements.h"
 #include "grassland/physics/diff_kernel/dk_geometry_sdf.h"
+#include "grassland/physics/diff_kernel/dk_hessian_assembler.h"
 
 namespace grassland {}
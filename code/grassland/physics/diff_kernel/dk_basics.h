@@ -13,6 +13,109 @@ template <typename Func>
 using HessianType =
     HessianTensor<typename Func::Scalar, Func::OutputType::SizeAtCompileTime, Func::InputType::SizeAtCompileTime>;
 
+template <typename Func, typename = void>
+struct HessianStructureOf {
+  static constexpr HessianStructure value = HESSIAN_STRUCTURE_DENSE;
+};
+
+template <typename Func>
+struct HessianStructureOf<Func, std::void_t<decltype(Func::kHessianStructure)>> {
+  static constexpr HessianStructure value = Func::kHessianStructure;
+};
+
+// Structure of H2 * J1 + J2 * H1 given the structures of H1 and H2.
+constexpr HessianStructure ComposedHessianStructure(HessianStructure structure1, HessianStructure structure2) {
+  if (structure1 == HESSIAN_STRUCTURE_ZERO && structure2 == HESSIAN_STRUCTURE_ZERO) {
+    return HESSIAN_STRUCTURE_ZERO;
+  }
+  if (structure1 == HESSIAN_STRUCTURE_DENSE || structure2 == HESSIAN_STRUCTURE_DENSE) {
+    return HESSIAN_STRUCTURE_DENSE;
+  }
+  return HESSIAN_STRUCTURE_SYMMETRIC;
+}
+
+// H * A, the chain rule term for a Hessian H of Func followed by an inner function with Jacobian A.
+template <typename Func, int NewInputDim>
+LM_DEVICE_FUNC HessianTensor<typename Func::Scalar, Func::OutputType::SizeAtCompileTime, NewInputDim> HessianChain(
+    const HessianType<Func> &H,
+    const Eigen::Matrix<typename Func::Scalar, Func::InputType::SizeAtCompileTime, NewInputDim> &A) {
+  if constexpr (HessianStructureOf<Func>::value == HESSIAN_STRUCTURE_ZERO) {
+    return {};
+  } else if constexpr (HessianStructureOf<Func>::value == HESSIAN_STRUCTURE_SYMMETRIC) {
+    return H.SymmetricProduct(A);
+  } else {
+    return H * A;
+  }
+}
+
+// A * H, the chain rule term for an outer function with Jacobian A following a function Func with Hessian H.
+template <typename Func, int NewOutputDim>
+LM_DEVICE_FUNC HessianTensor<typename Func::Scalar, NewOutputDim, Func::InputType::SizeAtCompileTime> HessianContract(
+    const Eigen::Matrix<typename Func::Scalar, NewOutputDim, Func::OutputType::SizeAtCompileTime> &A,
+    const HessianType<Func> &H) {
+  if constexpr (HessianStructureOf<Func>::value == HESSIAN_STRUCTURE_ZERO) {
+    return {};
+  } else if constexpr (HessianStructureOf<Func>::value == HESSIAN_STRUCTURE_SYMMETRIC) {
+    return HessianType<Func>::SymmetricContract(A, H);
+  } else {
+    return A * H;
+  }
+}
+
+template <typename Func, typename = void>
+struct HasEvaluateAll : std::false_type {};
+
+template <typename Func>
+struct HasEvaluateAll<Func,
+                      std::void_t<decltype(std::declval<const Func &>().EvaluateAll(
+                          std::declval<const typename Func::InputType &>(), nullptr, nullptr, nullptr))>>
+    : std::true_type {};
+
+// Value, Jacobian and Hessian in one pass, any of the outputs may be null. Functions that share intermediate results
+// between the three provide an EvaluateAll member, the others go through their separate calls.
+template <typename Func>
+LM_DEVICE_FUNC void EvaluateAll(const Func &f,
+                                const typename Func::InputType &x,
+                                typename Func::OutputType *value,
+                                JacobianType<Func> *J,
+                                HessianType<Func> *H) {
+  if constexpr (HasEvaluateAll<Func>::value) {
+    f.EvaluateAll(x, value, J, H);
+  } else {
+    if (value) {
+      *value = f(x);
+    }
+    if (J) {
+      *J = f.Jacobian(x);
+    }
+    if (H) {
+      *H = f.Hessian(x);
+    }
+  }
+}
+
+// Scratch Hessian of an intermediate function, empty when the function is linear. It is zeroed only when asked for,
+// so an evaluation without Hessians does not pay for clearing it.
+template <typename Func, bool = HessianStructureOf<Func>::value == HESSIAN_STRUCTURE_ZERO>
+struct HessianScratch {
+  LM_DEVICE_FUNC HessianType<Func> *Get(bool needed) {
+    if (!needed) {
+      return nullptr;
+    }
+    H.SetZero();
+    return &H;
+  }
+
+  HessianType<Func> H{typename HessianType<Func>::Uninitialized{}};
+};
+
+template <typename Func>
+struct HessianScratch<Func, true> {
+  LM_DEVICE_FUNC HessianType<Func> *Get(bool) {
+    return nullptr;
+  }
+};
+
 template <typename Func1, typename Func2>
 struct Compose {
   Func1 f1;
@@ -22,6 +125,9 @@ struct Compose {
   typedef typename Func1::InputType InputType;
   typedef typename Func2::OutputType OutputType;
 
+  static constexpr HessianStructure kHessianStructure =
+      ComposedHessianStructure(HessianStructureOf<Func1>::value, HessianStructureOf<Func2>::value);
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &x) const {
     return f1.ValidInput(x) && f2.ValidInput(f1(x));
   }
@@ -32,16 +138,46 @@ struct Compose {
 
   LM_DEVICE_FUNC Eigen::Matrix<Scalar, OutputType::SizeAtCompileTime, InputType::SizeAtCompileTime> Jacobian(
       const InputType &x) const {
-    return f2.Jacobian(f1(x)) * f1.Jacobian(x);
+    Eigen::Matrix<Scalar, OutputType::SizeAtCompileTime, InputType::SizeAtCompileTime> J;
+    EvaluateAll(x, nullptr, &J, nullptr);
+    return J;
   }
 
   LM_DEVICE_FUNC HessianTensor<Scalar, OutputType::SizeAtCompileTime, InputType::SizeAtCompileTime> Hessian(
       const InputType &x) const {
-    auto J1 = f1.Jacobian(x);
-    auto J2 = f2.Jacobian(f1(x));
-    auto H1 = f1.Hessian(x);
-    auto H2 = f2.Hessian(f1(x));
-    return H2 * J1 + J2 * H1;
+    HessianTensor<Scalar, OutputType::SizeAtCompileTime, InputType::SizeAtCompileTime> H;
+    if constexpr (kHessianStructure != HESSIAN_STRUCTURE_ZERO) {
+      EvaluateAll(x, nullptr, nullptr, &H);
+    }
+    return H;
+  }
+
+  // Each function of the chain is evaluated once, inner results are passed on instead of being recomputed.
+  LM_DEVICE_FUNC void EvaluateAll(const InputType &x,
+                                  OutputType *value,
+                                  JacobianType<Compose> *J,
+                                  HessianType<Compose> *H) const {
+    bool need_jacobians = J || H;
+    typename Func1::OutputType y;
+    JacobianType<Func1> J1;
+    JacobianType<Func2> J2;
+    HessianScratch<Func1> H1;
+    HessianScratch<Func2> H2;
+    grassland::EvaluateAll(f1, x, &y, need_jacobians ? &J1 : nullptr, H1.Get(H != nullptr));
+    grassland::EvaluateAll(f2, y, value, need_jacobians ? &J2 : nullptr, H2.Get(H != nullptr));
+    if (J) {
+      *J = J2 * J1;
+    }
+    if (H) {
+      if constexpr (HessianStructureOf<Func2>::value == HESSIAN_STRUCTURE_ZERO) {
+        *H = HessianType<Compose>();
+      } else {
+        *H = HessianChain<Func2>(H2.H, J1);
+      }
+      if constexpr (HessianStructureOf<Func1>::value != HESSIAN_STRUCTURE_ZERO) {
+        *H += HessianContract<Func1>(J2, H1.H);
+      }
+    }
   }
 };
 
@@ -51,6 +187,8 @@ struct Determinant3 {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &A) const {
     return true;
   }
@@ -88,6 +226,8 @@ struct LogDeterminant3 {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &A) const {
     return A.determinant() > 0;
   }
@@ -120,6 +260,8 @@ struct LogSquareDeterminant3 {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &A) const {
     return A.determinant() > 0;
   }
@@ -155,6 +297,8 @@ struct VecLength {
   typedef Eigen::Vector<Real, dim> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const {
     return v.norm() > Eps<Real>() * 100;
   }
@@ -183,6 +327,8 @@ struct VecNormalized {
   typedef Eigen::Vector<Real, dim> InputType;
   typedef Eigen::Vector<Real, dim> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const {
     return v.norm() > Eps<Real>() * 100;
   }
@@ -230,6 +376,8 @@ struct Cross3 {
   typedef Eigen::Matrix<Real, 3, 2> InputType;
   typedef Eigen::Vector<Real, 3> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const {
     return true;
   }
@@ -275,6 +423,8 @@ struct Dot {
   typedef Eigen::Matrix<Real, 3, 2> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const {
     return true;
   }
@@ -314,6 +464,8 @@ struct Atan2 {
   typedef Eigen::Vector<Real, 2> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const {
     return v.norm() > Eps<Real>() * 100;
   }
@@ -348,6 +500,8 @@ struct CrossNorm {
   typedef Eigen::Matrix<Real, 3, 2> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &F) const {
     return F.col(0).cross(F.col(1)).norm() > Eps<Real>() * 100;
   }
@@ -387,6 +541,8 @@ struct MultiplyConstant {
   typedef typename Func::InputType InputType;
   typedef typename Func::OutputType OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HessianStructureOf<Func>::value;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const {
     return f.ValidInput(v);
   }
@@ -405,6 +561,22 @@ struct MultiplyConstant {
     return f.Hessian(v) * s;
   }
 
+  LM_DEVICE_FUNC void EvaluateAll(const InputType &v,
+                                  OutputType *value,
+                                  JacobianType<MultiplyConstant> *J,
+                                  HessianType<MultiplyConstant> *H) const {
+    grassland::EvaluateAll(f, v, value, J, H);
+    if (value) {
+      *value *= s;
+    }
+    if (J) {
+      *J *= s;
+    }
+    if (H) {
+      *H = *H * s;
+    }
+  }
+
   Func f{};
   Scalar s{1.0};
 };
@@ -415,6 +587,8 @@ struct PlusConstant {
   typedef typename Func::InputType InputType;
   typedef typename Func::OutputType OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HessianStructureOf<Func>::value;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const {
     return f.ValidInput(v);
   }
@@ -433,6 +607,16 @@ struct PlusConstant {
     return f.Hessian(v);
   }
 
+  LM_DEVICE_FUNC void EvaluateAll(const InputType &v,
+                                  OutputType *value,
+                                  JacobianType<PlusConstant> *J,
+                                  HessianType<PlusConstant> *H) const {
+    grassland::EvaluateAll(f, v, value, J, H);
+    if (value) {
+      *value += s;
+    }
+  }
+
   Func f{};
   OutputType s{};
 };
@@ -443,6 +627,8 @@ struct RightMultiplyMatrix {
   typedef typename Func::InputType InputType;
   typedef typename Eigen::Matrix<Scalar, Func::OutputType::RowsAtCompileTime, MatrixType::ColsAtCompileTime> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HessianStructureOf<Func>::value;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const {
     return f.ValidInput(v);
   }
@@ -0,0 +1,242 @@
+#include "grassland/physics/diff_kernel/dk_batch_evaluator.h"
+
+namespace grassland {
+
+template <typename Func>
+void BatchKernel<Func>::SetParameters(const Func *functions, size_t num_elements, Parameters *parameters) {
+  parameters->functions.assign(functions, functions + num_elements);
+}
+
+template <typename Func>
+void BatchKernel<Func>::Evaluate(const Parameters &parameters,
+                                 size_t begin,
+                                 size_t end,
+                                 size_t stride,
+                                 const Real *inputs,
+                                 Real *values,
+                                 Real *gradients,
+                                 Real *hessians) {
+  size_t input_stride = end - begin;
+  for (size_t e = begin; e < end; e++) {
+    const Func &function = parameters.functions[e];
+    typename Func::InputType x;
+    for (int c = 0; c < kInputDim; c++) {
+      x.data()[c] = inputs[c * input_stride + e - begin];
+    }
+    if (values) {
+      values[e] = function(x).value();
+    }
+    if (gradients) {
+      auto J = function.Jacobian(x);
+      for (int c = 0; c < kInputDim; c++) {
+        gradients[c * stride + e] = J(0, c);
+      }
+    }
+    if (hessians) {
+      auto H = function.Hessian(x);
+      for (int r = 0; r < kInputDim; r++) {
+        for (int c = 0; c < kInputDim; c++) {
+          hessians[(r * kInputDim + c) * stride + e] = H.m[0](r, c);
+        }
+      }
+    }
+  }
+}
+
+template <typename Real>
+void BatchKernel<ElasticNeoHookeanSimpleTriangle<Real>>::SetParameters(
+    const ElasticNeoHookeanSimpleTriangle<Real> *functions,
+    size_t num_elements,
+    Parameters *parameters) {
+  parameters->mu.resize(num_elements);
+  parameters->lambda.resize(num_elements);
+  for (auto &dm_inv : parameters->dm_inv) {
+    dm_inv.resize(num_elements);
+  }
+  for (size_t e = 0; e < num_elements; e++) {
+    parameters->mu[e] = functions[e].mu;
+    parameters->lambda[e] = functions[e].lambda;
+    Eigen::Matrix2<Real> dm_inv = functions[e].Dm.inverse();
+    for (int i = 0; i < 4; i++) {
+      parameters->dm_inv[i][e] = dm_inv.data()[i];
+    }
+  }
+}
+
+// Closed form of ElasticNeoHookeanSimpleF3x2 composed with FEMTriangleDeformationGradient3x2, evaluated one element
+// per iteration with scalar arithmetic only so that the loop over elements vectorizes.
+template <typename Real>
+void BatchKernel<ElasticNeoHookeanSimpleTriangle<Real>>::Evaluate(const Parameters &parameters,
+                                                                  size_t begin,
+                                                                  size_t end,
+                                                                  size_t stride,
+                                                                  const Real *inputs,
+                                                                  Real *values,
+                                                                  Real *gradients,
+                                                                  Real *hessians) {
+  const Real *mu_ptr = parameters.mu.data();
+  const Real *lambda_ptr = parameters.lambda.data();
+  const Real *a_ptr = parameters.dm_inv[0].data();
+  const Real *c_ptr = parameters.dm_inv[1].data();
+  const Real *b_ptr = parameters.dm_inv[2].data();
+  const Real *d_ptr = parameters.dm_inv[3].data();
+  size_t input_stride = end - begin;
+  for (size_t e = begin; e < end; e++) {
+    Real mu = mu_ptr[e];
+    Real lambda = lambda_ptr[e];
+    // F = [e1 e2] * Dm^-1, Dm^-1 = [a b; c d]
+    Real a = a_ptr[e];
+    Real b = b_ptr[e];
+    Real c = c_ptr[e];
+    Real d = d_ptr[e];
+    Real w[2][3] = {{-(a + c), a, c}, {-(b + d), b, d}};  // dF.col(i) / dx_v = w[i][v] * I
+
+    Real f[2][3];
+    for (int k = 0; k < 3; k++) {
+      Real x0 = inputs[k * input_stride + e - begin];
+      Real e1 = inputs[(3 + k) * input_stride + e - begin] - x0;
+      Real e2 = inputs[(6 + k) * input_stride + e - begin] - x0;
+      f[0][k] = a * e1 + c * e2;
+      f[1][k] = b * e1 + d * e2;
+    }
+
+    Real n[3] = {f[0][1] * f[1][2] - f[0][2] * f[1][1], f[0][2] * f[1][0] - f[0][0] * f[1][2],
+                 f[0][0] * f[1][1] - f[0][1] * f[1][0]};
+    Real J = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    Real inv_J = Real(1) / J;
+    for (int k = 0; k < 3; k++) {
+      n[k] *= inv_J;
+    }
+    Real alpha = Real(1) + mu / lambda;
+    Real s = lambda * (J - alpha);
+
+    // dJ/df0 = f1 x n, dJ/df1 = n x f0
+    Real g[2][3] = {
+        {f[1][1] * n[2] - f[1][2] * n[1], f[1][2] * n[0] - f[1][0] * n[2], f[1][0] * n[1] - f[1][1] * n[0]},
+        {n[1] * f[0][2] - n[2] * f[0][1], n[2] * f[0][0] - n[0] * f[0][2], n[0] * f[0][1] - n[1] * f[0][0]}};
+
+    if (values) {
+      Real I2 = Real(1);
+      for (int k = 0; k < 3; k++) {
+        I2 += f[0][k] * f[0][k] + f[1][k] * f[1][k];
+      }
+      values[e] = Real(0.5) * mu * (I2 - Real(3)) + Real(0.5) * lambda * (J - alpha) * (J - alpha);
+    }
+
+    if (gradients) {
+      Real P[2][3];
+      for (int i = 0; i < 2; i++) {
+        for (int k = 0; k < 3; k++) {
+          P[i][k] = mu * f[i][k] + s * g[i][k];
+        }
+      }
+      for (int v = 0; v < 3; v++) {
+        for (int k = 0; k < 3; k++) {
+          gradients[(v * 3 + k) * stride + e] = w[0][v] * P[0][k] + w[1][v] * P[1][k];
+        }
+      }
+    }
+
+    if (hessians) {
+      // d(f0 x f1)/df0 = -[f1]x, d(f0 x f1)/df1 = [f0]x, the cross norm Hessian is
+      // S_i^T (I - n n^T) S_j / J plus the constant second derivative of the cross product contracted with n.
+      Real S[2][3][3] = {{{0, f[1][2], -f[1][1]}, {-f[1][2], 0, f[1][0]}, {f[1][1], -f[1][0], 0}},
+                         {{0, -f[0][2], f[0][1]}, {f[0][2], 0, -f[0][0]}, {-f[0][1], f[0][0], 0}}};
+      Real Q[2][3][3];
+      for (int i = 0; i < 2; i++) {
+        for (int r = 0; r < 3; r++) {
+          for (int col = 0; col < 3; col++) {
+            Real n_dot = n[0] * S[i][0][col] + n[1] * S[i][1][col] + n[2] * S[i][2][col];
+            Q[i][r][col] = S[i][r][col] - n[r] * n_dot;
+          }
+        }
+      }
+      Real K[3][3] = {{0, n[2], -n[1]}, {-n[2], 0, n[0]}, {n[1], -n[0], 0}};  // -[n]x, block (f0, f1)
+      Real HF[2][2][3][3];
+      for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+          for (int r = 0; r < 3; r++) {
+            for (int col = 0; col < 3; col++) {
+              Real A = S[i][0][r] * Q[j][0][col] + S[i][1][r] * Q[j][1][col] + S[i][2][r] * Q[j][2][col];
+              Real cross_hessian = i == j ? Real(0) : (i == 0 ? K[r][col] : K[col][r]);
+              HF[i][j][r][col] = s * (A * inv_J + cross_hessian) + lambda * g[i][r] * g[j][col] +
+                                 (i == j && r == col ? mu : Real(0));
+            }
+          }
+        }
+      }
+      for (int v = 0; v < 3; v++) {
+        for (int u = 0; u < 3; u++) {
+          for (int r = 0; r < 3; r++) {
+            for (int col = 0; col < 3; col++) {
+              Real h = w[0][v] * (w[0][u] * HF[0][0][r][col] + w[1][u] * HF[0][1][r][col]) +
+                       w[1][v] * (w[0][u] * HF[1][0][r][col] + w[1][u] * HF[1][1][r][col]);
+              hessians[((v * 3 + r) * kInputDim + u * 3 + col) * stride + e] = h;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Func>
+BatchEvaluator<Func>::BatchEvaluator(ThreadPool *thread_pool, size_t grain_size)
+    : thread_pool_(thread_pool), grain_size_(grain_size) {
+}
+
+template <typename Func>
+void BatchEvaluator<Func>::SetElements(const Func *functions, const uint32_t *indices, size_t num_elements) {
+  num_elements_ = num_elements;
+  indices_.assign(indices, indices + num_elements * kNumVertices);
+  BatchKernel<Func>::SetParameters(functions, num_elements, &parameters_);
+}
+
+template <typename Func>
+size_t BatchEvaluator<Func>::NumElements() const {
+  return num_elements_;
+}
+
+template <typename Func>
+void BatchEvaluator<Func>::Evaluate(const Vector3<Real> *positions,
+                                   Real *values,
+                                   Real *gradients,
+                                   Real *hessians) const {
+  auto evaluate_range = [&](size_t begin, size_t end, size_t) {
+    Real inputs[kInputDim * kBlockSize];
+    for (size_t block_begin = begin; block_begin < end; block_begin += kBlockSize) {
+      size_t block_end = std::min(block_begin + kBlockSize, end);
+      size_t block_size = block_end - block_begin;
+      for (int v = 0; v < kNumVertices; v++) {
+        for (size_t e = block_begin; e < block_end; e++) {
+          const Vector3<Real> &p = positions[indices_[e * kNumVertices + v]];
+          for (int k = 0; k < 3; k++) {
+            inputs[(v * 3 + k) * block_size + e - block_begin] = p[k];
+          }
+        }
+      }
+      BatchKernel<Func>::Evaluate(parameters_, block_begin, block_end, num_elements_, inputs, values, gradients,
+                                  hessians);
+    }
+  };
+  if (thread_pool_) {
+    thread_pool_->ParallelFor(num_elements_, grain_size_, evaluate_range);
+  } else {
+    evaluate_range(0, num_elements_, 0);
+  }
+}
+
+#define DECLARE_BATCH_EVALUATOR(Func)         \
+  template struct BatchKernel<Func<float>>;   \
+  template struct BatchKernel<Func<double>>;  \
+  template class BatchEvaluator<Func<float>>; \
+  template class BatchEvaluator<Func<double>>;
+
+DECLARE_BATCH_EVALUATOR(ElasticNeoHookeanTriangle)
+DECLARE_BATCH_EVALUATOR(ElasticNeoHookeanSimpleTriangle)
+DECLARE_BATCH_EVALUATOR(ElasticNeoHookeanTetrahedron)
+DECLARE_BATCH_EVALUATOR(ElasticNeoHookeanSimpleTetrahedron)
+DECLARE_BATCH_EVALUATOR(DihedralEnergy)
+DECLARE_BATCH_EVALUATOR(DihedralAngle)
+
+}  // namespace grassland
@@ -0,0 +1,98 @@
+#pragma once
+#include "grassland/physics/diff_kernel/dk_dihedral_angle.h"
+#include "grassland/physics/diff_kernel/dk_elastic_models.h"
+#include "grassland/util/thread_pool.h"
+
+namespace grassland {
+
+// Per-element parameters and the evaluation loop of a scalar energy over a batch of elements. The generic version
+// falls back to calling the AoS functor once per element, it gathers the element input from the SoA block and
+// scatters the results but does not vectorize across elements. Only ElasticNeoHookeanSimpleTriangle has a
+// specialization so far, it transposes the parameters into SoA and evaluates a whole range with loops over elements
+// that the compiler can vectorize. The other instantiated energies (ElasticNeoHookeanTriangle, the tetrahedra and the
+// dihedral energies) take the generic path.
+// inputs only holds the elements of [begin, end), component c of element e is at [c * (end - begin) + e - begin].
+// Outputs use the SoA layout of BatchEvaluator, component c of element e is at [c * stride + e].
+template <typename Func>
+struct BatchKernel {
+  typedef typename Func::Scalar Real;
+  static constexpr int kInputDim = Func::InputType::SizeAtCompileTime;
+
+  struct Parameters {
+    std::vector<Func> functions;
+  };
+
+  static void SetParameters(const Func *functions, size_t num_elements, Parameters *parameters);
+
+  static void Evaluate(const Parameters &parameters,
+                       size_t begin,
+                       size_t end,
+                       size_t stride,
+                       const Real *inputs,
+                       Real *values,
+                       Real *gradients,
+                       Real *hessians);
+};
+
+template <typename Real>
+struct BatchKernel<ElasticNeoHookeanSimpleTriangle<Real>> {
+  static constexpr int kInputDim = 9;
+
+  struct Parameters {
+    std::vector<Real> mu;
+    std::vector<Real> lambda;
+    std::vector<Real> dm_inv[4];  // column-major 2x2
+  };
+
+  static void SetParameters(const ElasticNeoHookeanSimpleTriangle<Real> *functions,
+                            size_t num_elements,
+                            Parameters *parameters);
+
+  static void Evaluate(const Parameters &parameters,
+                       size_t begin,
+                       size_t end,
+                       size_t stride,
+                       const Real *inputs,
+                       Real *values,
+                       Real *gradients,
+                       Real *hessians);
+};
+
+// Evaluates value, gradient and Hessian of a scalar per-element energy for many elements at once. Func takes the
+// vertex positions of one element as the columns of a 3xN matrix, elements index into a shared position array.
+// Outputs are SoA so that one component of all elements is contiguous:
+//   values[e], gradients[c * num_elements + e], hessians[(r * kInputDim + c) * num_elements + e]
+// where r and c index the flattened element input (vertex * 3 + axis).
+template <typename Func>
+class BatchEvaluator {
+ public:
+  typedef typename Func::Scalar Real;
+  static constexpr int kNumVertices = Func::InputType::ColsAtCompileTime;
+  static constexpr int kInputDim = Func::InputType::SizeAtCompileTime;
+  static_assert(Func::InputType::RowsAtCompileTime == 3, "BatchEvaluator expects vertex positions as columns");
+  static_assert(Func::OutputType::SizeAtCompileTime == 1, "BatchEvaluator expects a scalar energy");
+
+  // thread_pool may be null for a single threaded evaluation, grain_size is the number of elements per task.
+  BatchEvaluator(ThreadPool *thread_pool = nullptr, size_t grain_size = 1024);
+
+  // indices holds kNumVertices vertex indices per element.
+  void SetElements(const Func *functions, const uint32_t *indices, size_t num_elements);
+
+  size_t NumElements() const;
+
+  // Any of values, gradients and hessians may be null. The transposed inputs live in a small block on the stack of
+  // each task, so concurrent calls on one evaluator are safe as long as their outputs do not overlap.
+  void Evaluate(const Vector3<Real> *positions, Real *values, Real *gradients, Real *hessians) const;
+
+ private:
+  // Number of elements transposed and evaluated together within a task.
+  static constexpr size_t kBlockSize = 64;
+
+  ThreadPool *thread_pool_;
+  size_t grain_size_;
+  size_t num_elements_{0};
+  std::vector<uint32_t> indices_;
+  typename BatchKernel<Func>::Parameters parameters_;
+};
+
+}  // namespace grassland
@@ -164,20 +164,37 @@ LM_DEVICE_FUNC typename DihedralEnergy<Real>::OutputType DihedralEnergy<Real>::o
 
 template <typename Real>
 LM_DEVICE_FUNC Eigen::Matrix<Real, 1, 12> DihedralEnergy<Real>::Jacobian(const InputType &V) const {
-  DihedralAngleByVertices<Real> dihedral_angle;
-  auto angle = dihedral_angle(V).value() - rest_angle;
-  auto J = dihedral_angle.Jacobian(V);
-  return (Real(2.0) * angle) * J;
+  Eigen::Matrix<Real, 1, 12> J;
+  EvaluateAll(V, nullptr, &J, nullptr);
+  return J;
 }
 
 template <typename Real>
 LM_DEVICE_FUNC HessianTensor<Real, 1, 12> DihedralEnergy<Real>::Hessian(const InputType &V) const {
+  HessianTensor<Real, 1, 12> H;
+  EvaluateAll(V, nullptr, nullptr, &H);
+  return H;
+}
+
+template <typename Real>
+LM_DEVICE_FUNC void DihedralEnergy<Real>::EvaluateAll(const InputType &V,
+                                                      OutputType *value,
+                                                      Eigen::Matrix<Real, 1, 12> *J,
+                                                      HessianTensor<Real, 1, 12> *H) const {
   DihedralAngleByVertices<Real> dihedral_angle;
-  auto angle = dihedral_angle(V).value() - rest_angle;
-  auto J = dihedral_angle.Jacobian(V);
-  auto H = dihedral_angle.Hessian(V);
-  H.m[0] = H.m[0] * angle + J.transpose() * J;
-  return H * 2.0;
+  typename DihedralAngleByVertices<Real>::OutputType angle;
+  Eigen::Matrix<Real, 1, 12> angle_J;
+  grassland::EvaluateAll(dihedral_angle, V, &angle, (J || H) ? &angle_J : nullptr, H);
+  Real res = angle.value() - rest_angle;
+  if (value) {
+    *value = OutputType{res * res};
+  }
+  if (J) {
+    *J = (Real(2.0) * res) * angle_J;
+  }
+  if (H) {
+    H->m[0] = Real(2.0) * (H->m[0] * res + angle_J.transpose() * angle_J);
+  }
 }
 
 template class DihedralEnergy<float>;
@@ -9,6 +9,8 @@ struct DihedralAngleAssistEdgesToNormalsAxis {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 3, 3> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &A) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &E) const;
@@ -24,6 +26,8 @@ struct DihedralAngleAssistNormalsAxisToSinCosTheta {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Vector<Real, 2> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &normals_axis) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &N) const;
@@ -39,6 +43,8 @@ struct DihedralAngleAssistVerticesToEdges {
   typedef Eigen::Matrix<Real, 3, 4> InputType;
   typedef Eigen::Matrix<Real, 3, 3> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_ZERO;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &V) const;
@@ -62,6 +68,8 @@ struct DihedralEnergy {
   typedef Eigen::Matrix<Real, 3, 4> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &V) const;
@@ -70,6 +78,11 @@ struct DihedralEnergy {
 
   LM_DEVICE_FUNC HessianTensor<Real, 1, 12> Hessian(const InputType &V) const;
 
+  LM_DEVICE_FUNC void EvaluateAll(const InputType &V,
+                                  OutputType *value,
+                                  Eigen::Matrix<Real, 1, 12> *J,
+                                  HessianTensor<Real, 1, 12> *H) const;
+
   Scalar rest_angle{0.0};
 };
 
@@ -79,6 +92,8 @@ struct DihedralAngle {
   typedef Eigen::Matrix<Real, 3, 4> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &) const;
 
   LM_DEVICE_FUNC Eigen::Matrix<Real, 1, 12> Jacobian(const InputType &V) const;
@@ -206,7 +206,8 @@ template <typename Real>
 LM_DEVICE_FUNC HessianTensor<Real, 1, 12> ElasticNeoHookeanTetrahedron<Real>::Hessian(const InputType &V) const {
   FEMTetrahedronDeformationGradient<Real> deformation_gradient{Dm};
   ElasticNeoHookean<Real> neo_hookean{mu, lambda};
-  return neo_hookean.Hessian(deformation_gradient(V)) * deformation_gradient.Jacobian(V);
+  return HessianChain<ElasticNeoHookean<Real>>(neo_hookean.Hessian(deformation_gradient(V)),
+                                               deformation_gradient.Jacobian(V));
 }
 
 template <typename Real>
@@ -273,7 +274,8 @@ template <typename Real>
 LM_DEVICE_FUNC HessianTensor<Real, 1, 12> ElasticNeoHookeanSimpleTetrahedron<Real>::Hessian(const InputType &V) const {
   FEMTetrahedronDeformationGradient<Real> deformation_gradient{Dm};
   ElasticNeoHookeanSimple<Real> neo_hookean{mu, lambda};
-  return neo_hookean.Hessian(deformation_gradient(V)) * deformation_gradient.Jacobian(V);
+  return HessianChain<ElasticNeoHookeanSimple<Real>>(neo_hookean.Hessian(deformation_gradient(V)),
+                                                     deformation_gradient.Jacobian(V));
 }
 
 template <typename Real>
@@ -341,7 +343,8 @@ template <typename Real>
 LM_DEVICE_FUNC HessianTensor<Real, 1, 9> ElasticNeoHookeanTriangle<Real>::Hessian(const InputType &V) const {
   FEMTriangleDeformationGradient3x2<Real> deformation_gradient3x2{Dm};
   ElasticNeoHookeanF3x2<Real> neo_hookean_f3x2{mu, lambda};
-  return neo_hookean_f3x2.Hessian(deformation_gradient3x2(V)) * deformation_gradient3x2.Jacobian(V);
+  return HessianChain<ElasticNeoHookeanF3x2<Real>>(neo_hookean_f3x2.Hessian(deformation_gradient3x2(V)),
+                                                   deformation_gradient3x2.Jacobian(V));
 }
 
 template class ElasticNeoHookeanTriangle<float>;
@@ -373,7 +376,8 @@ template <typename Real>
 LM_DEVICE_FUNC HessianTensor<Real, 1, 9> ElasticNeoHookeanSimpleTriangle<Real>::Hessian(const InputType &V) const {
   FEMTriangleDeformationGradient3x2<Real> deformation_gradient3x2{Dm};
   ElasticNeoHookeanSimpleF3x2<Real> neo_hookean_f3x2{mu, lambda};
-  return neo_hookean_f3x2.Hessian(deformation_gradient3x2(V)) * deformation_gradient3x2.Jacobian(V);
+  return HessianChain<ElasticNeoHookeanSimpleF3x2<Real>>(neo_hookean_f3x2.Hessian(deformation_gradient3x2(V)),
+                                                         deformation_gradient3x2.Jacobian(V));
 }
 
 template class ElasticNeoHookeanSimpleTriangle<float>;
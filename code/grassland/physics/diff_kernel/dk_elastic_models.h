@@ -9,6 +9,8 @@ struct ElasticNeoHookean {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &F) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &F) const;
@@ -27,6 +29,8 @@ struct ElasticNeoHookeanSimple {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &F) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &F) const;
@@ -45,6 +49,8 @@ struct ElasticNeoHookeanF3x2 {
   typedef Eigen::Matrix<Real, 3, 2> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &F) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &F) const;
@@ -63,6 +69,8 @@ struct ElasticNeoHookeanSimpleF3x2 {
   typedef Eigen::Matrix<Real, 3, 2> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &F) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &F) const;
@@ -81,6 +89,8 @@ struct ElasticNeoHookeanTetrahedron {
   typedef Eigen::Matrix<Real, 3, 4> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &V) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &V) const;
@@ -102,6 +112,8 @@ struct ElasticNeoHookeanSimpleTetrahedron {
   typedef Eigen::Matrix<Real, 3, 4> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &V) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &V) const;
@@ -123,6 +135,8 @@ struct ElasticNeoHookeanTriangle {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &V) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &V) const;
@@ -142,6 +156,8 @@ struct ElasticNeoHookeanSimpleTriangle {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &V) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &V) const;
@@ -9,6 +9,8 @@ struct FEMTetrahedronDeformationGradient {
   typedef Eigen::Matrix<Real, 3, 4> InputType;
   typedef Eigen::Matrix<Real, 3, 3> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_ZERO;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &) const {
     return true;
   }
@@ -85,6 +87,8 @@ struct FEMDeformationGradient3x2To3x3 {
   typedef Eigen::Matrix<Real, 3, 2> InputType;
   typedef Eigen::Matrix<Real, 3, 3> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &) const {
     return true;
   }
@@ -125,6 +129,8 @@ struct FEMTriangleDeformationGradient3x2 {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 3, 2> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_ZERO;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &) const {
     return true;
   }
@@ -186,6 +192,8 @@ struct FEMTriangleDeformationGradient3x3 {
   typedef Eigen::Matrix<Real, 3, 3> InputType;
   typedef Eigen::Matrix<Real, 3, 3> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &) const {
     return true;
   }
@@ -207,7 +215,7 @@ struct FEMTriangleDeformationGradient3x3 {
       const InputType &V) const {
     FEMTriangleDeformationGradient3x2<Real> F3x2{Dm};
     FEMDeformationGradient3x2To3x3<Real> F3x2_to_F3x3;
-    return F3x2_to_F3x3.Hessian(F3x2(V)) * F3x2.Jacobian(V);
+    return HessianChain<FEMDeformationGradient3x2To3x3<Real>>(F3x2_to_F3x3.Hessian(F3x2(V)), F3x2.Jacobian(V));
   }
 
   Eigen::Matrix2<Real> Dm;
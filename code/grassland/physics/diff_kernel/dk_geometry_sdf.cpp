@@ -215,6 +215,80 @@ LM_DEVICE_FUNC HessianTensor<Real, 1, 3> CubeSDF<Real>::Hessian(const InputType
 template class CubeSDF<float>;
 template class CubeSDF<double>;
 
+template <typename Real>
+LM_DEVICE_FUNC bool BoxSDF<Real>::ValidInput(const InputType &) const {
+  return true;
+}
+
+template <typename Real>
+LM_DEVICE_FUNC typename BoxSDF<Real>::OutputType BoxSDF<Real>::operator()(const InputType &p) const {
+  Eigen::Vector3<Real> p0 = p - center;
+  Eigen::Vector3<Real> q = p0.cwiseAbs() - half_extent;
+  if (q.maxCoeff() > 0) {
+    q = q.cwiseMax(Eigen::Vector3<Real>(0, 0, 0));
+    return OutputType{q.norm()};
+  } else {
+    return OutputType{q.maxCoeff()};
+  }
+}
+
+template <typename Real>
+LM_DEVICE_FUNC Eigen::Matrix<Real, 1, 3> BoxSDF<Real>::Jacobian(const InputType &p) const {
+  Eigen::Vector3<Real> p0 = p - center;
+  Eigen::Vector3<Real> q = p0.cwiseAbs() - half_extent;
+  if (q.maxCoeff() > 0) {
+    q = q.cwiseMax(Eigen::Vector3<Real>(0, 0, 0));
+    for (int i = 0; i < 3; i++) {
+      if (p0(i) < 0) {
+        q(i) = -q(i);
+      }
+    }
+    return q.normalized().transpose();
+  } else {
+    int max_idx = 0;
+    for (int i = 1; i < 3; i++) {
+      if (q(i) > q(max_idx)) {
+        max_idx = i;
+      }
+    }
+    Eigen::RowVector3<Real> result = Eigen::RowVector3<Real>::Zero();
+    result(max_idx) = 1;
+    if (p0(max_idx) < 0) {
+      result(max_idx) = -1;
+    }
+    return result;
+  }
+}
+
+template <typename Real>
+LM_DEVICE_FUNC HessianTensor<Real, 1, 3> BoxSDF<Real>::Hessian(const InputType &v) const {
+  HessianTensor<Real, OutputType::SizeAtCompileTime, InputType::SizeAtCompileTime> H;
+  Eigen::Vector3<Real> v_diff = v - center;
+  Eigen::Vector3<Real> p = v_diff;
+  H.m[0] = Eigen::Matrix3<Real>::Identity();
+  for (int dim = 0; dim < 3; dim++) {
+    if (p(dim) < -half_extent(dim)) {
+      p(dim) = -half_extent(dim);
+    } else if (p(dim) > half_extent(dim)) {
+      p(dim) = half_extent(dim);
+    } else {
+      H.m[0](dim, dim) = 0;
+    }
+  }
+  v_diff = v_diff - p;
+  Real v_diff_norm = v_diff.norm();
+  if (v_diff_norm > Eps<Real>()) {
+    v_diff = v_diff / v_diff_norm;
+    H.m[0] = (H.m[0] - v_diff * v_diff.transpose()) / v_diff_norm;
+    return H;
+  } else {
+    return {};
+  }
+}
+
+template class BoxSDF<float>;
+template class BoxSDF<double>;
+
 template <typename Real>
 LM_DEVICE_FUNC bool PlaneSDF<Real>::ValidInput(const InputType &v) const {
   return true;
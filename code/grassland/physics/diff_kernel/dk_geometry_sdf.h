@@ -9,6 +9,8 @@ struct PointSDF {
   typedef Eigen::Vector<Real, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &v) const;
@@ -26,6 +28,8 @@ struct SphereSDF {
   typedef Eigen::Vector<Real, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &v) const;
@@ -44,6 +48,8 @@ struct SegmentSDF {
   typedef Eigen::Vector<Real, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &v) const;
@@ -62,6 +68,8 @@ struct CapsuleSDF {
   typedef Eigen::Vector<Real, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &v) const;
@@ -81,6 +89,8 @@ struct CubeSDF {
   typedef Eigen::Vector<Real, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &p) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &p) const;
@@ -93,12 +103,35 @@ struct CubeSDF {
   Real size{1.0};
 };
 
+// Like CubeSDF with a half extent of its own along every axis.
+template <typename Real>
+struct BoxSDF {
+  typedef Real Scalar;
+  typedef Eigen::Vector<Real, 3> InputType;
+  typedef Eigen::Matrix<Real, 1, 1> OutputType;
+
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
+  LM_DEVICE_FUNC bool ValidInput(const InputType &p) const;
+
+  LM_DEVICE_FUNC OutputType operator()(const InputType &p) const;
+
+  LM_DEVICE_FUNC Eigen::Matrix<Real, 1, 3> Jacobian(const InputType &p) const;
+
+  LM_DEVICE_FUNC HessianTensor<Real, 1, 3> Hessian(const InputType &v) const;
+
+  Eigen::Vector3<Real> center{0, 0, 0};
+  Eigen::Vector3<Real> half_extent{1, 1, 1};
+};
+
 template <typename Real>
 struct PlaneSDF {
   typedef Real Scalar;
   typedef Eigen::Vector<Real, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &v) const;
@@ -117,6 +150,8 @@ struct LineSDF {
   typedef Eigen::Vector<Real, 3> InputType;
   typedef Eigen::Matrix<Real, 1, 1> OutputType;
 
+  static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+
   LM_DEVICE_FUNC bool ValidInput(const InputType &v) const;
 
   LM_DEVICE_FUNC OutputType operator()(const InputType &v) const;
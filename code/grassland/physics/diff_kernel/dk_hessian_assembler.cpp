@@ -0,0 +1,289 @@
+#include "grassland/physics/diff_kernel/dk_hessian_assembler.h"
+
+#include <algorithm>
+
+namespace grassland {
+
+template <typename Real>
+HessianAssembler<Real>::HessianAssembler(ThreadPool *thread_pool, size_t grain_size)
+    : thread_pool_(thread_pool), grain_size_(grain_size) {
+}
+
+template <typename Real>
+int HessianAssembler<Real>::AddElementSet(const uint32_t *indices, size_t num_elements, int vertices_per_element) {
+  if (vertices_per_element <= 0 || vertices_per_element * vertices_per_element > 256) {
+    LogError("[HessianAssembler] unsupported number of vertices per element: {}", vertices_per_element);
+    return -1;
+  }
+  ElementSet element_set;
+  element_set.indices.assign(indices, indices + num_elements * vertices_per_element);
+  element_set.num_elements = num_elements;
+  element_set.vertices_per_element = vertices_per_element;
+  element_sets_.push_back(std::move(element_set));
+  return static_cast<int>(element_sets_.size() - 1);
+}
+
+template <typename Real>
+int HessianAssembler<Real>::Build(size_t num_vertices) {
+  for (auto &element_set : element_sets_) {
+    for (uint32_t v : element_set.indices) {
+      if (v >= num_vertices) {
+        LogError("[HessianAssembler] vertex index {} out of range ({} vertices)", v, num_vertices);
+        return -1;
+      }
+    }
+  }
+  num_vertices_ = num_vertices;
+
+  // Bucket the column of every (row, col) pair an element touches by row, then sort and deduplicate each row.
+  std::vector<uint32_t> row_offsets(num_vertices + 1, 0);
+  for (size_t v = 0; v < num_vertices; v++) {
+    row_offsets[v + 1] = 1;
+  }
+  for (auto &element_set : element_sets_) {
+    for (uint32_t v : element_set.indices) {
+      row_offsets[v + 1] += element_set.vertices_per_element;
+    }
+  }
+  for (size_t v = 0; v < num_vertices; v++) {
+    row_offsets[v + 1] += row_offsets[v];
+  }
+  std::vector<uint32_t> columns(row_offsets[num_vertices]);
+  std::vector<uint32_t> fill(row_offsets.begin(), row_offsets.end() - 1);
+  for (size_t v = 0; v < num_vertices; v++) {
+    columns[fill[v]++] = static_cast<uint32_t>(v);
+  }
+  for (auto &element_set : element_sets_) {
+    int k = element_set.vertices_per_element;
+    for (size_t e = 0; e < element_set.num_elements; e++) {
+      const uint32_t *element = element_set.indices.data() + e * k;
+      for (int a = 0; a < k; a++) {
+        for (int b = 0; b < k; b++) {
+          columns[fill[element[a]]++] = element[b];
+        }
+      }
+    }
+  }
+
+  block_row_offsets_.assign(num_vertices + 1, 0);
+  block_columns_.clear();
+  diagonal_blocks_.resize(num_vertices);
+  for (size_t v = 0; v < num_vertices; v++) {
+    auto row_begin = columns.begin() + row_offsets[v];
+    auto row_end = columns.begin() + row_offsets[v + 1];
+    std::sort(row_begin, row_end);
+    row_end = std::unique(row_begin, row_end);
+    for (auto it = row_begin; it != row_end; ++it) {
+      if (*it == v) {
+        diagonal_blocks_[v] = static_cast<uint32_t>(block_columns_.size());
+      }
+      block_columns_.push_back(*it);
+    }
+    block_row_offsets_[v + 1] = static_cast<uint32_t>(block_columns_.size());
+  }
+  values_.assign(block_columns_.size() * 9, Real(0));
+
+  // Scatter maps, stored transposed per block. Elements are visited in order, so every block sums its contributions
+  // in element order no matter how the rows are split between threads.
+  for (auto &element_set : element_sets_) {
+    int k = element_set.vertices_per_element;
+    std::vector<uint32_t> element_blocks(element_set.num_elements * k * k);
+    element_set.contribution_offsets.assign(block_columns_.size() + 1, 0);
+    for (size_t e = 0; e < element_set.num_elements; e++) {
+      const uint32_t *element = element_set.indices.data() + e * k;
+      for (int a = 0; a < k; a++) {
+        for (int b = 0; b < k; b++) {
+          uint32_t block = static_cast<uint32_t>(BlockIndex(element[a], element[b]));
+          element_blocks[(e * k + a) * k + b] = block;
+          element_set.contribution_offsets[block + 1]++;
+        }
+      }
+    }
+    for (size_t b = 0; b < block_columns_.size(); b++) {
+      element_set.contribution_offsets[b + 1] += element_set.contribution_offsets[b];
+    }
+    element_set.contribution_elements.resize(element_blocks.size());
+    element_set.contribution_local_blocks.resize(element_blocks.size());
+    std::vector<uint32_t> block_fill(element_set.contribution_offsets.begin(),
+                                     element_set.contribution_offsets.end() - 1);
+    for (size_t i = 0; i < element_blocks.size(); i++) {
+      uint32_t slot = block_fill[element_blocks[i]]++;
+      element_set.contribution_elements[slot] = static_cast<uint32_t>(i / (k * k));
+      element_set.contribution_local_blocks[slot] = static_cast<uint8_t>(i % (k * k));
+    }
+  }
+  return 0;
+}
+
+template <typename Real>
+size_t HessianAssembler<Real>::NumVertices() const {
+  return num_vertices_;
+}
+
+template <typename Real>
+size_t HessianAssembler<Real>::NumBlocks() const {
+  return block_columns_.size();
+}
+
+template <typename Real>
+template <typename Func>
+void HessianAssembler<Real>::ForEachBlockRow(const Func &func) const {
+  auto process_rows = [&](size_t begin, size_t end, size_t) {
+    for (size_t row = begin; row < end; row++) {
+      func(row);
+    }
+  };
+  if (thread_pool_) {
+    thread_pool_->ParallelFor(num_vertices_, grain_size_, process_rows);
+  } else {
+    process_rows(0, num_vertices_, 0);
+  }
+}
+
+template <typename Real>
+void HessianAssembler<Real>::SetZero() {
+  std::fill(values_.begin(), values_.end(), Real(0));
+}
+
+template <typename Real>
+void HessianAssembler<Real>::Accumulate(int element_set_index, const Real *hessians, ElementHessianLayout layout) {
+  const ElementSet &element_set = element_sets_[element_set_index];
+  const int k = element_set.vertices_per_element;
+  const size_t dim = static_cast<size_t>(k) * 3;
+  // Offset of entry (r, c) of element e is e * element_stride + (r * row_stride + c * column_stride).
+  size_t element_stride = layout == ELEMENT_HESSIAN_LAYOUT_SOA ? 1 : dim * dim;
+  size_t row_stride = layout == ELEMENT_HESSIAN_LAYOUT_SOA ? dim * element_set.num_elements : 1;
+  size_t column_stride = layout == ELEMENT_HESSIAN_LAYOUT_SOA ? element_set.num_elements : dim;
+  ForEachBlockRow([&](size_t row) {
+    for (uint32_t block = block_row_offsets_[row]; block < block_row_offsets_[row + 1]; block++) {
+      Real *block_values = values_.data() + block * 9;
+      for (uint32_t i = element_set.contribution_offsets[block]; i < element_set.contribution_offsets[block + 1];
+           i++) {
+        const Real *element_hessian = hessians + element_set.contribution_elements[i] * element_stride;
+        int a = element_set.contribution_local_blocks[i] / k;
+        int b = element_set.contribution_local_blocks[i] % k;
+        for (int r = 0; r < 3; r++) {
+          for (int c = 0; c < 3; c++) {
+            block_values[r * 3 + c] += element_hessian[(a * 3 + r) * row_stride + (b * 3 + c) * column_stride];
+          }
+        }
+      }
+    }
+  });
+}
+
+template <typename Real>
+void HessianAssembler<Real>::AddDiagonal(const Real *values) {
+  for (size_t v = 0; v < num_vertices_; v++) {
+    Real *block_values = values_.data() + diagonal_blocks_[v] * 9;
+    block_values[0] += values[v];
+    block_values[4] += values[v];
+    block_values[8] += values[v];
+  }
+}
+
+template <typename Real>
+void HessianAssembler<Real>::Multiply(const Real *x, Real *y) const {
+  ForEachBlockRow([&](size_t row) {
+    Real sum[3] = {0, 0, 0};
+    for (uint32_t block = block_row_offsets_[row]; block < block_row_offsets_[row + 1]; block++) {
+      const Real *block_values = values_.data() + block * 9;
+      const Real *x_col = x + block_columns_[block] * 3;
+      for (int r = 0; r < 3; r++) {
+        sum[r] += block_values[r * 3] * x_col[0] + block_values[r * 3 + 1] * x_col[1] +
+                  block_values[r * 3 + 2] * x_col[2];
+      }
+    }
+    for (int r = 0; r < 3; r++) {
+      y[row * 3 + r] = sum[r];
+    }
+  });
+}
+
+template <typename Real>
+int64_t HessianAssembler<Real>::BlockIndex(uint32_t row, uint32_t col) const {
+  if (row >= num_vertices_) {
+    return -1;
+  }
+  auto row_begin = block_columns_.begin() + block_row_offsets_[row];
+  auto row_end = block_columns_.begin() + block_row_offsets_[row + 1];
+  auto it = std::lower_bound(row_begin, row_end, col);
+  if (it == row_end || *it != col) {
+    return -1;
+  }
+  return it - block_columns_.begin();
+}
+
+template <typename Real>
+Real *HessianAssembler<Real>::BlockValues(size_t block) {
+  return values_.data() + block * 9;
+}
+
+template <typename Real>
+const Real *HessianAssembler<Real>::BlockValues(size_t block) const {
+  return values_.data() + block * 9;
+}
+
+template <typename Real>
+const std::vector<uint32_t> &HessianAssembler<Real>::BlockRowOffsets() const {
+  return block_row_offsets_;
+}
+
+template <typename Real>
+const std::vector<uint32_t> &HessianAssembler<Real>::BlockColumns() const {
+  return block_columns_;
+}
+
+template <typename Real>
+void HessianAssembler<Real>::ExportToEigen(Eigen::SparseMatrix<Real, Eigen::RowMajor> *matrix) const {
+  typedef typename Eigen::SparseMatrix<Real, Eigen::RowMajor>::StorageIndex StorageIndex;
+  Eigen::Index size = static_cast<Eigen::Index>(num_vertices_ * 3);
+  Eigen::Index num_nonzeros = static_cast<Eigen::Index>(block_columns_.size() * 9);
+  bool same_pattern = matrix->rows() == size && matrix->cols() == size && matrix->isCompressed() &&
+                      matrix->nonZeros() == num_nonzeros;
+  // Checks the index arrays of a matrix of the right shape against the pattern, or writes the pattern once they are
+  // found to differ.
+  auto visit_pattern = [&](auto &&visit) {
+    StorageIndex *outer = matrix->outerIndexPtr();
+    StorageIndex *inner = matrix->innerIndexPtr();
+    visit(outer[0], 0);
+    for (size_t row = 0; row < num_vertices_; row++) {
+      uint32_t row_length = block_row_offsets_[row + 1] - block_row_offsets_[row];
+      for (int r = 0; r < 3; r++) {
+        StorageIndex *row_inner = inner + block_row_offsets_[row] * 9 + r * row_length * 3;
+        for (uint32_t block = block_row_offsets_[row]; block < block_row_offsets_[row + 1]; block++) {
+          for (int c = 0; c < 3; c++) {
+            visit(*row_inner++, static_cast<StorageIndex>(block_columns_[block] * 3 + c));
+          }
+        }
+        visit(outer[row * 3 + r + 1],
+              static_cast<StorageIndex>(block_row_offsets_[row] * 9 + (r + 1) * row_length * 3));
+      }
+    }
+  };
+  if (same_pattern) {
+    visit_pattern([&](StorageIndex index, StorageIndex expected) { same_pattern &= index == expected; });
+  }
+  if (!same_pattern) {
+    matrix->resize(size, size);
+    matrix->resizeNonZeros(num_nonzeros);
+    visit_pattern([](StorageIndex &index, StorageIndex expected) { index = expected; });
+  }
+  Real *values = matrix->valuePtr();
+  ForEachBlockRow([&](size_t row) {
+    uint32_t row_length = block_row_offsets_[row + 1] - block_row_offsets_[row];
+    for (int r = 0; r < 3; r++) {
+      Real *row_values = values + block_row_offsets_[row] * 9 + r * row_length * 3;
+      for (uint32_t block = block_row_offsets_[row]; block < block_row_offsets_[row + 1]; block++) {
+        for (int c = 0; c < 3; c++) {
+          *row_values++ = values_[block * 9 + r * 3 + c];
+        }
+      }
+    }
+  });
+}
+
+template class HessianAssembler<float>;
+template class HessianAssembler<double>;
+
+}  // namespace grassland
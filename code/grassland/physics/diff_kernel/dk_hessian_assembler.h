@@ -0,0 +1,84 @@
+#pragma once
+#include "grassland/physics/diff_kernel/dk_hessian_tensor.h"
+#include "grassland/util/thread_pool.h"
+
+namespace grassland {
+
+// Memory layout of the per-element Hessians handed to HessianAssembler::Accumulate, with dim = 3 * vertices per
+// element and r, c indexing the flattened element input (vertex * 3 + axis).
+typedef enum ElementHessianLayout {
+  ELEMENT_HESSIAN_LAYOUT_SOA = 0,           // hessians[(r * dim + c) * num_elements + e], as BatchEvaluator writes it
+  ELEMENT_HESSIAN_LAYOUT_ELEMENT_MAJOR = 1,  // hessians[e * dim * dim + c * dim + r], one column-major matrix each
+} ElementHessianLayout;
+
+// Global Hessian over 3D vertices stored as BSR with 3x3 blocks. The block pattern and, for every element set, the
+// element-to-block scatter map are built once from the connectivity. The map is kept transposed, as the list of
+// element blocks feeding each nonzero block, so that Accumulate runs in parallel over block rows without atomics,
+// locks or hashing, and sums the contributions in a fixed order.
+template <typename Real>
+class HessianAssembler {
+ public:
+  // thread_pool may be null for single threaded assembly, grain_size is the number of block rows per task.
+  HessianAssembler(ThreadPool *thread_pool = nullptr, size_t grain_size = 256);
+
+  // Registers elements with vertices_per_element vertex indices each and returns the index of the element set.
+  // Must be called before Build.
+  int AddElementSet(const uint32_t *indices, size_t num_elements, int vertices_per_element);
+
+  // Builds the pattern over num_vertices vertices, every diagonal block is part of it. Returns -1 if an element
+  // references a vertex out of range.
+  int Build(size_t num_vertices);
+
+  size_t NumVertices() const;
+  size_t NumBlocks() const;
+
+  void SetZero();
+
+  // Adds one Hessian per element of the set to the global matrix.
+  void Accumulate(int element_set, const Real *hessians, ElementHessianLayout layout = ELEMENT_HESSIAN_LAYOUT_SOA);
+
+  // Adds value * I to every diagonal block, e.g. mass / dt^2.
+  void AddDiagonal(const Real *values);
+
+  // y = H x, x and y hold 3 * NumVertices() entries.
+  void Multiply(const Real *x, Real *y) const;
+
+  // Index of block (row, col) in the pattern, -1 if it is not part of it.
+  int64_t BlockIndex(uint32_t row, uint32_t col) const;
+
+  // Row-major 3x3 block values.
+  Real *BlockValues(size_t block);
+  const Real *BlockValues(size_t block) const;
+
+  const std::vector<uint32_t> &BlockRowOffsets() const;
+  const std::vector<uint32_t> &BlockColumns() const;
+
+  // Scalar CSR export. A matrix that already has this pattern, e.g. from a previous export, only gets its values
+  // overwritten so that a factorization can reuse its symbolic analysis. Any other matrix is rebuilt.
+  void ExportToEigen(Eigen::SparseMatrix<Real, Eigen::RowMajor> *matrix) const;
+
+ private:
+  template <typename Func>
+  void ForEachBlockRow(const Func &func) const;
+
+  struct ElementSet {
+    std::vector<uint32_t> indices;
+    size_t num_elements;
+    int vertices_per_element;
+    // Gather map over the blocks of the pattern, CSR: contributions[contribution_offsets[b] ...] feed block b.
+    std::vector<uint32_t> contribution_offsets;
+    std::vector<uint32_t> contribution_elements;
+    std::vector<uint8_t> contribution_local_blocks;  // a * vertices_per_element + b, block (a, b) of the element
+  };
+
+  ThreadPool *thread_pool_;
+  size_t grain_size_;
+  size_t num_vertices_{0};
+  std::vector<ElementSet> element_sets_;
+  std::vector<uint32_t> block_row_offsets_;
+  std::vector<uint32_t> block_columns_;
+  std::vector<uint32_t> diagonal_blocks_;
+  std::vector<Real> values_;
+};
+
+}  // namespace grassland
@@ -3,6 +3,16 @@
 
 namespace grassland {
 
+// Structure of the Hessian of a function known at compile time. A function declares it with
+//   static constexpr HessianStructure kHessianStructure = HESSIAN_STRUCTURE_SYMMETRIC;
+// and the chain rule in Compose skips zero terms and evaluates symmetric ones on the upper triangle only.
+// Storage stays dense either way, so m[i] can always be read as a full matrix.
+typedef enum HessianStructure {
+  HESSIAN_STRUCTURE_DENSE = 0,
+  HESSIAN_STRUCTURE_SYMMETRIC = 1,  // every m[i] is symmetric
+  HESSIAN_STRUCTURE_ZERO = 2,       // the function is linear, every m[i] is zero
+} HessianStructure;
+
 template <typename Real, int OutputDim, int InputDim>
 struct HessianTensor {
   Eigen::Matrix<Real, InputDim, InputDim> m[OutputDim];
@@ -13,6 +23,18 @@ struct HessianTensor {
     }
   }
 
+  // Tag for scratch tensors that are only zeroed once they are used.
+  struct Uninitialized {};
+
+  LM_DEVICE_FUNC explicit HessianTensor(Uninitialized) {
+  }
+
+  LM_DEVICE_FUNC void SetZero() {
+    for (int i = 0; i < OutputDim; i++) {
+      m[i].setZero();
+    }
+  }
+
   template <int NewOutputDim>
   LM_DEVICE_FUNC friend HessianTensor<Real, NewOutputDim, InputDim> operator*(
       const Eigen::Matrix<Real, NewOutputDim, OutputDim> &A,
@@ -38,6 +60,52 @@ struct HessianTensor {
     return new_H;
   }
 
+  // A^T * m[i] * A for symmetric m[i], only the upper triangle of the result is computed and then mirrored.
+  template <int NewInputDim>
+  LM_DEVICE_FUNC HessianTensor<Real, OutputDim, NewInputDim> SymmetricProduct(
+      const Eigen::Matrix<Real, InputDim, NewInputDim> &A) const {
+    HessianTensor<Real, OutputDim, NewInputDim> new_H;
+    for (int i = 0; i < OutputDim; i++) {
+      Eigen::Matrix<Real, InputDim, NewInputDim> HA = m[i] * A;
+      for (int c = 0; c < NewInputDim; c++) {
+        for (int r = 0; r <= c; r++) {
+          Real value = A.col(r).dot(HA.col(c));
+          new_H.m[i](r, c) = value;
+          new_H.m[i](c, r) = value;
+        }
+      }
+    }
+    return new_H;
+  }
+
+  // A * H for symmetric H, the contraction over the outputs of H keeps the result symmetric.
+  template <int NewOutputDim>
+  LM_DEVICE_FUNC static HessianTensor<Real, NewOutputDim, InputDim> SymmetricContract(
+      const Eigen::Matrix<Real, NewOutputDim, OutputDim> &A,
+      const HessianTensor &H) {
+    HessianTensor<Real, NewOutputDim, InputDim> new_H;
+    for (int i = 0; i < NewOutputDim; i++) {
+      for (int c = 0; c < InputDim; c++) {
+        for (int r = 0; r <= c; r++) {
+          Real value = 0;
+          for (int j = 0; j < OutputDim; j++) {
+            value += A(i, j) * H.m[j](r, c);
+          }
+          new_H.m[i](r, c) = value;
+          new_H.m[i](c, r) = value;
+        }
+      }
+    }
+    return new_H;
+  }
+
+  LM_DEVICE_FUNC HessianTensor &operator+=(const HessianTensor &H) {
+    for (int i = 0; i < OutputDim; i++) {
+      m[i] += H.m[i];
+    }
+    return *this;
+  }
+
   LM_DEVICE_FUNC HessianTensor operator+(const HessianTensor &H) const {
     HessianTensor new_H;
     for (int i = 0; i < OutputDim; i++) {
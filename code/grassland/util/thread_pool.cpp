@@ -0,0 +1,116 @@
+#include "grassland/util/thread_pool.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace grassland {
+
+ThreadPool::ThreadPool(size_t num_workers) {
+  if (!num_workers) {
+    size_t hardware_threads = std::thread::hardware_concurrency();
+    num_workers = hardware_threads > 1 ? hardware_threads - 1 : 0;
+  }
+  workers_.reserve(num_workers);
+  for (size_t i = 0; i < num_workers; i++) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+size_t ThreadPool::NumWorkers() const {
+  return workers_.size();
+}
+
+size_t ThreadPool::NumThreads() const {
+  return workers_.size() + 1;
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> task) {
+  std::packaged_task<void()> packaged(std::move(task));
+  std::future<void> future = packaged.get_future();
+  if (workers_.empty()) {
+    packaged();
+    return future;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.emplace(std::move(packaged));
+  }
+  condition_.notify_one();
+  return future;
+}
+
+void ThreadPool::ParallelFor(size_t num_items,
+                             size_t grain_size,
+                             const std::function<void(size_t begin, size_t end, size_t thread_index)> &func) {
+  if (!num_items) {
+    return;
+  }
+  grain_size = grain_size ? grain_size : 1;
+  size_t num_chunks = (num_items + grain_size - 1) / grain_size;
+  size_t num_helpers = std::min(workers_.size(), num_chunks - 1);
+  if (!num_helpers) {
+    func(0, num_items, 0);
+    return;
+  }
+
+  // Helpers that start late find no chunk left and never touch func, so the caller only waits for the chunks and
+  // nested calls from inside a worker cannot deadlock.
+  struct State {
+    std::atomic<size_t> next_chunk{0};
+    size_t num_done{0};
+    std::mutex mutex;
+    std::condition_variable condition;
+  };
+  auto state = std::make_shared<State>();
+  auto run = [state, num_chunks, num_items, grain_size, &func](size_t thread_index) {
+    size_t num_done = 0;
+    for (size_t chunk = state->next_chunk++; chunk < num_chunks; chunk = state->next_chunk++) {
+      size_t begin = chunk * grain_size;
+      func(begin, std::min(begin + grain_size, num_items), thread_index);
+      num_done++;
+    }
+    if (num_done) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->num_done += num_done;
+      if (state->num_done == num_chunks) {
+        state->condition.notify_all();
+      }
+    }
+  };
+
+  for (size_t i = 0; i < num_helpers; i++) {
+    Submit([run, i]() { run(i + 1); });
+  }
+  run(0);
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->condition.wait(lock, [&]() { return state->num_done == num_chunks; });
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+      if (stop_ && tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+}  // namespace grassland
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "grassland/util/util_util.h"
+
+namespace grassland {
+
+class ThreadPool {
+ public:
+  // 0 picks std::thread::hardware_concurrency() - 1 workers, the calling thread of ParallelFor takes the remaining
+  // share of the work.
+  explicit ThreadPool(size_t num_workers = 0);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  size_t NumWorkers() const;
+
+  // Number of threads taking part in a ParallelFor, including the caller.
+  size_t NumThreads() const;
+
+  std::future<void> Submit(std::function<void()> task);
+
+  // Splits [0, num_items) into chunks of grain_size items and blocks until func has run on all of them.
+  // func(begin, end, thread_index) may be called concurrently, thread_index is in [0, NumThreads()).
+  void ParallelFor(size_t num_items,
+                   size_t grain_size,
+                   const std::function<void(size_t begin, size_t end, size_t thread_index)> &func);
+
+ private:
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+  std::queue<std::packaged_task<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_{false};
+};
+
+// Calls func(i) or func(i, thread_index) for every i in [0, num_items), in chunks of grain_size on thread_pool, or in
+// order on the calling thread with thread_index 0 when thread_pool is null.
+template <typename Func>
+void ParallelForEach(ThreadPool *thread_pool, size_t num_items, size_t grain_size, const Func &func) {
+  auto process_range = [&](size_t begin, size_t end, size_t thread_index) {
+    for (size_t i = begin; i < end; i++) {
+      if constexpr (std::is_invocable_v<const Func &, int, size_t>) {
+        func(static_cast<int>(i), thread_index);
+      } else {
+        func(static_cast<int>(i));
+      }
+    }
+  };
+  if (thread_pool) {
+    thread_pool->ParallelFor(num_items, grain_size, process_range);
+  } else {
+    process_range(0, num_items, 0);
+  }
+}
+
+}  // namespace grassland
@@ -11,6 +11,7 @@
 #include "grassland/util/metronome.h"
 #include "grassland/util/sobol.h"
 #include "grassland/util/string_convert.h"
+#include "grassland/util/thread_pool.h"
 #include "grassland/util/util_util.h"
 #include "grassland/util/vendor_id.h"
 #include "grassland/util/virtual_file_system.h"
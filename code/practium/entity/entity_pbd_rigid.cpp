@@ -17,10 +17,10 @@ EntityPBDRigid::EntityPBDRigid(Scene *scene, Model *model, MaterialPBDRigid *mat
 }
 
 void EntityPBDRigid::SyncRenderState() const {
-  auto &pbd_entity = scene_->GetPBDSolver()->GetEntity(pbd_rigid_id_);
+  contradium::PBDSolver *pbd_solver = scene_->GetPBDSolver();
   Matrix<float, 3, 4> transform;
-  transform.block(0, 0, 3, 3) = pbd_entity.q_.toRotationMatrix();
-  transform.col(3) = pbd_entity.x_;
+  transform.block(0, 0, 3, 3) = pbd_solver->GetOrientation(pbd_rigid_id_).toRotationMatrix();
+  transform.col(3) = pbd_solver->GetPosition(pbd_rigid_id_);
   entity_geometry_material_->transform = EigenToGLM(transform);
 }
 
@@ -1,8 +1,14 @@
 #pragma once
+#include "snowberg/solver/solver_contact.h"
 #include "snowberg/solver/solver_element.h"
 #include "snowberg/solver/solver_object_pack.h"
+#include "snowberg/solver/solver_readback.h"
+#include "snowberg/solver/solver_reorder.h"
 #include "snowberg/solver/solver_rigid_object.h"
 #include "snowberg/solver/solver_scene.h"
+#include "snowberg/solver/solver_scene_batch.h"
+#include "snowberg/solver/solver_snapshot.h"
 #include "snowberg/solver/solver_util.h"
+#include "snowberg/solver/solver_vbd.h"
 
 namespace snowberg::solver {}
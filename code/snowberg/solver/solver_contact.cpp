@@ -0,0 +1,458 @@
+#include "snowberg/solver/solver_contact.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+
+namespace snowberg::solver {
+
+namespace {
+
+constexpr size_t kGrainSize = 256;
+
+// Uniform grid folded into a hash table. Every box is inserted into all cells it overlaps, a lookup returns the boxes
+// of every cell hashed to the same bucket, so callers still test the boxes themselves.
+class SpatialHash {
+ public:
+  SpatialHash(const std::vector<AABB> &boxes, float cell_size) : cell_size_(cell_size) {
+    size_t num_entries = 0;
+    for (const AABB &box : boxes) {
+      Vector3<int> lower = Cell(box.lower_bound);
+      Vector3<int> upper = Cell(box.upper_bound);
+      Vector3<int> extent = upper - lower + Vector3<int>::Ones();
+      num_entries += static_cast<size_t>(extent[0]) * extent[1] * extent[2];
+    }
+    size_t num_buckets = 1;
+    while (num_buckets < num_entries * 2) {
+      num_buckets <<= 1;
+    }
+    bucket_mask_ = num_buckets - 1;
+
+    bucket_offsets_.assign(num_buckets + 1, 0);
+    ForEachEntry(boxes, [&](size_t bucket, int) { bucket_offsets_[bucket + 1]++; });
+    for (size_t b = 0; b < num_buckets; b++) {
+      bucket_offsets_[b + 1] += bucket_offsets_[b];
+    }
+    items_.resize(num_entries);
+    std::vector<uint32_t> fill(bucket_offsets_.begin(), bucket_offsets_.end() - 1);
+    ForEachEntry(boxes, [&](size_t bucket, int item) { items_[fill[bucket]++] = item; });
+  }
+
+  Vector3<int> Cell(const Vector3<float> &p) const {
+    Vector3<float> cell = (p / cell_size_).array().floor();
+    return cell.cast<int>();
+  }
+
+  template <typename Func>
+  void ForEachInCell(const Vector3<int> &cell, const Func &func) const {
+    size_t bucket = Bucket(cell);
+    for (uint32_t i = bucket_offsets_[bucket]; i < bucket_offsets_[bucket + 1]; i++) {
+      func(items_[i]);
+    }
+  }
+
+ private:
+  size_t Bucket(const Vector3<int> &cell) const {
+    uint32_t h = static_cast<uint32_t>(cell[0]) * 73856093u ^ static_cast<uint32_t>(cell[1]) * 19349663u ^
+                 static_cast<uint32_t>(cell[2]) * 83492791u;
+    return h & bucket_mask_;
+  }
+
+  template <typename Func>
+  void ForEachEntry(const std::vector<AABB> &boxes, const Func &func) const {
+    for (size_t i = 0; i < boxes.size(); i++) {
+      Vector3<int> lower = Cell(boxes[i].lower_bound);
+      Vector3<int> upper = Cell(boxes[i].upper_bound);
+      for (int cx = lower[0]; cx <= upper[0]; cx++) {
+        for (int cy = lower[1]; cy <= upper[1]; cy++) {
+          for (int cz = lower[2]; cz <= upper[2]; cz++) {
+            func(Bucket(Vector3<int>{cx, cy, cz}), static_cast<int>(i));
+          }
+        }
+      }
+    }
+  }
+
+  float cell_size_;
+  size_t bucket_mask_{0};
+  std::vector<uint32_t> bucket_offsets_;
+  std::vector<int> items_;
+};
+
+struct ContactPair {
+  std::array<int, 4> indices;
+
+  bool operator<(const ContactPair &other) const {
+    return indices < other.indices;
+  }
+  bool operator==(const ContactPair &other) const {
+    return indices == other.indices;
+  }
+};
+
+bool Overlap(const AABB &a, const AABB &b) {
+  return (a.lower_bound.array() <= b.upper_bound.array()).all() &&
+         (b.lower_bound.array() <= a.upper_bound.array()).all();
+}
+
+// Mean of the largest extent of the boxes, a cell of this size is overlapped by a handful of boxes.
+float CellSize(const std::vector<AABB> &boxes) {
+  double sum = 0.0;
+  for (const AABB &box : boxes) {
+    sum += (box.upper_bound - box.lower_bound).maxCoeff();
+  }
+  return static_cast<float>(sum / boxes.size());
+}
+
+// Vertex-face and edge-edge pairs of non-adjacent primitives closer than the query radius of the pair. The radius of
+// a particle is query_radius plus its entry in extra, that of a pair the largest radius of its particles.
+class PairQuery {
+ public:
+  PairQuery(const Vector3<float> *x,
+            const std::vector<int> &triangle_indices,
+            const std::vector<int> &edge_indices,
+            float query_radius,
+            const std::vector<float> &extra)
+      : x_(x),
+        triangles_(triangle_indices.data()),
+        edges_(edge_indices.data()),
+        query_radius_(query_radius),
+        extra_(extra.data()) {
+    triangle_boxes_.resize(triangle_indices.size() / 3);
+    triangle_extra_.resize(triangle_boxes_.size());
+    triangle_spheres_.resize(triangle_boxes_.size());
+    for (size_t t = 0; t < triangle_boxes_.size(); t++) {
+      const int *f = triangles_ + t * 3;
+      triangle_extra_[t] = std::max({extra_[f[0]], extra_[f[1]], extra_[f[2]]});
+      AABB box{x[f[0]]};
+      box.Expand(x[f[1]]);
+      box.Expand(x[f[2]]);
+      box.lower_bound.array() -= query_radius + triangle_extra_[t];
+      box.upper_bound.array() += query_radius + triangle_extra_[t];
+      triangle_boxes_[t] = box;
+      Vector3<float> center = (x[f[0]] + x[f[1]] + x[f[2]]) / 3.0f;
+      float radius = std::max({(x[f[0]] - center).norm(), (x[f[1]] - center).norm(), (x[f[2]] - center).norm()});
+      triangle_spheres_[t] << center, radius;
+    }
+    edge_boxes_.resize(edge_indices.size() / 2);
+    expanded_edge_boxes_.resize(edge_boxes_.size());
+    edge_extra_.resize(edge_boxes_.size());
+    edge_spheres_.resize(edge_boxes_.size());
+    for (size_t e = 0; e < edge_boxes_.size(); e++) {
+      const int *p = edges_ + e * 2;
+      edge_extra_[e] = std::max(extra_[p[0]], extra_[p[1]]);
+      AABB box{x[p[0]]};
+      box.Expand(x[p[1]]);
+      box.lower_bound.array() -= edge_extra_[e];
+      box.upper_bound.array() += edge_extra_[e];
+      edge_boxes_[e] = box;
+      box.lower_bound.array() -= query_radius;
+      box.upper_bound.array() += query_radius;
+      expanded_edge_boxes_[e] = box;
+      edge_spheres_[e] << (x[p[0]] + x[p[1]]) * 0.5f, (x[p[1]] - x[p[0]]).norm() * 0.5f;
+    }
+    if (!triangle_boxes_.empty()) {
+      triangle_hash_ = std::make_unique<SpatialHash>(triangle_boxes_, CellSize(triangle_boxes_));
+    }
+    if (!edge_boxes_.empty()) {
+      edge_hash_ = std::make_unique<SpatialHash>(expanded_edge_boxes_, CellSize(expanded_edge_boxes_));
+    }
+  }
+
+  float Radius(int v) const {
+    return query_radius_ + extra_[v];
+  }
+
+  // Calls func(pair, distance) for every face near vertex v.
+  template <typename Func>
+  void VertexFaces(int v, const Func &func) const {
+    if (!triangle_hash_) {
+      return;
+    }
+    AABB box{x_[v]};
+    box.lower_bound.array() -= extra_[v];
+    box.upper_bound.array() += extra_[v];
+    ForEachCell(*triangle_hash_, box, [&](const Vector3<int> &cell, int t) {
+      const int *f = triangles_ + t * 3;
+      const AABB &triangle_box = triangle_boxes_[t];
+      float radius = query_radius_ + std::max(extra_[v], triangle_extra_[t]);
+      if (f[0] == v || f[1] == v || f[2] == v || !Overlap(box, triangle_box) ||
+          triangle_hash_->Cell(box.lower_bound.cwiseMax(triangle_box.lower_bound)) != cell ||
+          (x_[v] - triangle_spheres_[t].head<3>()).norm() - triangle_spheres_[t][3] >= radius) {
+        return;
+      }
+      float distance = DistancePointTriangle(x_[v], x_[f[0]], x_[f[1]], x_[f[2]]);
+      if (distance < radius) {
+        func(ContactPair{{v, f[0], f[1], f[2]}}, distance);
+      }
+    });
+  }
+
+  // Calls func(pair, distance) for every edge e1 > e0 near edge e0.
+  template <typename Func>
+  void EdgeEdges(int e0, const Func &func) const {
+    if (!edge_hash_) {
+      return;
+    }
+    const int *p = edges_ + e0 * 2;
+    const AABB &box = edge_boxes_[e0];
+    ForEachCell(*edge_hash_, box, [&](const Vector3<int> &cell, int e1) {
+      const int *q = edges_ + e1 * 2;
+      const AABB &other_box = expanded_edge_boxes_[e1];
+      float radius = query_radius_ + std::max(edge_extra_[e0], edge_extra_[e1]);
+      if (e1 <= e0 || p[0] == q[0] || p[0] == q[1] || p[1] == q[0] || p[1] == q[1] || !Overlap(box, other_box) ||
+          edge_hash_->Cell(box.lower_bound.cwiseMax(other_box.lower_bound)) != cell ||
+          (edge_spheres_[e0].head<3>() - edge_spheres_[e1].head<3>()).norm() - edge_spheres_[e0][3] -
+                  edge_spheres_[e1][3] >=
+              radius) {
+        return;
+      }
+      float distance = DistanceSegmentSegment(x_[p[0]], x_[p[1]], x_[q[0]], x_[q[1]]);
+      if (distance < radius) {
+        func(ContactPair{{p[0], p[1], q[0], q[1]}}, distance);
+      }
+    });
+  }
+
+ private:
+  // Calls func(cell, item) for the items of every cell box overlaps. Boxes overlapping in several cells are only
+  // accepted by the callers in the cell holding the corner of their overlap.
+  template <typename Func>
+  static void ForEachCell(const SpatialHash &hash, const AABB &box, const Func &func) {
+    Vector3<int> lower = hash.Cell(box.lower_bound);
+    Vector3<int> upper = hash.Cell(box.upper_bound);
+    for (int cx = lower[0]; cx <= upper[0]; cx++) {
+      for (int cy = lower[1]; cy <= upper[1]; cy++) {
+        for (int cz = lower[2]; cz <= upper[2]; cz++) {
+          Vector3<int> cell{cx, cy, cz};
+          hash.ForEachInCell(cell, [&](int item) { func(cell, item); });
+        }
+      }
+    }
+  }
+
+  const Vector3<float> *x_;
+  const int *triangles_;
+  const int *edges_;
+  float query_radius_;
+  const float *extra_;
+  std::vector<AABB> triangle_boxes_;
+  std::vector<float> triangle_extra_;
+  // Edge boxes grown by the extra of the edge, and by the query radius on top for the hash.
+  std::vector<AABB> edge_boxes_;
+  std::vector<AABB> expanded_edge_boxes_;
+  std::vector<float> edge_extra_;
+  // Bounding spheres as (center, radius), a cheaper rejection than the exact distance.
+  std::vector<Vector4<float>> triangle_spheres_;
+  std::vector<Vector4<float>> edge_spheres_;
+  std::unique_ptr<SpatialHash> triangle_hash_;
+  std::unique_ptr<SpatialHash> edge_hash_;
+};
+
+}  // namespace
+
+ContactDetector::ContactDetector(const std::vector<int> &triangle_indices, const Vector3<float> *x, int num_particle)
+    : num_particle_(num_particle) {
+  int num_triangles = triangle_indices.size() / 3;
+  // Triangles by their sorted particles, and by edge as (edge vertex 0, edge vertex 1, triangle).
+  std::vector<std::pair<std::array<int, 3>, int>> sorted_triangles;
+  std::vector<std::array<int, 3>> edge_triangles;
+  for (int t = 0; t < num_triangles; t++) {
+    std::array<int, 3> f{triangle_indices[t * 3], triangle_indices[t * 3 + 1], triangle_indices[t * 3 + 2]};
+    for (int k = 0; k < 3; k++) {
+      edge_triangles.push_back({std::min(f[k], f[(k + 1) % 3]), std::max(f[k], f[(k + 1) % 3]), t});
+    }
+    std::sort(f.begin(), f.end());
+    sorted_triangles.emplace_back(f, t);
+  }
+  std::sort(sorted_triangles.begin(), sorted_triangles.end());
+  std::sort(edge_triangles.begin(), edge_triangles.end());
+  auto triangles_with = [&](const std::array<int, 3> &f) {
+    return std::equal_range(sorted_triangles.begin(), sorted_triangles.end(), std::make_pair(f, 0),
+                            [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+  };
+
+  // A quad split along both diagonals, like the stretching elements of a grid cloth, is the same surface twice, and
+  // its diagonals would be a pair at distance 0. Such a quad shows up as all four triangles over four particles, the
+  // diagonals are the opposite edges closest to each other, and only the triangles of the smaller one are kept.
+  std::vector<bool> duplicate(num_triangles, false);
+  for (size_t i = 0; i < edge_triangles.size(); i++) {
+    for (size_t j = i + 1; j < edge_triangles.size() && edge_triangles[j][0] == edge_triangles[i][0] &&
+                           edge_triangles[j][1] == edge_triangles[i][1];
+         j++) {
+      std::array<int, 4> v{edge_triangles[i][0], edge_triangles[i][1], 0, 0};
+      int sum = v[0] + v[1];
+      v[2] = triangle_indices[edge_triangles[i][2] * 3] + triangle_indices[edge_triangles[i][2] * 3 + 1] +
+             triangle_indices[edge_triangles[i][2] * 3 + 2] - sum;
+      v[3] = triangle_indices[edge_triangles[j][2] * 3] + triangle_indices[edge_triangles[j][2] * 3 + 1] +
+             triangle_indices[edge_triangles[j][2] * 3 + 2] - sum;
+      std::sort(v.begin(), v.end());
+      if (std::adjacent_find(v.begin(), v.end()) != v.end()) {
+        continue;
+      }
+      bool complete = true;
+      for (int skip = 0; skip < 4; skip++) {
+        std::array<int, 3> f;
+        std::copy_if(v.begin(), v.end(), f.begin(), [&](int particle) { return particle != v[skip]; });
+        auto [begin, end] = triangles_with(f);
+        complete &= begin != end;
+      }
+      if (!complete) {
+        continue;
+      }
+      // v[0] and v[k] against the other two.
+      int diagonal = 1;
+      float closest = std::numeric_limits<float>::max();
+      for (int k = 1; k < 4; k++) {
+        int p = k == 1 ? 2 : 1;
+        int q = 6 - k - p;
+        float distance = DistanceSegmentSegment(x[v[0]], x[v[k]], x[v[p]], x[v[q]]);
+        if (distance < closest) {
+          closest = distance;
+          diagonal = k;
+        }
+      }
+      // The triangles without one end of the kept diagonal are those of the other.
+      for (int skip : {0, diagonal}) {
+        std::array<int, 3> f;
+        std::copy_if(v.begin(), v.end(), f.begin(), [&](int particle) { return particle != v[skip]; });
+        auto [begin, end] = triangles_with(f);
+        for (auto it = begin; it != end; ++it) {
+          duplicate[it->second] = true;
+        }
+      }
+    }
+  }
+  for (int t = 0; t < num_triangles; t++) {
+    if (!duplicate[t]) {
+      triangle_indices_.insert(triangle_indices_.end(), triangle_indices.begin() + t * 3,
+                               triangle_indices.begin() + t * 3 + 3);
+    }
+  }
+  for (const auto &edge_triangle : edge_triangles) {
+    if (!duplicate[edge_triangle[2]] &&
+        (edge_indices_.empty() || edge_indices_[edge_indices_.size() - 2] != edge_triangle[0] ||
+         edge_indices_.back() != edge_triangle[1])) {
+      edge_indices_.push_back(edge_triangle[0]);
+      edge_indices_.push_back(edge_triangle[1]);
+    }
+  }
+}
+
+float ContactDetector::QueryRadius(const SolverSettings &settings) {
+  // Two primitives close in by at most 2 * relaxation * query_radius within a step.
+  return std::max(settings.contact_query_radius,
+                  settings.contact_thickness / (1.0f - 2.0f * settings.contact_bound_relaxation));
+}
+
+void ContactDetector::Detect(const Vector3<float> *x,
+                             float thickness,
+                             float query_radius,
+                             float relaxation,
+                             ThreadPool *thread_pool,
+                             const int *particle_colors,
+                             const float *displacements) {
+  std::vector<float> extra(num_particle_, 0.0f);
+  if (displacements) {
+    for (int v = 0; v < num_particle_; v++) {
+      extra[v] = displacements[v] / relaxation;
+    }
+  }
+  PairQuery query(x, triangle_indices_, edge_indices_, query_radius, extra);
+  std::vector<int> vertices;
+  vertices.reserve(num_particle_);
+  for (int v = 0; v < num_particle_; v++) {
+    if (!particle_colors || particle_colors[v] >= 0) {
+      vertices.push_back(v);
+    }
+  }
+  int num_vertices = vertices.size();
+  int num_edges = NumEdges();
+  size_t num_threads = thread_pool ? thread_pool->NumThreads() : 1;
+
+  // One pass over the pairs keeps them with their distance and lowers the distance to the nearest pair of their
+  // particles, reduced over per-thread copies afterwards.
+  std::vector<float> radii(num_particle_);
+  for (int v = 0; v < num_particle_; v++) {
+    radii[v] = query.Radius(v);
+  }
+  std::vector<std::vector<float>> thread_distances(num_threads, radii);
+  using ThreadPairs = std::vector<std::vector<std::pair<ContactPair, float>>>;
+  ThreadPairs thread_vertex_faces(num_threads);
+  ThreadPairs thread_edge_edges(num_threads);
+  auto keep = [&](ThreadPairs &thread_pairs, size_t thread_index) {
+    return [&, thread_index](const ContactPair &pair, float distance) {
+      std::vector<float> &distances = thread_distances[thread_index];
+      for (int v : pair.indices) {
+        distances[v] = std::min(distances[v], distance);
+      }
+      thread_pairs[thread_index].emplace_back(pair, distance);
+    };
+  };
+  ParallelForEach(thread_pool, num_vertices, kGrainSize, [&](int i, size_t thread_index) {
+    query.VertexFaces(vertices[i], keep(thread_vertex_faces, thread_index));
+  });
+  ParallelForEach(thread_pool, num_edges, kGrainSize,
+                  [&](int e, size_t thread_index) { query.EdgeEdges(e, keep(thread_edge_edges, thread_index)); });
+  bounds_.resize(num_particle_);
+  for (int v = 0; v < num_particle_; v++) {
+    bounds_[v] = relaxation * radii[v];
+  }
+  for (const auto &distances : thread_distances) {
+    for (int v = 0; v < num_particle_; v++) {
+      bounds_[v] = std::min(bounds_[v], relaxation * distances[v]);
+    }
+  }
+
+  // A pair only enters the solve if its two sides can get within thickness of each other inside their bounds.
+  auto collect = [&](std::vector<int> *indices, const ThreadPairs &thread_pairs, bool vertex_face) {
+    std::vector<ContactPair> pairs;
+    for (const auto &partial_pairs : thread_pairs) {
+      for (const auto &[pair, distance] : partial_pairs) {
+        const auto &v = pair.indices;
+        float reach = vertex_face ? bounds_[v[0]] + std::max({bounds_[v[1]], bounds_[v[2]], bounds_[v[3]]})
+                                  : std::max(bounds_[v[0]], bounds_[v[1]]) + std::max(bounds_[v[2]], bounds_[v[3]]);
+        if (distance - reach < thickness) {
+          pairs.push_back(pair);
+        }
+      }
+    }
+    // Sorted so that the result does not depend on how the items were split between threads.
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    indices->resize(pairs.size() * 4);
+    for (size_t i = 0; i < pairs.size(); i++) {
+      std::copy(pairs[i].indices.begin(), pairs[i].indices.end(), indices->begin() + i * 4);
+    }
+  };
+  collect(&vertex_face_indices_, thread_vertex_faces, true);
+  collect(&edge_edge_indices_, thread_edge_edges, false);
+  vertex_face_directory_ = Directory(vertex_face_indices_, num_particle_);
+  edge_edge_directory_ = Directory(edge_edge_indices_, num_particle_);
+}
+
+int ContactDetector::NumEdges() const {
+  return static_cast<int>(edge_indices_.size() / 2);
+}
+
+const std::vector<int> &ContactDetector::VertexFaceIndices() const {
+  return vertex_face_indices_;
+}
+
+const std::vector<int> &ContactDetector::EdgeEdgeIndices() const {
+  return edge_edge_indices_;
+}
+
+const Directory &ContactDetector::VertexFaceDirectory() const {
+  return vertex_face_directory_;
+}
+
+const Directory &ContactDetector::EdgeEdgeDirectory() const {
+  return edge_edge_directory_;
+}
+
+const std::vector<float> &ContactDetector::Bounds() const {
+  return bounds_;
+}
+
+}  // namespace snowberg::solver
@@ -0,0 +1,78 @@
+#pragma once
+#include "snowberg/solver/solver_util.h"
+
+namespace snowberg::solver {
+
+// Contact pairs between the cloth triangles of a scene as seen by the particle solve. A vertex-face pair is (vertex,
+// triangle vertex 0, 1, 2) and an edge-edge pair is (edge 0 vertex 0, 1, edge 1 vertex 0, 1), both stored as 4
+// particle indices. The directories map a particle to the positions of its slots in these arrays, position / 4 is the
+// pair and position % 4 the slot. bounds is null when self contact is off.
+struct ContactRef {
+  int num_vertex_face;
+  const int *vertex_face_indices;
+  DirectoryRef vertex_face_directory;
+
+  int num_edge_edge;
+  const int *edge_edge_indices;
+  DirectoryRef edge_edge_directory;
+
+  // Largest distance a particle may move away from x_detect, its position at the last detection.
+  const float *bounds;
+  const Vector3<float> *x_detect;
+  // Positions at the start of the current sweep. The other particles of a pair are read from here, so that contacts
+  // between particles of one color do not race with their updates.
+  const Vector3<float> *x_sweep;
+
+  float thickness;
+  float stiffness;
+};
+
+// Broad and narrow phase of the cloth self contact, run on the host once per step. Candidates come from a spatial hash
+// over the triangles and edges. Each particle is bounded to relaxation times the distance to its nearest pair within
+// its query radius, so two primitives cannot pass through each other as long as relaxation < 0.5. Only the pairs that
+// can get closer than thickness inside these bounds are handed to the solve. A particle held back by its bound is not
+// stuck there, the solve detects again from where it got.
+class ContactDetector {
+ public:
+  ContactDetector() = default;
+  // triangle_indices holds 3 particle indices per triangle at positions x, edges are collected from them. Quads split
+  // along both diagonals only keep the triangles of one, so the stretching elements of any cloth can be passed as they
+  // are.
+  ContactDetector(const std::vector<int> &triangle_indices, const Vector3<float> *x, int num_particle);
+
+  // Particles with a negative entry in particle_colors, the free slots of an edited scene, are not tested against
+  // faces and keep the bound of an empty neighborhood. displacements holds how far each particle is expected to move
+  // before the next detection, its query radius grows by displacement / relaxation so that its bound covers that
+  // motion wherever nothing else is near.
+  void Detect(const Vector3<float> *x,
+              float thickness,
+              float query_radius,
+              float relaxation,
+              ThreadPool *thread_pool = nullptr,
+              const int *particle_colors = nullptr,
+              const float *displacements = nullptr);
+
+  // contact_query_radius, raised to the smallest radius for which no pair outside it can come within thickness in one
+  // step.
+  static float QueryRadius(const SolverSettings &settings);
+
+  int NumEdges() const;
+  const std::vector<int> &VertexFaceIndices() const;
+  const std::vector<int> &EdgeEdgeIndices() const;
+  const Directory &VertexFaceDirectory() const;
+  const Directory &EdgeEdgeDirectory() const;
+  const std::vector<float> &Bounds() const;
+
+ private:
+  int num_particle_{0};
+  std::vector<int> triangle_indices_;
+  std::vector<int> edge_indices_;
+
+  std::vector<int> vertex_face_indices_;
+  std::vector<int> edge_edge_indices_;
+  Directory vertex_face_directory_;
+  Directory edge_edge_directory_;
+  std::vector<float> bounds_;
+};
+
+}  // namespace snowberg::solver
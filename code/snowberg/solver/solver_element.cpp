@@ -1,3 +1,18 @@
 #include "snowberg/solver/solver_element.h"
 
-namespace snowberg::solver {}  // namespace snowberg::solver
+namespace snowberg::solver {
+
+LM_DEVICE_FUNC StretchingRestState ElementStretching::RestState() const {
+  StretchingRestState rest_state;
+  Matrix2<float> Dm_inv = Dm.inverse();
+  rest_state.gradients.row(0) = -Dm_inv.row(0) - Dm_inv.row(1);
+  rest_state.gradients.row(1) = Dm_inv.row(0);
+  rest_state.gradients.row(2) = Dm_inv.row(1);
+  rest_state.mu = mu * area;
+  rest_state.lambda = lambda * area;
+  rest_state.a = 1.0f + mu / lambda;
+  rest_state.damping = damping;
+  return rest_state;
+}
+
+}  // namespace snowberg::solver
@@ -3,6 +3,17 @@
 
 namespace snowberg::solver {
 
+// Everything the particle solve reads of a stretching element, derived from its rest shape. Row k of gradients is the
+// derivative of the deformation gradient F = X * gradients by vertex k, for the 3 vertex positions in the columns of X.
+// mu and lambda are scaled by the area and a = 1 + mu / lambda.
+struct StretchingRestState {
+  Matrix<float, 3, 2> gradients;
+  float mu;
+  float lambda;
+  float a;
+  float damping;
+};
+
 struct ElementStretching {
   float mu{0.0f};
   float lambda{0.0f};
@@ -11,6 +22,9 @@ struct ElementStretching {
   Matrix2<float> Dm{Matrix2<float>::Identity()};
   float sigma_lb{-1.0f};
   float sigma_ub{-1.0f};
+
+  // Has to be recomputed whenever Dm changes.
+  LM_DEVICE_FUNC StretchingRestState RestState() const;
 };
 
 struct ElementBending {
@@ -142,6 +142,24 @@ ObjectPack ObjectPack::CreateGridCloth(const std::vector<Vector3<float>> &pos_gr
   return object_pack;
 }
 
+ObjectPack ObjectPack::CreateSquareCloth(int n,
+                                         float spacing,
+                                         const Vector3<float> &origin,
+                                         float perturbation,
+                                         float sigma_ub) {
+  std::vector<Vector3<float>> pos_grid;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      pos_grid.push_back(origin + Vector3<float>{i * spacing, 0.0f, j * spacing});
+    }
+  }
+  ObjectPack object_pack = CreateGridCloth(pos_grid, n, n, 1.0f, 3e3f, 0.2f, 0.03f, 1e-6f, -1.0f, sigma_ub);
+  for (size_t i = 0; i < object_pack.x.size(); i++) {
+    object_pack.x[i].y() += perturbation * std::sin(1.7f * i);
+  }
+  return object_pack;
+}
+
 void ObjectPack::PushStretching(int u,
                                 int v,
                                 int w,
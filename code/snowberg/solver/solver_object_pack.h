@@ -40,6 +40,15 @@ struct ObjectPack {
                                     float sigma_ub = -1.0f,
                                     float elastic_limit = 4.0f);
 
+  // n by n grid cloth with the given spacing in the y = origin.y() plane, corner at origin, with the material defaults
+  // of CreateGridCloth. perturbation displaces particle i by perturbation * sin(1.7 i) along y off its rest shape. The
+  // tests and the benchmark build their cloth with this, so both see the same scene.
+  static ObjectPack CreateSquareCloth(int n,
+                                      float spacing,
+                                      const Vector3<float> &origin,
+                                      float perturbation = 0.0f,
+                                      float sigma_ub = -1.0f);
+
  private:
   void PushStretching(int u, int v, int w, float mu, float lambda, float damping, float sigma_lb, float sigma_ub);
   void PushBending(int a, int b, int c, int d, float stiffness, float damping, float elastic_limit);
@@ -0,0 +1,91 @@
+#include "snowberg/solver/solver_readback.h"
+
+namespace snowberg::solver {
+
+ReadbackFence::ReadbackFence(const PositionReadback *readback, int buffer) : readback_(readback), buffer_(buffer) {
+}
+
+bool ReadbackFence::Ready() const {
+  const std::shared_future<void> &future = readback_->futures_[buffer_];
+  if (future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return false;
+  }
+#if defined(LONGMARCH_CUDA_RUNTIME)
+  if (readback_->event_recorded_[buffer_] && cudaEventQuery(readback_->events_[buffer_]) != cudaSuccess) {
+    return false;
+  }
+#endif
+  return true;
+}
+
+const Vector3<float> *ReadbackFence::Wait() const {
+  const std::shared_future<void> &future = readback_->futures_[buffer_];
+  if (future.valid()) {
+    future.wait();
+  }
+#if defined(LONGMARCH_CUDA_RUNTIME)
+  if (readback_->event_recorded_[buffer_]) {
+    cudaEventSynchronize(readback_->events_[buffer_]);
+  }
+#endif
+  return readback_->positions_[buffer_];
+}
+
+int ReadbackFence::Buffer() const {
+  return buffer_;
+}
+
+PositionReadback::PositionReadback(const std::vector<int> &particle_ids, int num_buffers)
+    : particle_ids_(particle_ids), positions_(num_buffers), futures_(num_buffers) {
+#if defined(LONGMARCH_CUDA_RUNTIME)
+  events_.resize(num_buffers);
+  event_recorded_.resize(num_buffers, false);
+  for (int b = 0; b < num_buffers; b++) {
+    cudaMallocHost(&positions_[b], particle_ids_.size() * sizeof(Vector3<float>));
+    cudaEventCreateWithFlags(&events_[b], cudaEventDisableTiming);
+  }
+#else
+  for (auto &positions : positions_) {
+    positions = new Vector3<float>[particle_ids_.size()];
+  }
+#endif
+}
+
+PositionReadback::~PositionReadback() {
+  for (int b = 0; b < NumBuffers(); b++) {
+    ReadbackFence(this, b).Wait();
+  }
+#if defined(LONGMARCH_CUDA_RUNTIME)
+  for (int b = 0; b < NumBuffers(); b++) {
+    cudaFreeHost(positions_[b]);
+    cudaEventDestroy(events_[b]);
+  }
+  cudaFree(device_particle_ids_);
+  cudaFree(device_positions_);
+#else
+  for (auto positions : positions_) {
+    delete[] positions;
+  }
+#endif
+}
+
+const std::vector<int> &PositionReadback::ParticleIds() const {
+  return particle_ids_;
+}
+
+int PositionReadback::NumBuffers() const {
+  return positions_.size();
+}
+
+int PositionReadback::Acquire() {
+  int buffer = next_buffer_;
+  next_buffer_ = (next_buffer_ + 1) % NumBuffers();
+  ReadbackFence(this, buffer).Wait();
+  futures_[buffer] = std::shared_future<void>();
+#if defined(LONGMARCH_CUDA_RUNTIME)
+  event_recorded_[buffer] = false;
+#endif
+  return buffer;
+}
+
+}  // namespace snowberg::solver
@@ -0,0 +1,66 @@
+#pragma once
+#include "snowberg/solver/solver_util.h"
+
+#if defined(LONGMARCH_CUDA_RUNTIME)
+#include <cuda_runtime.h>
+#endif
+
+namespace snowberg::solver {
+
+class PositionReadback;
+
+// Completion of one ReadPositionsAsync. Valid until the readback it came from issues its next NumBuffers() readbacks.
+class ReadbackFence {
+ public:
+  bool Ready() const;
+  // Blocks until the positions are in place and returns them, in the order of the particle ids of the readback.
+  const Vector3<float> *Wait() const;
+  int Buffer() const;
+
+ private:
+  friend class PositionReadback;
+  friend class SceneHost;
+  friend class SceneDevice;
+  ReadbackFence(const PositionReadback *readback, int buffer);
+
+  const PositionReadback *readback_;
+  int buffer_;
+};
+
+// Caller owned destination of asynchronous position readbacks of a fixed set of particles. Readbacks go round robin
+// over NumBuffers() persistent buffers, page locked when the CUDA runtime is available, so with the default two a
+// frame can be drawn from one buffer while the next step fills the other. Issuing a readback into a buffer waits for
+// the previous one into the same buffer, the caller has to be done reading it by then.
+class PositionReadback {
+ public:
+  explicit PositionReadback(const std::vector<int> &particle_ids, int num_buffers = 2);
+  ~PositionReadback();
+  PositionReadback(const PositionReadback &) = delete;
+  PositionReadback &operator=(const PositionReadback &) = delete;
+
+  const std::vector<int> &ParticleIds() const;
+  int NumBuffers() const;
+
+ private:
+  friend class ReadbackFence;
+  friend class SceneHost;
+  friend class SceneDevice;
+
+  // Waits for the last readback into the next buffer and returns that buffer.
+  int Acquire();
+
+  std::vector<int> particle_ids_;
+  std::vector<Vector3<float> *> positions_;
+  int next_buffer_{0};
+  // Set by the host scene for every readback, a default constructed future counts as done.
+  std::vector<std::shared_future<void>> futures_;
+#if defined(LONGMARCH_CUDA_RUNTIME)
+  // Set by the device scene, with the particle ids and a staging buffer on the device allocated at its first readback.
+  std::vector<cudaEvent_t> events_;
+  std::vector<bool> event_recorded_;
+  int *device_particle_ids_{nullptr};
+  Vector3<float> *device_positions_{nullptr};
+#endif
+};
+
+}  // namespace snowberg::solver
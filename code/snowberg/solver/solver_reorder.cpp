@@ -0,0 +1,146 @@
+#include "snowberg/solver/solver_reorder.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace snowberg::solver {
+
+namespace {
+
+// Spreads the lower 10 bits of v to every third bit.
+uint32_t SpreadBits(uint32_t v) {
+  v = (v * 0x00010001u) & 0xFF0000FFu;
+  v = (v * 0x00000101u) & 0x0F00F00Fu;
+  v = (v * 0x00000011u) & 0xC30C30C3u;
+  v = (v * 0x00000005u) & 0x49249249u;
+  return v;
+}
+
+std::vector<int> MortonRanks(const std::vector<Vector3<float>> &x) {
+  AABB bounds;
+  for (const auto &p : x) {
+    bounds.Expand(p);
+  }
+  Vector3<float> scale = bounds.Size().cwiseMax(1e-9f).cwiseInverse() * 1023.0f;
+  std::vector<uint32_t> codes(x.size());
+  for (size_t i = 0; i < x.size(); i++) {
+    Vector3<float> cell = (x[i] - bounds.lower_bound).cwiseProduct(scale);
+    codes[i] = SpreadBits(static_cast<uint32_t>(cell[0])) << 2 | SpreadBits(static_cast<uint32_t>(cell[1])) << 1 |
+               SpreadBits(static_cast<uint32_t>(cell[2]));
+  }
+  std::vector<int> order(x.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return codes[a] < codes[b]; });
+  std::vector<int> ranks(x.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    ranks[order[i]] = i;
+  }
+  return ranks;
+}
+
+// Breadth first search from a vertex of least degree in every connected component, visiting the neighbors of a
+// vertex in ascending degree, reversed at the end.
+std::vector<int> RcmRanks(int num_particle,
+                          const std::vector<int> &stretching_indices,
+                          const std::vector<int> &bending_indices) {
+  std::vector<std::pair<int, int>> edges;
+  auto add_element_edges = [&](const std::vector<int> &element_indices, int element_size) {
+    for (size_t e = 0; e < element_indices.size(); e += element_size) {
+      for (int a = 0; a < element_size; a++) {
+        for (int b = 0; b < element_size; b++) {
+          if (a != b) {
+            edges.emplace_back(element_indices[e + a], element_indices[e + b]);
+          }
+        }
+      }
+    }
+  };
+  add_element_edges(stretching_indices, 3);
+  add_element_edges(bending_indices, 4);
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+  std::vector<int> first(num_particle + 1, 0);
+  for (const auto &edge : edges) {
+    first[edge.first + 1]++;
+  }
+  std::partial_sum(first.begin(), first.end(), first.begin());
+  auto degree = [&](int v) { return first[v + 1] - first[v]; };
+
+  std::vector<int> starts(num_particle);
+  std::iota(starts.begin(), starts.end(), 0);
+  std::stable_sort(starts.begin(), starts.end(), [&](int a, int b) { return degree(a) < degree(b); });
+
+  std::vector<int> order;
+  order.reserve(num_particle);
+  std::vector<bool> visited(num_particle, false);
+  std::vector<int> neighbors;
+  for (int start : starts) {
+    if (visited[start]) {
+      continue;
+    }
+    visited[start] = true;
+    order.push_back(start);
+    for (size_t head = order.size() - 1; head < order.size(); head++) {
+      int v = order[head];
+      neighbors.clear();
+      for (int i = first[v]; i < first[v + 1]; i++) {
+        if (!visited[edges[i].second]) {
+          neighbors.push_back(edges[i].second);
+        }
+      }
+      std::stable_sort(neighbors.begin(), neighbors.end(), [&](int a, int b) { return degree(a) < degree(b); });
+      for (int u : neighbors) {
+        visited[u] = true;
+        order.push_back(u);
+      }
+    }
+  }
+
+  std::vector<int> ranks(num_particle);
+  for (int i = 0; i < num_particle; i++) {
+    ranks[order[i]] = num_particle - 1 - i;
+  }
+  return ranks;
+}
+
+}  // namespace
+
+std::vector<int> ParticleOrder(ParticleOrdering ordering,
+                               const std::vector<Vector3<float>> &x,
+                               const std::vector<int> &colors,
+                               const std::vector<int> &stretching_indices,
+                               const std::vector<int> &bending_indices) {
+  int num_particle = x.size();
+  std::vector<int> order(num_particle);
+  std::iota(order.begin(), order.end(), 0);
+  if (ordering == PARTICLE_ORDERING_NONE) {
+    return order;
+  }
+  std::vector<int> ranks = ordering == PARTICLE_ORDERING_MORTON
+                               ? MortonRanks(x)
+                               : RcmRanks(num_particle, stretching_indices, bending_indices);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return colors[a] != colors[b] ? colors[a] < colors[b] : ranks[a] < ranks[b];
+  });
+  return order;
+}
+
+std::vector<int> ElementOrder(const std::vector<int> &element_indices,
+                              int element_size,
+                              const std::vector<int> &new_index) {
+  int num_element = element_indices.size() / element_size;
+  std::vector<int> keys(num_element);
+  for (int e = 0; e < num_element; e++) {
+    keys[e] = new_index[element_indices[e * element_size]];
+    for (int j = 1; j < element_size; j++) {
+      keys[e] = std::min(keys[e], new_index[element_indices[e * element_size + j]]);
+    }
+  }
+  std::vector<int> order(num_element);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+  return order;
+}
+
+}  // namespace snowberg::solver
@@ -0,0 +1,29 @@
+#pragma once
+#include "snowberg/solver/solver_util.h"
+
+namespace snowberg::solver {
+
+typedef enum ParticleOrdering {
+  PARTICLE_ORDERING_NONE = 0,    // id order, as the particles were added to the scene
+  PARTICLE_ORDERING_MORTON = 1,  // along a Morton curve through the bounding box of the positions
+  PARTICLE_ORDERING_RCM = 2,     // reverse Cuthill-McKee over the graph of particles sharing an element
+} ParticleOrdering;
+
+// Storage order of the particles for the VBD sweeps. order[i] is the current index of the particle to store at i.
+// Except for PARTICLE_ORDERING_NONE the particles are grouped by color first, so a sweep over one color reads a single
+// contiguous range, and ordered within a color so that particles close in space or in the mesh end up close in memory.
+// The mesh graph of PARTICLE_ORDERING_RCM comes from the 3 particle indices per stretching and 4 per bending.
+std::vector<int> ParticleOrder(ParticleOrdering ordering,
+                               const std::vector<Vector3<float>> &x,
+                               const std::vector<int> &colors,
+                               const std::vector<int> &stretching_indices,
+                               const std::vector<int> &bending_indices);
+
+// Storage order of elements with element_size particles each, ascending in the smallest new index of their particles,
+// so that the elements of neighboring particles stay close too. new_index maps a current particle index to its storage
+// index. order[i] is the current index of the element to store at i.
+std::vector<int> ElementOrder(const std::vector<int> &element_indices,
+                              int element_size,
+                              const std::vector<int> &new_index);
+
+}  // namespace snowberg::solver
@@ -1,5 +1,7 @@
 #include "snowberg/solver/solver_rigid_object.h"
 
+#include <algorithm>
+
 namespace snowberg::solver {
 
 RigidObject::operator RigidObjectRef() const {
@@ -21,4 +23,129 @@ RigidObjectDevice::operator RigidObjectRef() const {
   return rigid_object;
 }
 #endif
+
+namespace {
+
+constexpr size_t kGrainSize = 256;
+
+struct CandidateQuery {
+  Vector3<float> center;
+  float radius;
+};
+
+struct CandidateResult {
+  int *indices;
+  int count;
+};
+
+bool SphereHitsBox(const CandidateQuery &query, const CandidateResult *, const AABB &aabb) {
+  return DistancePointAABB(query.center, aabb.lower_bound, aabb.upper_bound) <= query.radius;
+}
+
+bool CountCandidate(const CandidateQuery &, CandidateResult *result, int, const AABB *) {
+  result->count++;
+  return true;
+}
+
+bool StoreCandidate(const CandidateQuery &, CandidateResult *result, int instance_index, const AABB *) {
+  result->indices[result->count++] = instance_index;
+  return true;
+}
+
+}  // namespace
+
+RigidBroadPhase::RigidBroadPhase(const std::vector<MeshSDF> &meshes) {
+  mesh_bounds_.resize(meshes.size());
+  for (size_t i = 0; i < meshes.size(); i++) {
+    for (const auto &p : meshes[i].GetVertices()) {
+      mesh_bounds_[i].Expand(p);
+    }
+  }
+}
+
+void RigidBroadPhase::UpdateBounds(const RigidObjectRef *rigid_objects, int num_rigid_object) {
+  world_bounds_.resize(num_rigid_object);
+  bounds_.resize(num_rigid_object * 2);
+  std::vector<int> instance_indices(num_rigid_object);
+  for (int i = 0; i < num_rigid_object; i++) {
+    const RigidObjectState &state = rigid_objects[i].state;
+    Vector3<float> center = state.R * mesh_bounds_[i].Center() + state.t;
+    Vector3<float> extent = state.R.cwiseAbs() * mesh_bounds_[i].Size() * 0.5f +
+                            Vector3<float>::Constant(kRigidContactMargin);
+    world_bounds_[i].lower_bound = center - extent;
+    world_bounds_[i].upper_bound = center + extent;
+    bounds_[i * 2] = world_bounds_[i].lower_bound;
+    bounds_[i * 2 + 1] = world_bounds_[i].upper_bound;
+    instance_indices[i] = i;
+  }
+  if (num_rigid_object > 0) {
+    bvh_.UpdateInstances(world_bounds_.data(), instance_indices.data(), num_rigid_object);
+  }
+}
+
+void RigidBroadPhase::UpdateCandidates(const Vector3<float> *x_prev,
+                                       const Vector3<float> *x,
+                                       int num_particle,
+                                       ThreadPool *thread_pool,
+                                       const int *particle_colors) {
+  spheres_.resize(num_particle);
+  candidates_.first.resize(num_particle);
+  candidates_.count.assign(num_particle, 0);
+  auto for_each_particle = [&](const auto &func) { ParallelForEach(thread_pool, num_particle, kGrainSize, func); };
+
+  // Counted first and stored after the prefix sum, so the lists do not depend on the thread count.
+  BVHRef bvh = bvh_;
+  for_each_particle([&](int pidx) {
+    float radius = (x[pidx] - x_prev[pidx]).norm();
+    Vector3<float> center = (x[pidx] + x_prev[pidx]) * 0.5f;
+    spheres_[pidx] = Vector4<float>{center[0], center[1], center[2], radius};
+    if (!world_bounds_.empty() && (!particle_colors || particle_colors[pidx] >= 0)) {
+      CandidateResult result{nullptr, 0};
+      bvh.Traversal(CandidateQuery{center, radius}, &result, world_bounds_.data(), SphereHitsBox, CountCandidate);
+      candidates_.count[pidx] = result.count;
+    }
+  });
+  for (int i = 0, accum = 0; i < num_particle; i++) {
+    candidates_.first[i] = accum;
+    accum += candidates_.count[i];
+  }
+  candidates_.positions.resize(num_particle ? candidates_.first.back() + candidates_.count.back() : 0);
+  if (!candidates_.positions.empty()) {
+    for_each_particle([&](int pidx) {
+      if (!candidates_.count[pidx]) {
+        return;
+      }
+      const Vector4<float> &sphere = spheres_[pidx];
+      CandidateResult result{candidates_.positions.data() + candidates_.first[pidx], 0};
+      bvh.Traversal(CandidateQuery{sphere.head<3>(), sphere[3]}, &result, world_bounds_.data(), SphereHitsBox,
+                    StoreCandidate);
+      std::sort(result.indices, result.indices + result.count);
+    });
+  }
+}
+
+const std::vector<Vector3<float>> &RigidBroadPhase::Bounds() const {
+  return bounds_;
+}
+
+const std::vector<Vector4<float>> &RigidBroadPhase::Spheres() const {
+  return spheres_;
+}
+
+const Directory &RigidBroadPhase::Candidates() const {
+  return candidates_;
+}
+
+RigidBroadPhase::operator RigidCandidateRef() const {
+  RigidCandidateRef candidate_ref{};
+  if (!bounds_.empty()) {
+    candidate_ref.bounds = bounds_.data();
+  }
+  if (!bounds_.empty() && !spheres_.empty()) {
+    candidate_ref.spheres = spheres_.data();
+    candidate_ref.candidates = candidates_;
+  }
+  return candidate_ref;
+}
+
 }  // namespace snowberg::solver
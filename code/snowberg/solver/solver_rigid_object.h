@@ -30,4 +30,53 @@ struct RigidObjectDevice {
 };
 #endif
 
+// Distance to the surface of a rigid object below which it pushes particles away.
+constexpr float kRigidContactMargin = 0.018f;
+
+// Rigid objects within reach of each particle during one step. bounds holds the lower and upper corner of the world
+// space box of every rigid object grown by kRigidContactMargin, a particle outside of it is out of contact. spheres
+// holds the query sphere (center, radius) of every particle, and candidates lists the ascending indices of the rigid
+// objects whose bounds the sphere touches. As long as a particle stays within its sphere only the candidates need to
+// be tested. Both are null when not available, then every rigid object is tested.
+struct RigidCandidateRef {
+  const Vector3<float> *bounds;
+  const Vector4<float> *spheres;
+  DirectoryRef candidates;
+};
+
+// Broad phase between the particles and the rigid objects, run on the host once per step. The world bounds follow
+// from the mesh bounds under the current rigid transforms, and the candidates of all particles come from one BVH query
+// each, so the narrow phase cost stays flat in the number of rigid objects far from the cloth.
+class RigidBroadPhase {
+ public:
+  RigidBroadPhase() = default;
+  explicit RigidBroadPhase(const std::vector<MeshSDF> &meshes);
+
+  void UpdateBounds(const RigidObjectRef *rigid_objects, int num_rigid_object);
+
+  // The sphere of a particle is centered between x_prev and x, the predicted position of the step, with a radius of
+  // their distance, so it reaches half the predicted motion past both ends. Requires UpdateBounds first. Particles
+  // with a negative entry in particle_colors, the free slots of an edited scene, get no candidates.
+  void UpdateCandidates(const Vector3<float> *x_prev,
+                        const Vector3<float> *x,
+                        int num_particle,
+                        ThreadPool *thread_pool = nullptr,
+                        const int *particle_colors = nullptr);
+
+  const std::vector<Vector3<float>> &Bounds() const;
+  const std::vector<Vector4<float>> &Spheres() const;
+  // positions holds rigid object indices rather than positions in a content array.
+  const Directory &Candidates() const;
+
+  operator RigidCandidateRef() const;
+
+ private:
+  std::vector<AABB> mesh_bounds_;
+  std::vector<AABB> world_bounds_;
+  std::vector<Vector3<float>> bounds_;
+  BVHHost bvh_;
+  std::vector<Vector4<float>> spheres_;
+  Directory candidates_;
+};
+
 }  // namespace snowberg::solver
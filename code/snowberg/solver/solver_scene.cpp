@@ -1,16 +1,24 @@
 #include "snowberg/solver/solver_scene.h"
 
+#if defined(__CUDACC__)
+#include "thrust/execution_policy.h"
+#include "thrust/transform.h"
+#endif
+
 namespace snowberg::solver {
 LM_DEVICE_FUNC int SceneRef::ParticleIndex(int particle_id) const {
-  return BinarySearch(particle_ids, num_particle, particle_id);
+  int i = BinarySearch(particle_ids, num_particle_ids, particle_id);
+  return i < 0 ? -1 : particle_order[i];
 }
 
 LM_DEVICE_FUNC int SceneRef::StretchingIndex(int stretching_id) const {
-  return BinarySearch(stretching_ids, num_stretching, stretching_id);
+  int i = BinarySearch(stretching_ids, num_stretching_ids, stretching_id);
+  return i < 0 ? -1 : stretching_order[i];
 }
 
 LM_DEVICE_FUNC int SceneRef::BendingIndex(int bending_id) const {
-  return BinarySearch(bending_ids, num_bending, bending_id);
+  int i = BinarySearch(bending_ids, num_bending_ids, bending_id);
+  return i < 0 ? -1 : bending_order[i];
 }
 
 LM_DEVICE_FUNC int SceneRef::RigidObjectIndex(int rigid_object_id) const {
@@ -99,45 +107,10 @@ std::vector<Vector3<float>> Scene::GetPositions(const std::vector<int> &particle
   return positions;
 }
 
-#if defined(__CUDACC__)
-SceneDevice::SceneDevice(const Scene &scene) {
-  x_prev_ = scene.x_;
-  x_ = scene.x_;
-  v_ = scene.v_;
-  m_ = scene.m_;
-  particle_ids_ = scene.particle_ids_;
-  particle_ids_host_ = scene.particle_ids_;
-  next_particle_id_ = scene.next_particle_id_;
-
-  stretchings_ = scene.stretchings_;
-  stretching_indices_ = scene.stretching_indices_;
-  stretching_ids_ = scene.stretching_ids_;
-  stretching_ids_host_ = scene.stretching_ids_;
-  next_stretching_id_ = scene.next_stretching_id_;
-
-  bendings_ = scene.bendings_;
-  bending_indices_ = scene.bending_indices_;
-  bending_ids_ = scene.bending_ids_;
-  bending_ids_host_ = scene.bending_ids_;
-  next_bending_id_ = scene.next_bending_id_;
-
-  std::vector<RigidObjectRef> rigid_objects = scene.rigid_objects_;
-  rigid_object_meshes_.reserve(scene.rigid_object_meshes_.size());
-  for (int i = 0; i < scene.rigid_object_meshes_.size(); i++) {
-    rigid_object_meshes_.emplace_back(scene.rigid_object_meshes_[i]);
-    rigid_objects[i].mesh_sdf = rigid_object_meshes_.back();
-  }
-  rigid_objects_ = rigid_objects;
-  rigid_object_ids_ = scene.rigid_object_ids_;
-  rigid_object_ids_host_ = scene.rigid_object_ids_;
-  next_rigid_object_id_ = scene.next_rigid_object_id_;
-
+std::vector<int> Scene::ParticleColors(const Directory &stretching_directory,
+                                       const Directory &bending_directory,
+                                       int *num_colors) const {
   int num_particle = x_.size();
-  Directory stretching_directory{scene.stretching_indices_, num_particle};
-  stretching_directory_ = stretching_directory;
-  Directory bending_directory{scene.bending_indices_, num_particle};
-  bending_directory_ = bending_directory;
-
   std::vector<int> particle_colors(num_particle, -1);
 
   int c = 0;
@@ -145,44 +118,30 @@ SceneDevice::SceneDevice(const Scene &scene) {
     for (int i = 0; i < num_particle; i++) {
       if (particle_colors[i] != -1)
         continue;
-      int id = scene.particle_ids_[i];
+      int id = particle_ids_[i];
       bool pass = true;
       auto check_conflict = [&](int other_id) {
         if (other_id == id)
           return;
-        int idx = BinarySearch(scene.particle_ids_.data(), num_particle, other_id);
+        int idx = BinarySearch(particle_ids_.data(), num_particle, other_id);
         if (particle_colors[idx] == c)
           pass = false;
       };
 
-      // printf("idx: %d, id: %d\n", i, id);
-
       for (int j = 0, first = stretching_directory.first[id], size = stretching_directory.count[id]; pass && j < size;
            j++) {
-        // printf("stretching - j: %d, first: %d, size: %d count: %d\n", j, first, size,
-        // stretching_directory.positions.size());
         int stretching_i = stretching_directory.positions[first + j] / 3;
-        check_conflict(scene.stretching_indices_[stretching_i * 3]);
-        check_conflict(scene.stretching_indices_[stretching_i * 3 + 1]);
-        check_conflict(scene.stretching_indices_[stretching_i * 3 + 2]);
+        check_conflict(stretching_indices_[stretching_i * 3]);
+        check_conflict(stretching_indices_[stretching_i * 3 + 1]);
+        check_conflict(stretching_indices_[stretching_i * 3 + 2]);
       }
 
       for (int j = 0, first = bending_directory.first[id], size = bending_directory.count[id]; pass && j < size; j++) {
-        // printf("bending - j: %d, first: %d, size: %d count: %d position: %d\n", j, first, size,
-        // bending_directory.positions.size(), bending_directory.positions[first + j]);
         int bending_i = bending_directory.positions[first + j] / 4;
-        // printf("%d %d %d %d %d\n", bending_i * 4, bending_i * 4 + 1, bending_i * 4 + 2, bending_i * 4 + 3,
-        // bending_directory.positions.size()); printf("%d %d %d %d\n", scene.bending_indices_[bending_i * 4],
-        // scene.bending_indices_[bending_i * 4 + 1], scene.bending_indices_[bending_i * 4 + 2],
-        // scene.bending_indices_[bending_i * 4 + 3]);
-        check_conflict(scene.bending_indices_[bending_i * 4]);
-        // puts("check0");
-        check_conflict(scene.bending_indices_[bending_i * 4 + 1]);
-        // puts("check1");
-        check_conflict(scene.bending_indices_[bending_i * 4 + 2]);
-        // puts("check2");
-        check_conflict(scene.bending_indices_[bending_i * 4 + 3]);
-        // puts("check3");
+        check_conflict(bending_indices_[bending_i * 4]);
+        check_conflict(bending_indices_[bending_i * 4 + 1]);
+        check_conflict(bending_indices_[bending_i * 4 + 2]);
+        check_conflict(bending_indices_[bending_i * 4 + 3]);
       }
 
       if (pass) {
@@ -191,10 +150,106 @@ SceneDevice::SceneDevice(const Scene &scene) {
       }
     }
   }
-  // puts("here");
-  particle_colors_ = particle_colors;
-  particle_directory_host_ = Directory(particle_colors, c);
+  *num_colors = c;
+  return particle_colors;
+}
+
+SceneLayout Scene::Layout(ParticleOrdering ordering) const {
+  int num_particle = x_.size();
+  SceneLayout layout;
+  std::vector<int> colors = ParticleColors(Directory{stretching_indices_, num_particle},
+                                           Directory{bending_indices_, num_particle}, &layout.num_colors);
+
+  // Element indices hold particle ids, which are the indices in the scene.
+  std::vector<int> order = ParticleOrder(ordering, x_, colors, stretching_indices_, bending_indices_);
+  layout.particle_order.resize(num_particle);
+  for (int i = 0; i < num_particle; i++) {
+    layout.particle_order[order[i]] = i;
+    layout.x.push_back(x_[order[i]]);
+    layout.v.push_back(v_[order[i]]);
+    layout.m.push_back(m_[order[i]]);
+    layout.particle_colors.push_back(colors[order[i]]);
+  }
+  const std::vector<int> &new_index = layout.particle_order;
+
+  auto reorder_elements = [&](const auto &elements, const std::vector<int> &indices, int element_size,
+                              auto &layout_elements, std::vector<int> &layout_indices,
+                              std::vector<int> &layout_order) {
+    std::vector<int> element_order(elements.size());
+    if (ordering == PARTICLE_ORDERING_NONE) {
+      for (size_t e = 0; e < elements.size(); e++) {
+        element_order[e] = e;
+      }
+    } else {
+      element_order = ElementOrder(indices, element_size, new_index);
+    }
+    layout_order.resize(elements.size());
+    for (size_t e = 0; e < elements.size(); e++) {
+      layout_order[element_order[e]] = e;
+      layout_elements.push_back(elements[element_order[e]]);
+      for (int j = 0; j < element_size; j++) {
+        layout_indices.push_back(new_index[indices[element_order[e] * element_size + j]]);
+      }
+    }
+  };
+  reorder_elements(stretchings_, stretching_indices_, 3, layout.stretchings, layout.stretching_indices,
+                   layout.stretching_order);
+  reorder_elements(bendings_, bending_indices_, 4, layout.bendings, layout.bending_indices, layout.bending_order);
+  for (const auto &stretching : layout.stretchings) {
+    layout.stretching_rest_states.push_back(stretching.RestState());
+  }
+  return layout;
+}
+
+#if defined(__CUDACC__)
+SceneDevice::SceneDevice(const Scene &scene, ThreadPool *thread_pool, ParticleOrdering ordering)
+    : thread_pool_(thread_pool) {
+  SceneLayout layout = scene.Layout(ordering);
+  x_prev_ = layout.x;
+  x_ = layout.x;
+  v_ = layout.v;
+  m_ = layout.m;
+  particle_ids_ = scene.particle_ids_;
+  particle_ids_host_ = scene.particle_ids_;
+  particle_order_ = layout.particle_order;
+  next_particle_id_ = scene.next_particle_id_;
+
+  stretchings_ = layout.stretchings;
+  stretching_rest_states_ = layout.stretching_rest_states;
+  stretching_indices_ = layout.stretching_indices;
+  stretching_ids_ = scene.stretching_ids_;
+  stretching_ids_host_ = scene.stretching_ids_;
+  stretching_order_ = layout.stretching_order;
+  next_stretching_id_ = scene.next_stretching_id_;
+
+  bendings_ = layout.bendings;
+  bending_indices_ = layout.bending_indices;
+  bending_ids_ = scene.bending_ids_;
+  bending_ids_host_ = scene.bending_ids_;
+  bending_order_ = layout.bending_order;
+  next_bending_id_ = scene.next_bending_id_;
+
+  std::vector<RigidObjectRef> rigid_objects = scene.rigid_objects_;
+  rigid_object_meshes_.reserve(scene.rigid_object_meshes_.size());
+  for (int i = 0; i < scene.rigid_object_meshes_.size(); i++) {
+    rigid_object_meshes_.emplace_back(scene.rigid_object_meshes_[i]);
+    rigid_objects[i].mesh_sdf = rigid_object_meshes_.back();
+  }
+  rigid_objects_ = rigid_objects;
+  rigid_object_ids_ = scene.rigid_object_ids_;
+  rigid_object_ids_host_ = scene.rigid_object_ids_;
+  next_rigid_object_id_ = scene.next_rigid_object_id_;
+
+  int num_particle = x_.size();
+  stretching_directory_ = Directory{layout.stretching_indices, num_particle};
+  bending_directory_ = Directory{layout.bending_indices, num_particle};
+
+  particle_colors_ = layout.particle_colors;
+  particle_directory_host_ = Directory(layout.particle_colors, layout.num_colors);
   particle_directory_ = particle_directory_host_;
+  residuals_.resize(num_particle, 0.0f);
+  contact_detector_ = ContactDetector(layout.stretching_indices, layout.x.data(), num_particle);
+  rigid_broad_phase_ = RigidBroadPhase(scene.rigid_object_meshes_);
 
   cudaStreamCreate(&stream_);
 }
@@ -207,10 +262,11 @@ namespace {
 struct SearchAndCopyOp {
   const Vector3<float> *x;
   const int *particle_ids;
+  const int *particle_order;
   int num_particle;
 
   LM_DEVICE_FUNC Vector3<float> operator()(int particle_id) {
-    return x[BinarySearch(particle_ids, num_particle, particle_id)];
+    return x[particle_order[BinarySearch(particle_ids, num_particle, particle_id)]];
   }
 };
 }  // namespace
@@ -219,12 +275,46 @@ std::vector<Vector3<float>> SceneDevice::GetPositions(const std::vector<int> &pa
   thrust::device_vector<int> query_particle_ids(particle_ids);
   thrust::device_vector<Vector3<float>> result_positions(particle_ids.size());
   thrust::transform(query_particle_ids.begin(), query_particle_ids.end(), result_positions.begin(),
-                    SearchAndCopyOp{x_.data().get(), particle_ids_.data().get(), static_cast<int>(x_.size())});
+                    SearchAndCopyOp{x_.data().get(), particle_ids_.data().get(), particle_order_.data().get(),
+                                    static_cast<int>(x_.size())});
   std::vector<Vector3<float>> result_positions_host(particle_ids.size());
   thrust::copy(result_positions.begin(), result_positions.end(), result_positions_host.begin());
   return result_positions_host;
 }
 
+ReadbackFence SceneDevice::ReadPositionsAsync(PositionReadback &readback) {
+  int buffer = readback.Acquire();
+  const std::vector<int> &particle_ids = readback.ParticleIds();
+  size_t num_particle = particle_ids.size();
+  if (!readback.device_particle_ids_) {
+    cudaMalloc(&readback.device_particle_ids_, num_particle * sizeof(int));
+    cudaMalloc(&readback.device_positions_, num_particle * sizeof(Vector3<float>));
+    cudaMemcpy(readback.device_particle_ids_, particle_ids.data(), num_particle * sizeof(int), cudaMemcpyHostToDevice);
+  }
+  thrust::transform(thrust::cuda::par.on(stream_), readback.device_particle_ids_,
+                    readback.device_particle_ids_ + num_particle, readback.device_positions_,
+                    SearchAndCopyOp{x_.data().get(), particle_ids_.data().get(), particle_order_.data().get(),
+                                    static_cast<int>(x_.size())});
+  cudaMemcpyAsync(readback.positions_[buffer], readback.device_positions_, num_particle * sizeof(Vector3<float>),
+                  cudaMemcpyDeviceToHost, stream_);
+  cudaEventRecord(readback.events_[buffer], stream_);
+  readback.event_recorded_[buffer] = true;
+  return ReadbackFence(&readback, buffer);
+}
+
+RigidCandidateRef SceneDevice::UpdateRigidBounds() {
+  RigidCandidateRef rigid_candidates{};
+  if (rigid_objects_.empty()) {
+    return rigid_candidates;
+  }
+  rigid_objects_host_.resize(rigid_objects_.size());
+  thrust::copy(rigid_objects_.begin(), rigid_objects_.end(), rigid_objects_host_.begin());
+  rigid_broad_phase_.UpdateBounds(rigid_objects_host_.data(), rigid_objects_host_.size());
+  rigid_bounds_ = rigid_broad_phase_.Bounds();
+  rigid_candidates.bounds = thrust::raw_pointer_cast(rigid_bounds_.data());
+  return rigid_candidates;
+}
+
 RigidObjectState SceneDevice::GetRigidObjectState(int rigid_object_id) const {
   int rigid_object_idx = BinarySearch(rigid_object_ids_host_.data(), rigid_object_ids_host_.size(), rigid_object_id);
   RigidObjectRef ref = rigid_objects_[rigid_object_idx];
@@ -264,6 +354,18 @@ void SceneDevice::SetRigidObjectFriction(int rigid_object_id, float friction) {
   rigid_objects_[rigid_object_idx] = ref;
 }
 
+const SolverSettings &SceneDevice::GetSolverSettings() const {
+  return settings_;
+}
+
+void SceneDevice::SetSolverSettings(const SolverSettings &settings) {
+  settings_ = settings;
+}
+
+const SolverStatistics &SceneDevice::GetSolverStatistics() const {
+  return statistics_;
+}
+
 SceneDevice::operator SceneRef() {
   SceneRef scene_ref{};
 
@@ -272,24 +374,45 @@ SceneDevice::operator SceneRef() {
   scene_ref.x = thrust::raw_pointer_cast(x_.data());
   scene_ref.v = thrust::raw_pointer_cast(v_.data());
   scene_ref.m = thrust::raw_pointer_cast(m_.data());
+  scene_ref.num_particle_ids = particle_ids_.size();
   scene_ref.particle_ids = thrust::raw_pointer_cast(particle_ids_.data());
+  scene_ref.particle_order = thrust::raw_pointer_cast(particle_order_.data());
 
   scene_ref.num_stretching = stretchings_.size();
   scene_ref.stretchings = thrust::raw_pointer_cast(stretchings_.data());
+  scene_ref.stretching_rest_states = thrust::raw_pointer_cast(stretching_rest_states_.data());
   scene_ref.stretching_indices = thrust::raw_pointer_cast(stretching_indices_.data());
+  scene_ref.num_stretching_ids = stretching_ids_.size();
   scene_ref.stretching_ids = thrust::raw_pointer_cast(stretching_ids_.data());
+  scene_ref.stretching_order = thrust::raw_pointer_cast(stretching_order_.data());
   scene_ref.stretching_directory = stretching_directory_;
 
   scene_ref.num_bending = bendings_.size();
   scene_ref.bendings = thrust::raw_pointer_cast(bendings_.data());
   scene_ref.bending_indices = thrust::raw_pointer_cast(bending_indices_.data());
+  scene_ref.num_bending_ids = bending_ids_.size();
   scene_ref.bending_ids = thrust::raw_pointer_cast(bending_ids_.data());
+  scene_ref.bending_order = thrust::raw_pointer_cast(bending_order_.data());
   scene_ref.bending_directory = bending_directory_;
 
   scene_ref.num_rigid_object = rigid_objects_.size();
   scene_ref.rigid_objects = thrust::raw_pointer_cast(rigid_objects_.data());
   scene_ref.rigid_object_ids = thrust::raw_pointer_cast(rigid_object_ids_.data());
 
+  if (settings_.self_contact && contact_bounds_.size() == x_.size()) {
+    scene_ref.contact.num_vertex_face = vertex_face_indices_.size() / 4;
+    scene_ref.contact.vertex_face_indices = thrust::raw_pointer_cast(vertex_face_indices_.data());
+    scene_ref.contact.vertex_face_directory = vertex_face_directory_;
+    scene_ref.contact.num_edge_edge = edge_edge_indices_.size() / 4;
+    scene_ref.contact.edge_edge_indices = thrust::raw_pointer_cast(edge_edge_indices_.data());
+    scene_ref.contact.edge_edge_directory = edge_edge_directory_;
+    scene_ref.contact.bounds = thrust::raw_pointer_cast(contact_bounds_.data());
+    scene_ref.contact.x_detect = thrust::raw_pointer_cast(x_detect_.data());
+    scene_ref.contact.x_sweep = thrust::raw_pointer_cast(x_sweep_.data());
+    scene_ref.contact.thickness = settings_.contact_thickness;
+    scene_ref.contact.stiffness = settings_.contact_stiffness;
+  }
+
   return scene_ref;
 }
 #endif
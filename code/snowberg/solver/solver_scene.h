@@ -1,7 +1,11 @@
 #pragma once
+#include "snowberg/solver/solver_contact.h"
 #include "snowberg/solver/solver_element.h"
 #include "snowberg/solver/solver_object_pack.h"
+#include "snowberg/solver/solver_readback.h"
+#include "snowberg/solver/solver_reorder.h"
 #include "snowberg/solver/solver_rigid_object.h"
+#include "snowberg/solver/solver_snapshot.h"
 #include "snowberg/solver/solver_util.h"
 
 #if defined(__CUDACC__)
@@ -10,29 +14,43 @@
 
 namespace snowberg::solver {
 
+// Particles and elements are stored in the order of a SceneLayout. The ids are kept ascending, *_order holds the
+// storage index of each of them. After SceneHost::RemoveObject the storage has free slots, which no directory refers
+// to, and the ids of removed particles and elements stay with an order of -1 until they are compacted away, so
+// num_*_ids may differ from the storage sizes.
 struct SceneRef {
   int num_particle;
   Vector3<float> *x_prev;
   Vector3<float> *x;
   Vector3<float> *v;
   float *m;
+  int num_particle_ids;
   int *particle_ids;
+  int *particle_order;
 
   int num_stretching;
   ElementStretching *stretchings;
+  StretchingRestState *stretching_rest_states;
   int *stretching_indices;
+  int num_stretching_ids;
   int *stretching_ids;
+  int *stretching_order;
   DirectoryRef stretching_directory;
 
   int num_bending;
   ElementBending *bendings;
   int *bending_indices;
+  int num_bending_ids;
   int *bending_ids;
+  int *bending_order;
   DirectoryRef bending_directory;
 
   int num_rigid_object;
   RigidObjectRef *rigid_objects;
   int *rigid_object_ids;
+  RigidCandidateRef rigid_candidates;
+
+  ContactRef contact;
 
   LM_DEVICE_FUNC int ParticleIndex(int particle_id) const;
   LM_DEVICE_FUNC int StretchingIndex(int stretching_id) const;
@@ -40,6 +58,26 @@ struct SceneRef {
   LM_DEVICE_FUNC int RigidObjectIndex(int rigid_object_id) const;
 };
 
+// Arrays of a scene in the storage order of the solver. The element indices refer to storage indices, and *_order holds
+// the storage index of every id in ascending id order.
+struct SceneLayout {
+  std::vector<Vector3<float>> x;
+  std::vector<Vector3<float>> v;
+  std::vector<float> m;
+  std::vector<int> particle_order;
+  std::vector<int> particle_colors;
+  int num_colors{0};
+
+  std::vector<ElementStretching> stretchings;
+  std::vector<StretchingRestState> stretching_rest_states;
+  std::vector<int> stretching_indices;
+  std::vector<int> stretching_order;
+
+  std::vector<ElementBending> bendings;
+  std::vector<int> bending_indices;
+  std::vector<int> bending_order;
+};
+
 class Scene {
  public:
   ObjectPackView AddObject(const ObjectPack &object_pack);
@@ -54,36 +92,189 @@ class Scene {
 
  private:
   friend class SceneDevice;
+  friend class SceneHost;
+  friend class SceneHostBatch;
+
+  // Greedy coloring such that no two particles sharing an element have the same color, particles of one color can
+  // be solved in parallel.
+  std::vector<int> ParticleColors(const Directory &stretching_directory,
+                                  const Directory &bending_directory,
+                                  int *num_colors) const;
+
+  // Colors the particles, reorders particles and elements by ParticleOrder and ElementOrder, and derives the rest
+  // states of the stretchings.
+  SceneLayout Layout(ParticleOrdering ordering) const;
+
+  std::vector<Vector3<float>> x_;
+  std::vector<Vector3<float>> v_;
+  std::vector<float> m_;
+  std::vector<int> particle_ids_;
+  int next_particle_id_{0};
+
+  std::vector<ElementStretching> stretchings_;
+  std::vector<int> stretching_indices_;
+  std::vector<int> stretching_ids_;
+  int next_stretching_id_{0};
+
+  std::vector<ElementBending> bendings_;
+  std::vector<int> bending_indices_;
+  std::vector<int> bending_ids_;
+  int next_bending_id_{0};
+
+  std::vector<RigidObjectRef> rigid_objects_;
+  std::vector<MeshSDF> rigid_object_meshes_;
+  std::vector<int> rigid_object_ids_;
+  int next_rigid_object_id_{0};
+};
+
+// CPU counterpart of SceneDevice running the same VBD step, colors are swept one after another and the particles of
+// a color are distributed over the thread pool.
+class SceneHost {
+ public:
+  // thread_pool may be null to run single threaded. ordering only changes the storage order, ids stay valid.
+  SceneHost(const Scene &scene,
+            ThreadPool *thread_pool = nullptr,
+            ParticleOrdering ordering = PARTICLE_ORDERING_NONE);
+  ~SceneHost();
+  SceneHost(const SceneHost &) = delete;
+  SceneHost &operator=(const SceneHost &) = delete;
+
+  // Adds an object to the running scene. Its particles and elements fill the slots freed by RemoveObject before the
+  // storage grows, only its own particles are colored, and the directories are edited in place, so the cost is
+  // proportional to the object rather than the scene. The ordering of the constructor does not apply to it.
+  ObjectPackView AddObject(const ObjectPack &object_pack);
+  // Removes the particles and elements of a view returned by AddObject, or by Scene::AddObject for the scene this was
+  // built from. Elements have to be removed together with their particles, which is what a whole view does.
+  void RemoveObject(const ObjectPackView &object_pack_view);
+
+  // Storage indices of the particles of every color, in sweep order.
+  const Directory &GetColorDirectory() const;
+
+  // Both throw std::out_of_range for an id that is not in the scene or was removed.
+  std::vector<Vector3<float>> GetPositions(const std::vector<int> &particle_ids) const;
+
+  // Copies the current positions of the particles of readback into its next buffer. With a thread pool the copy runs
+  // on a worker and this returns right away, Update, Restore and the object edits wait for it before touching the
+  // positions, so the buffer always holds the positions of the moment of the call.
+  ReadbackFence ReadPositionsAsync(PositionReadback &readback);
+
+  RigidObjectState GetRigidObjectState(int rigid_object_id) const;
+  void SetRigidObjectState(int rigid_object_id, const RigidObjectState &state);
+
+  float GetRigidObjectStiffness(int rigid_object_id) const;
+  void SetRigidObjectStiffness(int rigid_object_id, float stiffness);
+
+  float GetRigidObjectFriction(int rigid_object_id) const;
+  void SetRigidObjectFriction(int rigid_object_id, float friction);
+
+  const SolverSettings &GetSolverSettings() const;
+  void SetSolverSettings(const SolverSettings &settings);
+
+  // Iterations, residual and Chebyshev spectral radius of the last Update.
+  const SolverStatistics &GetSolverStatistics() const;
+
+  // Binary copy of the simulation state: particle positions and velocities, the stretching and bending rest shapes
+  // after plasticity, the rigid object states, stiffnesses and frictions, the id counters, settings and statistics.
+  // Restore takes a snapshot of a SceneHost built from the same scene with the same ordering, topology and meshes are
+  // not part of it. It overwrites the state in place without rebuilding anything, and the following steps are bitwise
+  // identical to those after the snapshot. Throws std::runtime_error on a snapshot of a different scene.
+  std::vector<uint8_t> Snapshot() const;
+  void Restore(const std::vector<uint8_t> &snapshot);
+
+  operator SceneRef();
+
+  static void Update(SceneHost &scene, float dt);
+
+  // Runs the fixed batch iteration count and leaves self contact out, see CheckBatchSettings. Throws
+  // std::invalid_argument when a scene asks for self contact, a tolerance or Chebyshev acceleration.
+  static void UpdateBatch(const std::vector<SceneHost *> &scenes, float dt);
+
+ private:
+  // Storage index of a live particle id, -1 otherwise.
+  int ParticleIndex(int particle_id) const;
+  int RigidObjectIndex(int rigid_object_id) const;
+
+  // Colors each new particle with the smallest color none of the particles sharing an element with it has.
+  void ColorParticles(const std::vector<int> &particle_indices);
+
+  uint64_t TopologyHash() const;
+
+  // Refreshes the rigid broad phase once x holds the predicted positions of the step.
+  RigidCandidateRef UpdateRigidCandidates();
+
+  void WaitReadbacks();
+
+  ThreadPool *thread_pool_;
+  std::vector<std::shared_future<void>> pending_readbacks_;
+  SolverSettings settings_;
+  SolverStatistics statistics_;
+
+  std::vector<Vector3<float>> x_prev_;
   std::vector<Vector3<float>> x_;
+  std::vector<Vector3<float>> x_iterate_;
+  std::vector<Vector3<float>> x_iterate_prev_;
   std::vector<Vector3<float>> v_;
   std::vector<float> m_;
   std::vector<int> particle_ids_;
+  std::vector<int> particle_order_;
   int next_particle_id_{0};
+  std::vector<int> particle_colors_;
+  DynamicDirectory particle_directory_;
+  std::vector<int> free_particle_slots_;
+  int num_removed_particle_ids_{0};
 
   std::vector<ElementStretching> stretchings_;
+  std::vector<StretchingRestState> stretching_rest_states_;
   std::vector<int> stretching_indices_;
   std::vector<int> stretching_ids_;
+  std::vector<int> stretching_order_;
   int next_stretching_id_{0};
+  DynamicDirectory stretching_directory_;
+  std::vector<int> free_stretching_slots_;
+  int num_removed_stretching_ids_{0};
 
   std::vector<ElementBending> bendings_;
   std::vector<int> bending_indices_;
   std::vector<int> bending_ids_;
+  std::vector<int> bending_order_;
   int next_bending_id_{0};
+  DynamicDirectory bending_directory_;
+  std::vector<int> free_bending_slots_;
+  int num_removed_bending_ids_{0};
 
   std::vector<RigidObjectRef> rigid_objects_;
   std::vector<MeshSDF> rigid_object_meshes_;
   std::vector<int> rigid_object_ids_;
   int next_rigid_object_id_{0};
+
+  // Hash of the ids, orders and element indices, a snapshot is only restored into a scene of the same topology. 0
+  // until first needed and after every edit.
+  mutable uint64_t topology_hash_{0};
+
+  RigidBroadPhase rigid_broad_phase_;
+
+  // Rebuilt from the remaining triangles at the next step with self contact after an edit.
+  ContactDetector contact_detector_;
+  bool contact_detector_outdated_{false};
+  std::vector<Vector3<float>> x_detect_;
+  std::vector<Vector3<float>> x_sweep_;
 };
 
 #if defined(__CUDACC__)
 class SceneDevice {
  public:
-  SceneDevice(const Scene &scene);
+  // thread_pool runs the self contact detection on the host, it may be null to run it single threaded.
+  SceneDevice(const Scene &scene,
+              ThreadPool *thread_pool = nullptr,
+              ParticleOrdering ordering = PARTICLE_ORDERING_NONE);
   ~SceneDevice();
 
   std::vector<Vector3<float>> GetPositions(const std::vector<int> &particle_ids) const;
 
+  // Gathers the positions on the stream of the scene and copies them into the next buffer of readback without
+  // synchronizing. Steps issued afterwards run behind the copy on the same stream.
+  ReadbackFence ReadPositionsAsync(PositionReadback &readback);
+
   RigidObjectState GetRigidObjectState(int rigid_object_id) const;
   void SetRigidObjectState(int rigid_object_id, const RigidObjectState &state);
 
@@ -93,28 +284,41 @@ class SceneDevice {
   float GetRigidObjectFriction(int rigid_object_id) const;
   void SetRigidObjectFriction(int rigid_object_id, float friction);
 
+  const SolverSettings &GetSolverSettings() const;
+  void SetSolverSettings(const SolverSettings &settings);
+
+  // Iterations, residual and Chebyshev spectral radius of the last Update.
+  const SolverStatistics &GetSolverStatistics() const;
+
   operator SceneRef();
 
   static void Update(SceneDevice &scene, float dt);
 
+  // Runs the fixed batch iteration count and leaves self contact out, see CheckBatchSettings. Throws
+  // std::invalid_argument when a scene asks for self contact, a tolerance or Chebyshev acceleration.
   static void UpdateBatch(const std::vector<SceneDevice *> &scenes, float dt);
 
  private:
+  RigidCandidateRef UpdateRigidBounds();
+
   thrust::device_vector<Vector3<float>> x_prev_;
   thrust::device_vector<Vector3<float>> x_;
   thrust::device_vector<Vector3<float>> v_;
   thrust::device_vector<float> m_;
   thrust::device_vector<int> particle_ids_;
   std::vector<int> particle_ids_host_;
+  thrust::device_vector<int> particle_order_;
   int next_particle_id_{0};
   thrust::device_vector<int> particle_colors_;
   DirectoryDevice particle_directory_;
   Directory particle_directory_host_;
 
   thrust::device_vector<ElementStretching> stretchings_;
+  thrust::device_vector<StretchingRestState> stretching_rest_states_;
   thrust::device_vector<int> stretching_indices_;
   thrust::device_vector<int> stretching_ids_;
   std::vector<int> stretching_ids_host_;
+  thrust::device_vector<int> stretching_order_;
   int next_stretching_id_{0};
   DirectoryDevice stretching_directory_;
 
@@ -122,6 +326,7 @@ class SceneDevice {
   thrust::device_vector<int> bending_indices_;
   thrust::device_vector<int> bending_ids_;
   std::vector<int> bending_ids_host_;
+  thrust::device_vector<int> bending_order_;
   int next_bending_id_{0};
   DirectoryDevice bending_directory_;
 
@@ -130,6 +335,30 @@ class SceneDevice {
   thrust::device_vector<int> rigid_object_ids_;
   std::vector<int> rigid_object_ids_host_;
   int next_rigid_object_id_{0};
+  // Only the bounds of the rigid objects are refreshed on the host, each particle tests all of them on the device.
+  RigidBroadPhase rigid_broad_phase_;
+  std::vector<RigidObjectRef> rigid_objects_host_;
+  thrust::device_vector<Vector3<float>> rigid_bounds_;
+
+  SolverSettings settings_;
+  SolverStatistics statistics_;
+  thrust::device_vector<float> residuals_;
+  thrust::device_vector<Vector3<float>> x_iterate_;
+  thrust::device_vector<Vector3<float>> x_iterate_prev_;
+
+  // Contacts are detected on the host over the thread pool and uploaded every step.
+  ThreadPool *thread_pool_;
+  ContactDetector contact_detector_;
+  std::vector<Vector3<float>> x_host_;
+  thrust::device_vector<int> vertex_face_indices_;
+  DirectoryDevice vertex_face_directory_;
+  thrust::device_vector<int> edge_edge_indices_;
+  DirectoryDevice edge_edge_directory_;
+  thrust::device_vector<float> contact_bounds_;
+  thrust::device_vector<Vector3<float>> x_detect_;
+  thrust::device_vector<Vector3<float>> x_sweep_;
+  thrust::device_vector<float> contact_displacements_;
+  std::vector<float> contact_displacements_host_;
 
   cudaStream_t stream_;
 };
@@ -0,0 +1,265 @@
+#include "snowberg/solver/solver_scene_batch.h"
+#include "snowberg/solver/solver_vbd.h"
+
+namespace snowberg::solver {
+
+namespace {
+
+constexpr size_t kGrainSize = 64;
+
+template <typename T>
+void AppendArray(std::vector<T> &arena, const std::vector<T> &values) {
+  arena.insert(arena.end(), values.begin(), values.end());
+}
+
+// Appends the buckets of directory, first is shifted to the positions in the arena while the contents stay as they are.
+void AppendDirectory(Directory &arena, const Directory &directory) {
+  int position_offset = arena.positions.size();
+  for (size_t b = 0; b < directory.first.size(); b++) {
+    arena.first.push_back(directory.first[b] + position_offset);
+    arena.count.push_back(directory.count[b]);
+  }
+  AppendArray(arena.positions, directory.positions);
+}
+
+}  // namespace
+
+SceneHostBatch::SceneHostBatch(const std::vector<const Scene *> &scenes,
+                               ThreadPool *thread_pool,
+                               ParticleOrdering ordering)
+    : thread_pool_(thread_pool) {
+  for (const Scene *scene : scenes) {
+    int first_mesh = AppendMeshes(*scene);
+    Append(*scene, scene->Layout(ordering), first_mesh);
+  }
+  Finalize();
+}
+
+SceneHostBatch::SceneHostBatch(const Scene &scene,
+                               int num_environments,
+                               ThreadPool *thread_pool,
+                               ParticleOrdering ordering)
+    : thread_pool_(thread_pool) {
+  SceneLayout layout = scene.Layout(ordering);
+  int first_mesh = AppendMeshes(scene);
+  for (int e = 0; e < num_environments; e++) {
+    Append(scene, layout, first_mesh);
+  }
+  Finalize();
+}
+
+int SceneHostBatch::AppendMeshes(const Scene &scene) {
+  int first_mesh = rigid_object_meshes_.size();
+  AppendArray(rigid_object_meshes_, scene.rigid_object_meshes_);
+  return first_mesh;
+}
+
+void SceneHostBatch::Append(const Scene &scene, const SceneLayout &layout, int first_mesh) {
+  int environment = NumEnvironments();
+  int num_particle = layout.x.size();
+  particle_offsets_.push_back(particle_offsets_.back() + num_particle);
+  AppendArray(x_, layout.x);
+  AppendArray(v_, layout.v);
+  AppendArray(m_, layout.m);
+  AppendArray(particle_ids_, scene.particle_ids_);
+  AppendArray(particle_order_, layout.particle_order);
+  AppendArray(particle_colors_, layout.particle_colors);
+  particle_environments_.resize(particle_offsets_.back(), environment);
+  num_colors_ = std::max(num_colors_, layout.num_colors);
+
+  stretching_offsets_.push_back(stretching_offsets_.back() + layout.stretchings.size());
+  AppendArray(stretchings_, layout.stretchings);
+  AppendArray(stretching_rest_states_, layout.stretching_rest_states);
+  AppendArray(stretching_indices_, layout.stretching_indices);
+  AppendArray(stretching_ids_, scene.stretching_ids_);
+  AppendArray(stretching_order_, layout.stretching_order);
+  stretching_environments_.resize(stretching_offsets_.back(), environment);
+  AppendDirectory(stretching_directory_, Directory{layout.stretching_indices, num_particle});
+
+  bending_offsets_.push_back(bending_offsets_.back() + layout.bendings.size());
+  AppendArray(bendings_, layout.bendings);
+  AppendArray(bending_indices_, layout.bending_indices);
+  AppendArray(bending_ids_, scene.bending_ids_);
+  AppendArray(bending_order_, layout.bending_order);
+  bending_environments_.resize(bending_offsets_.back(), environment);
+  AppendDirectory(bending_directory_, Directory{layout.bending_indices, num_particle});
+
+  int num_rigid_object = scene.rigid_objects_.size();
+  rigid_object_offsets_.push_back(rigid_object_offsets_.back() + num_rigid_object);
+  AppendArray(rigid_objects_, scene.rigid_objects_);
+  AppendArray(rigid_object_ids_, scene.rigid_object_ids_);
+  for (int i = 0; i < num_rigid_object; i++) {
+    rigid_object_mesh_indices_.push_back(first_mesh + i);
+  }
+  rigid_broad_phases_.emplace_back(scene.rigid_object_meshes_);
+}
+
+void SceneHostBatch::Finalize() {
+  for (size_t i = 0; i < rigid_objects_.size(); i++) {
+    rigid_objects_[i].mesh_sdf = rigid_object_meshes_[rigid_object_mesh_indices_[i]];
+  }
+  x_prev_ = x_;
+  initial_x_ = x_;
+  initial_v_ = v_;
+  initial_stretchings_ = stretchings_;
+  initial_bendings_ = bendings_;
+  for (const RigidObjectRef &rigid_object : rigid_objects_) {
+    initial_rigid_object_states_.push_back(rigid_object.state);
+  }
+  sweeps_ = Directory(particle_colors_, num_colors_);
+}
+
+int SceneHostBatch::NumEnvironments() const {
+  return particle_offsets_.size() - 1;
+}
+
+std::vector<Vector3<float>> SceneHostBatch::GetPositions(int environment, const std::vector<int> &particle_ids) const {
+  int first = particle_offsets_[environment];
+  int num_particle = particle_offsets_[environment + 1] - first;
+  std::vector<Vector3<float>> positions;
+  positions.reserve(particle_ids.size());
+  for (auto id : particle_ids) {
+    int i = BinarySearch(particle_ids_.data() + first, num_particle, id);
+    if (i < 0 || particle_order_[first + i] < 0) {
+      throw std::out_of_range("[SceneHostBatch] particle id is not in the environment");
+    }
+    positions.push_back(x_[first + particle_order_[first + i]]);
+  }
+  return positions;
+}
+
+RigidObjectState SceneHostBatch::GetRigidObjectState(int environment, int rigid_object_id) const {
+  int first = rigid_object_offsets_[environment];
+  int num_rigid_object = rigid_object_offsets_[environment + 1] - first;
+  return rigid_objects_[first + BinarySearch(rigid_object_ids_.data() + first, num_rigid_object, rigid_object_id)]
+      .state;
+}
+
+void SceneHostBatch::SetRigidObjectState(int environment, int rigid_object_id, const RigidObjectState &state) {
+  int first = rigid_object_offsets_[environment];
+  int num_rigid_object = rigid_object_offsets_[environment + 1] - first;
+  rigid_objects_[first + BinarySearch(rigid_object_ids_.data() + first, num_rigid_object, rigid_object_id)].state =
+      state;
+}
+
+void SceneHostBatch::Reset(int environment) {
+  for (int i = particle_offsets_[environment]; i < particle_offsets_[environment + 1]; i++) {
+    x_prev_[i] = initial_x_[i];
+    x_[i] = initial_x_[i];
+    v_[i] = initial_v_[i];
+  }
+  for (int i = stretching_offsets_[environment]; i < stretching_offsets_[environment + 1]; i++) {
+    stretchings_[i] = initial_stretchings_[i];
+    stretching_rest_states_[i] = stretchings_[i].RestState();
+  }
+  for (int i = bending_offsets_[environment]; i < bending_offsets_[environment + 1]; i++) {
+    bendings_[i] = initial_bendings_[i];
+  }
+  for (int i = rigid_object_offsets_[environment]; i < rigid_object_offsets_[environment + 1]; i++) {
+    rigid_objects_[i].state = initial_rigid_object_states_[i];
+  }
+}
+
+SceneRef SceneHostBatch::EnvironmentRef(int environment) {
+  SceneRef scene_ref{};
+
+  int particle_first = particle_offsets_[environment];
+  scene_ref.num_particle = particle_offsets_[environment + 1] - particle_first;
+  scene_ref.x_prev = x_prev_.data() + particle_first;
+  scene_ref.x = x_.data() + particle_first;
+  scene_ref.v = v_.data() + particle_first;
+  scene_ref.m = m_.data() + particle_first;
+  scene_ref.num_particle_ids = scene_ref.num_particle;
+  scene_ref.particle_ids = particle_ids_.data() + particle_first;
+  scene_ref.particle_order = particle_order_.data() + particle_first;
+
+  int stretching_first = stretching_offsets_[environment];
+  scene_ref.num_stretching = stretching_offsets_[environment + 1] - stretching_first;
+  scene_ref.stretchings = stretchings_.data() + stretching_first;
+  scene_ref.stretching_rest_states = stretching_rest_states_.data() + stretching_first;
+  scene_ref.stretching_indices = stretching_indices_.data() + stretching_first * 3;
+  scene_ref.num_stretching_ids = scene_ref.num_stretching;
+  scene_ref.stretching_ids = stretching_ids_.data() + stretching_first;
+  scene_ref.stretching_order = stretching_order_.data() + stretching_first;
+  scene_ref.stretching_directory = DirectoryRef{stretching_directory_.first.data() + particle_first,
+                                                stretching_directory_.count.data() + particle_first,
+                                                stretching_directory_.positions.data()};
+
+  int bending_first = bending_offsets_[environment];
+  scene_ref.num_bending = bending_offsets_[environment + 1] - bending_first;
+  scene_ref.bendings = bendings_.data() + bending_first;
+  scene_ref.bending_indices = bending_indices_.data() + bending_first * 4;
+  scene_ref.num_bending_ids = scene_ref.num_bending;
+  scene_ref.bending_ids = bending_ids_.data() + bending_first;
+  scene_ref.bending_order = bending_order_.data() + bending_first;
+  scene_ref.bending_directory = DirectoryRef{bending_directory_.first.data() + particle_first,
+                                             bending_directory_.count.data() + particle_first,
+                                             bending_directory_.positions.data()};
+
+  int rigid_object_first = rigid_object_offsets_[environment];
+  scene_ref.num_rigid_object = rigid_object_offsets_[environment + 1] - rigid_object_first;
+  scene_ref.rigid_objects = rigid_objects_.data() + rigid_object_first;
+  scene_ref.rigid_object_ids = rigid_object_ids_.data() + rigid_object_first;
+
+  return scene_ref;
+}
+
+void SceneHostBatch::Update(SceneHostBatch &batch, float dt) {
+  ThreadPool *thread_pool = batch.thread_pool_;
+  int num_environments = batch.NumEnvironments();
+  int num_particle = batch.x_.size();
+  const int *particle_offsets = batch.particle_offsets_.data();
+  const int *particle_environments = batch.particle_environments_.data();
+  std::vector<SceneRef> scene_refs(num_environments);
+  for (int e = 0; e < num_environments; e++) {
+    scene_refs[e] = batch.EnvironmentRef(e);
+  }
+
+  batch.x_prev_ = batch.x_;
+  Vector3<float> gravity{0.0, -9.8, 0.0};
+  ParallelForEach(thread_pool, num_particle, kGrainSize, [&](int p) {
+    int e = particle_environments[p];
+    vbd::InitializeParticle(scene_refs[e], p - particle_offsets[e], gravity, dt);
+  });
+  // Environments are few particles each, so each one runs its broad phase alone.
+  ParallelForEach(thread_pool, num_environments, 1, [&](int e) {
+    if (!scene_refs[e].num_rigid_object) {
+      return;
+    }
+    RigidBroadPhase &rigid_broad_phase = batch.rigid_broad_phases_[e];
+    rigid_broad_phase.UpdateBounds(scene_refs[e].rigid_objects, scene_refs[e].num_rigid_object);
+    rigid_broad_phase.UpdateCandidates(scene_refs[e].x_prev, scene_refs[e].x, scene_refs[e].num_particle);
+    scene_refs[e].rigid_candidates = rigid_broad_phase;
+  });
+
+  const Directory &sweeps = batch.sweeps_;
+  for (int iter = 0; iter < vbd::kNumBatchIterations; iter++) {
+    for (int c = 0; c < batch.num_colors_; c++) {
+      const int *particle_indices = sweeps.positions.data() + sweeps.first[c];
+      ParallelForEach(thread_pool, sweeps.count[c], kGrainSize, [&](int i) {
+        int p = particle_indices[i];
+        int e = particle_environments[p];
+        vbd::SolveParticlePosition(scene_refs[e], p - particle_offsets[e], dt, vbd::kBatchFriction);
+      });
+    }
+  }
+
+  ParallelForEach(thread_pool, num_particle, kGrainSize, [&](int p) {
+    int e = particle_environments[p];
+    vbd::UpdateVelocity(scene_refs[e], p - particle_offsets[e], dt);
+  });
+  const int *stretching_offsets = batch.stretching_offsets_.data();
+  const int *stretching_environments = batch.stretching_environments_.data();
+  ParallelForEach(thread_pool, batch.stretchings_.size(), kGrainSize, [&](int s) {
+    int e = stretching_environments[s];
+    vbd::UpdateStretchingPlasticity(scene_refs[e], s - stretching_offsets[e]);
+  });
+  const int *bending_offsets = batch.bending_offsets_.data();
+  const int *bending_environments = batch.bending_environments_.data();
+  ParallelForEach(thread_pool, batch.bendings_.size(), kGrainSize, [&](int b) {
+    int e = bending_environments[b];
+    vbd::UpdateBendingPlasticity(scene_refs[e], b - bending_offsets[e]);
+  });
+}
+
+}  // namespace snowberg::solver
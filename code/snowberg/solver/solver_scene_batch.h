@@ -0,0 +1,98 @@
+#pragma once
+#include "snowberg/solver/solver_scene.h"
+
+namespace snowberg::solver {
+
+// Many small independent scenes, the environments of a reinforcement learning rollout, stepped together on the host.
+// All environments share one arena, a single array per particle and element attribute in which each environment owns
+// a contiguous range, and each environment sees its range through a SceneRef of its own. One sweep runs one color of
+// every environment as a single parallel loop over the arena, so the thread pool stays busy however small each
+// environment is, and each work item looks up its environment in constant time. A step runs the fixed iteration count
+// and friction of SceneHost::UpdateBatch without self contact, with the same result.
+class SceneHostBatch {
+ public:
+  SceneHostBatch(const std::vector<const Scene *> &scenes,
+                 ThreadPool *thread_pool = nullptr,
+                 ParticleOrdering ordering = PARTICLE_ORDERING_NONE);
+  // num_environments copies of one scene, colored and laid out once.
+  SceneHostBatch(const Scene &scene,
+                 int num_environments,
+                 ThreadPool *thread_pool = nullptr,
+                 ParticleOrdering ordering = PARTICLE_ORDERING_NONE);
+  SceneHostBatch(const SceneHostBatch &) = delete;
+  SceneHostBatch &operator=(const SceneHostBatch &) = delete;
+
+  int NumEnvironments() const;
+
+  // Ids are those of the scene the environment was built from, throws std::out_of_range for an id that is not in it
+  // or was removed from it.
+  std::vector<Vector3<float>> GetPositions(int environment, const std::vector<int> &particle_ids) const;
+
+  RigidObjectState GetRigidObjectState(int environment, int rigid_object_id) const;
+  void SetRigidObjectState(int environment, int rigid_object_id, const RigidObjectState &state);
+
+  // Brings one environment back to the state it was built with, including its rest shapes and rigid object states,
+  // in time proportional to the environment.
+  void Reset(int environment);
+
+  SceneRef EnvironmentRef(int environment);
+
+  static void Update(SceneHostBatch &batch, float dt);
+
+ private:
+  // Copies the rigid object meshes of a scene once for all environments built from it, returns the index of the first.
+  int AppendMeshes(const Scene &scene);
+  void Append(const Scene &scene, const SceneLayout &layout, int first_mesh);
+  // Points the rigid objects to their meshes and builds the sweeps once all environments are appended.
+  void Finalize();
+
+  ThreadPool *thread_pool_;
+
+  // Offsets of the ranges of every environment, with the total at the end.
+  std::vector<int> particle_offsets_{0};
+  std::vector<int> stretching_offsets_{0};
+  std::vector<int> bending_offsets_{0};
+  std::vector<int> rigid_object_offsets_{0};
+
+  // Element indices, orders and directory contents are local to the environment.
+  std::vector<Vector3<float>> x_prev_;
+  std::vector<Vector3<float>> x_;
+  std::vector<Vector3<float>> v_;
+  std::vector<float> m_;
+  std::vector<int> particle_ids_;
+  std::vector<int> particle_order_;
+  std::vector<int> particle_environments_;
+  std::vector<int> particle_colors_;
+  std::vector<Vector3<float>> initial_x_;
+  std::vector<Vector3<float>> initial_v_;
+
+  std::vector<ElementStretching> stretchings_;
+  std::vector<StretchingRestState> stretching_rest_states_;
+  std::vector<int> stretching_indices_;
+  std::vector<int> stretching_ids_;
+  std::vector<int> stretching_order_;
+  std::vector<int> stretching_environments_;
+  std::vector<ElementStretching> initial_stretchings_;
+  Directory stretching_directory_;
+
+  std::vector<ElementBending> bendings_;
+  std::vector<int> bending_indices_;
+  std::vector<int> bending_ids_;
+  std::vector<int> bending_order_;
+  std::vector<int> bending_environments_;
+  std::vector<ElementBending> initial_bendings_;
+  Directory bending_directory_;
+
+  std::vector<RigidObjectRef> rigid_objects_;
+  std::vector<MeshSDF> rigid_object_meshes_;
+  std::vector<int> rigid_object_mesh_indices_;
+  std::vector<int> rigid_object_ids_;
+  std::vector<RigidObjectState> initial_rigid_object_states_;
+  std::vector<RigidBroadPhase> rigid_broad_phases_;
+
+  // Arena particle indices of every color, over all environments in environment order.
+  int num_colors_{0};
+  Directory sweeps_;
+};
+
+}  // namespace snowberg::solver
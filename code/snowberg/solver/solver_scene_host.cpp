@@ -0,0 +1,748 @@
+#include "snowberg/solver/solver_scene.h"
+#include "snowberg/solver/solver_vbd.h"
+
+#include <atomic>
+
+namespace snowberg::solver {
+
+namespace {
+
+constexpr size_t kGrainSize = 64;
+constexpr uint32_t kSnapshotMagic = 0x4e534253;  // "SBSN"
+constexpr uint32_t kSnapshotVersion = 3;
+// Written field by field, both structs have padding.
+constexpr size_t kSettingsSize = 5 * sizeof(int32_t) + 6 * sizeof(float) + 3 * sizeof(uint8_t);
+constexpr int kStretchingFields = 10;
+
+// FNV-1a over the bytes of all arrays.
+uint64_t HashArrays(std::initializer_list<const std::vector<int> *> arrays) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const std::vector<int> *array : arrays) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(array->data());
+    for (size_t i = 0; i < array->size() * sizeof(int); i++) {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    hash = (hash ^ array->size()) * 1099511628211ull;
+  }
+  return hash;
+}
+
+void WriteSettings(SnapshotWriter &writer, const SolverSettings &settings) {
+  writer.Write<int32_t>(settings.min_iterations);
+  writer.Write<int32_t>(settings.max_iterations);
+  writer.Write<int32_t>(settings.check_interval);
+  writer.Write<float>(settings.tolerance);
+  writer.Write<int32_t>(settings.criterion);
+  writer.Write<uint8_t>(settings.chebyshev);
+  writer.Write<float>(settings.spectral_radius);
+  writer.Write<int32_t>(settings.chebyshev_delay);
+  writer.Write<uint8_t>(settings.self_contact);
+  writer.Write<float>(settings.contact_thickness);
+  writer.Write<float>(settings.contact_query_radius);
+  writer.Write<float>(settings.contact_stiffness);
+  writer.Write<float>(settings.contact_bound_relaxation);
+  writer.Write<uint8_t>(settings.rigid_broad_phase);
+}
+
+SolverSettings ReadSettings(SnapshotReader &reader) {
+  SolverSettings settings;
+  settings.min_iterations = reader.Read<int32_t>();
+  settings.max_iterations = reader.Read<int32_t>();
+  settings.check_interval = reader.Read<int32_t>();
+  settings.tolerance = reader.Read<float>();
+  settings.criterion = static_cast<ConvergenceCriterion>(reader.Read<int32_t>());
+  settings.chebyshev = reader.Read<uint8_t>();
+  settings.spectral_radius = reader.Read<float>();
+  settings.chebyshev_delay = reader.Read<int32_t>();
+  settings.self_contact = reader.Read<uint8_t>();
+  settings.contact_thickness = reader.Read<float>();
+  settings.contact_query_radius = reader.Read<float>();
+  settings.contact_stiffness = reader.Read<float>();
+  settings.contact_bound_relaxation = reader.Read<float>();
+  settings.rigid_broad_phase = reader.Read<uint8_t>();
+  return settings;
+}
+
+// Storage slots for num new entries, the lowest free slots first in ascending order, then new ones past size.
+std::vector<int> TakeSlots(std::vector<int> &free_slots, int num, int size) {
+  std::sort(free_slots.begin(), free_slots.end(), std::greater<int>());
+  std::vector<int> slots;
+  slots.reserve(num);
+  while (static_cast<int>(slots.size()) < num && !free_slots.empty()) {
+    slots.push_back(free_slots.back());
+    free_slots.pop_back();
+  }
+  while (static_cast<int>(slots.size()) < num) {
+    slots.push_back(size++);
+  }
+  return slots;
+}
+
+// Gives an id an order of -1, and drops all such ids once they make up more than half of them. Returns the storage
+// index the id had, -1 if it was not found.
+int RemoveId(std::vector<int> &ids, std::vector<int> &order, int &num_removed, int id) {
+  int i = BinarySearch(ids.data(), ids.size(), id);
+  if (i < 0 || order[i] < 0) {
+    return -1;
+  }
+  int index = order[i];
+  order[i] = -1;
+  if (++num_removed * 2 > static_cast<int>(ids.size())) {
+    size_t kept = 0;
+    for (size_t k = 0; k < ids.size(); k++) {
+      if (order[k] >= 0) {
+        ids[kept] = ids[k];
+        order[kept++] = order[k];
+      }
+    }
+    ids.resize(kept);
+    order.resize(kept);
+    num_removed = 0;
+  }
+  return index;
+}
+
+// Whether a particle of a live slot is held back by its contact bound.
+bool ReachesContactBound(ThreadPool *thread_pool, const SceneRef &scene_ref, const std::vector<int> &particle_colors) {
+  std::atomic<bool> reaches{false};
+  ParallelForEach(thread_pool, scene_ref.num_particle, kGrainSize, [&](int pidx) {
+    if (particle_colors[pidx] >= 0 && vbd::ReachesContactBound(scene_ref, pidx)) {
+      reaches.store(true, std::memory_order_relaxed);
+    }
+  });
+  return reaches.load();
+}
+
+// One sweep over the particles of every color. With evaluate_residual, returns the residual of the sweep, reduced
+// per thread first.
+float SweepColors(ThreadPool *thread_pool,
+                  const SceneRef &scene_ref,
+                  const Directory &colors,
+                  float dt,
+                  ConvergenceCriterion criterion,
+                  bool evaluate_residual) {
+  std::vector<float> partial_residuals(thread_pool ? thread_pool->NumThreads() : 1, 0.0f);
+  for (size_t c = 0; c < colors.first.size(); c++) {
+    const int *particle_indices = colors.positions.data() + colors.first[c];
+    ParallelForEach(thread_pool, colors.count[c], kGrainSize, [&](int i, size_t thread_index) {
+      float residual = vbd::SolveParticlePosition(scene_ref, particle_indices[i], dt, -1.0f, criterion);
+      if (evaluate_residual) {
+        float &partial_residual = partial_residuals[thread_index];
+        partial_residual = criterion == CONVERGENCE_CRITERION_FORCE_RESIDUAL ? partial_residual + residual
+                                                                              : std::max(partial_residual, residual);
+      }
+    });
+  }
+  if (criterion == CONVERGENCE_CRITERION_FORCE_RESIDUAL) {
+    float sum = 0.0f;
+    for (float partial_residual : partial_residuals) {
+      sum += partial_residual;
+    }
+    return std::sqrt(sum);
+  }
+  return *std::max_element(partial_residuals.begin(), partial_residuals.end());
+}
+
+}  // namespace
+
+SceneHost::SceneHost(const Scene &scene, ThreadPool *thread_pool, ParticleOrdering ordering)
+    : thread_pool_(thread_pool) {
+  SceneLayout layout = scene.Layout(ordering);
+  x_prev_ = layout.x;
+  x_ = layout.x;
+  v_ = layout.v;
+  m_ = layout.m;
+  particle_ids_ = scene.particle_ids_;
+  particle_order_ = layout.particle_order;
+  next_particle_id_ = scene.next_particle_id_;
+
+  stretchings_ = layout.stretchings;
+  stretching_rest_states_ = layout.stretching_rest_states;
+  stretching_indices_ = layout.stretching_indices;
+  stretching_ids_ = scene.stretching_ids_;
+  stretching_order_ = layout.stretching_order;
+  next_stretching_id_ = scene.next_stretching_id_;
+
+  bendings_ = layout.bendings;
+  bending_indices_ = layout.bending_indices;
+  bending_ids_ = scene.bending_ids_;
+  bending_order_ = layout.bending_order;
+  next_bending_id_ = scene.next_bending_id_;
+
+  rigid_objects_ = scene.rigid_objects_;
+  rigid_object_meshes_ = scene.rigid_object_meshes_;
+  for (size_t i = 0; i < rigid_object_meshes_.size(); i++) {
+    rigid_objects_[i].mesh_sdf = rigid_object_meshes_[i];
+  }
+  rigid_object_ids_ = scene.rigid_object_ids_;
+  next_rigid_object_id_ = scene.next_rigid_object_id_;
+  rigid_broad_phase_ = RigidBroadPhase(rigid_object_meshes_);
+
+  int num_particle = x_.size();
+  contact_detector_ = ContactDetector(stretching_indices_, x_.data(), num_particle);
+  stretching_directory_ = DynamicDirectory(Directory{stretching_indices_, num_particle});
+  bending_directory_ = DynamicDirectory(Directory{bending_indices_, num_particle});
+
+  particle_colors_ = layout.particle_colors;
+  particle_directory_ = DynamicDirectory(Directory(particle_colors_, layout.num_colors));
+}
+
+SceneHost::~SceneHost() {
+  WaitReadbacks();
+}
+
+ObjectPackView SceneHost::AddObject(const ObjectPack &object_pack) {
+  WaitReadbacks();
+  ObjectPackView object_pack_view;
+
+  int pack_num_particle = object_pack.x.size();
+  std::vector<int> particle_slots = TakeSlots(free_particle_slots_, pack_num_particle, x_.size());
+  size_t num_particle = std::max<size_t>(x_.size(), particle_slots.empty() ? 0 : particle_slots.back() + 1);
+  x_prev_.resize(num_particle);
+  x_.resize(num_particle);
+  v_.resize(num_particle);
+  m_.resize(num_particle);
+  particle_colors_.resize(num_particle, -1);
+  // Every particle has a bucket, also those in no stretching or bending.
+  stretching_directory_.ResizeBuckets(num_particle);
+  bending_directory_.ResizeBuckets(num_particle);
+  for (int i = 0; i < pack_num_particle; i++) {
+    int pidx = particle_slots[i];
+    x_prev_[pidx] = object_pack.x[i];
+    x_[pidx] = object_pack.x[i];
+    v_[pidx] = object_pack.v[i];
+    m_[pidx] = object_pack.m[i];
+    object_pack_view.particle_ids.push_back(next_particle_id_);
+    particle_ids_.push_back(next_particle_id_++);
+    particle_order_.push_back(pidx);
+  }
+
+  int pack_num_stretching = object_pack.stretchings.size();
+  std::vector<int> stretching_slots = TakeSlots(free_stretching_slots_, pack_num_stretching, stretchings_.size());
+  size_t num_stretching =
+      std::max<size_t>(stretchings_.size(), stretching_slots.empty() ? 0 : stretching_slots.back() + 1);
+  stretchings_.resize(num_stretching);
+  stretching_rest_states_.resize(num_stretching);
+  stretching_indices_.resize(num_stretching * 3, -1);
+  for (int i = 0; i < pack_num_stretching; i++) {
+    int sidx = stretching_slots[i];
+    stretchings_[sidx] = object_pack.stretchings[i];
+    stretching_rest_states_[sidx] = object_pack.stretchings[i].RestState();
+    for (int j = 0; j < 3; j++) {
+      int pidx = particle_slots[object_pack.stretching_indices[i * 3 + j]];
+      stretching_indices_[sidx * 3 + j] = pidx;
+      stretching_directory_.Insert(pidx, sidx * 3 + j);
+    }
+    object_pack_view.stretching_ids.push_back(next_stretching_id_);
+    stretching_ids_.push_back(next_stretching_id_++);
+    stretching_order_.push_back(sidx);
+  }
+
+  int pack_num_bending = object_pack.bendings.size();
+  std::vector<int> bending_slots = TakeSlots(free_bending_slots_, pack_num_bending, bendings_.size());
+  size_t num_bending = std::max<size_t>(bendings_.size(), bending_slots.empty() ? 0 : bending_slots.back() + 1);
+  bendings_.resize(num_bending);
+  bending_indices_.resize(num_bending * 4, -1);
+  for (int i = 0; i < pack_num_bending; i++) {
+    int bidx = bending_slots[i];
+    bendings_[bidx] = object_pack.bendings[i];
+    for (int j = 0; j < 4; j++) {
+      int pidx = particle_slots[object_pack.bending_indices[i * 4 + j]];
+      bending_indices_[bidx * 4 + j] = pidx;
+      bending_directory_.Insert(pidx, bidx * 4 + j);
+    }
+    object_pack_view.bending_ids.push_back(next_bending_id_);
+    bending_ids_.push_back(next_bending_id_++);
+    bending_order_.push_back(bidx);
+  }
+
+  ColorParticles(particle_slots);
+  topology_hash_ = 0;
+  contact_detector_outdated_ = true;
+  return object_pack_view;
+}
+
+void SceneHost::RemoveObject(const ObjectPackView &object_pack_view) {
+  WaitReadbacks();
+  for (int id : object_pack_view.stretching_ids) {
+    int sidx = RemoveId(stretching_ids_, stretching_order_, num_removed_stretching_ids_, id);
+    if (sidx < 0) {
+      continue;
+    }
+    for (int j = 0; j < 3; j++) {
+      stretching_directory_.Erase(sidx * 3 + j);
+      stretching_indices_[sidx * 3 + j] = -1;
+    }
+    stretchings_[sidx] = ElementStretching{};
+    free_stretching_slots_.push_back(sidx);
+  }
+
+  for (int id : object_pack_view.bending_ids) {
+    int bidx = RemoveId(bending_ids_, bending_order_, num_removed_bending_ids_, id);
+    if (bidx < 0) {
+      continue;
+    }
+    for (int j = 0; j < 4; j++) {
+      bending_directory_.Erase(bidx * 4 + j);
+      bending_indices_[bidx * 4 + j] = -1;
+    }
+    bendings_[bidx] = ElementBending{};
+    free_bending_slots_.push_back(bidx);
+  }
+
+  // Free particle slots keep their last position until they are taken again, the step skips them.
+  for (int id : object_pack_view.particle_ids) {
+    int pidx = RemoveId(particle_ids_, particle_order_, num_removed_particle_ids_, id);
+    if (pidx < 0) {
+      continue;
+    }
+    particle_directory_.Erase(pidx);
+    particle_colors_[pidx] = -1;
+    v_[pidx] = Vector3<float>::Zero();
+    free_particle_slots_.push_back(pidx);
+  }
+
+  topology_hash_ = 0;
+  contact_detector_outdated_ = true;
+}
+
+const Directory &SceneHost::GetColorDirectory() const {
+  return particle_directory_.GetDirectory();
+}
+
+void SceneHost::ColorParticles(const std::vector<int> &particle_indices) {
+  std::vector<int> used(particle_directory_.NumBuckets() + 1, -1);
+  for (int pidx : particle_indices) {
+    auto mark = [&](int other) {
+      int color = particle_colors_[other];
+      if (color >= 0 && color < static_cast<int>(used.size())) {
+        used[color] = pidx;
+      }
+    };
+    const Directory &stretchings = stretching_directory_.GetDirectory();
+    for (int j = 0; j < stretchings.count[pidx]; j++) {
+      int sidx = stretchings.positions[stretchings.first[pidx] + j] / 3;
+      for (int k = 0; k < 3; k++) {
+        mark(stretching_indices_[sidx * 3 + k]);
+      }
+    }
+    const Directory &bendings = bending_directory_.GetDirectory();
+    for (int j = 0; j < bendings.count[pidx]; j++) {
+      int bidx = bendings.positions[bendings.first[pidx] + j] / 4;
+      for (int k = 0; k < 4; k++) {
+        mark(bending_indices_[bidx * 4 + k]);
+      }
+    }
+    int color = 0;
+    while (used[color] == pidx) {
+      color++;
+    }
+    if (color + 1 >= static_cast<int>(used.size())) {
+      used.resize(color + 2, -1);
+    }
+    particle_colors_[pidx] = color;
+    particle_directory_.Insert(color, pidx);
+  }
+}
+
+uint64_t SceneHost::TopologyHash() const {
+  if (!topology_hash_) {
+    topology_hash_ = HashArrays({&particle_ids_, &particle_order_, &stretching_indices_, &stretching_ids_,
+                                 &bending_indices_, &bending_ids_, &rigid_object_ids_});
+  }
+  return topology_hash_;
+}
+
+std::vector<Vector3<float>> SceneHost::GetPositions(const std::vector<int> &particle_ids) const {
+  std::vector<Vector3<float>> positions;
+  positions.reserve(particle_ids.size());
+  for (auto id : particle_ids) {
+    int pidx = ParticleIndex(id);
+    if (pidx < 0) {
+      throw std::out_of_range("[SceneHost] particle id is not in the scene");
+    }
+    positions.push_back(x_[pidx]);
+  }
+  return positions;
+}
+
+ReadbackFence SceneHost::ReadPositionsAsync(PositionReadback &readback) {
+  // Checked here rather than in the copy, which may run on a worker.
+  for (int id : readback.ParticleIds()) {
+    if (ParticleIndex(id) < 0) {
+      throw std::out_of_range("[SceneHost] particle id is not in the scene");
+    }
+  }
+  int buffer = readback.Acquire();
+  auto copy = [this, &readback, buffer]() {
+    const std::vector<int> &particle_ids = readback.ParticleIds();
+    Vector3<float> *positions = readback.positions_[buffer];
+    for (size_t i = 0; i < particle_ids.size(); i++) {
+      positions[i] = x_[ParticleIndex(particle_ids[i])];
+    }
+  };
+  if (thread_pool_) {
+    readback.futures_[buffer] = thread_pool_->Submit(copy).share();
+    // Finished copies are dropped here so that readbacks issued without stepping in between do not pile up.
+    pending_readbacks_.erase(std::remove_if(pending_readbacks_.begin(), pending_readbacks_.end(),
+                                            [](const std::shared_future<void> &future) {
+                                              return future.wait_for(std::chrono::seconds(0)) ==
+                                                     std::future_status::ready;
+                                            }),
+                             pending_readbacks_.end());
+    pending_readbacks_.push_back(readback.futures_[buffer]);
+  } else {
+    copy();
+  }
+  return ReadbackFence(&readback, buffer);
+}
+
+void SceneHost::WaitReadbacks() {
+  for (const auto &future : pending_readbacks_) {
+    future.wait();
+  }
+  pending_readbacks_.clear();
+}
+
+int SceneHost::ParticleIndex(int particle_id) const {
+  int i = BinarySearch(particle_ids_.data(), particle_ids_.size(), particle_id);
+  return i < 0 ? -1 : particle_order_[i];
+}
+
+int SceneHost::RigidObjectIndex(int rigid_object_id) const {
+  return BinarySearch(rigid_object_ids_.data(), rigid_object_ids_.size(), rigid_object_id);
+}
+
+RigidObjectState SceneHost::GetRigidObjectState(int rigid_object_id) const {
+  return rigid_objects_[RigidObjectIndex(rigid_object_id)].state;
+}
+
+void SceneHost::SetRigidObjectState(int rigid_object_id, const RigidObjectState &state) {
+  rigid_objects_[RigidObjectIndex(rigid_object_id)].state = state;
+}
+
+float SceneHost::GetRigidObjectStiffness(int rigid_object_id) const {
+  return rigid_objects_[RigidObjectIndex(rigid_object_id)].stiffness;
+}
+
+void SceneHost::SetRigidObjectStiffness(int rigid_object_id, float stiffness) {
+  rigid_objects_[RigidObjectIndex(rigid_object_id)].stiffness = stiffness;
+}
+
+float SceneHost::GetRigidObjectFriction(int rigid_object_id) const {
+  return rigid_objects_[RigidObjectIndex(rigid_object_id)].friction;
+}
+
+void SceneHost::SetRigidObjectFriction(int rigid_object_id, float friction) {
+  rigid_objects_[RigidObjectIndex(rigid_object_id)].friction = friction;
+}
+
+std::vector<uint8_t> SceneHost::Snapshot() const {
+  SnapshotWriter writer;
+  writer.Write(kSnapshotMagic);
+  writer.Write(kSnapshotVersion);
+  writer.Write(TopologyHash());
+  writer.Write(next_particle_id_);
+  writer.Write(next_stretching_id_);
+  writer.Write(next_bending_id_);
+  writer.Write(next_rigid_object_id_);
+  WriteSettings(writer, settings_);
+  writer.Write(statistics_);
+  writer.WriteArray(x_);
+  writer.WriteArray(v_);
+  std::vector<float> stretching_fields;
+  stretching_fields.reserve(stretchings_.size() * kStretchingFields);
+  for (const ElementStretching &stretching : stretchings_) {
+    stretching_fields.insert(stretching_fields.end(),
+                             {stretching.mu, stretching.lambda, stretching.area, stretching.damping,
+                              stretching.Dm(0, 0), stretching.Dm(1, 0), stretching.Dm(0, 1), stretching.Dm(1, 1),
+                              stretching.sigma_lb, stretching.sigma_ub});
+  }
+  writer.WriteArray(stretching_fields);
+  writer.WriteArray(bendings_);
+  std::vector<RigidObjectState> rigid_object_states;
+  std::vector<float> rigid_object_parameters;
+  for (const RigidObjectRef &rigid_object : rigid_objects_) {
+    rigid_object_states.push_back(rigid_object.state);
+    rigid_object_parameters.push_back(rigid_object.stiffness);
+    rigid_object_parameters.push_back(rigid_object.friction);
+  }
+  writer.WriteArray(rigid_object_states);
+  writer.WriteArray(rigid_object_parameters);
+  return writer.Release();
+}
+
+void SceneHost::Restore(const std::vector<uint8_t> &snapshot) {
+  WaitReadbacks();
+  SnapshotReader reader(snapshot);
+  if (reader.Read<uint32_t>() != kSnapshotMagic || reader.Read<uint32_t>() != kSnapshotVersion) {
+    throw std::runtime_error("[Snapshot] not a scene snapshot of this version");
+  }
+  if (reader.Read<uint64_t>() != TopologyHash()) {
+    throw std::runtime_error("[Snapshot] snapshot of a different scene");
+  }
+  // Checked before anything is overwritten, the scene is left untouched by a truncated snapshot.
+  size_t state_size = 4 * sizeof(int) + kSettingsSize + sizeof(SolverStatistics) + 6 * sizeof(uint64_t) +
+                      x_.size() * sizeof(Vector3<float>) * 2 + stretchings_.size() * kStretchingFields * sizeof(float) +
+                      bendings_.size() * sizeof(ElementBending) +
+                      rigid_objects_.size() * (sizeof(RigidObjectState) + 2 * sizeof(float));
+  if (reader.Remaining() != state_size) {
+    throw std::runtime_error("[Snapshot] snapshot size does not match the scene");
+  }
+  next_particle_id_ = reader.Read<int>();
+  next_stretching_id_ = reader.Read<int>();
+  next_bending_id_ = reader.Read<int>();
+  next_rigid_object_id_ = reader.Read<int>();
+  settings_ = ReadSettings(reader);
+  statistics_ = reader.Read<SolverStatistics>();
+  reader.ReadArray(x_);
+  reader.ReadArray(v_);
+  std::vector<float> stretching_fields(stretchings_.size() * kStretchingFields);
+  reader.ReadArray(stretching_fields);
+  reader.ReadArray(bendings_);
+  std::vector<RigidObjectState> rigid_object_states(rigid_objects_.size());
+  std::vector<float> rigid_object_parameters(rigid_objects_.size() * 2);
+  reader.ReadArray(rigid_object_states);
+  reader.ReadArray(rigid_object_parameters);
+
+  for (size_t i = 0; i < stretchings_.size(); i++) {
+    const float *fields = stretching_fields.data() + i * kStretchingFields;
+    ElementStretching &stretching = stretchings_[i];
+    stretching.mu = fields[0];
+    stretching.lambda = fields[1];
+    stretching.area = fields[2];
+    stretching.damping = fields[3];
+    stretching.Dm << fields[4], fields[6], fields[5], fields[7];
+    stretching.sigma_lb = fields[8];
+    stretching.sigma_ub = fields[9];
+  }
+  for (size_t i = 0; i < rigid_objects_.size(); i++) {
+    rigid_objects_[i].state = rigid_object_states[i];
+    rigid_objects_[i].stiffness = rigid_object_parameters[i * 2];
+    rigid_objects_[i].friction = rigid_object_parameters[i * 2 + 1];
+  }
+  x_prev_ = x_;
+  ParallelForEach(thread_pool_, stretchings_.size(), kGrainSize,
+                  [&](int sid) { stretching_rest_states_[sid] = stretchings_[sid].RestState(); });
+}
+
+RigidCandidateRef SceneHost::UpdateRigidCandidates() {
+  rigid_broad_phase_.UpdateBounds(rigid_objects_.data(), rigid_objects_.size());
+  if (settings_.rigid_broad_phase) {
+    rigid_broad_phase_.UpdateCandidates(x_prev_.data(), x_.data(), x_.size(), thread_pool_, particle_colors_.data());
+    return rigid_broad_phase_;
+  }
+  RigidCandidateRef rigid_candidates{};
+  rigid_candidates.bounds = rigid_broad_phase_.Bounds().empty() ? nullptr : rigid_broad_phase_.Bounds().data();
+  return rigid_candidates;
+}
+
+const SolverSettings &SceneHost::GetSolverSettings() const {
+  return settings_;
+}
+
+void SceneHost::SetSolverSettings(const SolverSettings &settings) {
+  settings_ = settings;
+}
+
+const SolverStatistics &SceneHost::GetSolverStatistics() const {
+  return statistics_;
+}
+
+SceneHost::operator SceneRef() {
+  SceneRef scene_ref{};
+
+  scene_ref.num_particle = x_.size();
+  scene_ref.x_prev = x_prev_.data();
+  scene_ref.x = x_.data();
+  scene_ref.v = v_.data();
+  scene_ref.m = m_.data();
+  scene_ref.num_particle_ids = particle_ids_.size();
+  scene_ref.particle_ids = particle_ids_.data();
+  scene_ref.particle_order = particle_order_.data();
+
+  scene_ref.num_stretching = stretchings_.size();
+  scene_ref.stretchings = stretchings_.data();
+  scene_ref.stretching_rest_states = stretching_rest_states_.data();
+  scene_ref.stretching_indices = stretching_indices_.data();
+  scene_ref.num_stretching_ids = stretching_ids_.size();
+  scene_ref.stretching_ids = stretching_ids_.data();
+  scene_ref.stretching_order = stretching_order_.data();
+  scene_ref.stretching_directory = stretching_directory_;
+
+  scene_ref.num_bending = bendings_.size();
+  scene_ref.bendings = bendings_.data();
+  scene_ref.bending_indices = bending_indices_.data();
+  scene_ref.num_bending_ids = bending_ids_.size();
+  scene_ref.bending_ids = bending_ids_.data();
+  scene_ref.bending_order = bending_order_.data();
+  scene_ref.bending_directory = bending_directory_;
+
+  scene_ref.num_rigid_object = rigid_objects_.size();
+  scene_ref.rigid_objects = rigid_objects_.data();
+  scene_ref.rigid_object_ids = rigid_object_ids_.data();
+
+  if (settings_.self_contact && contact_detector_.Bounds().size() == x_.size()) {
+    scene_ref.contact.num_vertex_face = contact_detector_.VertexFaceIndices().size() / 4;
+    scene_ref.contact.vertex_face_indices = contact_detector_.VertexFaceIndices().data();
+    scene_ref.contact.vertex_face_directory = contact_detector_.VertexFaceDirectory();
+    scene_ref.contact.num_edge_edge = contact_detector_.EdgeEdgeIndices().size() / 4;
+    scene_ref.contact.edge_edge_indices = contact_detector_.EdgeEdgeIndices().data();
+    scene_ref.contact.edge_edge_directory = contact_detector_.EdgeEdgeDirectory();
+    scene_ref.contact.bounds = contact_detector_.Bounds().data();
+    scene_ref.contact.x_detect = x_detect_.data();
+    scene_ref.contact.x_sweep = x_sweep_.data();
+    scene_ref.contact.thickness = settings_.contact_thickness;
+    scene_ref.contact.stiffness = settings_.contact_stiffness;
+  }
+
+  return scene_ref;
+}
+
+void SceneHost::Update(SceneHost &scene, float dt) {
+  scene.WaitReadbacks();
+  ThreadPool *thread_pool = scene.thread_pool_;
+  const SolverSettings &settings = scene.settings_;
+  SolverStatistics statistics;
+  Vector3<float> gravity{0.0, -9.8, 0.0};
+  scene.x_prev_ = scene.x_;
+  std::vector<float> displacements;
+  // Detects the contacts at the current positions, with query radii grown by the motion still expected in the step.
+  auto detect_contacts = [&](const Vector3<float> &pending_gravity) {
+    SceneRef scene_ref = scene;
+    displacements.resize(scene_ref.num_particle);
+    ParallelForEach(thread_pool, scene_ref.num_particle, kGrainSize, [&](int pidx) {
+      displacements[pidx] = vbd::PredictedDisplacement(scene_ref, pidx, pending_gravity, dt);
+    });
+    scene.contact_detector_.Detect(scene.x_.data(), settings.contact_thickness,
+                                   ContactDetector::QueryRadius(settings), settings.contact_bound_relaxation,
+                                   thread_pool, scene.particle_colors_.data(), displacements.data());
+    scene.x_detect_ = scene.x_;
+    statistics.contact_detections++;
+  };
+  if (settings.self_contact) {
+    if (scene.contact_detector_outdated_) {
+      std::vector<int> triangle_indices;
+      for (int index : scene.stretching_indices_) {
+        if (index >= 0) {
+          triangle_indices.push_back(index);
+        }
+      }
+      scene.contact_detector_ = ContactDetector(triangle_indices, scene.x_.data(), scene.x_.size());
+      scene.contact_detector_outdated_ = false;
+    }
+    detect_contacts(gravity);
+    scene.x_sweep_.resize(scene.x_.size());
+  }
+  SceneRef scene_ref = scene;
+  ParallelForEach(thread_pool, scene_ref.num_particle, kGrainSize, [&](int pidx) {
+    if (scene.particle_colors_[pidx] >= 0) {
+      vbd::InitializeParticle(scene_ref, pidx, gravity, dt);
+    }
+  });
+  scene_ref.rigid_candidates = scene.UpdateRigidCandidates();
+
+  vbd::ChebyshevSchedule chebyshev(settings, scene.statistics_.spectral_radius);
+  if (settings.chebyshev) {
+    scene.x_iterate_ = scene.x_;
+    scene.x_iterate_prev_ = scene.x_;
+  }
+  while (statistics.iterations < settings.max_iterations) {
+    bool check = vbd::IsResidualCheck(settings, statistics.iterations + 1);
+    if (settings.self_contact) {
+      scene.x_sweep_ = scene.x_;
+    }
+    float residual = SweepColors(thread_pool, scene_ref, scene.particle_directory_.GetDirectory(), dt,
+                                 settings.criterion, check || settings.chebyshev);
+    statistics.iterations++;
+    if (check) {
+      statistics.residual = residual;
+      if (vbd::IsConverged(settings, statistics.iterations, residual)) {
+        break;
+      }
+    }
+    if (settings.chebyshev) {
+      float omega = chebyshev.Next(residual);
+      ParallelForEach(thread_pool, scene_ref.num_particle, kGrainSize, [&](int pidx) {
+        vbd::ChebyshevExtrapolate(scene_ref, pidx, omega, scene.x_iterate_.data(), scene.x_iterate_prev_.data());
+      });
+    }
+    // The bounds only hold back the particles until the contacts around them are known again.
+    if (settings.self_contact && statistics.iterations < settings.max_iterations &&
+        ReachesContactBound(thread_pool, scene_ref, scene.particle_colors_)) {
+      detect_contacts(Vector3<float>::Zero());
+      scene_ref.contact = SceneRef(scene).contact;
+    }
+  }
+  statistics.spectral_radius = chebyshev.SpectralRadius();
+  statistics.restarts = chebyshev.Restarts();
+  scene.statistics_ = statistics;
+
+  ParallelForEach(thread_pool, scene_ref.num_particle, kGrainSize,
+                  [&](int pidx) { vbd::UpdateVelocity(scene_ref, pidx, dt); });
+  ParallelForEach(thread_pool, scene_ref.num_stretching, kGrainSize,
+                  [&](int sid) { vbd::UpdateStretchingPlasticity(scene_ref, sid); });
+  ParallelForEach(thread_pool, scene_ref.num_bending, kGrainSize,
+                  [&](int bid) { vbd::UpdateBendingPlasticity(scene_ref, bid); });
+}
+
+void SceneHost::UpdateBatch(const std::vector<SceneHost *> &scenes, float dt) {
+  if (scenes.empty()) {
+    return;
+  }
+  ThreadPool *thread_pool = scenes[0]->thread_pool_;
+  std::vector<SceneRef> scene_refs(scenes.size());
+  size_t max_color_cnt = 0;
+  Vector3<float> gravity{0.0, -9.8, 0.0};
+  for (const SceneHost *scene : scenes) {
+    CheckBatchSettings(scene->settings_);
+  }
+  for (size_t i = 0; i < scenes.size(); i++) {
+    scenes[i]->WaitReadbacks();
+    scene_refs[i] = *scenes[i];
+    scene_refs[i].contact = ContactRef{};
+    scenes[i]->x_prev_ = scenes[i]->x_;
+    const SceneRef &scene_ref = scene_refs[i];
+    const std::vector<int> &particle_colors = scenes[i]->particle_colors_;
+    ParallelForEach(thread_pool, scene_ref.num_particle, kGrainSize, [&](int pidx) {
+      if (particle_colors[pidx] >= 0) {
+        vbd::InitializeParticle(scene_ref, pidx, gravity, dt);
+      }
+    });
+    scene_refs[i].rigid_candidates = scenes[i]->UpdateRigidCandidates();
+    max_color_cnt = std::max(max_color_cnt, scenes[i]->particle_directory_.GetDirectory().first.size());
+  }
+
+  // The particles of one color across all scenes form a single parallel sweep.
+  std::vector<std::vector<int>> scene_offsets(max_color_cnt, std::vector<int>(scenes.size() + 1, 0));
+  for (size_t c = 0; c < max_color_cnt; c++) {
+    for (size_t i = 0; i < scenes.size(); i++) {
+      const Directory &colors = scenes[i]->particle_directory_.GetDirectory();
+      scene_offsets[c][i + 1] = scene_offsets[c][i] + (c < colors.first.size() ? colors.count[c] : 0);
+    }
+  }
+
+  for (int iter = 0; iter < vbd::kNumBatchIterations; iter++) {
+    for (size_t c = 0; c < max_color_cnt; c++) {
+      const std::vector<int> &offsets = scene_offsets[c];
+      ParallelForEach(thread_pool, offsets.back(), kGrainSize, [&](int tid) {
+        size_t sid = std::upper_bound(offsets.begin(), offsets.end(), tid) - offsets.begin() - 1;
+        const Directory &colors = scenes[sid]->particle_directory_.GetDirectory();
+        int pid = colors.positions[colors.first[c] + tid - offsets[sid]];
+        vbd::SolveParticlePosition(scene_refs[sid], pid, dt, vbd::kBatchFriction);
+      });
+    }
+  }
+
+  for (size_t i = 0; i < scenes.size(); i++) {
+    const SceneRef &scene_ref = scene_refs[i];
+    ParallelForEach(thread_pool, scene_ref.num_particle, kGrainSize,
+                    [&](int pidx) { vbd::UpdateVelocity(scene_ref, pidx, dt); });
+    ParallelForEach(thread_pool, scene_ref.num_stretching, kGrainSize,
+                    [&](int sid) { vbd::UpdateStretchingPlasticity(scene_ref, sid); });
+    ParallelForEach(thread_pool, scene_ref.num_bending, kGrainSize,
+                    [&](int bid) { vbd::UpdateBendingPlasticity(scene_ref, bid); });
+  }
+}
+
+}  // namespace snowberg::solver
@@ -1,5 +1,9 @@
 #if defined(__CUDACC__)
 #include "snowberg/solver/solver_scene.h"
+#include "snowberg/solver/solver_vbd.h"
+#include "thrust/copy.h"
+#include "thrust/functional.h"
+#include "thrust/reduce.h"
 
 #define DISPATCH_SIZE(thread_count, block_size) ((thread_count + block_size - 1) / block_size), block_size
 #define DEFAULT_DISPATCH_SIZE(num_particle) DISPATCH_SIZE(num_particle, 256)
@@ -9,149 +13,22 @@ namespace snowberg::solver {
 __global__ void InitializeSolver(SceneRef scene_ref, Vector3<float> gravity, float dt) {
   int pid = threadIdx.x + blockIdx.x * blockDim.x;
   if (pid < scene_ref.num_particle) {
-    scene_ref.v[pid] += gravity * dt;
-    scene_ref.x[pid] = scene_ref.x_prev[pid] + scene_ref.v[pid] * dt;
+    vbd::InitializeParticle(scene_ref, pid, gravity, dt);
   }
 }
 
-__device__ Matrix3<float> VecLengthHessian(const Vector3<float> &v) {
-  auto v_hat = v.normalized().derived();
-  return (Matrix3<float>::Identity() - v_hat * v_hat.transpose()) / v.norm();
-}
-
-__device__ void StretchingEnergy(const ElementStretching &stretching,
-                                 const Matrix3<float> &X,
-                                 Vector3<float> &jacobian,
-                                 Matrix3<float> &hessian,
-                                 int self_index) {
-  Matrix<float, 3, 2> F;
-  F.col(0) = X.col(1) - X.col(0);
-  F.col(1) = X.col(2) - X.col(0);
-  auto a = 1.0 + stretching.mu / stretching.lambda;
-  Matrix2<float> Dm_inv = stretching.Dm.inverse();
-  F = F * Dm_inv;
-  Vector2<float> dXdxi;
-  if (self_index == 0) {
-    dXdxi = (-Dm_inv.row(0) - Dm_inv.row(1)).transpose();
-  } else if (self_index == 1) {
-    dXdxi = Dm_inv.row(0).transpose();
-  } else {
-    dXdxi = Dm_inv.row(1).transpose();
-  }
-  Vector3<float> Fz = F.col(0).cross(F.col(1));
-  Vector3<float> n = Fz.normalized();
-  float J = Fz.norm();
-  jacobian = stretching.mu * (F.col(0) * dXdxi[0] + F.col(1) * dXdxi[1]);
-  hessian = stretching.mu * dXdxi.squaredNorm() * Matrix3<float>::Identity();
-  Vector3<float> compressed_jacobian = (F.col(1).cross(n) * dXdxi[0] + n.cross(F.col(0)) * dXdxi[1]);
-  jacobian += stretching.lambda * (J - a) * compressed_jacobian;
-  hessian += stretching.lambda * compressed_jacobian * compressed_jacobian.transpose();
-  compressed_jacobian = dXdxi[1] * F.col(0) - dXdxi[0] * F.col(1);
-  hessian +=
-      stretching.lambda * (J - a) * -Skew3(compressed_jacobian) * VecLengthHessian(Fz) * Skew3(compressed_jacobian);
-  jacobian *= stretching.area;
-  hessian *= stretching.area;
-}
-
-__global__ void SolveVBDParticlePosition(SceneRef scene_ref, const int *particle_indices, int num_particle, float dt) {
+__global__ void SolveVBDParticlePosition(SceneRef scene_ref,
+                                         const int *particle_indices,
+                                         int num_particle,
+                                         float dt,
+                                         ConvergenceCriterion criterion,
+                                         float *residuals) {
   int tid = threadIdx.x + blockIdx.x * blockDim.x;
   if (tid < num_particle) {
-    int pid = particle_indices[tid];
-    int pidx = scene_ref.ParticleIndex(pid);
-    Vector3<float> x = scene_ref.x[pidx];
-    Vector3<float> x_prev = scene_ref.x_prev[pidx];
-    float m = scene_ref.m[pidx];
-    Vector3<float> f = -(m / (dt * dt)) * (x - (x_prev + scene_ref.v[pidx] * dt));
-    Matrix3<float> H = (m / (dt * dt)) * Matrix3<float>::Identity();
-
-    for (int i = 0; i < scene_ref.stretching_directory.count[pid]; i++) {
-      int stretching_id = scene_ref.stretching_directory.positions[scene_ref.stretching_directory.first[pid] + i] / 3;
-      auto stretching = scene_ref.stretchings[stretching_id];
-
-      grassland::ElasticNeoHookeanSimpleTriangle<float> neo_hookean{stretching.mu, stretching.lambda, stretching.Dm};
-      uint32_t u = scene_ref.stretching_indices[stretching_id * 3 + 0];
-      uint32_t v = scene_ref.stretching_indices[stretching_id * 3 + 1];
-      uint32_t w = scene_ref.stretching_indices[stretching_id * 3 + 2];
-      int self_index = pid == u ? 0 : (pid == v ? 1 : 2);
-
-      Matrix3<float> X;
-      X << scene_ref.x[u], scene_ref.x[v], scene_ref.x[w];
-      Vector3<float> jacobian;
-      Matrix3<float> hessian;
-      // jacobian = neo_hookean.Jacobian(X).block(0, 3 * self_index, 1, 3).transpose() * stretching.area;
-      // hessian = neo_hookean.Hessian(X).m[0].block(3 * self_index, 3 * self_index, 3, 3) * stretching.area;
-      StretchingEnergy(stretching, X, jacobian, hessian, self_index);
-
-      float k_damping = stretching.damping / dt;
-      f -= jacobian + hessian * (x - x_prev) * k_damping;
-      H += hessian * (1.0 + k_damping);
+    float residual = vbd::SolveParticlePosition(scene_ref, particle_indices[tid], dt, -1.0f, criterion);
+    if (residuals) {
+      residuals[tid] = residual;
     }
-
-    for (int i = 0; i < scene_ref.bending_directory.count[pid]; i++) {
-      int bending_id = scene_ref.bending_directory.positions[scene_ref.bending_directory.first[pid] + i] / 4;
-      auto bending = scene_ref.bendings[bending_id];
-
-      grassland::DihedralAngle<float> dihedral_angle;
-      uint32_t u = scene_ref.bending_indices[bending_id * 4 + 0];
-      uint32_t v = scene_ref.bending_indices[bending_id * 4 + 1];
-      uint32_t w = scene_ref.bending_indices[bending_id * 4 + 2];
-      uint32_t z = scene_ref.bending_indices[bending_id * 4 + 3];
-      int self_index = pid == u ? 0 : (pid == v ? 1 : (pid == w ? 2 : 3));
-
-      Matrix<float, 3, 4> X;
-      X << scene_ref.x[u], scene_ref.x[v], scene_ref.x[w], scene_ref.x[z];
-      float theta = dihedral_angle(X).value() - bending.theta_rest;
-      Vector3<float> jacobian;  // = dihedral_angle.Jacobian(X).block(0, 3 * self_index, 1, 3).transpose();
-      Matrix3<float> hessian;   // = Matrix3<float>::Zero();
-      // hessian = dihedral_angle.SubHessian(X, self_index);
-      DihedralAngleSubHessianJacobian(X, jacobian, hessian, self_index);
-      hessian = (2.0 * theta * hessian + 2.0 * jacobian * jacobian.transpose()).derived();
-      jacobian *= 2.0 * theta;
-
-      // if (fabs(theta) > 0.0f) {
-      //   printf("theta: %f jacobian: %f %f %f, current_angle: %f, theta_rest: %f\n", theta, jacobian[0], jacobian[1],
-      //   jacobian[2], dihedral_angle(X).value(), bending.theta_rest);
-      // }
-
-      float k_damping = bending.damping / dt;
-      f -= jacobian * bending.stiffness + hessian * (x - x_prev) * k_damping * bending.stiffness;
-      H += hessian * (1.0 + k_damping) * bending.stiffness;
-    }
-
-    const Vector3<float> rel_vel = (x - x_prev) / dt;
-
-    constexpr float K_DAMPING = 1e-6;
-    for (int i = 0; i < scene_ref.num_rigid_object; i++) {
-      float sdf;
-      Vector3<float> jacobian;
-      Matrix3<float> hessian;
-      RigidObjectRef rigid_object = scene_ref.rigid_objects[i];
-      rigid_object.mesh_sdf.SDF(x, rigid_object.state.R, rigid_object.state.t, &sdf, &jacobian, &hessian);
-      Vector3<float> r = x - sdf * jacobian - rigid_object.state.t;
-      sdf -= 0.018f;
-      if (sdf < 0.0) {
-        float k_stiffness = rigid_object.stiffness * m;
-        float force_mag = -2.0 * k_stiffness * sdf;
-        Matrix3<float> partial_H =
-            2.0 * k_stiffness * jacobian * jacobian.transpose() + 2.0 * k_stiffness * sdf * hessian;
-        f -= 2.0 * k_stiffness * sdf * jacobian + partial_H * (x - x_prev) * K_DAMPING;
-        H += partial_H + partial_H * K_DAMPING;
-
-        Vector3<float> velocity_component = rel_vel - rigid_object.state.v - rigid_object.state.omega.cross(r);
-        velocity_component = velocity_component - jacobian * jacobian.transpose() * velocity_component;
-        float max_friction_force = force_mag * rigid_object.friction;
-        float vel_comp_norm = velocity_component.norm();
-        if (vel_comp_norm > max_friction_force * dt / m) {
-          f -= velocity_component / vel_comp_norm * max_friction_force;
-        } else if (vel_comp_norm > 1e-9) {
-          f -= velocity_component / dt * m;
-          // f -= velocity_component / vel_comp_norm * max_friction_force;
-        }
-      }
-    }
-
-    Vector3<float> delta_x = H.inverse() * f;
-    scene_ref.x[pidx] += delta_x;
   }
 }
 
@@ -168,215 +45,148 @@ __global__ void SolveVBDParticlePositionBatched(const int *scene_offsets,
     sid--;
   const SceneRef &scene_ref = scene_refs[sid];
   if (tid < total_particles) {
-    tid -= scene_offsets[sid];
-    int pid = particle_indices[tid];
-    int pidx = scene_ref.ParticleIndex(pid);
-    Vector3<float> x = scene_ref.x[pidx];
-    Vector3<float> x_prev = scene_ref.x_prev[pidx];
-    float m = scene_ref.m[pidx];
-    Vector3<float> f = -(m / (dt * dt)) * (x - (x_prev + scene_ref.v[pidx] * dt));
-    Matrix3<float> H = (m / (dt * dt)) * Matrix3<float>::Identity();
-
-    for (int i = 0; i < scene_ref.stretching_directory.count[pid]; i++) {
-      int stretching_id = scene_ref.stretching_directory.positions[scene_ref.stretching_directory.first[pid] + i] / 3;
-      auto stretching = scene_ref.stretchings[stretching_id];
-
-      uint32_t u = scene_ref.stretching_indices[stretching_id * 3 + 0];
-      uint32_t v = scene_ref.stretching_indices[stretching_id * 3 + 1];
-      uint32_t w = scene_ref.stretching_indices[stretching_id * 3 + 2];
-      int self_index = pid == u ? 0 : (pid == v ? 1 : 2);
-
-      Matrix3<float> X;
-      X << scene_ref.x[u], scene_ref.x[v], scene_ref.x[w];
-      Vector3<float> jacobian;
-      Matrix3<float> hessian;
-      // jacobian = neo_hookean.Jacobian(X).block(0, 3 * self_index, 1, 3).transpose() * stretching.area;
-      // hessian = neo_hookean.Hessian(X).m[0].block(3 * self_index, 3 * self_index, 3, 3) * stretching.area;
-      StretchingEnergy(stretching, X, jacobian, hessian, self_index);
-
-      float k_damping = stretching.damping / dt;
-      f -= jacobian + hessian * (x - x_prev) * k_damping;
-      H += hessian * (1.0 + k_damping);
-    }
-
-    for (int i = 0; i < scene_ref.bending_directory.count[pid]; i++) {
-      int bending_id = scene_ref.bending_directory.positions[scene_ref.bending_directory.first[pid] + i] / 4;
-      auto bending = scene_ref.bendings[bending_id];
-
-      grassland::DihedralAngle<float> dihedral_angle;
-      uint32_t u = scene_ref.bending_indices[bending_id * 4 + 0];
-      uint32_t v = scene_ref.bending_indices[bending_id * 4 + 1];
-      uint32_t w = scene_ref.bending_indices[bending_id * 4 + 2];
-      uint32_t z = scene_ref.bending_indices[bending_id * 4 + 3];
-      int self_index = pid == u ? 0 : (pid == v ? 1 : (pid == w ? 2 : 3));
-
-      Matrix<float, 3, 4> X;
-      X << scene_ref.x[u], scene_ref.x[v], scene_ref.x[w], scene_ref.x[z];
-      float theta = dihedral_angle(X).value() - bending.theta_rest;
-      Vector3<float> jacobian;  // = dihedral_angle.Jacobian(X).block(0, 3 * self_index, 1, 3).transpose();
-      Matrix3<float> hessian;   // = Matrix3<float>::Zero();
-      // hessian = dihedral_angle.SubHessian(X, self_index);
-      DihedralAngleSubHessianJacobian(X, jacobian, hessian, self_index);
-      hessian = (2.0 * theta * hessian + 2.0 * jacobian * jacobian.transpose()).derived();
-      jacobian *= 2.0 * theta;
-
-      // if (fabs(theta) > 0.0f) {
-      //   printf("theta: %f jacobian: %f %f %f, current_angle: %f, theta_rest: %f\n", theta, jacobian[0], jacobian[1],
-      //   jacobian[2], dihedral_angle(X).value(), bending.theta_rest);
-      // }
-
-      float k_damping = bending.damping / dt;
-      f -= jacobian * bending.stiffness + hessian * (x - x_prev) * k_damping * bending.stiffness;
-      H += hessian * (1.0 + k_damping) * bending.stiffness;
-    }
-
-    const float k_friction = 5.0f;
-    const Vector3<float> rel_vel = (x - x_prev) / dt;
-
-    constexpr float K_DAMPING = 1e-6;
-    for (int i = 0; i < scene_ref.num_rigid_object; i++) {
-      float sdf;
-      Vector3<float> jacobian;
-      Matrix3<float> hessian;
-      RigidObjectRef rigid_object = scene_ref.rigid_objects[i];
-      rigid_object.mesh_sdf.SDF(x, rigid_object.state.R, rigid_object.state.t, &sdf, &jacobian, &hessian);
-      Vector3<float> r = x - sdf * jacobian - rigid_object.state.t;
-      sdf -= 0.018f;
-      if (sdf < 0.0) {
-        float k_stiffness = rigid_object.stiffness * m;
-        float force_mag = -2.0 * k_stiffness * sdf;
-        Matrix3<float> partial_H =
-            2.0 * k_stiffness * jacobian * jacobian.transpose() + 2.0 * k_stiffness * sdf * hessian;
-        f -= 2.0 * k_stiffness * sdf * jacobian + partial_H * (x - x_prev) * K_DAMPING;
-        H += partial_H + partial_H * K_DAMPING;
-
-        Vector3<float> velocity_component = rel_vel - rigid_object.state.v - rigid_object.state.omega.cross(r);
-        velocity_component = velocity_component - jacobian * jacobian.transpose() * velocity_component;
-        float max_friction_force = force_mag * k_friction;
-        float vel_comp_norm = velocity_component.norm();
-        if (vel_comp_norm > max_friction_force * dt / m) {
-          f -= velocity_component / vel_comp_norm * max_friction_force;
-        } else if (vel_comp_norm > 1e-9) {
-          f -= velocity_component / dt * m;
-          // f -= velocity_component / vel_comp_norm * max_friction_force;
-        }
-      }
-    }
-
-    Vector3<float> delta_x = H.inverse() * f;
-    scene_ref.x[pidx] += delta_x;
+    vbd::SolveParticlePosition(scene_ref, particle_indices[tid], dt, vbd::kBatchFriction);
   }
 }
 
 __global__ void UpdateStretchingPlasticity(SceneRef scene_ref) {
   int sid = threadIdx.x + blockIdx.x * blockDim.x;
   if (sid < scene_ref.num_stretching) {
-    ElementStretching stretching = scene_ref.stretchings[sid];
-    if (stretching.sigma_lb > 0.0 || stretching.sigma_ub > 0.0) {
-      uint32_t u = scene_ref.stretching_indices[sid * 3 + 0];
-      uint32_t v = scene_ref.stretching_indices[sid * 3 + 1];
-      uint32_t w = scene_ref.stretching_indices[sid * 3 + 2];
-      Matrix3<float> X;
-      X << scene_ref.x[u], scene_ref.x[v], scene_ref.x[w];
-      Matrix<float, 3, 2> F;
-      F << X.col(1) - X.col(0), X.col(2) - X.col(0);
-      Matrix<float, 3, 2> Fe = F * stretching.Dm.inverse();
-      Matrix<float, 3, 2> U;
-      Matrix<float, 2, 2> S;
-      Matrix<float, 2, 2> Vt;
-      SVD(Fe, U, S, Vt);
-      if (stretching.sigma_lb > 0.0) {
-        // if (S(0, 0) < stretching.theta_lb || S(1, 1) < stretching.theta_lb) {
-        //   // printf("Stretching clamped (lower)\n");
-        // }
-        S(0, 0) = max(S(0, 0), stretching.sigma_lb);
-        S(1, 1) = max(S(1, 1), stretching.sigma_lb);
-      }
-      if (stretching.sigma_ub > 0.0) {
-        // if (S(0, 0) > stretching.theta_ub || S(1, 1) > stretching.theta_ub) {
-        //   printf("Stretching clamped (upper)\n");
-        //   printf("%f %f\n", S(0, 0), S(1, 1));
-        // }
-        S(0, 0) = min(S(0, 0), stretching.sigma_ub);
-        S(1, 1) = min(S(1, 1), stretching.sigma_ub);
-      }
-      S(0, 0) = 1.0 / S(0, 0);
-      S(1, 1) = 1.0 / S(1, 1);
-      // printf("BP1");
-      stretching.Dm = Vt.transpose() * S * U.transpose() * F;
-      // printf("BP2");
-      scene_ref.stretchings[sid] = stretching;
-    }
+    vbd::UpdateStretchingPlasticity(scene_ref, sid);
   }
 }
 
 __global__ void UpdateBendingPlasticity(SceneRef scene_ref) {
   int bid = threadIdx.x + blockIdx.x * blockDim.x;
   if (bid < scene_ref.num_bending) {
-    ElementBending bending = scene_ref.bendings[bid];
-    constexpr float pi = 3.14159265358979323846;
-    if (bending.elastic_limit < pi) {
-      uint32_t a = scene_ref.bending_indices[bid * 4 + 0];
-      uint32_t b = scene_ref.bending_indices[bid * 4 + 1];
-      uint32_t c = scene_ref.bending_indices[bid * 4 + 2];
-      uint32_t d = scene_ref.bending_indices[bid * 4 + 3];
-      Matrix<float, 3, 4> X;
-      X << scene_ref.x[a], scene_ref.x[b], scene_ref.x[c], scene_ref.x[d];
-      DihedralAngle<float> dihedral_angle;
-      float theta = dihedral_angle(X).value();
-      float theta_rest = bending.theta_rest;
+    vbd::UpdateBendingPlasticity(scene_ref, bid);
+  }
+}
 
-      // limit difference between theta and theta_rest to bending.bending_bound
-      float diff = theta_rest - theta;
-      if (diff > pi) {
-        diff -= 2.0 * pi;
-      }
-      if (diff < -pi) {
-        diff += 2.0 * pi;
-      }
-      if (diff < 0.0) {
-        diff = max(diff, -bending.elastic_limit);
-      }
-      if (diff > 0.0) {
-        diff = min(diff, bending.elastic_limit);
-      }
+__global__ void ChebyshevExtrapolate(SceneRef scene_ref,
+                                     float omega,
+                                     Vector3<float> *x_iterate,
+                                     Vector3<float> *x_iterate_prev) {
+  int pid = threadIdx.x + blockIdx.x * blockDim.x;
+  if (pid < scene_ref.num_particle) {
+    vbd::ChebyshevExtrapolate(scene_ref, pid, omega, x_iterate, x_iterate_prev);
+  }
+}
 
-      theta_rest = theta + diff;
-      if (theta_rest < -pi) {
-        theta_rest += 2.0 * pi;
-      }
-      if (theta_rest > pi) {
-        theta_rest -= 2.0 * pi;
-      }
-      bending.theta_rest = theta_rest;
-      scene_ref.bendings[bid] = bending;
-    }
+__global__ void PredictDisplacements(SceneRef scene_ref, Vector3<float> gravity, float dt, float *displacements) {
+  int pid = threadIdx.x + blockIdx.x * blockDim.x;
+  if (pid < scene_ref.num_particle) {
+    displacements[pid] = vbd::PredictedDisplacement(scene_ref, pid, gravity, dt);
+  }
+}
+
+// Sets *reaches once a particle is held back by its contact bound.
+__global__ void ReachContactBounds(SceneRef scene_ref, int *reaches) {
+  int pid = threadIdx.x + blockIdx.x * blockDim.x;
+  if (pid < scene_ref.num_particle && vbd::ReachesContactBound(scene_ref, pid)) {
+    *reaches = 1;
   }
 }
 
 __global__ void UpdateVelocity(SceneRef scene_ref, float dt) {
   int pid = threadIdx.x + blockIdx.x * blockDim.x;
   if (pid < scene_ref.num_particle) {
-    scene_ref.v[pid] = (scene_ref.x[pid] - scene_ref.x_prev[pid]) / dt;
+    vbd::UpdateVelocity(scene_ref, pid, dt);
   }
 }
 
 void SceneDevice::Update(SceneDevice &scene, float dt) {
   DeviceClock clk;
-  SceneRef scene_ref = scene;
+  const SolverSettings &settings = scene.settings_;
+  SolverStatistics statistics;
+  Vector3<float> gravity{0.0, -9.8, 0.0};
   scene.x_prev_ = scene.x_;
-  InitializeSolver<<<DEFAULT_DISPATCH_SIZE(scene_ref.num_particle), 0, scene.stream_>>>(
-      scene_ref, Vector3<float>{0.0, -9.8, 0.0}, dt);
+  // Detects the contacts at the current positions on the host, with query radii grown by the motion still expected in
+  // the step, and uploads them.
+  auto detect_contacts = [&](const Vector3<float> &pending_gravity) {
+    SceneRef scene_ref = scene;
+    scene.contact_displacements_.resize(scene_ref.num_particle);
+    PredictDisplacements<<<DEFAULT_DISPATCH_SIZE(scene_ref.num_particle)>>>(scene_ref, pending_gravity, dt,
+                                                                             scene.contact_displacements_.data().get());
+    scene.x_host_.resize(scene.x_.size());
+    thrust::copy(scene.x_.begin(), scene.x_.end(), scene.x_host_.begin());
+    scene.contact_displacements_host_.resize(scene_ref.num_particle);
+    thrust::copy(scene.contact_displacements_.begin(), scene.contact_displacements_.end(),
+                 scene.contact_displacements_host_.begin());
+    scene.contact_detector_.Detect(scene.x_host_.data(), settings.contact_thickness,
+                                   ContactDetector::QueryRadius(settings), settings.contact_bound_relaxation,
+                                   scene.thread_pool_, nullptr, scene.contact_displacements_host_.data());
+    scene.vertex_face_indices_ = scene.contact_detector_.VertexFaceIndices();
+    scene.vertex_face_directory_ = scene.contact_detector_.VertexFaceDirectory();
+    scene.edge_edge_indices_ = scene.contact_detector_.EdgeEdgeIndices();
+    scene.edge_edge_directory_ = scene.contact_detector_.EdgeEdgeDirectory();
+    scene.contact_bounds_ = scene.contact_detector_.Bounds();
+    scene.x_detect_ = scene.x_;
+    statistics.contact_detections++;
+  };
+  thrust::device_vector<int> contact_bound_reached;
+  if (settings.self_contact) {
+    detect_contacts(gravity);
+    scene.x_sweep_.resize(scene.x_.size());
+    contact_bound_reached.resize(1);
+    clk.Record("Detect Contacts");
+  }
+  SceneRef scene_ref = scene;
+  scene_ref.rigid_candidates = scene.UpdateRigidBounds();
+  InitializeSolver<<<DEFAULT_DISPATCH_SIZE(scene_ref.num_particle), 0, scene.stream_>>>(scene_ref, gravity, dt);
   clk.Record("Initialize Solver");
 
-  const int num_vbd_iterations_ = 40;
-  for (int iter = 0; iter < num_vbd_iterations_; iter++) {
+  vbd::ChebyshevSchedule chebyshev(settings, scene.statistics_.spectral_radius);
+  if (settings.chebyshev) {
+    scene.x_iterate_ = scene.x_;
+    scene.x_iterate_prev_ = scene.x_;
+  }
+  while (statistics.iterations < settings.max_iterations) {
+    bool check = vbd::IsResidualCheck(settings, statistics.iterations + 1);
+    bool evaluate_residual = check || settings.chebyshev;
+    if (settings.self_contact) {
+      thrust::copy(scene.x_.begin(), scene.x_.end(), scene.x_sweep_.begin());
+    }
     for (int c = 0; c < scene.particle_directory_host_.first.size(); c++) {
+      int first = scene.particle_directory_host_.first[c];
       SolveVBDParticlePosition<<<DEFAULT_DISPATCH_SIZE(scene.particle_directory_host_.count[c])>>>(
-          scene_ref, scene.particle_directory_.positions.data().get() + scene.particle_directory_host_.first[c],
-          scene.particle_directory_host_.count[c], dt);
+          scene_ref, scene.particle_directory_.positions.data().get() + first, scene.particle_directory_host_.count[c],
+          dt, settings.criterion, evaluate_residual ? scene.residuals_.data().get() + first : nullptr);
+    }
+    statistics.iterations++;
+    float residual = 0.0f;
+    if (evaluate_residual) {
+      if (settings.criterion == CONVERGENCE_CRITERION_FORCE_RESIDUAL) {
+        residual =
+            std::sqrt(thrust::reduce(scene.residuals_.begin(), scene.residuals_.end(), 0.0f, thrust::plus<float>()));
+      } else {
+        residual = thrust::reduce(scene.residuals_.begin(), scene.residuals_.end(), 0.0f, thrust::maximum<float>());
+      }
+    }
+    if (check) {
+      statistics.residual = residual;
+      if (vbd::IsConverged(settings, statistics.iterations, residual)) {
+        break;
+      }
+    }
+    if (settings.chebyshev) {
+      ChebyshevExtrapolate<<<DEFAULT_DISPATCH_SIZE(scene_ref.num_particle)>>>(
+          scene_ref, chebyshev.Next(residual), scene.x_iterate_.data().get(), scene.x_iterate_prev_.data().get());
+    }
+    // The bounds only hold back the particles until the contacts around them are known again.
+    if (settings.self_contact && statistics.iterations < settings.max_iterations) {
+      contact_bound_reached[0] = 0;
+      ReachContactBounds<<<DEFAULT_DISPATCH_SIZE(scene_ref.num_particle)>>>(scene_ref,
+                                                                              contact_bound_reached.data().get());
+      if (contact_bound_reached[0]) {
+        detect_contacts(Vector3<float>::Zero());
+        scene_ref.contact = SceneRef(scene).contact;
+      }
     }
   }
+  statistics.spectral_radius = chebyshev.SpectralRadius();
+  statistics.restarts = chebyshev.Restarts();
+  scene.statistics_ = statistics;
   clk.Record("Solve VBD");
 
   UpdateVelocity<<<DEFAULT_DISPATCH_SIZE(scene_ref.num_particle), 0, scene.stream_>>>(scene_ref, dt);
@@ -412,6 +222,9 @@ __global__ void CopyParticleIndices(const int *scene_offsets,
 }
 
 void SceneDevice::UpdateBatch(const std::vector<SceneDevice *> &scenes, float dt) {
+  for (const SceneDevice *scene : scenes) {
+    CheckBatchSettings(scene->settings_);
+  }
   DeviceClock clk;
   std::vector<SceneRef> scene_refs(scenes.size());
   thrust::device_vector<SceneRef> device_scenes(scenes.size());
@@ -423,6 +236,8 @@ void SceneDevice::UpdateBatch(const std::vector<SceneDevice *> &scenes, float dt
 
   for (int i = 0; i < scenes.size(); i++) {
     scene_refs[i] = *scenes[i];
+    scene_refs[i].contact = ContactRef{};
+    scene_refs[i].rigid_candidates = scenes[i]->UpdateRigidBounds();
     scenes[i]->x_prev_ = scenes[i]->x_;
     InitializeSolver<<<DEFAULT_DISPATCH_SIZE(scene_refs[i].num_particle), 0, scenes[i]->stream_>>>(
         scene_refs[i], Vector3<float>{0.0, -9.8, 0.0}, dt);
@@ -456,7 +271,6 @@ void SceneDevice::UpdateBatch(const std::vector<SceneDevice *> &scenes, float dt
 
   clk.Record("Initialize Solver");
 
-  const int num_vbd_iterations_ = 20;
   // for (int i = 0; i < scenes.size(); i++) {
   //   for (int iter = 0; iter < num_vbd_iterations_; iter++) {
   //     for (int c = 0; c < scenes[i]->particle_directory_host_.first.size(); c++) {
@@ -468,7 +282,7 @@ void SceneDevice::UpdateBatch(const std::vector<SceneDevice *> &scenes, float dt
   //     }
   //   }
   // }
-  for (int iter = 0; iter < num_vbd_iterations_; iter++) {
+  for (int iter = 0; iter < vbd::kNumBatchIterations; iter++) {
     for (int c = 0; c < max_color_cnt; c++) {
       SolveVBDParticlePositionBatched<<<DEFAULT_DISPATCH_SIZE(total_particle_count[c])>>>(
           scene_offsets[c].data().get(), scenes.size(), device_scenes.data().get(),
@@ -0,0 +1,201 @@
+#include "snowberg/solver/solver_snapshot.h"
+
+#include <fstream>
+
+namespace snowberg::solver {
+
+namespace {
+
+constexpr uint32_t kCompressedMagic = 0x5a534253;  // "SBSZ"
+constexpr int kHashBits = 16;
+constexpr size_t kMinMatch = 4;
+
+uint32_t Load32(const uint8_t *data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void WriteVarint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t ReadVarint(const std::vector<uint8_t> &in, size_t &offset) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (offset >= in.size()) {
+      break;
+    }
+    uint8_t byte = in[offset++];
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw std::runtime_error("[Snapshot] corrupted compressed data");
+}
+
+// Byte k of every 4 byte word goes to the k-th quarter, trailing bytes stay in place.
+std::vector<uint8_t> Shuffle(const std::vector<uint8_t> &data) {
+  std::vector<uint8_t> shuffled(data.size());
+  size_t num_word = data.size() / 4;
+  for (size_t w = 0; w < num_word; w++) {
+    for (size_t b = 0; b < 4; b++) {
+      shuffled[b * num_word + w] = data[w * 4 + b];
+    }
+  }
+  std::copy(data.begin() + num_word * 4, data.end(), shuffled.begin() + num_word * 4);
+  return shuffled;
+}
+
+std::vector<uint8_t> Unshuffle(const std::vector<uint8_t> &shuffled) {
+  std::vector<uint8_t> data(shuffled.size());
+  size_t num_word = shuffled.size() / 4;
+  for (size_t w = 0; w < num_word; w++) {
+    for (size_t b = 0; b < 4; b++) {
+      data[w * 4 + b] = shuffled[b * num_word + w];
+    }
+  }
+  std::copy(shuffled.begin() + num_word * 4, shuffled.end(), data.begin() + num_word * 4);
+  return data;
+}
+
+}  // namespace
+
+std::vector<uint8_t> SnapshotWriter::Release() {
+  return std::move(data_);
+}
+
+void SnapshotWriter::WriteBytes(const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  data_.insert(data_.end(), bytes, bytes + size);
+}
+
+SnapshotReader::SnapshotReader(const std::vector<uint8_t> &data) : data_(data) {
+}
+
+size_t SnapshotReader::Remaining() const {
+  return data_.size() - offset_;
+}
+
+void SnapshotReader::ReadBytes(void *data, size_t size) {
+  if (size > data_.size() - offset_) {
+    throw std::runtime_error("[Snapshot] unexpected end of snapshot");
+  }
+  std::memcpy(data, data_.data() + offset_, size);
+  offset_ += size;
+}
+
+// The stream is a sequence of (literal count, literals, match offset, match length - kMinMatch), ended by a match
+// offset of 0 after the last literals. Matches are found through a hash table of the last position of every 4 bytes.
+std::vector<uint8_t> CompressSnapshot(const std::vector<uint8_t> &snapshot) {
+  std::vector<uint8_t> in = Shuffle(snapshot);
+  SnapshotWriter header;
+  header.Write(kCompressedMagic);
+  header.Write<uint64_t>(in.size());
+  std::vector<uint8_t> out = header.Release();
+  out.reserve(in.size() / 2 + 16);
+
+  std::vector<int64_t> table(size_t{1} << kHashBits, -1);
+  size_t anchor = 0;
+  size_t i = 0;
+  while (i + kMinMatch <= in.size()) {
+    uint32_t word = Load32(in.data() + i);
+    uint32_t hash = (word * 2654435761u) >> (32 - kHashBits);
+    int64_t candidate = table[hash];
+    table[hash] = i;
+    if (candidate < 0 || Load32(in.data() + candidate) != word) {
+      i++;
+      continue;
+    }
+    size_t length = kMinMatch;
+    while (i + length < in.size() && in[candidate + length] == in[i + length]) {
+      length++;
+    }
+    WriteVarint(out, i - anchor);
+    out.insert(out.end(), in.begin() + anchor, in.begin() + i);
+    WriteVarint(out, i - candidate);
+    WriteVarint(out, length - kMinMatch);
+    i += length;
+    anchor = i;
+  }
+  WriteVarint(out, in.size() - anchor);
+  out.insert(out.end(), in.begin() + anchor, in.end());
+  WriteVarint(out, 0);
+  return out;
+}
+
+std::vector<uint8_t> DecompressSnapshot(const std::vector<uint8_t> &compressed) {
+  SnapshotReader header(compressed);
+  if (header.Read<uint32_t>() != kCompressedMagic) {
+    throw std::runtime_error("[Snapshot] not a compressed snapshot");
+  }
+  uint64_t size = header.Read<uint64_t>();
+  std::vector<uint8_t> out(size);
+  size_t position = 0;
+  size_t offset = sizeof(uint32_t) + sizeof(uint64_t);
+  while (true) {
+    uint64_t num_literal = ReadVarint(compressed, offset);
+    if (num_literal > compressed.size() - offset || num_literal > size - position) {
+      throw std::runtime_error("[Snapshot] corrupted compressed data");
+    }
+    std::memcpy(out.data() + position, compressed.data() + offset, num_literal);
+    position += num_literal;
+    offset += num_literal;
+    uint64_t match_offset = ReadVarint(compressed, offset);
+    if (!match_offset) {
+      break;
+    }
+    uint64_t length = ReadVarint(compressed, offset) + kMinMatch;
+    if (match_offset > position || length > size - position) {
+      throw std::runtime_error("[Snapshot] corrupted compressed data");
+    }
+    if (match_offset >= length) {
+      std::memcpy(out.data() + position, out.data() + position - match_offset, length);
+    } else {
+      // The match overlaps the bytes it produces.
+      for (uint64_t k = 0; k < length; k++) {
+        out[position + k] = out[position + k - match_offset];
+      }
+    }
+    position += length;
+  }
+  if (position != size) {
+    throw std::runtime_error("[Snapshot] corrupted compressed data");
+  }
+  return Unshuffle(out);
+}
+
+void WriteSnapshotFile(const std::string &path, const std::vector<uint8_t> &snapshot, bool compress) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("[Snapshot] cannot open " + path + " for writing");
+  }
+  if (compress) {
+    std::vector<uint8_t> compressed = CompressSnapshot(snapshot);
+    file.write(reinterpret_cast<const char *>(compressed.data()), compressed.size());
+  } else {
+    file.write(reinterpret_cast<const char *>(snapshot.data()), snapshot.size());
+  }
+  if (!file) {
+    throw std::runtime_error("[Snapshot] failed to write " + path);
+  }
+}
+
+std::vector<uint8_t> ReadSnapshotFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("[Snapshot] cannot open " + path);
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (data.size() >= sizeof(uint32_t) && Load32(data.data()) == kCompressedMagic) {
+    return DecompressSnapshot(data);
+  }
+  return data;
+}
+
+}  // namespace snowberg::solver
@@ -0,0 +1,88 @@
+#pragma once
+#include "snowberg/solver/solver_util.h"
+
+namespace snowberg::solver {
+
+// Types a snapshot holds as their bytes, trivially copyable ones and fixed size Eigen matrices of arithmetic scalars,
+// which only copy their coefficients without being trivially copyable by the standard. Structs of such matrices are
+// opted in one by one. None may hold padding, whose bytes would make equal states give different snapshots, so
+// structs with padding are written field by field instead.
+template <typename T>
+struct IsSnapshotData : std::is_trivially_copyable<T> {};
+
+template <typename Scalar, int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+struct IsSnapshotData<Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>>
+    : std::bool_constant<Rows != Eigen::Dynamic && Cols != Eigen::Dynamic && std::is_arithmetic_v<Scalar>> {};
+
+template <>
+struct IsSnapshotData<RigidObjectState> : std::true_type {
+  static_assert(sizeof(RigidObjectState) == 28 * sizeof(float), "RigidObjectState has padding");
+};
+
+// Appends plain data values and arrays to one contiguous binary blob. Arrays are prefixed by their length.
+class SnapshotWriter {
+ public:
+  template <typename T>
+  void Write(const T &value) {
+    static_assert(IsSnapshotData<T>::value, "snapshots hold plain data only");
+    WriteBytes(&value, sizeof(T));
+  }
+
+  template <typename T>
+  void WriteArray(const std::vector<T> &values) {
+    static_assert(IsSnapshotData<T>::value, "snapshots hold plain data only");
+    Write<uint64_t>(values.size());
+    WriteBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  std::vector<uint8_t> Release();
+
+ private:
+  void WriteBytes(const void *data, size_t size);
+
+  std::vector<uint8_t> data_;
+};
+
+// Reads back what a SnapshotWriter wrote, in the same order. Throws std::runtime_error when reading past the end or
+// when an array does not have the expected length.
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(const std::vector<uint8_t> &data);
+
+  template <typename T>
+  T Read() {
+    static_assert(IsSnapshotData<T>::value, "snapshots hold plain data only");
+    T value;
+    ReadBytes(&value, sizeof(T));
+    return value;
+  }
+
+  // Reads into values without reallocating, the array in the snapshot has to have values.size() elements.
+  template <typename T>
+  void ReadArray(std::vector<T> &values) {
+    static_assert(IsSnapshotData<T>::value, "snapshots hold plain data only");
+    if (Read<uint64_t>() != values.size()) {
+      throw std::runtime_error("[Snapshot] array size does not match the scene");
+    }
+    ReadBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  size_t Remaining() const;
+
+ private:
+  void ReadBytes(void *data, size_t size);
+
+  const std::vector<uint8_t> &data_;
+  size_t offset_{0};
+};
+
+// Lossless compression of a snapshot blob. The bytes of every 4 byte word are regrouped by significance first, so the
+// sign and exponent bytes of the float state line up into long repeats, followed by a hashed LZ77 pass.
+std::vector<uint8_t> CompressSnapshot(const std::vector<uint8_t> &snapshot);
+std::vector<uint8_t> DecompressSnapshot(const std::vector<uint8_t> &compressed);
+
+// Writes a snapshot blob to a file, compressed or as is. ReadSnapshotFile tells both apart and returns the plain blob.
+void WriteSnapshotFile(const std::string &path, const std::vector<uint8_t> &snapshot, bool compress = true);
+std::vector<uint8_t> ReadSnapshotFile(const std::string &path);
+
+}  // namespace snowberg::solver
@@ -1,5 +1,7 @@
 #include "snowberg/solver/solver_util.h"
 
+#include <stdexcept>
+
 namespace snowberg::solver {
 
 LM_DEVICE_FUNC RigidObjectState RigidObjectState::NextState(float dt) const {
@@ -13,6 +15,18 @@ LM_DEVICE_FUNC RigidObjectState RigidObjectState::NextState(float dt) const {
   return new_state;
 }
 
+void CheckBatchSettings(const SolverSettings &settings) {
+  if (settings.self_contact) {
+    throw std::invalid_argument("[UpdateBatch] self contact is not supported in a batch");
+  }
+  if (settings.tolerance > 0.0f) {
+    throw std::invalid_argument("[UpdateBatch] adaptive iterations are not supported in a batch");
+  }
+  if (settings.chebyshev) {
+    throw std::invalid_argument("[UpdateBatch] Chebyshev acceleration is not supported in a batch");
+  }
+}
+
 Directory::Directory(const std::vector<int> &contents, int num_bucket) {
   first.resize(num_bucket, 0);
   count.resize(num_bucket, 0);
@@ -41,6 +55,101 @@ Directory::operator DirectoryRef() const {
   return directory_ref;
 }
 
+DynamicDirectory::DynamicDirectory(const Directory &directory) : directory_(directory), capacity_(directory.count) {
+  int num_content = 0;
+  for (int content : directory_.positions) {
+    num_content = std::max(num_content, content + 1);
+  }
+  bucket_.resize(num_content, -1);
+  location_.resize(num_content, -1);
+  for (size_t b = 0; b < directory_.first.size(); b++) {
+    for (int i = directory_.first[b]; i < directory_.first[b] + directory_.count[b]; i++) {
+      int content = directory_.positions[i];
+      bucket_[content] = b;
+      location_[content] = i;
+    }
+  }
+}
+
+void DynamicDirectory::Insert(int bucket, int content) {
+  ResizeBuckets(bucket + 1);
+  if (content >= static_cast<int>(location_.size())) {
+    bucket_.resize(std::max<size_t>(content + 1, location_.size() * 2), -1);
+    location_.resize(bucket_.size(), -1);
+  }
+  if (directory_.count[bucket] == capacity_[bucket]) {
+    Move(bucket, std::max(4, capacity_[bucket] * 2));
+  }
+  int location = directory_.first[bucket] + directory_.count[bucket]++;
+  directory_.positions[location] = content;
+  bucket_[content] = bucket;
+  location_[content] = location;
+}
+
+void DynamicDirectory::Erase(int content) {
+  int bucket = bucket_[content];
+  int location = location_[content];
+  int last = directory_.first[bucket] + --directory_.count[bucket];
+  int moved = directory_.positions[last];
+  directory_.positions[location] = moved;
+  location_[moved] = location;
+  bucket_[content] = -1;
+  location_[content] = -1;
+}
+
+void DynamicDirectory::ResizeBuckets(int num_bucket) {
+  if (num_bucket > NumBuckets()) {
+    directory_.first.resize(num_bucket, directory_.positions.size());
+    directory_.count.resize(num_bucket, 0);
+    capacity_.resize(num_bucket, 0);
+  }
+}
+
+int DynamicDirectory::NumBuckets() const {
+  return directory_.first.size();
+}
+
+const Directory &DynamicDirectory::GetDirectory() const {
+  return directory_;
+}
+
+DynamicDirectory::operator DirectoryRef() const {
+  return directory_;
+}
+
+void DynamicDirectory::Move(int bucket, int capacity) {
+  int first = directory_.positions.size();
+  directory_.positions.resize(first + capacity, -1);
+  for (int i = 0; i < directory_.count[bucket]; i++) {
+    int content = directory_.positions[directory_.first[bucket] + i];
+    directory_.positions[first + i] = content;
+    location_[content] = first + i;
+  }
+  num_abandoned_ += capacity_[bucket];
+  directory_.first[bucket] = first;
+  capacity_[bucket] = capacity;
+  if (num_abandoned_ * 2 > directory_.positions.size()) {
+    Compact();
+  }
+}
+
+void DynamicDirectory::Compact() {
+  std::vector<int> positions;
+  positions.reserve(directory_.positions.size() - num_abandoned_);
+  for (int b = 0; b < NumBuckets(); b++) {
+    int first = positions.size();
+    for (int i = 0; i < directory_.count[b]; i++) {
+      int content = directory_.positions[directory_.first[b] + i];
+      positions.push_back(content);
+      location_[content] = first + i;
+    }
+    positions.resize(first + capacity_[b], -1);
+    directory_.first[b] = first;
+  }
+  directory_.positions = std::move(positions);
+  num_abandoned_ = 0;
+}
+
 #if defined(__CUDACC__)
 
 DirectoryDevice::DirectoryDevice(const Directory &directory) {
@@ -22,6 +22,62 @@ struct RigidObjectState {
   LM_DEVICE_FUNC RigidObjectState NextState(float dt) const;
 };
 
+typedef enum ConvergenceCriterion {
+  CONVERGENCE_CRITERION_MAX_DISPLACEMENT = 0,  // largest |dx| of a particle within one sweep
+  CONVERGENCE_CRITERION_FORCE_RESIDUAL = 1,    // L2 norm over all particles of the force before their update
+} ConvergenceCriterion;
+
+// Iteration control of the VBD solve. The residual is reduced over all particles every check_interval sweeps, and the
+// solve stops at the first check past min_iterations where it is below tolerance. A tolerance of 0 always runs
+// max_iterations sweeps.
+//
+// With chebyshev, every sweep after the first chebyshev_delay plain ones is extrapolated by the Chebyshev
+// semi-iterative method. A spectral_radius <= 0 is estimated from the residual ratio of the plain sweeps, or taken over
+// from the previous Update when there are fewer than two. The residual is then evaluated every sweep, and a growing
+// residual restarts the acceleration with plain sweeps.
+struct SolverSettings {
+  int min_iterations{4};
+  int max_iterations{40};
+  int check_interval{4};
+  float tolerance{0.0f};
+  ConvergenceCriterion criterion{CONVERGENCE_CRITERION_MAX_DISPLACEMENT};
+  bool chebyshev{false};
+  float spectral_radius{0.0f};
+  int chebyshev_delay{4};
+
+  // Self and cloth-cloth contact between all stretching triangles. Vertex-face and edge-edge pairs within the query
+  // radius of their particles are pushed apart once closer than contact_thickness, and each particle moves at most
+  // contact_bound_relaxation (< 0.5) times the distance to its nearest pair away from where the contacts were
+  // detected, so nothing tunnels through. The query radius of a particle is contact_query_radius plus its motion
+  // predicted for the step over contact_bound_relaxation, and a sweep that leaves particles at their bound detects the
+  // contacts again before the next one, so the bounds do not slow down free motion. contact_stiffness is scaled by the
+  // particle mass like the stiffness of rigid objects. The thickness has to stay below the rest edge length, otherwise
+  // neighbors within one sheet repel each other.
+  bool self_contact{false};
+  float contact_thickness{0.002f};
+  float contact_query_radius{0.02f};
+  float contact_stiffness{1e5f};
+  float contact_bound_relaxation{0.4f};
+
+  // Per step candidate lists of rigid objects for every particle. Off, every particle tests the bounds of every rigid
+  // object. The result is the same either way.
+  bool rigid_broad_phase{true};
+};
+
+struct SolverStatistics {
+  int iterations{0};
+  float residual{0.0f};  // at the last sweep
+  float spectral_radius{0.0f};
+  int restarts{0};
+  // Contact detections run within the step, 0 without self contact.
+  int contact_detections{0};
+};
+
+// The batched updates of several scenes run vbd::kNumBatchIterations plain sweeps without self contact, whatever
+// min_iterations and max_iterations say. Throws std::invalid_argument for settings they would otherwise ignore: self
+// contact, a tolerance above 0 and Chebyshev acceleration.
+void CheckBatchSettings(const SolverSettings &settings);
+
 struct DirectoryRef {
   const int *first;
   const int *count;
@@ -37,6 +93,38 @@ struct Directory {
   operator DirectoryRef() const;
 };
 
+// Directory edited in place one entry at a time. Every bucket owns a range of positions of which the first count are
+// used, so the directory stays a valid DirectoryRef throughout. A full bucket moves to the end of positions with twice
+// its capacity, and positions is compacted once more than half of it is abandoned, so an edit costs amortized constant
+// time however large the directory is. Every content value is in at most one bucket, which finds it on Erase. The order
+// within a bucket is the insertion order until an Erase moves its last entry into the gap.
+class DynamicDirectory {
+ public:
+  DynamicDirectory() = default;
+  explicit DynamicDirectory(const Directory &directory);
+
+  // Buckets past the end are added empty.
+  void Insert(int bucket, int content);
+  void Erase(int content);
+  // Adds empty buckets up to num_bucket, never drops any.
+  void ResizeBuckets(int num_bucket);
+
+  int NumBuckets() const;
+  const Directory &GetDirectory() const;
+  operator DirectoryRef() const;
+
+ private:
+  void Move(int bucket, int capacity);
+  void Compact();
+
+  Directory directory_;
+  std::vector<int> capacity_;
+  // Bucket and index into positions of every content value, -1 when absent.
+  std::vector<int> bucket_;
+  std::vector<int> location_;
+  size_t num_abandoned_{0};
+};
+
 #if defined(__CUDACC__)
 struct DirectoryDevice {
   DirectoryDevice() = default;
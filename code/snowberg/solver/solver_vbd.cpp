@@ -0,0 +1,393 @@
+#include "snowberg/solver/solver_vbd.h"
+
+namespace snowberg::solver::vbd {
+
+namespace {
+
+LM_DEVICE_FUNC Matrix3<float> VecLengthHessian(const Vector3<float> &v) {
+  auto v_hat = v.normalized().derived();
+  return (Matrix3<float>::Identity() - v_hat * v_hat.transpose()) / v.norm();
+}
+
+// Penalty 0.5 * k * (thickness - d)^2 of a contact pair at distance d along the unit direction n, as seen by the slot
+// whose position moves d by weight * n.
+LM_DEVICE_FUNC void AddContactPenalty(const ContactRef &contact,
+                                      float k,
+                                      float d,
+                                      const Vector3<float> &n,
+                                      float weight,
+                                      Vector3<float> &f,
+                                      Matrix3<float> &H) {
+  f += k * (contact.thickness - d) * weight * n;
+  H += k * weight * weight * n * n.transpose();
+}
+
+LM_DEVICE_FUNC void AddContacts(const SceneRef &scene_ref,
+                                int pid,
+                                const Vector3<float> &x,
+                                float k,
+                                Vector3<float> &f,
+                                Matrix3<float> &H) {
+  const ContactRef &contact = scene_ref.contact;
+  for (int i = 0; i < contact.vertex_face_directory.count[pid]; i++) {
+    int position = contact.vertex_face_directory.positions[contact.vertex_face_directory.first[pid] + i];
+    const int *pair = contact.vertex_face_indices + position / 4 * 4;
+    int self_index = position % 4;
+    Vector3<float> X[4];
+    for (int j = 0; j < 4; j++) {
+      X[j] = j == self_index ? x : contact.x_sweep[pair[j]];
+    }
+    float u, v;
+    DistancePointTriangle(X[0], X[1], X[2], X[3], u, v);
+    Vector3<float> diff = X[0] - (X[1] + u * (X[2] - X[1]) + v * (X[3] - X[1]));
+    float d = diff.norm();
+    if (d < contact.thickness && d > 1e-9f) {
+      float weights[4] = {1.0f, u + v - 1.0f, -u, -v};
+      AddContactPenalty(contact, k, d, diff / d, weights[self_index], f, H);
+    }
+  }
+
+  for (int i = 0; i < contact.edge_edge_directory.count[pid]; i++) {
+    int position = contact.edge_edge_directory.positions[contact.edge_edge_directory.first[pid] + i];
+    const int *pair = contact.edge_edge_indices + position / 4 * 4;
+    int self_index = position % 4;
+    Vector3<float> X[4];
+    for (int j = 0; j < 4; j++) {
+      X[j] = j == self_index ? x : contact.x_sweep[pair[j]];
+    }
+    float u, v;
+    DistanceSegmentSegment(X[0], X[1], X[2], X[3], u, v);
+    Vector3<float> diff = (X[0] + u * (X[1] - X[0])) - (X[2] + v * (X[3] - X[2]));
+    float d = diff.norm();
+    if (d < contact.thickness && d > 1e-9f) {
+      float weights[4] = {1.0f - u, u, v - 1.0f, -v};
+      AddContactPenalty(contact, k, d, diff / d, weights[self_index], f, H);
+    }
+  }
+}
+
+// Penalty and friction of one rigid object on a particle at x, zero beyond kRigidContactMargin from its surface.
+LM_DEVICE_FUNC void AddRigidContact(const RigidObjectRef &rigid_object,
+                                    const Vector3<float> &x,
+                                    const Vector3<float> &x_prev,
+                                    float m,
+                                    float dt,
+                                    float friction,
+                                    Vector3<float> &f,
+                                    Matrix3<float> &H) {
+  constexpr float K_DAMPING = 1e-6;
+  const Vector3<float> rel_vel = (x - x_prev) / dt;
+  float sdf;
+  Vector3<float> jacobian;
+  Matrix3<float> hessian;
+  rigid_object.mesh_sdf.SDF(x, rigid_object.state.R, rigid_object.state.t, &sdf, &jacobian, &hessian);
+  Vector3<float> r = x - sdf * jacobian - rigid_object.state.t;
+  sdf -= kRigidContactMargin;
+  if (sdf < 0.0) {
+    float k_stiffness = rigid_object.stiffness * m;
+    float force_mag = -2.0 * k_stiffness * sdf;
+    Matrix3<float> partial_H = 2.0 * k_stiffness * jacobian * jacobian.transpose() + 2.0 * k_stiffness * sdf * hessian;
+    f -= 2.0 * k_stiffness * sdf * jacobian + partial_H * (x - x_prev) * K_DAMPING;
+    H += partial_H + partial_H * K_DAMPING;
+
+    Vector3<float> velocity_component = rel_vel - rigid_object.state.v - rigid_object.state.omega.cross(r);
+    velocity_component = velocity_component - jacobian * jacobian.transpose() * velocity_component;
+    float max_friction_force = force_mag * (friction < 0.0f ? rigid_object.friction : friction);
+    float vel_comp_norm = velocity_component.norm();
+    if (vel_comp_norm > max_friction_force * dt / m) {
+      f -= velocity_component / vel_comp_norm * max_friction_force;
+    } else if (vel_comp_norm > 1e-9) {
+      f -= velocity_component / dt * m;
+    }
+  }
+}
+
+LM_DEVICE_FUNC bool InRigidBounds(const RigidCandidateRef &rigid_candidates, int i, const Vector3<float> &x) {
+  if (!rigid_candidates.bounds) {
+    return true;
+  }
+  const Vector3<float> &lower = rigid_candidates.bounds[i * 2];
+  const Vector3<float> &upper = rigid_candidates.bounds[i * 2 + 1];
+  return x[0] >= lower[0] && x[1] >= lower[1] && x[2] >= lower[2] && x[0] <= upper[0] && x[1] <= upper[1] &&
+         x[2] <= upper[2];
+}
+
+LM_DEVICE_FUNC bool InSphere(const Vector4<float> &sphere, const Vector3<float> &x) {
+  return (x - sphere.head<3>()).squaredNorm() <= sphere[3] * sphere[3];
+}
+
+// Projects the particle back into the ball around x_detect it may move in until the next detection.
+LM_DEVICE_FUNC void ClampToContactBound(const SceneRef &scene_ref, int pidx) {
+  if (!scene_ref.contact.bounds) {
+    return;
+  }
+  float bound = scene_ref.contact.bounds[pidx];
+  Vector3<float> displacement = scene_ref.x[pidx] - scene_ref.contact.x_detect[pidx];
+  float distance = displacement.norm();
+  if (distance > bound) {
+    scene_ref.x[pidx] = scene_ref.contact.x_detect[pidx] + displacement * (bound / distance);
+  }
+}
+
+}  // namespace
+
+LM_DEVICE_FUNC void StretchingEnergy(const StretchingRestState &rest_state,
+                                     const Matrix3<float> &X,
+                                     int self_index,
+                                     Vector3<float> &jacobian,
+                                     Matrix3<float> &hessian) {
+  Matrix<float, 3, 2> F = X * rest_state.gradients;
+  Vector2<float> dXdxi = rest_state.gradients.row(self_index).transpose();
+  Vector3<float> Fz = F.col(0).cross(F.col(1));
+  Vector3<float> n = Fz.normalized();
+  float J = Fz.norm();
+  jacobian = rest_state.mu * (F.col(0) * dXdxi[0] + F.col(1) * dXdxi[1]);
+  hessian = rest_state.mu * dXdxi.squaredNorm() * Matrix3<float>::Identity();
+  Vector3<float> compressed_jacobian = (F.col(1).cross(n) * dXdxi[0] + n.cross(F.col(0)) * dXdxi[1]);
+  jacobian += rest_state.lambda * (J - rest_state.a) * compressed_jacobian;
+  hessian += rest_state.lambda * compressed_jacobian * compressed_jacobian.transpose();
+  compressed_jacobian = dXdxi[1] * F.col(0) - dXdxi[0] * F.col(1);
+  hessian += rest_state.lambda * (J - rest_state.a) * -Skew3(compressed_jacobian) * VecLengthHessian(Fz) *
+             Skew3(compressed_jacobian);
+}
+
+LM_DEVICE_FUNC float PredictedDisplacement(const SceneRef &scene_ref,
+                                           int pidx,
+                                           const Vector3<float> &gravity,
+                                           float dt) {
+  return (scene_ref.x_prev[pidx] + (scene_ref.v[pidx] + gravity * dt) * dt - scene_ref.x[pidx]).norm();
+}
+
+LM_DEVICE_FUNC bool ReachesContactBound(const SceneRef &scene_ref, int pidx) {
+  float bound = scene_ref.contact.bounds[pidx];
+  return bound > 0.0f && (scene_ref.x[pidx] - scene_ref.contact.x_detect[pidx]).norm() >= bound * kContactBoundReach;
+}
+
+LM_DEVICE_FUNC void InitializeParticle(const SceneRef &scene_ref, int pidx, const Vector3<float> &gravity, float dt) {
+  scene_ref.v[pidx] += gravity * dt;
+  scene_ref.x[pidx] = scene_ref.x_prev[pidx] + scene_ref.v[pidx] * dt;
+  ClampToContactBound(scene_ref, pidx);
+}
+
+LM_DEVICE_FUNC float SolveParticlePosition(const SceneRef &scene_ref,
+                                           int pidx,
+                                           float dt,
+                                           float friction,
+                                           ConvergenceCriterion criterion) {
+  Vector3<float> x = scene_ref.x[pidx];
+  Vector3<float> x_prev = scene_ref.x_prev[pidx];
+  float m = scene_ref.m[pidx];
+  Vector3<float> f = -(m / (dt * dt)) * (x - (x_prev + scene_ref.v[pidx] * dt));
+  Matrix3<float> H = (m / (dt * dt)) * Matrix3<float>::Identity();
+
+  for (int i = 0; i < scene_ref.stretching_directory.count[pidx]; i++) {
+    int stretching_id = scene_ref.stretching_directory.positions[scene_ref.stretching_directory.first[pidx] + i] / 3;
+    const StretchingRestState &rest_state = scene_ref.stretching_rest_states[stretching_id];
+
+    uint32_t u = scene_ref.stretching_indices[stretching_id * 3 + 0];
+    uint32_t v = scene_ref.stretching_indices[stretching_id * 3 + 1];
+    uint32_t w = scene_ref.stretching_indices[stretching_id * 3 + 2];
+    int self_index = pidx == u ? 0 : (pidx == v ? 1 : 2);
+
+    Matrix3<float> X;
+    X << scene_ref.x[u], scene_ref.x[v], scene_ref.x[w];
+    Vector3<float> jacobian;
+    Matrix3<float> hessian;
+    StretchingEnergy(rest_state, X, self_index, jacobian, hessian);
+
+    float k_damping = rest_state.damping / dt;
+    f -= jacobian + hessian * (x - x_prev) * k_damping;
+    H += hessian * (1.0 + k_damping);
+  }
+
+  for (int i = 0; i < scene_ref.bending_directory.count[pidx]; i++) {
+    int bending_id = scene_ref.bending_directory.positions[scene_ref.bending_directory.first[pidx] + i] / 4;
+    auto bending = scene_ref.bendings[bending_id];
+
+    grassland::DihedralAngle<float> dihedral_angle;
+    uint32_t u = scene_ref.bending_indices[bending_id * 4 + 0];
+    uint32_t v = scene_ref.bending_indices[bending_id * 4 + 1];
+    uint32_t w = scene_ref.bending_indices[bending_id * 4 + 2];
+    uint32_t z = scene_ref.bending_indices[bending_id * 4 + 3];
+    int self_index = pidx == u ? 0 : (pidx == v ? 1 : (pidx == w ? 2 : 3));
+
+    Matrix<float, 3, 4> X;
+    X << scene_ref.x[u], scene_ref.x[v], scene_ref.x[w], scene_ref.x[z];
+    float theta = dihedral_angle(X).value() - bending.theta_rest;
+    Vector3<float> jacobian;
+    Matrix3<float> hessian;
+    DihedralAngleSubHessianJacobian(X, jacobian, hessian, self_index);
+    hessian = (2.0 * theta * hessian + 2.0 * jacobian * jacobian.transpose()).derived();
+    jacobian *= 2.0 * theta;
+
+    float k_damping = bending.damping / dt;
+    f -= jacobian * bending.stiffness + hessian * (x - x_prev) * k_damping * bending.stiffness;
+    H += hessian * (1.0 + k_damping) * bending.stiffness;
+  }
+
+  const RigidCandidateRef &rigid_candidates = scene_ref.rigid_candidates;
+  auto add_rigid_contact = [&](int i) {
+    if (InRigidBounds(rigid_candidates, i, x)) {
+      AddRigidContact(scene_ref.rigid_objects[i], x, x_prev, m, dt, friction, f, H);
+    }
+  };
+  if (rigid_candidates.spheres && InSphere(rigid_candidates.spheres[pidx], x)) {
+    for (int i = 0; i < rigid_candidates.candidates.count[pidx]; i++) {
+      add_rigid_contact(rigid_candidates.candidates.positions[rigid_candidates.candidates.first[pidx] + i]);
+    }
+  } else {
+    for (int i = 0; i < scene_ref.num_rigid_object; i++) {
+      add_rigid_contact(i);
+    }
+  }
+
+  if (scene_ref.contact.bounds) {
+    AddContacts(scene_ref, pidx, x, scene_ref.contact.stiffness * m, f, H);
+  }
+
+  Vector3<float> delta_x = H.inverse() * f;
+  scene_ref.x[pidx] += delta_x;
+  ClampToContactBound(scene_ref, pidx);
+  return criterion == CONVERGENCE_CRITERION_FORCE_RESIDUAL ? f.squaredNorm() : (scene_ref.x[pidx] - x).norm();
+}
+
+bool IsResidualCheck(const SolverSettings &settings, int num_iterations) {
+  return num_iterations == settings.max_iterations ||
+         (settings.tolerance > 0.0f && settings.check_interval > 0 && num_iterations % settings.check_interval == 0);
+}
+
+bool IsConverged(const SolverSettings &settings, int num_iterations, float residual) {
+  return num_iterations >= settings.min_iterations && residual < settings.tolerance;
+}
+
+LM_DEVICE_FUNC void ChebyshevExtrapolate(const SceneRef &scene_ref,
+                                         int pidx,
+                                         float omega,
+                                         Vector3<float> *x_iterate,
+                                         Vector3<float> *x_iterate_prev) {
+  Vector3<float> x = x_iterate_prev[pidx] + omega * (scene_ref.x[pidx] - x_iterate_prev[pidx]);
+  x_iterate_prev[pidx] = x_iterate[pidx];
+  scene_ref.x[pidx] = x;
+  ClampToContactBound(scene_ref, pidx);
+  x_iterate[pidx] = scene_ref.x[pidx];
+}
+
+ChebyshevSchedule::ChebyshevSchedule(const SolverSettings &settings, float spectral_radius)
+    : settings_(settings),
+      spectral_radius_(settings.spectral_radius > 0.0f ? settings.spectral_radius : spectral_radius) {
+}
+
+float ChebyshevSchedule::Next(float residual) {
+  bool estimate = settings_.spectral_radius <= 0.0f;
+  if (num_accelerated_sweeps_ > 0 && residual > last_residual_) {
+    num_plain_sweeps_ = 0;
+    num_accelerated_sweeps_ = 0;
+    restarts_++;
+    if (estimate) {
+      spectral_radius_ *= kBackOff;
+    }
+  }
+  float last_residual = last_residual_;
+  last_residual_ = residual;
+  if (num_plain_sweeps_ < settings_.chebyshev_delay) {
+    // The first plain sweeps mostly damp the fast modes, so their ratio only bounds the spectral radius from below.
+    if (estimate && restarts_ == 0 && num_plain_sweeps_ > 0 && last_residual > 0.0f) {
+      spectral_radius_ = std::max(spectral_radius_, std::min(residual / last_residual, kMaxSpectralRadius));
+    }
+    num_plain_sweeps_++;
+    return 1.0f;
+  }
+  float rho2 = spectral_radius_ * spectral_radius_;
+  omega_ = num_accelerated_sweeps_ == 0 ? 2.0f / (2.0f - rho2) : 4.0f / (4.0f - rho2 * omega_);
+  num_accelerated_sweeps_++;
+  return omega_;
+}
+
+float ChebyshevSchedule::SpectralRadius() const {
+  if (settings_.spectral_radius <= 0.0f && restarts_ == 0 && num_accelerated_sweeps_ > 0) {
+    return spectral_radius_ + kGrowth * (kMaxSpectralRadius - spectral_radius_);
+  }
+  return spectral_radius_;
+}
+
+int ChebyshevSchedule::Restarts() const {
+  return restarts_;
+}
+
+LM_DEVICE_FUNC void UpdateVelocity(const SceneRef &scene_ref, int pidx, float dt) {
+  scene_ref.v[pidx] = (scene_ref.x[pidx] - scene_ref.x_prev[pidx]) / dt;
+}
+
+LM_DEVICE_FUNC void UpdateStretchingPlasticity(const SceneRef &scene_ref, int sid) {
+  ElementStretching stretching = scene_ref.stretchings[sid];
+  if (stretching.sigma_lb > 0.0 || stretching.sigma_ub > 0.0) {
+    uint32_t u = scene_ref.stretching_indices[sid * 3 + 0];
+    uint32_t v = scene_ref.stretching_indices[sid * 3 + 1];
+    uint32_t w = scene_ref.stretching_indices[sid * 3 + 2];
+    Matrix3<float> X;
+    X << scene_ref.x[u], scene_ref.x[v], scene_ref.x[w];
+    Matrix<float, 3, 2> F;
+    F << X.col(1) - X.col(0), X.col(2) - X.col(0);
+    Matrix<float, 3, 2> Fe = X * scene_ref.stretching_rest_states[sid].gradients;
+    Matrix<float, 3, 2> U;
+    Matrix<float, 2, 2> S;
+    Matrix<float, 2, 2> Vt;
+    SVD(Fe, U, S, Vt);
+    if (stretching.sigma_lb > 0.0) {
+      S(0, 0) = fmaxf(S(0, 0), stretching.sigma_lb);
+      S(1, 1) = fmaxf(S(1, 1), stretching.sigma_lb);
+    }
+    if (stretching.sigma_ub > 0.0) {
+      S(0, 0) = fminf(S(0, 0), stretching.sigma_ub);
+      S(1, 1) = fminf(S(1, 1), stretching.sigma_ub);
+    }
+    S(0, 0) = 1.0 / S(0, 0);
+    S(1, 1) = 1.0 / S(1, 1);
+    stretching.Dm = Vt.transpose() * S * U.transpose() * F;
+    scene_ref.stretchings[sid] = stretching;
+    scene_ref.stretching_rest_states[sid] = stretching.RestState();
+  }
+}
+
+LM_DEVICE_FUNC void UpdateBendingPlasticity(const SceneRef &scene_ref, int bid) {
+  ElementBending bending = scene_ref.bendings[bid];
+  constexpr float pi = 3.14159265358979323846;
+  if (bending.elastic_limit < pi) {
+    uint32_t a = scene_ref.bending_indices[bid * 4 + 0];
+    uint32_t b = scene_ref.bending_indices[bid * 4 + 1];
+    uint32_t c = scene_ref.bending_indices[bid * 4 + 2];
+    uint32_t d = scene_ref.bending_indices[bid * 4 + 3];
+    Matrix<float, 3, 4> X;
+    X << scene_ref.x[a], scene_ref.x[b], scene_ref.x[c], scene_ref.x[d];
+    DihedralAngle<float> dihedral_angle;
+    float theta = dihedral_angle(X).value();
+    float theta_rest = bending.theta_rest;
+
+    // limit difference between theta and theta_rest to bending.bending_bound
+    float diff = theta_rest - theta;
+    if (diff > pi) {
+      diff -= 2.0 * pi;
+    }
+    if (diff < -pi) {
+      diff += 2.0 * pi;
+    }
+    if (diff < 0.0) {
+      diff = fmaxf(diff, -bending.elastic_limit);
+    }
+    if (diff > 0.0) {
+      diff = fminf(diff, bending.elastic_limit);
+    }
+
+    theta_rest = theta + diff;
+    if (theta_rest < -pi) {
+      theta_rest += 2.0 * pi;
+    }
+    if (theta_rest > pi) {
+      theta_rest -= 2.0 * pi;
+    }
+    bending.theta_rest = theta_rest;
+    scene_ref.bendings[bid] = bending;
+  }
+}
+
+}  // namespace snowberg::solver::vbd
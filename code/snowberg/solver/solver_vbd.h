@@ -0,0 +1,95 @@
+#pragma once
+#include "snowberg/solver/solver_scene.h"
+
+namespace snowberg::solver::vbd {
+
+// Per-particle and per-element steps of the VBD cloth solver. The CUDA kernels of SceneDevice and the thread pool
+// loops of SceneHost both call these, so the two backends run the same arithmetic.
+
+constexpr int kNumBatchIterations = 20;
+constexpr float kBatchFriction = 5.0f;
+
+// Gradient and Hessian by vertex self_index of the stretching energy of an element with vertex positions X.
+LM_DEVICE_FUNC void StretchingEnergy(const StretchingRestState &rest_state,
+                                     const Matrix3<float> &X,
+                                     int self_index,
+                                     Vector3<float> &jacobian,
+                                     Matrix3<float> &hessian);
+
+// A particle counts as held back by its contact bound once it is this share of the bound away from x_detect.
+constexpr float kContactBoundReach = 0.999f;
+
+// Distance from x to where the velocity, raised by gravity * dt, carries the particle by the end of the step. Before
+// InitializeParticle pass the gravity of the step, after it zero.
+LM_DEVICE_FUNC float PredictedDisplacement(const SceneRef &scene_ref,
+                                           int pidx,
+                                           const Vector3<float> &gravity,
+                                           float dt);
+
+// Whether the particle is held back by its contact bound, so that the contacts have to be detected again for it to
+// move on. Only valid with self contact.
+LM_DEVICE_FUNC bool ReachesContactBound(const SceneRef &scene_ref, int pidx);
+
+LM_DEVICE_FUNC void InitializeParticle(const SceneRef &scene_ref, int pidx, const Vector3<float> &gravity, float dt);
+
+// Newton step on the position of one particle with its neighbors fixed. pidx is a storage index, like the entries of
+// the color directory and the element indices. friction < 0 uses the friction of each rigid object, otherwise it
+// overrides all of them. Returns the particle's share of the residual: |dx| for CONVERGENCE_CRITERION_MAX_DISPLACEMENT,
+// |f|^2 for CONVERGENCE_CRITERION_FORCE_RESIDUAL.
+LM_DEVICE_FUNC float SolveParticlePosition(const SceneRef &scene_ref,
+                                           int pidx,
+                                           float dt,
+                                           float friction = -1.0f,
+                                           ConvergenceCriterion criterion = CONVERGENCE_CRITERION_MAX_DISPLACEMENT);
+
+// Whether the residual is evaluated in the sweep that completes num_iterations sweeps, and whether the solve may stop
+// after it.
+bool IsResidualCheck(const SolverSettings &settings, int num_iterations);
+bool IsConverged(const SolverSettings &settings, int num_iterations, float residual);
+
+// Chebyshev step x_{k+1} = omega * (x_hat - x_{k-1}) + x_{k-1} on the result x_hat of a sweep. x_iterate holds x_k and
+// x_iterate_prev holds x_{k-1}, both advance by one iteration. omega = 1 keeps x_hat. Like every position update of the
+// step, the result stays within the contact bound.
+LM_DEVICE_FUNC void ChebyshevExtrapolate(const SceneRef &scene_ref,
+                                         int pidx,
+                                         float omega,
+                                         Vector3<float> *x_iterate,
+                                         Vector3<float> *x_iterate_prev);
+
+// Omega sequence of the Chebyshev acceleration within one Update, fed with the residual of every sweep. Without a
+// spectral radius in the settings, the estimate starts from the residual ratio of the plain sweeps, backs off on every
+// restart, and grows after each Update that went without one.
+class ChebyshevSchedule {
+ public:
+  // spectral_radius is the estimate carried over from the previous Update, 0 for none.
+  ChebyshevSchedule(const SolverSettings &settings, float spectral_radius);
+
+  // Takes the residual of the sweep just finished and returns the omega to extrapolate it with.
+  float Next(float residual);
+
+  // Estimate to start the next Update with.
+  float SpectralRadius() const;
+  int Restarts() const;
+
+ private:
+  // Past kMaxSpectralRadius the omega sequence approaches 2 and a single inaccurate sweep gets amplified too much.
+  static constexpr float kMaxSpectralRadius = 0.99f;
+  static constexpr float kBackOff = 0.9f;
+  static constexpr float kGrowth = 0.25f;
+
+  const SolverSettings &settings_;
+  float spectral_radius_;
+  float omega_{1.0f};
+  float last_residual_{-1.0f};
+  int num_plain_sweeps_{0};
+  int num_accelerated_sweeps_{0};
+  int restarts_{0};
+};
+
+LM_DEVICE_FUNC void UpdateVelocity(const SceneRef &scene_ref, int pidx, float dt);
+
+LM_DEVICE_FUNC void UpdateStretchingPlasticity(const SceneRef &scene_ref, int sid);
+
+LM_DEVICE_FUNC void UpdateBendingPlasticity(const SceneRef &scene_ref, int bid);
+
+}  // namespace snowberg::solver::vbd
@@ -23,6 +23,9 @@ class Scene : public Object {
     } raytracing;
     struct Rasterization {
       glm::vec3 ambient_light{0.1f, 0.1f, 0.1f};
+      float lod_pixel_error{1.0f};  // largest projected LOD error in pixels, 0 always draws the full resolution
+      bool meshlet_culling{true};   // frustum culling of meshlets, for meshes built with meshlets
+      bool meshlet_cone_culling{false};  // backface cone culling, only for closed meshes as both faces are drawn
     } raster;
     int &samples_per_dispatch{raytracing.samples_per_dispatch};
     int &max_bounces{raytracing.max_bounces};
@@ -4,7 +4,10 @@
 
 namespace sparkium {
 
-GeometryMesh::GeometryMesh(Core *core, const Mesh<float> &mesh) : Geometry(core) {
+GeometryMesh::GeometryMesh(Core *core, const Mesh<float> &mesh) : GeometryMesh(core, mesh, Settings{}) {
+}
+
+GeometryMesh::GeometryMesh(Core *core, const Mesh<float> &mesh, const Settings &settings) : Geometry(core) {
   std::vector<uint8_t> data;
   auto write_data = [&](const void *data_ptr, size_t size) {
     data.insert(data.end(), static_cast<const uint8_t *>(data_ptr), static_cast<const uint8_t *>(data_ptr) + size);
@@ -19,36 +22,146 @@ GeometryMesh::GeometryMesh(Core *core, const Mesh<float> &mesh) : Geometry(core)
     mesh_ptr = &mesh_copy;
   }
 
+  statistics_before_ =
+      AnalyzeVertexCache(mesh.Indices(), mesh.NumIndices(), mesh.NumVertices(), settings.vertex_cache_size);
+  statistics_after_ = statistics_before_;
+  if (settings.optimize_vertex_order) {
+    if (mesh_ptr != &mesh_copy) {
+      mesh_copy = mesh;
+      mesh_ptr = &mesh_copy;
+    }
+    if (!mesh_copy.OptimizeVertexOrder(settings.vertex_cache_size, settings.overdraw_threshold)) {
+      statistics_after_ = AnalyzeVertexCache(mesh_copy.Indices(), mesh_copy.NumIndices(), mesh_copy.NumVertices(),
+                                             settings.vertex_cache_size);
+    }
+  }
+
+  std::vector<uint32_t> indices(mesh_ptr->Indices(), mesh_ptr->Indices() + mesh_ptr->NumIndices());
+  if (settings.build_meshlets) {
+    std::vector<uint32_t> triangle_order;
+    meshlets_ = BuildMeshlets(indices.data(), indices.size(), mesh_ptr->Positions(), mesh_ptr->NumVertices(),
+                              &triangle_order, settings.meshlet_max_vertices, settings.meshlet_max_triangles);
+    for (size_t i = 0; i < triangle_order.size(); i++) {
+      for (int j = 0; j < 3; j++) {
+        indices[i * 3 + j] = mesh_ptr->Indices()[triangle_order[i] * 3 + j];
+      }
+    }
+    statistics_after_ =
+        AnalyzeVertexCache(indices.data(), indices.size(), mesh_ptr->NumVertices(), settings.vertex_cache_size);
+  }
+
   header_.num_indices = mesh_ptr->NumIndices();
   header_.num_vertices = mesh_ptr->NumVertices();
 
+  AABB aabb;
+  for (size_t i = 0; i < mesh_ptr->NumVertices(); i++) {
+    aabb.Expand(mesh_ptr->Positions()[i]);
+  }
+  header_.attribute_encoding = settings.attribute_encoding;
+  if (mesh_ptr->NumVertices()) {
+    Vector3<float> extent = aabb.upper_bound - aabb.lower_bound;
+    for (int i = 0; i < 3; i++) {
+      header_.position_min[i] = aabb.lower_bound[i];
+      header_.position_extent[i] = extent[i];
+    }
+  }
+
   header_.index_offset = data.size();
-  write_data(mesh_ptr->Indices(), mesh_ptr->NumIndices() * sizeof(uint32_t));
+  write_data(indices.data(), indices.size() * sizeof(uint32_t));
+
   header_.position_offset = data.size();
-  header_.position_stride = sizeof(float) * 3;
-  write_data(mesh_ptr->Positions(), mesh_ptr->NumVertices() * sizeof(float) * 3);
+  if (header_.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_POSITION_UNORM16) {
+    header_.position_stride = sizeof(uint16_t) * 4;
+    for (size_t i = 0; i < mesh_ptr->NumVertices(); i++) {
+      uint16_t quantized[4]{};
+      for (int j = 0; j < 3; j++) {
+        float extent = header_.position_extent[j];
+        float t = extent > 0.0f ? (mesh_ptr->Positions()[i][j] - header_.position_min[j]) / extent : 0.0f;
+        quantized[j] = QuantizeUnorm16(t);
+      }
+      write_data(quantized, sizeof(quantized));
+    }
+  } else {
+    header_.position_stride = sizeof(float) * 3;
+    write_data(mesh_ptr->Positions(), mesh_ptr->NumVertices() * sizeof(float) * 3);
+  }
+
+  auto write_octahedral = [&](const Vector3<float> *vectors) {
+    for (size_t i = 0; i < mesh_ptr->NumVertices(); i++) {
+      uint32_t packed = EncodeOctahedral16(vectors[i]);
+      write_data(&packed, sizeof(packed));
+    }
+  };
 
   if (mesh_ptr->Normals()) {
     header_.normal_offset = data.size();
-    header_.normal_stride = sizeof(float) * 3;
-    write_data(mesh_ptr->Normals(), mesh_ptr->NumVertices() * sizeof(float) * 3);
+    if (header_.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_NORMAL_OCT16) {
+      header_.normal_stride = sizeof(uint32_t);
+      write_octahedral(mesh_ptr->Normals());
+    } else {
+      header_.normal_stride = sizeof(float) * 3;
+      write_data(mesh_ptr->Normals(), mesh_ptr->NumVertices() * sizeof(float) * 3);
+    }
   }
 
   if (mesh_ptr->TexCoords()) {
     header_.tex_coord_offset = data.size();
-    header_.tex_coord_stride = sizeof(float) * 2;
-    write_data(mesh_ptr->TexCoords(), mesh_ptr->NumVertices() * sizeof(float) * 2);
+    if (header_.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_TEX_COORD_HALF) {
+      header_.tex_coord_stride = sizeof(uint16_t) * 2;
+      for (size_t i = 0; i < mesh_ptr->NumVertices(); i++) {
+        uint16_t packed[2] = {FloatToHalf(mesh_ptr->TexCoords()[i][0]), FloatToHalf(mesh_ptr->TexCoords()[i][1])};
+        write_data(packed, sizeof(packed));
+      }
+    } else {
+      header_.tex_coord_stride = sizeof(float) * 2;
+      write_data(mesh_ptr->TexCoords(), mesh_ptr->NumVertices() * sizeof(float) * 2);
+    }
   }
 
   if (mesh_ptr->Tangents()) {
     header_.tangent_offset = data.size();
-    header_.tangent_stride = sizeof(float) * 3;
-    write_data(mesh_ptr->Tangents(), mesh_ptr->NumVertices() * sizeof(float) * 3);
+    if (header_.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_TANGENT_OCT16) {
+      header_.tangent_stride = sizeof(uint32_t);
+      write_octahedral(mesh_ptr->Tangents());
+    } else {
+      header_.tangent_stride = sizeof(float) * 3;
+      write_data(mesh_ptr->Tangents(), mesh_ptr->NumVertices() * sizeof(float) * 3);
+    }
     header_.signal_offset = data.size();
     header_.signal_stride = sizeof(float);
     write_data(mesh_ptr->Signals(), mesh_ptr->NumVertices() * sizeof(float));
   }
 
+  levels_of_detail_.push_back({header_.index_offset, header_.num_indices, 0.0f});
+  size_t target_index_count = mesh_ptr->NumIndices();
+  for (uint32_t level = 1; level < settings.num_lod_levels; level++) {
+    target_index_count = static_cast<size_t>(target_index_count * settings.lod_reduction) / 3 * 3;
+    float error = 0.0f;
+    std::vector<uint32_t> lod_indices =
+        SimplifyMesh(mesh_ptr->Indices(), mesh_ptr->NumIndices(), mesh_ptr->Positions(), mesh_ptr->NumVertices(),
+                     target_index_count, std::numeric_limits<float>::max(), &error);
+    if (lod_indices.empty() || lod_indices.size() >= levels_of_detail_.back().num_indices * 0.9) {
+      break;
+    }
+    std::vector<uint32_t> triangle_order = OptimizeVertexCache(lod_indices.data(), lod_indices.size(),
+                                                               mesh_ptr->NumVertices(), settings.vertex_cache_size);
+    LevelOfDetail lod{static_cast<uint32_t>(data.size()), static_cast<uint32_t>(lod_indices.size()),
+                      std::max(error, levels_of_detail_.back().error)};
+    for (uint32_t t : triangle_order) {
+      write_data(&lod_indices[t * 3], sizeof(uint32_t) * 3);
+    }
+    levels_of_detail_.push_back(lod);
+  }
+
+  if (mesh_ptr->NumVertices()) {
+    Vector3<float> center = aabb.Center();
+    float radius = 0.0f;
+    for (size_t i = 0; i < mesh_ptr->NumVertices(); i++) {
+      radius = std::max(radius, (mesh_ptr->Positions()[i] - center).norm());
+    }
+    bounding_sphere_ = glm::vec4{center[0], center[1], center[2], radius};
+  }
+
   std::memcpy(data.data(), &header_, sizeof(header_));
 
   core_->GraphicsCore()->CreateBuffer(data.size(), graphics::BUFFER_TYPE_STATIC, &geometry_buffer_);
@@ -68,4 +181,40 @@ const GeometryMesh::Header &GeometryMesh::GetHeader() const {
   return header_;
 }
 
+const VertexCacheStatistics &GeometryMesh::GetVertexCacheStatisticsBefore() const {
+  return statistics_before_;
+}
+
+const VertexCacheStatistics &GeometryMesh::GetVertexCacheStatisticsAfter() const {
+  return statistics_after_;
+}
+
+const std::vector<GeometryMesh::LevelOfDetail> &GeometryMesh::GetLevelsOfDetail() const {
+  return levels_of_detail_;
+}
+
+const glm::vec4 &GeometryMesh::GetBoundingSphere() const {
+  return bounding_sphere_;
+}
+
+const std::vector<Meshlet> &GeometryMesh::GetMeshlets() const {
+  return meshlets_;
+}
+
+std::vector<glm::vec3> GeometryMesh::DownloadPositions() const {
+  std::vector<glm::vec3> positions(header_.num_vertices);
+  if (!(header_.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_POSITION_UNORM16)) {
+    geometry_buffer_->DownloadData(positions.data(), header_.num_vertices * sizeof(glm::vec3), header_.position_offset);
+    return positions;
+  }
+  std::vector<uint16_t> quantized(header_.num_vertices * 4);
+  geometry_buffer_->DownloadData(quantized.data(), quantized.size() * sizeof(uint16_t), header_.position_offset);
+  for (size_t i = 0; i < header_.num_vertices; i++) {
+    for (int j = 0; j < 3; j++) {
+      positions[i][j] = header_.position_min[j] + header_.position_extent[j] * DequantizeUnorm16(quantized[i * 4 + j]);
+    }
+  }
+  return positions;
+}
+
 }  // namespace sparkium
@@ -3,6 +3,15 @@
 
 namespace sparkium {
 
+typedef enum GeometryAttributeEncoding {
+  GEOMETRY_ATTRIBUTE_ENCODING_FLOAT32 = 0,
+  GEOMETRY_ATTRIBUTE_ENCODING_POSITION_UNORM16 = 1,  // 3x16-bit relative to the mesh AABB, 8 byte stride
+  GEOMETRY_ATTRIBUTE_ENCODING_NORMAL_OCT16 = 2,      // octahedral 2x16-bit, 4 byte stride
+  GEOMETRY_ATTRIBUTE_ENCODING_TANGENT_OCT16 = 4,     // octahedral 2x16-bit, 4 byte stride
+  GEOMETRY_ATTRIBUTE_ENCODING_TEX_COORD_HALF = 8,    // 2x half float, 4 byte stride
+  GEOMETRY_ATTRIBUTE_ENCODING_COMPACT = 15,
+} GeometryAttributeEncoding;
+
 class GeometryMesh : public Geometry {
  public:
   struct Header {
@@ -19,16 +28,60 @@ class GeometryMesh : public Geometry {
     uint32_t signal_offset;
     uint32_t signal_stride;
     uint32_t index_offset;
+    uint32_t attribute_encoding;  // GeometryAttributeEncoding bits
+    float position_min[3];        // position = position_min + position_extent * unorm16
+    float position_extent[3];
+  };
+
+  struct Settings {
+    bool optimize_vertex_order{true};  // vertex cache + overdraw triangle order, then vertex fetch order
+    uint32_t vertex_cache_size{16};
+    float overdraw_threshold{1.05f};
+    uint32_t num_lod_levels{1};  // including the full resolution mesh, 1 disables the LOD chain
+    float lod_reduction{0.5f};   // index count ratio between two consecutive levels
+    uint32_t attribute_encoding{GEOMETRY_ATTRIBUTE_ENCODING_FLOAT32};
+    // Level 0 indices are regrouped so that each meshlet is a contiguous range. This runs after the vertex order
+    // optimization and keeps its order within each meshlet, but not across meshlet borders, see BuildMeshlets.
+    bool build_meshlets{false};
+    uint32_t meshlet_max_vertices{64};
+    uint32_t meshlet_max_triangles{124};
+  };
+
+  struct LevelOfDetail {
+    uint32_t index_offset;
+    uint32_t num_indices;
+    float error;  // geometric deviation from the full resolution mesh, in object space
   };
 
   GeometryMesh(Core *core, const Mesh<float> &mesh);
+  GeometryMesh(Core *core, const Mesh<float> &mesh, const Settings &settings);
 
   int PrimitiveCount() override;
   graphics::Buffer *GetBuffer() const;
   const Header &GetHeader() const;
 
+  // Simulated post-transform cache statistics of the source index stream and of the uploaded one.
+  const VertexCacheStatistics &GetVertexCacheStatisticsBefore() const;
+  const VertexCacheStatistics &GetVertexCacheStatisticsAfter() const;
+
+  // Level 0 is the full resolution mesh described by the header, coarser levels share its vertex streams and only
+  // carry their own index lists. Errors are non-decreasing with the level.
+  const std::vector<LevelOfDetail> &GetLevelsOfDetail() const;
+  const glm::vec4 &GetBoundingSphere() const;  // object space center and radius
+
+  // Empty unless Settings::build_meshlets was set. Bounds are in object space.
+  const std::vector<Meshlet> &GetMeshlets() const;
+
+  // Read back the position stream and decode it to float, whatever the attribute encoding is.
+  std::vector<glm::vec3> DownloadPositions() const;
+
  private:
   Header header_{};
+  VertexCacheStatistics statistics_before_{};
+  VertexCacheStatistics statistics_after_{};
+  std::vector<LevelOfDetail> levels_of_detail_;
+  std::vector<Meshlet> meshlets_;
+  glm::vec4 bounding_sphere_{0.0f};
   std::unique_ptr<graphics::Buffer> geometry_buffer_;
   int primitive_count_;
 };
@@ -7,6 +7,15 @@
 
 namespace sparkium::raster {
 
+namespace {
+
+// Depth ranges of the near field and the far field pass, which meet at kFieldSplit.
+constexpr float kZNear = 0.1f;
+constexpr float kFieldSplit = 100.0f;
+constexpr float kZFar = 10000.0f;
+
+}  // namespace
+
 Camera::Camera(sparkium::Camera &camera) : camera_(camera) {
   core_ = DedicatedCast(camera.GetCore());
   if (core_) {
@@ -26,19 +35,39 @@ graphics::Buffer *Camera::FarFieldBuffer() const {
 
 void Camera::Update() {
   data_.view = camera_.view;
-  data_.proj = glm::perspectiveZO(camera_.fovy, camera_.aspect, 0.1f, 100.0f);
+  data_.proj = glm::perspectiveZO(camera_.fovy, camera_.aspect, kZNear, kFieldSplit);
   data_.view_proj = data_.proj * data_.view;
   data_.inv_view = glm::inverse(data_.view);
   data_.inv_proj = glm::inverse(data_.proj);
   data_.inv_view_proj = glm::inverse(data_.view_proj);
   near_field_buffer_->UploadData(&data_, sizeof(CameraData));
-  data_.proj = glm::perspectiveZO(camera_.fovy, camera_.aspect, 100.0f, 10000.0f);
+  data_.proj = glm::perspectiveZO(camera_.fovy, camera_.aspect, kFieldSplit, kZFar);
   data_.view_proj = data_.proj * data_.view;
   data_.inv_proj = glm::inverse(data_.proj);
   data_.inv_view_proj = glm::inverse(data_.view_proj);
   far_field_buffer_->UploadData(&data_, sizeof(CameraData));
 }
 
+glm::vec3 Camera::Position() const {
+  return glm::inverse(camera_.view)[3];
+}
+
+float Camera::FovY() const {
+  return camera_.fovy;
+}
+
+float Camera::ZNear() const {
+  return kZNear;
+}
+
+float Camera::ZFar() const {
+  return kZFar;
+}
+
+glm::mat4 Camera::ViewProjection(float z_near, float z_far) const {
+  return glm::perspectiveZO(camera_.fovy, camera_.aspect, z_near, z_far) * camera_.view;
+}
+
 Camera *DedicatedCast(sparkium::Camera *camera) {
   COMPONENT_CAST(camera, Camera);
 }
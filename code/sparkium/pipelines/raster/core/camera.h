@@ -18,6 +18,12 @@ class Camera : public Object {
   graphics::Buffer *NearFieldBuffer() const;
   graphics::Buffer *FarFieldBuffer() const;
   void Update();
+  glm::vec3 Position() const;
+  float FovY() const;
+  // Nearest and farthest depth drawn, over both the near field and the far field pass.
+  float ZNear() const;
+  float ZFar() const;
+  glm::mat4 ViewProjection(float z_near, float z_far) const;
 
  private:
   sparkium::Camera &camera_;
@@ -15,4 +15,18 @@ class Entity;
 class Camera;
 class Film;
 
+struct RasterView {
+  glm::vec3 eye{0.0f};
+  float pixels_per_unit{0.0f};  // screen pixels covered by a unit length at unit distance from the eye
+  float lod_pixel_error{0.0f};
+  glm::vec4 frustum_planes[6]{};  // world space, dot(plane, vec4(x, 1)) >= 0 inside
+  bool meshlet_culling{false};
+  bool meshlet_cone_culling{false};
+};
+
+struct DrawRange {
+  uint32_t first_index;
+  uint32_t index_count;
+};
+
 }  // namespace sparkium::raster
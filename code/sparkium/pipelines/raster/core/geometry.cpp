@@ -8,4 +8,12 @@ void Geometry::SetupProgram(graphics::Program *program) {
 void Geometry::DispatchDrawCalls(graphics::CommandContext *cmd_ctx) {
 }
 
+void Geometry::BuildDrawRanges(const glm::mat4x3 &affine, const RasterView &view, std::vector<DrawRange> *ranges) {
+  ranges->clear();
+}
+
+void Geometry::DispatchDrawCalls(graphics::CommandContext *cmd_ctx, const std::vector<DrawRange> &ranges) {
+  DispatchDrawCalls(cmd_ctx);
+}
+
 }  // namespace sparkium::raster
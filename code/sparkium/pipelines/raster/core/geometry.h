@@ -11,6 +11,9 @@ class Geometry : public Object {
   virtual graphics::Shader *VertexShader() = 0;
   virtual void SetupProgram(graphics::Program *program);
   virtual void DispatchDrawCalls(graphics::CommandContext *cmd_ctx);
+  // Per-instance LOD selection and culling, the ranges are then handed back to DispatchDrawCalls.
+  virtual void BuildDrawRanges(const glm::mat4x3 &affine, const RasterView &view, std::vector<DrawRange> *ranges);
+  virtual void DispatchDrawCalls(graphics::CommandContext *cmd_ctx, const std::vector<DrawRange> &ranges);
   virtual glm::vec4 CentricArea(const glm::mat4x3 &affine) = 0;
 
  protected:
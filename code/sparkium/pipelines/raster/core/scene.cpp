@@ -59,6 +59,20 @@ void Scene::Render(Camera *camera, Film *film) {
 
   ambient_light_buffer_->UploadData(&settings.ambient_light, sizeof(glm::vec3));
 
+  view_.eye = camera->Position();
+  view_.pixels_per_unit = static_cast<float>(film->film_.GetHeight()) / (2.0f * std::tan(camera->FovY() * 0.5f));
+  view_.lod_pixel_error = settings.raster.lod_pixel_error;
+  // Covers both the near field and the far field pass. Rows of the transposed view projection give the planes.
+  glm::mat4 view_proj_t = glm::transpose(camera->ViewProjection(camera->ZNear(), camera->ZFar()));
+  view_.frustum_planes[0] = view_proj_t[3] + view_proj_t[0];
+  view_.frustum_planes[1] = view_proj_t[3] - view_proj_t[0];
+  view_.frustum_planes[2] = view_proj_t[3] + view_proj_t[1];
+  view_.frustum_planes[3] = view_proj_t[3] - view_proj_t[1];
+  view_.frustum_planes[4] = view_proj_t[2];
+  view_.frustum_planes[5] = view_proj_t[3] - view_proj_t[2];
+  view_.meshlet_culling = settings.raster.meshlet_culling;
+  view_.meshlet_cone_culling = settings.raster.meshlet_cone_culling;
+
   for (auto &[entity, status] : entities_) {
     if (status.active) {
       entity->Update(this);
@@ -149,6 +163,10 @@ void Scene::RegisterLightingCallback(const std::function<void(graphics::CommandC
   lighting_callbacks_.push_back(callback);
 }
 
+const RasterView &Scene::GetView() const {
+  return view_;
+}
+
 Scene *DedicatedCast(sparkium::Scene *scene) {
   COMPONENT_CAST(scene, Scene);
 }
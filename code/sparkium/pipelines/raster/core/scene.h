@@ -23,6 +23,8 @@ class Scene : public Object {
   void RegisterShadowMapCallback(const std::function<void(graphics::CommandContext *)> &callback);
   void RegisterLightingCallback(const std::function<void(graphics::CommandContext *)> &callback);
 
+  const RasterView &GetView() const;
+
  private:
   sparkium::Scene &scene_;
   Core *core_;
@@ -31,6 +33,8 @@ class Scene : public Object {
   std::vector<std::function<void(graphics::CommandContext *)>> shadow_map_callbacks_;
   std::vector<std::function<void(graphics::CommandContext *)>> lighting_callbacks_;
 
+  RasterView view_{};
+
   std::unique_ptr<graphics::Shader> ambient_light_vs_;
   std::unique_ptr<graphics::Shader> ambient_light_ps_;
   std::unique_ptr<graphics::Program> ambient_light_program_;
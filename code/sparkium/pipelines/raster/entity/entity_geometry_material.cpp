@@ -58,12 +58,13 @@ void EntityGeometryMaterial::Update(Scene *scene) {
   instance_buffer_->UploadData(&instance_data, sizeof(InstanceData));
   material_->Sync();
 
+  geometry_->BuildDrawRanges(entity_.transform, scene->GetView(), &draw_ranges_);
   scene->RegisterRenderCallback([this](graphics::CommandContext *cmd_ctx, graphics::Buffer *camera_buffer) {
     cmd_ctx->CmdBindProgram(render_program_.get());
     cmd_ctx->CmdBindResources(0, {camera_buffer}, graphics::BIND_POINT_GRAPHICS);
     cmd_ctx->CmdBindResources(1, {instance_buffer_.get()}, graphics::BIND_POINT_GRAPHICS);
     material_->BindMaterialResources(cmd_ctx);
-    geometry_->DispatchDrawCalls(cmd_ctx);
+    geometry_->DispatchDrawCalls(cmd_ctx, draw_ranges_);
   });
 
   if (entity_.raster_light) {
@@ -26,6 +26,7 @@ class EntityGeometryMaterial : public Entity {
   Material *material_{};
   std::unique_ptr<graphics::Program> render_program_;
   std::unique_ptr<graphics::Buffer> instance_buffer_;
+  std::vector<DrawRange> draw_ranges_;
 
   std::unique_ptr<graphics::Buffer> point_light_buffer_;
   std::unique_ptr<graphics::Shader> point_light_vs_;
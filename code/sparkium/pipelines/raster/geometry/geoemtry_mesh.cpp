@@ -7,7 +7,7 @@ namespace sparkium::raster {
 GeometryMesh::GeometryMesh(sparkium::GeometryMesh &geometry)
     : geometry_(geometry), Geometry(DedicatedCast(geometry.GetCore())) {
   auto header = geometry_.GetHeader();
-  std::vector<std::string> args;
+  std::vector<std::string> args = {"-I."};
   if (header.normal_offset) {
     args.push_back("-DHAS_NORMAL");
   }
@@ -17,6 +17,22 @@ GeometryMesh::GeometryMesh(sparkium::GeometryMesh &geometry)
   if (header.tangent_offset) {
     args.push_back("-DHAS_TANGENT");
   }
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_POSITION_UNORM16) {
+    args.push_back("-DPOSITION_UNORM16");
+    args.push_back(fmt::format("-DPOSITION_MIN=float3({:.9g},{:.9g},{:.9g})", header.position_min[0],
+                               header.position_min[1], header.position_min[2]));
+    args.push_back(fmt::format("-DPOSITION_EXTENT=float3({:.9g},{:.9g},{:.9g})", header.position_extent[0],
+                               header.position_extent[1], header.position_extent[2]));
+  }
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_NORMAL_OCT16) {
+    args.push_back("-DNORMAL_OCT16");
+  }
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_TEX_COORD_HALF) {
+    args.push_back("-DTEX_COORD_HALF");
+  }
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_TANGENT_OCT16) {
+    args.push_back("-DTANGENT_OCT16");
+  }
   core_->GraphicsCore()->CreateShader(core_->GetShadersVFS(), "geometry/mesh/vertex_shader.hlsl", "VSMain", "vs_6_0",
                                       args, &vertex_shader_);
 }
@@ -27,26 +43,88 @@ graphics::Shader *GeometryMesh::VertexShader() {
 
 void GeometryMesh::SetupProgram(graphics::Program *program) {
   auto &header = geometry_.GetHeader();
+  auto input_type = [&header](GeometryAttributeEncoding encoding, graphics::InputType packed_type,
+                               graphics::InputType float_type) {
+    return (header.attribute_encoding & encoding) ? packed_type : float_type;
+  };
   program->AddInputBinding(header.position_stride);
   int binding = 0;
-  program->AddInputAttribute(binding++, graphics::INPUT_TYPE_FLOAT3, 0);
+  program->AddInputAttribute(
+      binding++,
+      input_type(GEOMETRY_ATTRIBUTE_ENCODING_POSITION_UNORM16, graphics::INPUT_TYPE_UINT2, graphics::INPUT_TYPE_FLOAT3),
+      0);
   if (header.normal_offset) {
     program->AddInputBinding(header.normal_stride);
-    program->AddInputAttribute(binding++, graphics::INPUT_TYPE_FLOAT3, 0);
+    program->AddInputAttribute(
+        binding++,
+        input_type(GEOMETRY_ATTRIBUTE_ENCODING_NORMAL_OCT16, graphics::INPUT_TYPE_UINT, graphics::INPUT_TYPE_FLOAT3),
+        0);
   }
   if (header.tex_coord_offset) {
     program->AddInputBinding(header.tex_coord_stride);
-    program->AddInputAttribute(binding++, graphics::INPUT_TYPE_FLOAT2, 0);
+    program->AddInputAttribute(
+        binding++,
+        input_type(GEOMETRY_ATTRIBUTE_ENCODING_TEX_COORD_HALF, graphics::INPUT_TYPE_UINT, graphics::INPUT_TYPE_FLOAT2),
+        0);
   }
   if (header.tangent_offset) {
     program->AddInputBinding(header.tangent_stride);
-    program->AddInputAttribute(binding++, graphics::INPUT_TYPE_FLOAT3, 0);
+    program->AddInputAttribute(
+        binding++,
+        input_type(GEOMETRY_ATTRIBUTE_ENCODING_TANGENT_OCT16, graphics::INPUT_TYPE_UINT, graphics::INPUT_TYPE_FLOAT3),
+        0);
     program->AddInputBinding(header.signal_stride);
     program->AddInputAttribute(binding, graphics::INPUT_TYPE_FLOAT, 0);
   }
 }
 
 void GeometryMesh::DispatchDrawCalls(graphics::CommandContext *cmd_ctx) {
+  DispatchDrawCalls(cmd_ctx, {{0, geometry_.GetHeader().num_indices}});
+}
+
+void GeometryMesh::BuildDrawRanges(const glm::mat4x3 &affine, const RasterView &view, std::vector<DrawRange> *ranges) {
+  ranges->clear();
+  auto &header = geometry_.GetHeader();
+  int level_of_detail = SelectLevelOfDetail(affine, view);
+  auto &meshlets = geometry_.GetMeshlets();
+  if (level_of_detail || meshlets.empty() || !view.meshlet_culling) {
+    auto &lod = geometry_.GetLevelsOfDetail()[level_of_detail];
+    ranges->push_back({(lod.index_offset - header.index_offset) / static_cast<uint32_t>(sizeof(uint32_t)),
+                       lod.num_indices});
+    return;
+  }
+
+  // Cull in object space: planes map through the transpose of the model matrix, and backfacing is preserved by any
+  // affine map that keeps the orientation.
+  glm::mat4 model{glm::vec4{affine[0], 0.0f}, glm::vec4{affine[1], 0.0f}, glm::vec4{affine[2], 0.0f},
+                  glm::vec4{affine[3], 1.0f}};
+  glm::mat4 model_t = glm::transpose(model);
+  Vector4<float> planes[6];
+  for (int i = 0; i < 6; i++) {
+    glm::vec4 plane = model_t * view.frustum_planes[i];
+    planes[i] = {plane.x, plane.y, plane.z, plane.w};
+  }
+  bool cone_culling = view.meshlet_cone_culling && glm::determinant(glm::mat3{model}) > 0.0f;
+  glm::vec3 eye = glm::inverse(model) * glm::vec4{view.eye, 1.0f};
+  Vector3<float> object_eye{eye.x, eye.y, eye.z};
+
+  for (auto &meshlet : meshlets) {
+    if (!MeshletInFrustum(meshlet, planes, 6) || (cone_culling && MeshletBackfacing(meshlet, object_eye))) {
+      continue;
+    }
+    uint32_t first_index = meshlet.triangle_offset * 3;
+    if (!ranges->empty() && ranges->back().first_index + ranges->back().index_count == first_index) {
+      ranges->back().index_count += meshlet.triangle_count * 3;
+    } else {
+      ranges->push_back({first_index, meshlet.triangle_count * 3});
+    }
+  }
+}
+
+void GeometryMesh::DispatchDrawCalls(graphics::CommandContext *cmd_ctx, const std::vector<DrawRange> &ranges) {
+  if (ranges.empty()) {
+    return;
+  }
   auto &header = geometry_.GetHeader();
   std::vector<graphics::Buffer *> buffers;
   std::vector<uint64_t> offsets;
@@ -69,15 +147,34 @@ void GeometryMesh::DispatchDrawCalls(graphics::CommandContext *cmd_ctx) {
   }
   cmd_ctx->CmdBindVertexBuffers(0, buffers, offsets);
   cmd_ctx->CmdBindIndexBuffer(geometry_.GetBuffer(), header.index_offset);
-  cmd_ctx->CmdDrawIndexed(geometry_.PrimitiveCount() * 3, 1, 0, 0, 0);
+  for (auto &range : ranges) {
+    cmd_ctx->CmdDrawIndexed(range.index_count, 1, range.first_index, 0, 0);
+  }
+}
+
+int GeometryMesh::SelectLevelOfDetail(const glm::mat4x3 &affine, const RasterView &view) const {
+  auto &levels = geometry_.GetLevelsOfDetail();
+  if (levels.size() < 2 || view.lod_pixel_error <= 0.0f) {
+    return 0;
+  }
+  glm::vec4 sphere = geometry_.GetBoundingSphere();
+  float scale = glm::max(glm::length(affine[0]), glm::max(glm::length(affine[1]), glm::length(affine[2])));
+  glm::vec3 center = affine * glm::vec4{glm::vec3{sphere}, 1.0f};
+  // Conservative: the error is projected at the closest point of the bounding sphere.
+  float distance = glm::max(glm::length(center - view.eye) - sphere.w * scale, 0.1f);
+  float pixels_per_object_unit = view.pixels_per_unit * scale / distance;
+  for (int level = static_cast<int>(levels.size()) - 1; level > 0; level--) {
+    if (levels[level].error * pixels_per_object_unit <= view.lod_pixel_error) {
+      return level;
+    }
+  }
+  return 0;
 }
 
 glm::vec4 GeometryMesh::CentricArea(const glm::mat4x3 &affine) {
   glm::vec3 centric{0.0f};
   auto header = geometry_.GetHeader();
-  std::vector<glm::vec3> positions(header.num_vertices);
-  geometry_.GetBuffer()->DownloadData(positions.data(), header.num_vertices * sizeof(glm::vec3),
-                                      header.position_offset);
+  std::vector<glm::vec3> positions = geometry_.DownloadPositions();
   std::vector<uint32_t> indices(header.num_indices);
   geometry_.GetBuffer()->DownloadData(indices.data(), header.num_indices * sizeof(uint32_t), header.index_offset);
   float total_area = 0.0f;
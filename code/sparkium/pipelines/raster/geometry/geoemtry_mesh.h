@@ -9,9 +9,13 @@ class GeometryMesh : public Geometry {
   graphics::Shader *VertexShader() override;
   void SetupProgram(graphics::Program *program) override;
   void DispatchDrawCalls(graphics::CommandContext *cmd_ctx) override;
+  void BuildDrawRanges(const glm::mat4x3 &affine, const RasterView &view, std::vector<DrawRange> *ranges) override;
+  void DispatchDrawCalls(graphics::CommandContext *cmd_ctx, const std::vector<DrawRange> &ranges) override;
   glm::vec4 CentricArea(const glm::mat4x3 &affine) override;
 
  private:
+  int SelectLevelOfDetail(const glm::mat4x3 &affine, const RasterView &view) const;
+
   sparkium::GeometryMesh &geometry_;
   std::unique_ptr<graphics::Shader> vertex_shader_;
 };
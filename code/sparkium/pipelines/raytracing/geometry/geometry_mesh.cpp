@@ -8,10 +8,21 @@ GeometryMesh::GeometryMesh(sparkium::GeometryMesh &geometry)
     : geometry_(geometry), Geometry(DedicatedCast(geometry.GetCore())) {
   auto header = geometry_.GetHeader();
 
-  core_->GraphicsCore()->CreateBottomLevelAccelerationStructure(
-      geometry_.GetBuffer()->Range(header.position_offset), geometry_.GetBuffer()->Range(header.index_offset),
-      header.num_vertices, header.position_stride, header.num_indices / 3, graphics::RAYTRACING_GEOMETRY_FLAG_NONE,
-      &blas_);
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_POSITION_UNORM16) {
+    // The acceleration structure builder only reads float positions, the hit group decodes the same values.
+    std::vector<glm::vec3> positions = geometry_.DownloadPositions();
+    core_->GraphicsCore()->CreateBuffer(positions.size() * sizeof(glm::vec3), graphics::BUFFER_TYPE_STATIC,
+                                        &blas_position_buffer_);
+    blas_position_buffer_->UploadData(positions.data(), positions.size() * sizeof(glm::vec3));
+    core_->GraphicsCore()->CreateBottomLevelAccelerationStructure(
+        blas_position_buffer_->Range(0), geometry_.GetBuffer()->Range(header.index_offset), header.num_vertices,
+        sizeof(glm::vec3), header.num_indices / 3, graphics::RAYTRACING_GEOMETRY_FLAG_NONE, &blas_);
+  } else {
+    core_->GraphicsCore()->CreateBottomLevelAccelerationStructure(
+        geometry_.GetBuffer()->Range(header.position_offset), geometry_.GetBuffer()->Range(header.index_offset),
+        header.num_vertices, header.position_stride, header.num_indices / 3, graphics::RAYTRACING_GEOMETRY_FLAG_NONE,
+        &blas_);
+  }
 
   auto &vfs = core_->GetShadersVFS();
   sampler_implementation_ = CodeLines(vfs, "geometry/mesh/geometry_sampler.hlsli");
@@ -19,6 +19,9 @@ class GeometryMesh : public Geometry {
     uint32_t signal_offset;
     uint32_t signal_stride;
     uint32_t index_offset;
+    uint32_t attribute_encoding;
+    float position_min[3];
+    float position_extent[3];
   };
 
   GeometryMesh(sparkium::GeometryMesh &geometry);
@@ -32,6 +35,7 @@ class GeometryMesh : public Geometry {
  private:
   sparkium::GeometryMesh &geometry_;
   std::unique_ptr<graphics::AccelerationStructure> blas_;
+  std::unique_ptr<graphics::Buffer> blas_position_buffer_;  // decoded float positions for quantized meshes
   CodeLines sampler_implementation_;
   CodeLines closest_hit_shader_implementation_;
 };
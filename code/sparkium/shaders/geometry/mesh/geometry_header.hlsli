@@ -1,4 +1,10 @@
 #pragma once
+
+#define GEOMETRY_ATTRIBUTE_ENCODING_POSITION_UNORM16 1
+#define GEOMETRY_ATTRIBUTE_ENCODING_NORMAL_OCT16 2
+#define GEOMETRY_ATTRIBUTE_ENCODING_TANGENT_OCT16 4
+#define GEOMETRY_ATTRIBUTE_ENCODING_TEX_COORD_HALF 8
+
 struct GeometryHeader {
   uint num_vertices;
   uint num_indices;
@@ -13,4 +19,83 @@ struct GeometryHeader {
   uint signal_offset;
   uint signal_stride;
   uint index_offset;
+  uint attribute_encoding;
+  float3 position_min;
+  float3 position_extent;
 };
+
+template <class BufferType>
+GeometryHeader LoadGeometryHeader(BufferType buf) {
+  GeometryHeader header;
+  header.num_vertices = buf.Load(0);
+  header.num_indices = buf.Load(4);
+  header.position_offset = buf.Load(8);
+  header.position_stride = buf.Load(12);
+  header.normal_offset = buf.Load(16);
+  header.normal_stride = buf.Load(20);
+  header.tex_coord_offset = buf.Load(24);
+  header.tex_coord_stride = buf.Load(28);
+  header.tangent_offset = buf.Load(32);
+  header.tangent_stride = buf.Load(36);
+  header.signal_offset = buf.Load(40);
+  header.signal_stride = buf.Load(44);
+  header.index_offset = buf.Load(48);
+  header.attribute_encoding = buf.Load(52);
+  header.position_min = asfloat(buf.Load3(56));
+  header.position_extent = asfloat(buf.Load3(68));
+  return header;
+}
+
+float3 DecodePositionUnorm16(uint2 packed, float3 position_min, float3 position_extent) {
+  float3 t = float3(packed.x & 0xffff, packed.x >> 16, packed.y & 0xffff) * (1.0 / 65535.0);
+  return position_min + position_extent * t;
+}
+
+float3 DecodeOctahedral16(uint packed) {
+  float2 e = float2(packed & 0xffff, packed >> 16) * (2.0 / 65535.0) - 1.0;
+  float3 v = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+  float t = saturate(-v.z);
+  v.x += v.x >= 0.0 ? -t : t;
+  v.y += v.y >= 0.0 ? -t : t;
+  return normalize(v);
+}
+
+float2 DecodeHalf2(uint packed) {
+  return float2(f16tof32(packed & 0xffff), f16tof32(packed >> 16));
+}
+
+template <class BufferType>
+float3 LoadMeshPosition(BufferType buf, GeometryHeader header, uint vid) {
+  uint offset = header.position_offset + header.position_stride * vid;
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_POSITION_UNORM16) {
+    return DecodePositionUnorm16(buf.Load2(offset), header.position_min, header.position_extent);
+  }
+  return asfloat(buf.Load3(offset));
+}
+
+template <class BufferType>
+float3 LoadMeshNormal(BufferType buf, GeometryHeader header, uint vid) {
+  uint offset = header.normal_offset + header.normal_stride * vid;
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_NORMAL_OCT16) {
+    return DecodeOctahedral16(buf.Load(offset));
+  }
+  return asfloat(buf.Load3(offset));
+}
+
+template <class BufferType>
+float2 LoadMeshTexCoord(BufferType buf, GeometryHeader header, uint vid) {
+  uint offset = header.tex_coord_offset + header.tex_coord_stride * vid;
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_TEX_COORD_HALF) {
+    return DecodeHalf2(buf.Load(offset));
+  }
+  return asfloat(buf.Load2(offset));
+}
+
+template <class BufferType>
+float3 LoadMeshTangent(BufferType buf, GeometryHeader header, uint vid) {
+  uint offset = header.tangent_offset + header.tangent_stride * vid;
+  if (header.attribute_encoding & GEOMETRY_ATTRIBUTE_ENCODING_TANGENT_OCT16) {
+    return DecodeOctahedral16(buf.Load(offset));
+  }
+  return asfloat(buf.Load3(offset));
+}
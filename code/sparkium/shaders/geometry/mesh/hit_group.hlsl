@@ -8,27 +8,13 @@
                                              in BuiltInTriangleIntersectionAttributes attr) {
   HitRecord hit_record;
   BufferReference<ByteAddressBuffer> geometry_buffer = MakeBufferReference(data_buffers[InstanceID()], 0);
-  GeometryHeader header;
-  header.num_vertices = geometry_buffer.Load(0);
-  header.num_indices = geometry_buffer.Load(4);
-  header.position_offset = geometry_buffer.Load(8);
-  header.position_stride = geometry_buffer.Load(12);
-  header.normal_offset = geometry_buffer.Load(16);
-  header.normal_stride = geometry_buffer.Load(20);
-  header.tex_coord_offset = geometry_buffer.Load(24);
-  header.tex_coord_stride = geometry_buffer.Load(28);
-  header.tangent_offset = geometry_buffer.Load(32);
-  header.tangent_stride = geometry_buffer.Load(36);
-  header.signal_offset = geometry_buffer.Load(40);
-  header.signal_stride = geometry_buffer.Load(44);
-  header.index_offset = geometry_buffer.Load(48);
+  GeometryHeader header = LoadGeometryHeader(geometry_buffer);
 
   uint3 vid;
   vid = geometry_buffer.Load3(header.index_offset + PrimitiveIndex() * 3 * 4);
 
-  float3 pos[3] = {LoadFloat3(geometry_buffer, header.position_offset + header.position_stride * vid[0]),
-                   LoadFloat3(geometry_buffer, header.position_offset + header.position_stride * vid[1]),
-                   LoadFloat3(geometry_buffer, header.position_offset + header.position_stride * vid[2])};
+  float3 pos[3] = {LoadMeshPosition(geometry_buffer, header, vid[0]), LoadMeshPosition(geometry_buffer, header, vid[1]),
+                   LoadMeshPosition(geometry_buffer, header, vid[2])};
 
   float3 barycentrics =
       float3(1.0 - attr.barycentrics.x - attr.barycentrics.y, attr.barycentrics.x, attr.barycentrics.y);
@@ -41,9 +27,9 @@
 
   if (header.normal_offset != 0) {
     hit_record.normal =
-        LoadFloat3(geometry_buffer, header.normal_offset + header.normal_stride * vid[0]) * barycentrics[0] +
-        LoadFloat3(geometry_buffer, header.normal_offset + header.normal_stride * vid[1]) * barycentrics[1] +
-        LoadFloat3(geometry_buffer, header.normal_offset + header.normal_stride * vid[2]) * barycentrics[2];
+        LoadMeshNormal(geometry_buffer, header, vid[0]) * barycentrics[0] +
+        LoadMeshNormal(geometry_buffer, header, vid[1]) * barycentrics[1] +
+        LoadMeshNormal(geometry_buffer, header, vid[2]) * barycentrics[2];
     hit_record.normal = normalize(mul(WorldToObject4x3(), hit_record.normal).xyz);
   } else {
     hit_record.normal = hit_record.geom_normal;
@@ -51,18 +37,18 @@
   // normal transformation need to multiply inverse transpose of the object to world matrix
   if (header.tex_coord_offset != 0) {
     hit_record.tex_coord =
-        LoadFloat2(geometry_buffer, header.tex_coord_offset + header.tex_coord_stride * vid[0]) * barycentrics[0] +
-        LoadFloat2(geometry_buffer, header.tex_coord_offset + header.tex_coord_stride * vid[1]) * barycentrics[1] +
-        LoadFloat2(geometry_buffer, header.tex_coord_offset + header.tex_coord_stride * vid[2]) * barycentrics[2];
+        LoadMeshTexCoord(geometry_buffer, header, vid[0]) * barycentrics[0] +
+        LoadMeshTexCoord(geometry_buffer, header, vid[1]) * barycentrics[1] +
+        LoadMeshTexCoord(geometry_buffer, header, vid[2]) * barycentrics[2];
   } else {
     hit_record.tex_coord = float2(0.0, 0.0);
   }
 
   if (header.tangent_offset != 0) {
     hit_record.tangent =
-        LoadFloat3(geometry_buffer, header.tangent_offset + header.tangent_stride * vid[0]) * barycentrics[0] +
-        LoadFloat3(geometry_buffer, header.tangent_offset + header.tangent_stride * vid[1]) * barycentrics[1] +
-        LoadFloat3(geometry_buffer, header.tangent_offset + header.tangent_stride * vid[2]) * barycentrics[2];
+        LoadMeshTangent(geometry_buffer, header, vid[0]) * barycentrics[0] +
+        LoadMeshTangent(geometry_buffer, header, vid[1]) * barycentrics[1] +
+        LoadMeshTangent(geometry_buffer, header, vid[2]) * barycentrics[2];
     hit_record.tangent = normalize(mul(ObjectToWorld3x4(), float4(hit_record.tangent, 0.0)).xyz);
   } else {
     hit_record.tangent = cross(hit_record.normal, float3(0.0, 0.0, 1.0));
@@ -102,27 +88,13 @@
 #else
   HitRecord hit_record;
   BufferReference<ByteAddressBuffer> geometry_buffer = MakeBufferReference(data_buffers[InstanceID()], 0);
-  GeometryHeader header;
-  header.num_vertices = geometry_buffer.Load(0);
-  header.num_indices = geometry_buffer.Load(4);
-  header.position_offset = geometry_buffer.Load(8);
-  header.position_stride = geometry_buffer.Load(12);
-  header.normal_offset = geometry_buffer.Load(16);
-  header.normal_stride = geometry_buffer.Load(20);
-  header.tex_coord_offset = geometry_buffer.Load(24);
-  header.tex_coord_stride = geometry_buffer.Load(28);
-  header.tangent_offset = geometry_buffer.Load(32);
-  header.tangent_stride = geometry_buffer.Load(36);
-  header.signal_offset = geometry_buffer.Load(40);
-  header.signal_stride = geometry_buffer.Load(44);
-  header.index_offset = geometry_buffer.Load(48);
+  GeometryHeader header = LoadGeometryHeader(geometry_buffer);
 
   uint3 vid;
   vid = geometry_buffer.Load3(header.index_offset + PrimitiveIndex() * 3 * 4);
 
-  float3 pos[3] = {LoadFloat3(geometry_buffer, header.position_offset + header.position_stride * vid[0]),
-                   LoadFloat3(geometry_buffer, header.position_offset + header.position_stride * vid[1]),
-                   LoadFloat3(geometry_buffer, header.position_offset + header.position_stride * vid[2])};
+  float3 pos[3] = {LoadMeshPosition(geometry_buffer, header, vid[0]), LoadMeshPosition(geometry_buffer, header, vid[1]),
+                   LoadMeshPosition(geometry_buffer, header, vid[2])};
 
   float3 barycentrics =
       float3(1.0 - attr.barycentrics.x - attr.barycentrics.y, attr.barycentrics.x, attr.barycentrics.y);
@@ -135,9 +107,9 @@
 
   if (header.normal_offset != 0) {
     hit_record.normal =
-        LoadFloat3(geometry_buffer, header.normal_offset + header.normal_stride * vid[0]) * barycentrics[0] +
-        LoadFloat3(geometry_buffer, header.normal_offset + header.normal_stride * vid[1]) * barycentrics[1] +
-        LoadFloat3(geometry_buffer, header.normal_offset + header.normal_stride * vid[2]) * barycentrics[2];
+        LoadMeshNormal(geometry_buffer, header, vid[0]) * barycentrics[0] +
+        LoadMeshNormal(geometry_buffer, header, vid[1]) * barycentrics[1] +
+        LoadMeshNormal(geometry_buffer, header, vid[2]) * barycentrics[2];
     hit_record.normal = normalize(mul(WorldToObject4x3(), hit_record.normal).xyz);
   } else {
     hit_record.normal = hit_record.geom_normal;
@@ -145,18 +117,18 @@
   // normal transformation need to multiply inverse transpose of the object to world matrix
   if (header.tex_coord_offset != 0) {
     hit_record.tex_coord =
-        LoadFloat2(geometry_buffer, header.tex_coord_offset + header.tex_coord_stride * vid[0]) * barycentrics[0] +
-        LoadFloat2(geometry_buffer, header.tex_coord_offset + header.tex_coord_stride * vid[1]) * barycentrics[1] +
-        LoadFloat2(geometry_buffer, header.tex_coord_offset + header.tex_coord_stride * vid[2]) * barycentrics[2];
+        LoadMeshTexCoord(geometry_buffer, header, vid[0]) * barycentrics[0] +
+        LoadMeshTexCoord(geometry_buffer, header, vid[1]) * barycentrics[1] +
+        LoadMeshTexCoord(geometry_buffer, header, vid[2]) * barycentrics[2];
   } else {
     hit_record.tex_coord = float2(0.0, 0.0);
   }
 
   if (header.tangent_offset != 0) {
     hit_record.tangent =
-        LoadFloat3(geometry_buffer, header.tangent_offset + header.tangent_stride * vid[0]) * barycentrics[0] +
-        LoadFloat3(geometry_buffer, header.tangent_offset + header.tangent_stride * vid[1]) * barycentrics[1] +
-        LoadFloat3(geometry_buffer, header.tangent_offset + header.tangent_stride * vid[2]) * barycentrics[2];
+        LoadMeshTangent(geometry_buffer, header, vid[0]) * barycentrics[0] +
+        LoadMeshTangent(geometry_buffer, header, vid[1]) * barycentrics[1] +
+        LoadMeshTangent(geometry_buffer, header, vid[2]) * barycentrics[2];
     hit_record.tangent = normalize(mul(ObjectToWorld3x4(), float4(hit_record.tangent, 0.0)).xyz);
   } else {
     hit_record.tangent = float3(0.0, 0.0, 0.0);
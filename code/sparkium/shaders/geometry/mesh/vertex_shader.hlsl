@@ -1,20 +1,54 @@
+#include "geometry/mesh/geometry_header.hlsli"
+
+#if defined(POSITION_UNORM16)
+#define POSITION_TYPE uint2
+#define DECODE_POSITION(p) DecodePositionUnorm16(p, POSITION_MIN, POSITION_EXTENT)
+#else
+#define POSITION_TYPE float3
+#define DECODE_POSITION(p) (p)
+#endif
+
+#if defined(NORMAL_OCT16)
+#define NORMAL_TYPE uint
+#define DECODE_NORMAL(n) DecodeOctahedral16(n)
+#else
+#define NORMAL_TYPE float3
+#define DECODE_NORMAL(n) (n)
+#endif
+
+#if defined(TEX_COORD_HALF)
+#define TEX_COORD_TYPE uint
+#define DECODE_TEX_COORD(uv) DecodeHalf2(uv)
+#else
+#define TEX_COORD_TYPE float2
+#define DECODE_TEX_COORD(uv) (uv)
+#endif
+
+#if defined(TANGENT_OCT16)
+#define TANGENT_TYPE uint
+#define DECODE_TANGENT(t) DecodeOctahedral16(t)
+#else
+#define TANGENT_TYPE float3
+#define DECODE_TANGENT(t) (t)
+#endif
+
 struct VSInput {
-  [[vk::location(0)]] float3 position : TEXCOORD0;
+  [[vk::location(0)]] POSITION_TYPE position : TEXCOORD0;
 #if defined(HAS_NORMAL)
-  [[vk::location(1)]] float3 normal : TEXCOORD1;
+  [[vk::location(1)]] NORMAL_TYPE normal : TEXCOORD1;
 
 #if defined(HAS_TEXCOORD)
-  [[vk::location(2)]] float2 tex_coord : TEXCOORD2;
+  [[vk::location(2)]] TEX_COORD_TYPE tex_coord : TEXCOORD2;
 
 #if defined(HAS_TANGENT)
-  [[vk::location(3)]] float3 tangent : TEXCOORD3;
+  [[vk::location(3)]] TANGENT_TYPE tangent : TEXCOORD3;
   [[vk::location(4)]] float signal : TEXCOORD4;
 #endif
 
 #else
 
 #if defined(HAS_TANGENT)
-  [[vk::location(2)]] float3 tangent : TEXCOORD2;
+  [[vk::location(2)]] TANGENT_TYPE tangent : TEXCOORD2;
   [[vk::location(3)]] float signal : TEXCOORD3;
 #endif
 
@@ -23,17 +57,17 @@ struct VSInput {
 #else
 
 #if defined(HAS_TEXCOORD)
-  [[vk::location(1)]] float2 tex_coord : TEXCOORD1;
+  [[vk::location(1)]] TEX_COORD_TYPE tex_coord : TEXCOORD1;
 
 #if defined(HAS_TANGENT)
-  [[vk::location(2)]] float3 tangent : TEXCOORD2;
+  [[vk::location(2)]] TANGENT_TYPE tangent : TEXCOORD2;
   [[vk::location(3)]] float signal : TEXCOORD3;
 #endif
 
 #else
 
 #if defined(HAS_TANGENT)
-  [[vk::location(1)]] float3 tangent : TEXCOORD1;
+  [[vk::location(1)]] TANGENT_TYPE tangent : TEXCOORD1;
   [[vk::location(2)]] float signal : TEXCOORD2;
 #endif
 
@@ -71,19 +105,19 @@ ConstantBuffer<GeometryData> geometry_data : register(b0, space1);
 
 VSOutput VSMain(VSInput input) {
   VSOutput output;
-  output.world_position = mul(geometry_data.model, float4(input.position, 1.0)).xyz;
+  output.world_position = mul(geometry_data.model, float4(DECODE_POSITION(input.position), 1.0)).xyz;
 #if defined(HAS_NORMAL)
-  output.world_normal = normalize(mul(geometry_data.normal_matrix, float4(input.normal, 0)).xyz);
+  output.world_normal = normalize(mul(geometry_data.normal_matrix, float4(DECODE_NORMAL(input.normal), 0)).xyz);
 #else
   output.world_normal = float3(0, 0, 0);
 #endif
 #if defined(HAS_TEXCOORD)
-  output.tex_coord = input.tex_coord;
+  output.tex_coord = DECODE_TEX_COORD(input.tex_coord);
 #else
   output.tex_coord = float2(0, 0);
 #endif
 #if defined(HAS_TANGENT)
-  output.tangent = normalize(mul(geometry_data.model, float4(input.tangent, 0)).xyz);
+  output.tangent = normalize(mul(geometry_data.model, float4(DECODE_TANGENT(input.tangent), 0)).xyz);
   output.signal = input.signal;
 #else
   output.tangent = float3(0, 0, 0);
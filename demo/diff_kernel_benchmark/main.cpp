@@ -0,0 +1,122 @@
+#include <long_march.h>
+
+#include <chrono>
+#include <random>
+
+using namespace long_march;
+
+namespace {
+
+template <typename Func, typename Setup>
+void GenerateElements(Setup setup,
+                      size_t num_elements,
+                      std::vector<Func> *functions,
+                      std::vector<typename Func::InputType> *inputs) {
+  using Real = typename Func::Scalar;
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<Real> dis(-0.2, 0.2);
+  functions->resize(num_elements);
+  inputs->resize(num_elements);
+  for (size_t i = 0; i < num_elements; i++) {
+    setup(&(*functions)[i], gen);
+    // Vertex 0 at the origin and vertex k on the k-th axis, jittered, keeps every element well shaped.
+    for (int v = 0; v < Func::InputType::ColsAtCompileTime; v++) {
+      for (int k = 0; k < Func::InputType::RowsAtCompileTime; k++) {
+        (*inputs)[i](k, v) = (v == k + 1 ? Real(1) : Real(0)) + dis(gen);
+      }
+    }
+  }
+}
+
+template <typename Body>
+double NanosecondsPerElement(Body body, size_t num_elements, int num_rounds) {
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < num_rounds; round++) {
+    for (size_t i = 0; i < num_elements; i++) {
+      body(i);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return seconds * 1e9 / (static_cast<double>(num_elements) * num_rounds);
+}
+
+template <typename Func, typename Setup>
+void BenchmarkHessian(const char *name, Setup setup, size_t num_elements = 1 << 14, int num_rounds = 8) {
+  using Real = typename Func::Scalar;
+  std::vector<Func> functions;
+  std::vector<typename Func::InputType> inputs;
+  GenerateElements(setup, num_elements, &functions, &inputs);
+
+  Real checksum = 0;
+  double ns_per_element = NanosecondsPerElement(
+      [&](size_t i) { checksum += functions[i].Hessian(inputs[i]).m[0](0, 0); }, num_elements, num_rounds);
+  std::printf("%-48s %10.1f ns/Hessian  (checksum %g)\n", name, ns_per_element, static_cast<double>(checksum));
+}
+
+// Value, Jacobian and Hessian through three separate calls against a single fused EvaluateAll.
+template <typename Func, typename Setup>
+void BenchmarkEvaluateAll(const char *name, Setup setup, size_t num_elements = 1 << 14, int num_rounds = 8) {
+  using Real = typename Func::Scalar;
+  std::vector<Func> functions;
+  std::vector<typename Func::InputType> inputs;
+  GenerateElements(setup, num_elements, &functions, &inputs);
+
+  Real checksum_separate = 0;
+  double ns_separate = NanosecondsPerElement(
+      [&](size_t i) {
+        auto value = functions[i](inputs[i]);
+        auto J = functions[i].Jacobian(inputs[i]);
+        auto H = functions[i].Hessian(inputs[i]);
+        checksum_separate += value.data()[0] + J(0, 0) + H.m[0](0, 0);
+      },
+      num_elements, num_rounds);
+
+  Real checksum_fused = 0;
+  double ns_fused = NanosecondsPerElement(
+      [&](size_t i) {
+        typename Func::OutputType value;
+        JacobianType<Func> J;
+        HessianType<Func> H;
+        EvaluateAll(functions[i], inputs[i], &value, &J, &H);
+        checksum_fused += value.data()[0] + J(0, 0) + H.m[0](0, 0);
+      },
+      num_elements, num_rounds);
+
+  std::printf("%-48s %10.1f ns separate %10.1f ns fused  (checksum %g / %g)\n", name, ns_separate, ns_fused,
+              static_cast<double>(checksum_separate), static_cast<double>(checksum_fused));
+}
+
+template <typename Real>
+void RunBenchmarks(const char *real_name) {
+  std::printf("-- %s\n", real_name);
+  auto no_setup = [](auto *, std::mt19937 &) {};
+  auto triangle_setup = [](auto *function, std::mt19937 &gen) {
+    std::uniform_real_distribution<Real> dis(0.5, 1.5);
+    function->Dm << dis(gen), 0, 0, dis(gen);
+  };
+  auto tetrahedron_setup = [](auto *function, std::mt19937 &gen) {
+    std::uniform_real_distribution<Real> dis(0.5, 1.5);
+    function->Dm = Eigen::Matrix3<Real>::Identity() * dis(gen);
+  };
+  BenchmarkHessian<DihedralAngleByVertices<Real>>("DihedralAngleByVertices", no_setup);
+  BenchmarkHessian<DihedralEnergy<Real>>("DihedralEnergy", no_setup);
+  BenchmarkHessian<DihedralAngle<Real>>("DihedralAngle (closed form)", no_setup);
+  BenchmarkHessian<ElasticNeoHookeanSimpleTriangle<Real>>("ElasticNeoHookeanSimpleTriangle", triangle_setup);
+  BenchmarkHessian<ElasticNeoHookeanTriangle<Real>>("ElasticNeoHookeanTriangle", triangle_setup);
+  BenchmarkHessian<ElasticNeoHookeanSimpleTetrahedron<Real>>("ElasticNeoHookeanSimpleTetrahedron", tetrahedron_setup);
+  BenchmarkHessian<ElasticNeoHookeanTetrahedron<Real>>("ElasticNeoHookeanTetrahedron", tetrahedron_setup);
+
+  std::printf("-- %s, value + Jacobian + Hessian\n", real_name);
+  BenchmarkEvaluateAll<DihedralAngleByVertices<Real>>("DihedralAngleByVertices", no_setup);
+  BenchmarkEvaluateAll<DihedralEnergy<Real>>("DihedralEnergy", no_setup);
+  BenchmarkEvaluateAll<CrossNormalized<Real>>("CrossNormalized", no_setup);
+  // No fused path, both columns go through the same separate calls.
+  BenchmarkEvaluateAll<ElasticNeoHookeanSimpleTriangle<Real>>("ElasticNeoHookeanSimpleTriangle", triangle_setup);
+}
+
+}  // namespace
+
+int main() {
+  RunBenchmarks<float>("float");
+  RunBenchmarks<double>("double");
+}
@@ -0,0 +1,172 @@
+#include <long_march.h>
+
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <random>
+
+using namespace long_march;
+
+namespace {
+
+// Grid cloth in the y = 1 plane with its vertices displaced off the rest shape, so the first steps have to recover it.
+// The library builds it, so the benchmark measures the cloth the tests check with BuildClothScene(n, perturbation,
+// 0.05f).
+solver::Scene BuildClothScene(int n, float perturbation) {
+  solver::Scene scene;
+  scene.AddObject(solver::ObjectPack::CreateSquareCloth(n, 0.05f, Vector3<float>{0.0f, 1.0f, 0.0f}, perturbation));
+  return scene;
+}
+
+// The same cloth as a triangle mesh. With shuffled, its vertices are stored in random order, as a stand-in for meshes
+// whose vertex order has nothing to do with their connectivity.
+solver::Scene BuildMeshClothScene(int n, float perturbation, bool shuffled) {
+  std::vector<uint32_t> shuffle(n * n);
+  std::iota(shuffle.begin(), shuffle.end(), 0);
+  if (shuffled) {
+    std::mt19937 rng(1);
+    std::shuffle(shuffle.begin(), shuffle.end(), rng);
+  }
+  std::vector<Vector3<float>> positions(n * n);
+  for (int i = 0; i < n * n; i++) {
+    positions[shuffle[i]] = Vector3<float>{i / n * 0.05f, 1.0f + perturbation * std::sin(1.7f * i), i % n * 0.05f};
+  }
+  std::vector<uint32_t> indices;
+  for (int i = 0; i + 1 < n; i++) {
+    for (int j = 0; j + 1 < n; j++) {
+      uint32_t v00 = shuffle[i * n + j], v01 = shuffle[i * n + j + 1];
+      uint32_t v10 = shuffle[(i + 1) * n + j], v11 = shuffle[(i + 1) * n + j + 1];
+      indices.insert(indices.end(), {v00, v10, v01, v01, v10, v11});
+    }
+  }
+  solver::Scene scene;
+  scene.AddObject(solver::ObjectPack::CreateFromMesh(positions, indices));
+  return scene;
+}
+
+// Time per step at a fixed sweep count, so only the memory access pattern differs between orderings.
+void BenchmarkOrdering(const char *name,
+                       const solver::Scene &scene,
+                       solver::ParticleOrdering ordering,
+                       ThreadPool *thread_pool,
+                       int num_steps,
+                       float dt) {
+  solver::SceneHost scene_host(scene, thread_pool, ordering);
+  solver::SceneHost::Update(scene_host, dt);
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < num_steps; step++) {
+    solver::SceneHost::Update(scene_host, dt);
+  }
+  double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::printf("%-32s %8.2f ms/step\n", name, milliseconds / num_steps);
+}
+
+// Sweeps needed to bring every step of a short simulation to a fixed residual.
+void BenchmarkIterations(const char *name,
+                         const solver::Scene &scene,
+                         const solver::SolverSettings &settings,
+                         ThreadPool *thread_pool,
+                         int num_steps,
+                         float dt) {
+  solver::SceneHost scene_host(scene, thread_pool);
+  scene_host.SetSolverSettings(settings);
+  int total_iterations = 0;
+  int max_iterations = 0;
+  int restarts = 0;
+  int unconverged_steps = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < num_steps; step++) {
+    solver::SceneHost::Update(scene_host, dt);
+    const solver::SolverStatistics &statistics = scene_host.GetSolverStatistics();
+    total_iterations += statistics.iterations;
+    max_iterations = std::max(max_iterations, statistics.iterations);
+    restarts += statistics.restarts;
+    unconverged_steps += statistics.residual < settings.tolerance ? 0 : 1;
+  }
+  double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::printf("%-32s %8.1f sweeps/step  %4d max  %4d restarts  %3d unconverged  %8.2f ms/step  (rho %.3f)\n", name,
+              static_cast<double>(total_iterations) / num_steps, max_iterations, restarts, unconverged_steps,
+              milliseconds / num_steps, scene_host.GetSolverStatistics().spectral_radius);
+}
+
+// Throughput of num_environments copies of a small scene, stepped as separate scene hosts, as SceneHost::UpdateBatch
+// over those scene hosts, and as one SceneHostBatch.
+void BenchmarkEnvironments(const solver::Scene &scene,
+                           int num_environments,
+                           ThreadPool *thread_pool,
+                           int num_steps,
+                           float dt) {
+  std::vector<std::unique_ptr<solver::SceneHost>> scene_hosts;
+  std::vector<solver::SceneHost *> scene_host_pointers;
+  for (int e = 0; e < num_environments; e++) {
+    scene_hosts.push_back(std::make_unique<solver::SceneHost>(scene, thread_pool));
+    scene_host_pointers.push_back(scene_hosts.back().get());
+  }
+  solver::SceneHostBatch batch(scene, num_environments, thread_pool);
+  auto report = [&](const char *name, auto &&step) {
+    step();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_steps; i++) {
+      step();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-32s %10.0f env-steps/s\n", name, num_environments * num_steps / seconds);
+  };
+  report("separate, batch iterations", [&] {
+    for (solver::SceneHost *scene_host : scene_host_pointers) {
+      solver::SceneHost::UpdateBatch({scene_host}, dt);
+    }
+  });
+  report("SceneHost::UpdateBatch", [&] { solver::SceneHost::UpdateBatch(scene_host_pointers, dt); });
+  report("SceneHostBatch", [&] { solver::SceneHostBatch::Update(batch, dt); });
+}
+
+}  // namespace
+
+int main() {
+  const int n = 32;
+  const int num_steps = 30;
+  const float dt = 1.0f / 120.0f;
+  solver::Scene scene = BuildClothScene(n, 0.02f);
+  ThreadPool thread_pool;
+
+  solver::SolverSettings settings;
+  settings.min_iterations = 1;
+  settings.max_iterations = 1000;
+  settings.check_interval = 1;
+  for (float tolerance : {1e-5f, 1e-6f}) {
+    settings.tolerance = tolerance;
+    std::printf("%dx%d cloth, %d steps, max displacement below %g\n", n, n, num_steps, tolerance);
+    settings.chebyshev = false;
+    BenchmarkIterations("plain", scene, settings, &thread_pool, num_steps, dt);
+    settings.chebyshev = true;
+    settings.spectral_radius = 0.0f;
+    BenchmarkIterations("chebyshev, estimated rho", scene, settings, &thread_pool, num_steps, dt);
+    for (float spectral_radius : {0.8f, 0.9f, 0.95f}) {
+      settings.spectral_radius = spectral_radius;
+      std::string name = "chebyshev, rho " + std::to_string(spectral_radius).substr(0, 4);
+      BenchmarkIterations(name.c_str(), scene, settings, &thread_pool, num_steps, dt);
+    }
+    settings.spectral_radius = 0.0f;
+  }
+
+  const int n_large = 256;
+  const int num_ordering_steps = 5;
+  std::printf("%dx%d cloth, %d steps of %d sweeps\n", n_large, n_large, num_ordering_steps,
+              solver::SolverSettings{}.max_iterations);
+  BenchmarkOrdering("grid order", BuildMeshClothScene(n_large, 0.02f, false), solver::PARTICLE_ORDERING_NONE,
+                    &thread_pool, num_ordering_steps, dt);
+  solver::Scene shuffled_scene = BuildMeshClothScene(n_large, 0.02f, true);
+  BenchmarkOrdering("shuffled", shuffled_scene, solver::PARTICLE_ORDERING_NONE, &thread_pool, num_ordering_steps, dt);
+  BenchmarkOrdering("shuffled, morton", shuffled_scene, solver::PARTICLE_ORDERING_MORTON, &thread_pool,
+                    num_ordering_steps, dt);
+  BenchmarkOrdering("shuffled, rcm", shuffled_scene, solver::PARTICLE_ORDERING_RCM, &thread_pool, num_ordering_steps,
+                    dt);
+
+  const int n_small = 8;
+  const int num_environments = 64;
+  const int num_environment_steps = 5;
+  std::printf("%d environments of a %dx%d cloth, %d steps of %d sweeps\n", num_environments, n_small, n_small,
+              num_environment_steps, solver::vbd::kNumBatchIterations);
+  BenchmarkEnvironments(BuildClothScene(n_small, 0.02f), num_environments, &thread_pool, num_environment_steps, dt);
+}
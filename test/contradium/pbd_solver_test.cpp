@@ -0,0 +1,526 @@
+#include "gtest/gtest.h"
+#include "long_march.h"
+
+using namespace long_march;
+
+namespace {
+
+// Closed cube mesh around the origin with half extent h, outward facing triangles.
+Mesh<float> Cube(float h) {
+  std::vector<Vector3<float>> positions = {
+      {-h, -h, -h}, {h, -h, -h}, {h, h, -h}, {-h, h, -h}, {-h, -h, h}, {h, -h, h}, {h, h, h}, {-h, h, h},
+  };
+  std::vector<uint32_t> indices = {
+      1, 0, 2, 2, 0, 3, 5, 1, 6, 6, 1, 2, 4, 5, 7, 7, 5, 6, 0, 4, 3, 3, 4, 7, 2, 3, 6, 6, 3, 7, 4, 0, 5, 5, 0, 1,
+  };
+  return Mesh<float>(positions.size(), indices.size(), indices.data(), positions.data());
+}
+
+// Cube of half extent h with every face split into n by n quads, faces do not share vertices like in a render mesh.
+Mesh<float> TessellatedCube(float h, int n) {
+  std::vector<Vector3<float>> positions;
+  std::vector<uint32_t> indices;
+  for (int axis = 0; axis < 3; axis++) {
+    for (float side : {-1.0f, 1.0f}) {
+      Vector3<float> normal = Vector3<float>::Zero();
+      normal[axis] = side;
+      Vector3<float> u = Vector3<float>::Zero();
+      u[(axis + 1) % 3] = 1.0f;
+      Vector3<float> v = normal.cross(u);
+      uint32_t base = positions.size();
+      for (int i = 0; i <= n; i++) {
+        for (int j = 0; j <= n; j++) {
+          positions.push_back(h * (normal + (2.0f * i / n - 1.0f) * u + (2.0f * j / n - 1.0f) * v));
+        }
+      }
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+          uint32_t k = base + i * (n + 1) + j;
+          indices.insert(indices.end(), {k, k + n + 1, k + 1, k + 1, k + n + 1, k + n + 2});
+        }
+      }
+    }
+  }
+  return Mesh<float>(positions.size(), indices.size(), indices.data(), positions.data());
+}
+
+// The all pairs step the solver had before its broad phase, kept as the reference it has to match bit for bit.
+void ReferenceStep(std::vector<contradium::PBDSolver::RigidEntity> &entities, float dt) {
+  Vector3<float> gravity{0.0f, -9.81f, 0.0f};
+  std::vector<Vector3<float>> x_new(entities.size());
+  std::vector<Quaternion<float>> q_new(entities.size());
+  for (size_t i = 0; i < entities.size(); i++) {
+    auto &entity = entities[i];
+    if (entity.mass_) {
+      entity.v_ += dt * gravity;
+    }
+    x_new[i] = entity.x_ + dt * entity.v_;
+    q_new[i] = entity.q_;
+    if (entity.w_.norm() > 1e-6f) {
+      Eigen::AngleAxis<float> angle_axis(dt * entity.w_.norm(), entity.w_.normalized());
+      q_new[i] = (Quaternion<float>{angle_axis} * entity.q_).normalized();
+    }
+  }
+  for (int step = 0; step < 20; step++) {
+    std::vector<Vector3<float>> delta_x(entities.size(), Vector3<float>::Zero());
+    std::vector<Vector3<float>> delta_theta(entities.size(), Vector3<float>::Zero());
+    std::vector<int> num_contacts(entities.size(), 0);
+    for (size_t a = 0; a < entities.size(); a++) {
+      MeshSDFRef mesh_sdf = entities[a].shape->GetMeshSDF();
+      Matrix<float, 3, 3> R = q_new[a].toRotationMatrix();
+      AABB aabb_A;
+      const Mesh<float> &mesh_A = entities[a].shape->GetMesh();
+      for (size_t k = 0; k < mesh_A.NumVertices(); k++) {
+        aabb_A.Expand(q_new[a] * mesh_A.Positions()[k] + x_new[a]);
+      }
+      for (size_t b = 0; b < entities.size(); b++) {
+        if (b == a) {
+          continue;
+        }
+        const Mesh<float> &mesh_B = entities[b].shape->GetMesh();
+        for (size_t k = 0; k < mesh_B.NumVertices(); k++) {
+          Vector3<float> r_B = q_new[b] * mesh_B.Positions()[k] + x_new[b];
+          if (!aabb_A.Contain(r_B)) {
+            continue;
+          }
+          float sdf;
+          Vector3<float> n;
+          mesh_sdf.SDF(r_B, R, x_new[a], &sdf, &n, nullptr);
+          if (sdf < 0.0f) {
+            Vector3<float> r_A = r_B - sdf * n;
+            Vector3<float> grad_theta_A = (r_A - x_new[a]).cross(n);
+            Vector3<float> grad_theta_B = (r_B - x_new[b]).cross(-n);
+            float denom = n.dot(entities[a].inv_mass_ * n) + n.dot(entities[b].inv_mass_ * n) +
+                          grad_theta_A.dot(entities[a].inv_inertia_ * grad_theta_A) +
+                          grad_theta_B.dot(entities[b].inv_inertia_ * grad_theta_B);
+            float coeff = sdf / denom;
+            num_contacts[a]++;
+            num_contacts[b]++;
+            delta_x[a] += coeff * entities[a].inv_mass_ * n;
+            delta_theta[a] += coeff * entities[a].inv_inertia_ * grad_theta_A;
+            delta_x[b] += coeff * entities[b].inv_mass_ * -n;
+            delta_theta[b] += coeff * entities[b].inv_inertia_ * grad_theta_B;
+          }
+        }
+      }
+    }
+    for (size_t i = 0; i < entities.size(); i++) {
+      if (num_contacts[i] > 0) {
+        x_new[i] += delta_x[i] / num_contacts[i];
+        if (delta_theta[i].norm() > 1e-6f) {
+          Eigen::AngleAxis<float> angle_axis(delta_theta[i].norm() / num_contacts[i], delta_theta[i].normalized());
+          q_new[i] = (Quaternion<float>{angle_axis} * q_new[i]).normalized();
+        }
+      }
+    }
+  }
+  for (size_t i = 0; i < entities.size(); i++) {
+    auto &entity = entities[i];
+    entity.v_ = (x_new[i] - entity.x_) / dt;
+    Eigen::AngleAxis<float> angle_axis(q_new[i] * entity.q_.conjugate());
+    entity.w_ = angle_axis.axis() * angle_axis.angle() / dt;
+    entity.x_ = x_new[i];
+    entity.q_ = q_new[i];
+  }
+}
+
+// A static floor with a few layers of tilted boxes dropped onto it, most of them far apart from each other.
+std::vector<int> BuildScene(contradium::PBDSolver &solver) {
+  std::vector<int> ids;
+  Mesh<float> floor = Cube(4.0f);
+  Mesh<float> box = Cube(0.25f);
+  Vector3<float> axis = Vector3<float>{1.0f, 0.5f, 0.2f}.normalized();
+  ids.push_back(solver.AddEntity(floor, Vector3<float>{0.0f, -4.0f, 0.0f}, Quaternion<float>::Identity(), 0.0f, 0.0f));
+  for (int layer = 0; layer < 3; layer++) {
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 4; j++) {
+        Vector3<float> x{i * 1.2f - 1.8f + 0.1f * layer, 0.2f + 0.45f * layer, j * 1.2f - 1.8f};
+        Quaternion<float> q{Eigen::AngleAxis<float>(0.3f * (i + j + layer), axis)};
+        ids.push_back(solver.AddEntity(box, x, q));
+      }
+    }
+  }
+  return ids;
+}
+
+}  // namespace
+
+TEST(Contradium, PBDSolverBroadPhase) {
+  const float dt = 1.0f / 60.0f;
+  contradium::PBDSolver serial;
+  std::vector<int> ids = BuildScene(serial);
+  ThreadPool thread_pool(3);
+  contradium::PBDSolver parallel(&thread_pool);
+  BuildScene(parallel);
+  std::vector<contradium::PBDSolver::RigidEntity> reference;
+  for (int id : ids) {
+    reference.push_back(serial.GetEntity(id));
+  }
+
+  for (int step = 0; step < 30; step++) {
+    serial.Step(dt);
+    parallel.Step(dt);
+    ReferenceStep(reference, dt);
+  }
+  for (size_t i = 0; i < ids.size(); i++) {
+    const auto &entity = serial.GetEntity(ids[i]);
+    EXPECT_EQ(entity.x_, reference[i].x_);
+    EXPECT_EQ(entity.q_.coeffs(), reference[i].q_.coeffs());
+    EXPECT_EQ(entity.x_, parallel.GetEntity(ids[i]).x_);
+    EXPECT_EQ(entity.q_.coeffs(), parallel.GetEntity(ids[i]).q_.coeffs());
+  }
+  // The boxes landed on the floor rather than falling through it.
+  for (size_t i = 1; i < ids.size(); i++) {
+    EXPECT_GT(serial.GetEntity(ids[i]).x_.y(), 0.0f);
+  }
+}
+
+TEST(Contradium, PBDSolverSharedShapesAndRemoval) {
+  const float dt = 1.0f / 60.0f;
+  contradium::PBDSolver solver;
+  std::vector<int> ids = BuildScene(solver);
+  // All boxes share one shape, the floor has its own.
+  std::shared_ptr<const contradium::CollisionShape> box_shape = solver.GetEntity(ids[1]).shape;
+  for (size_t i = 2; i < ids.size(); i++) {
+    EXPECT_EQ(solver.GetEntity(ids[i]).shape, box_shape);
+  }
+  EXPECT_NE(solver.GetEntity(ids[0]).shape, box_shape);
+  EXPECT_EQ(solver.GetShape(Cube(0.25f)), box_shape);
+  EXPECT_NE(solver.GetShape(Cube(0.3f)), box_shape);
+
+  // Removing bodies leaves the other ids pointing at the same bodies.
+  for (int step = 0; step < 5; step++) {
+    solver.Step(dt);
+  }
+  std::vector<Vector3<float>> positions;
+  for (int id : ids) {
+    positions.push_back(solver.GetPosition(id));
+  }
+  std::vector<int> removed = {ids[5], ids[1], ids.back(), ids[20]};
+  for (int id : removed) {
+    solver.RemoveEntity(id);
+  }
+  EXPECT_EQ(solver.NumEntities(), static_cast<int>(ids.size() - removed.size()));
+  EXPECT_THROW(solver.GetPosition(ids[5]), std::out_of_range);
+  std::vector<int> kept;
+  for (size_t i = 0; i < ids.size(); i++) {
+    if (std::find(removed.begin(), removed.end(), ids[i]) == removed.end()) {
+      EXPECT_EQ(solver.GetPosition(ids[i]), positions[i]);
+      kept.push_back(ids[i]);
+    }
+  }
+
+  // A new body gets a fresh id and the scene keeps stepping.
+  int added = solver.AddEntity(box_shape, Vector3<float>{0.0f, 3.0f, 0.0f});
+  EXPECT_EQ(added, static_cast<int>(ids.size()));
+  for (int step = 0; step < 20; step++) {
+    solver.Step(dt);
+  }
+  EXPECT_GT(solver.GetPosition(added).y(), 0.0f);
+  for (size_t i = 1; i < kept.size(); i++) {
+    EXPECT_GT(solver.GetPosition(kept[i]).y(), 0.0f);
+  }
+}
+
+TEST(Contradium, PBDSolverWarmStartAndEarlyTermination) {
+  const float dt = 1.0f / 60.0f;
+  // Boxes resting on the floor in stacks of two, the upper one shifted so its corners rest on the face below.
+  auto build = [](contradium::PBDSolver &solver) {
+    std::vector<int> ids;
+    ids.push_back(solver.AddEntity(Cube(4.0f), Vector3<float>{0.0f, -4.0f, 0.0f}, Quaternion<float>::Identity(), 0.0f,
+                                   0.0f));
+    Mesh<float> box = Cube(0.25f);
+    for (int i = 0; i < 4; i++) {
+      for (int level = 0; level < 2; level++) {
+        Vector3<float> x{i * 1.0f - 1.5f + 0.1f * level, 0.26f + 0.52f * level, 0.1f * level};
+        ids.push_back(solver.AddEntity(box, x));
+      }
+    }
+    return ids;
+  };
+  contradium::PBDSolver fixed;
+  std::vector<int> ids = build(fixed);
+  contradium::PBDSolver adaptive;
+  build(adaptive);
+  contradium::PBDSettings settings;
+  settings.tolerance = 1e-3f;
+  settings.warm_start = 0.5f;
+  adaptive.SetSettings(settings);
+  EXPECT_EQ(adaptive.GetSettings().max_iterations, 20);
+
+  int fixed_iterations = 0;
+  int adaptive_iterations = 0;
+  for (int step = 0; step < 120; step++) {
+    fixed.Step(dt);
+    adaptive.Step(dt);
+    const contradium::PBDStatistics &statistics = adaptive.GetStatistics();
+    // Without a tolerance a step runs every iteration, unless no body overlaps another one at all.
+    if (fixed.GetStatistics().contacts > 0) {
+      EXPECT_EQ(fixed.GetStatistics().iterations, 20);
+    }
+    EXPECT_LE(statistics.persistent_contacts, statistics.contacts);
+    if (statistics.iterations < 20) {
+      EXPECT_LT(statistics.residual, settings.tolerance);
+    }
+    fixed_iterations += fixed.GetStatistics().iterations;
+    adaptive_iterations += statistics.iterations;
+  }
+  // Every box touches the one below it and keeps touching it from step to step.
+  EXPECT_LT(adaptive_iterations, fixed_iterations / 2);
+  EXPECT_EQ(fixed.GetStatistics().contacts, 24);
+  EXPECT_EQ(adaptive.GetStatistics().contacts, 24);
+  EXPECT_EQ(adaptive.GetStatistics().persistent_contacts, 24);
+  for (size_t i = 1; i < ids.size(); i++) {
+    EXPECT_NEAR(adaptive.GetPosition(ids[i]).y(), fixed.GetPosition(ids[i]).y(), 5e-3f);
+  }
+}
+
+TEST(Contradium, PBDSolverSleepingIslands) {
+  const float dt = 1.0f / 60.0f;
+  contradium::PBDSolver solver;
+  contradium::PBDSettings settings;
+  settings.sleep_linear_velocity = 0.05f;
+  settings.sleep_angular_velocity = 0.05f;
+  settings.sleep_steps = 10;
+  solver.SetSettings(settings);
+  // Four stacks of two boxes resting on the floor, far enough apart to be islands of their own.
+  Mesh<float> box = Cube(0.25f);
+  int floor =
+      solver.AddEntity(Cube(4.0f), Vector3<float>{0.0f, -4.0f, 0.0f}, Quaternion<float>::Identity(), 0.0f, 0.0f);
+  std::vector<int> ids;
+  for (int i = 0; i < 4; i++) {
+    for (int level = 0; level < 2; level++) {
+      Vector3<float> x{i * 1.0f - 1.5f + 0.1f * level, 0.26f + 0.52f * level, 0.1f * level};
+      ids.push_back(solver.AddEntity(box, x));
+    }
+  }
+
+  for (int step = 0; step < 120 && solver.GetStatistics().sleeping_entities < 8; step++) {
+    solver.Step(dt);
+    EXPECT_LE(solver.GetStatistics().islands, 8);
+  }
+  EXPECT_EQ(solver.GetStatistics().sleeping_entities, 8);
+  EXPECT_FALSE(solver.IsSleeping(floor));
+  std::vector<Vector3<float>> positions;
+  for (int id : ids) {
+    EXPECT_TRUE(solver.IsSleeping(id));
+    positions.push_back(solver.GetPosition(id));
+  }
+  // Sleeping bodies are left exactly where they are, and without a moving body the step stops after one iteration.
+  for (int step = 0; step < 5; step++) {
+    solver.Step(dt);
+    EXPECT_EQ(solver.GetStatistics().contacts, 0);
+    EXPECT_EQ(solver.GetStatistics().islands, 0);
+    EXPECT_EQ(solver.GetStatistics().iterations, 1);
+  }
+  for (size_t i = 0; i < ids.size(); i++) {
+    EXPECT_EQ(solver.GetPosition(ids[i]), positions[i]);
+  }
+
+  // A box dropped onto the first stack wakes that stack only.
+  int dropped = solver.AddEntity(box, Vector3<float>{-1.3f, 1.6f, 0.2f});
+  for (int step = 0; step < 30 && solver.IsSleeping(ids[0]); step++) {
+    solver.Step(dt);
+  }
+  EXPECT_FALSE(solver.IsSleeping(ids[0]));
+  EXPECT_FALSE(solver.IsSleeping(ids[1]));
+  for (size_t i = 2; i < ids.size(); i++) {
+    EXPECT_TRUE(solver.IsSleeping(ids[i]));
+  }
+  for (int step = 0; step < 120 && solver.GetStatistics().sleeping_entities < 9; step++) {
+    solver.Step(dt);
+  }
+  EXPECT_EQ(solver.GetStatistics().sleeping_entities, 9);
+  EXPECT_GT(solver.GetPosition(dropped).y(), 1.0f);
+
+  // Setting the state of a body wakes its island.
+  solver.SetVelocity(ids[5], Vector3<float>{0.0f, 1.0f, 0.0f});
+  EXPECT_FALSE(solver.IsSleeping(ids[4]));
+  EXPECT_FALSE(solver.IsSleeping(ids[5]));
+  EXPECT_TRUE(solver.IsSleeping(ids[6]));
+  solver.Step(dt);
+  EXPECT_GT(solver.GetPosition(ids[5]).y(), positions[5].y());
+
+  // Turning sleeping off wakes the rest.
+  settings.sleep_linear_velocity = 0.0f;
+  solver.SetSettings(settings);
+  for (int id : ids) {
+    EXPECT_FALSE(solver.IsSleeping(id));
+  }
+  solver.Step(dt);
+  EXPECT_EQ(solver.GetStatistics().sleeping_entities, 0);
+}
+
+TEST(Contradium, PBDSolverStaticBodiesWakeSleepers) {
+  const float dt = 1.0f / 60.0f;
+  contradium::PBDSolver solver;
+  contradium::PBDSettings settings;
+  settings.sleep_linear_velocity = 0.05f;
+  settings.sleep_angular_velocity = 0.05f;
+  settings.sleep_steps = 10;
+  solver.SetSettings(settings);
+  // A box on each of three static pedestals, and a static block far above.
+  Quaternion<float> identity = Quaternion<float>::Identity();
+  int left = solver.AddEntity(Cube(0.5f), Vector3<float>{-2.0f, -0.5f, 0.0f}, identity, 0.0f, 0.0f);
+  int right = solver.AddEntity(Cube(0.5f), Vector3<float>{2.0f, -0.5f, 0.0f}, identity, 0.0f, 0.0f);
+  solver.AddEntity(Cube(0.5f), Vector3<float>{0.0f, -0.5f, 0.0f}, identity, 0.0f, 0.0f);
+  int block = solver.AddEntity(Cube(0.25f), Vector3<float>{0.0f, 5.0f, 0.0f}, identity, 0.0f, 0.0f);
+  int on_left = solver.AddEntity(Cube(0.25f), Vector3<float>{-2.0f, 0.26f, 0.0f});
+  int on_right = solver.AddEntity(Cube(0.25f), Vector3<float>{2.0f, 0.26f, 0.0f});
+  int on_middle = solver.AddEntity(Cube(0.25f), Vector3<float>{0.0f, 0.26f, 0.0f});
+  for (int step = 0; step < 120 && solver.GetStatistics().sleeping_entities < 3; step++) {
+    solver.Step(dt);
+  }
+  ASSERT_TRUE(solver.IsSleeping(on_left));
+  ASSERT_TRUE(solver.IsSleeping(on_right));
+  ASSERT_TRUE(solver.IsSleeping(on_middle));
+
+  // Moving a static body onto a sleeping one wakes it, though nothing was near its old pose.
+  solver.SetPosition(block, solver.GetPosition(on_middle) + Vector3<float>{0.0f, 0.49f, 0.0f});
+  EXPECT_FALSE(solver.IsSleeping(on_middle));
+  EXPECT_TRUE(solver.IsSleeping(on_left));
+  EXPECT_TRUE(solver.IsSleeping(on_right));
+
+  // Removing a pedestal wakes the box on it, which falls.
+  solver.RemoveEntity(left);
+  EXPECT_FALSE(solver.IsSleeping(on_left));
+  EXPECT_TRUE(solver.IsSleeping(on_right));
+  for (int step = 0; step < 30; step++) {
+    solver.Step(dt);
+  }
+  EXPECT_LT(solver.GetPosition(on_left).y(), -0.5f);
+
+  // So does moving one away.
+  solver.SetPosition(right, Vector3<float>{2.0f, -2.0f, 0.0f});
+  EXPECT_FALSE(solver.IsSleeping(on_right));
+  solver.Step(dt);
+  EXPECT_LT(solver.GetPosition(on_right).y(), 0.25f);
+}
+
+TEST(Contradium, PBDSolverPrimitiveShapes) {
+  const float dt = 1.0f / 60.0f;
+  contradium::PBDSolver solver;
+  auto plane = contradium::CollisionShape::CreatePlane();
+  auto sphere = contradium::CollisionShape::CreateSphere(0.3f);
+  auto box = contradium::CollisionShape::CreateBox(Vector3<float>{0.4f, 0.2f, 0.3f});
+  auto capsule = contradium::CollisionShape::CreateCapsule(0.5f, 0.2f);
+  EXPECT_EQ(sphere->Type(), contradium::COLLISION_SHAPE_TYPE_SPHERE);
+  EXPECT_EQ(box->Points().size(), 8u);
+  EXPECT_FALSE(capsule->HasMesh(Cube(0.2f)));
+
+  solver.AddEntity(plane, Vector3<float>::Zero(), Quaternion<float>::Identity(), 0.0f, 0.0f);
+  // Two spheres overlapping side by side, a sphere dropped onto a box, and two capsules lying across each other.
+  int left = solver.AddEntity(sphere, Vector3<float>{-0.25f, 0.3f, 2.0f});
+  int right = solver.AddEntity(sphere, Vector3<float>{0.25f, 0.3f, 2.0f});
+  int box_id = solver.AddEntity(box, Vector3<float>{2.0f, 0.5f, 0.0f});
+  int on_box = solver.AddEntity(sphere, Vector3<float>{2.0f, 1.2f, 0.0f});
+  Quaternion<float> along_x{Eigen::AngleAxis<float>(0.5f * PI<float>(), Vector3<float>::UnitZ())};
+  Quaternion<float> along_z{Eigen::AngleAxis<float>(0.5f * PI<float>(), Vector3<float>::UnitX())};
+  int lower = solver.AddEntity(capsule, Vector3<float>{-2.0f, 0.3f, 0.0f}, along_x);
+  int upper = solver.AddEntity(capsule, Vector3<float>{-2.0f, 0.9f, 0.0f}, along_z);
+  for (int step = 0; step < 120; step++) {
+    solver.Step(dt);
+  }
+
+  EXPECT_NEAR(solver.GetPosition(left).y(), 0.3f, 0.01f);
+  EXPECT_NEAR(solver.GetPosition(right).y(), 0.3f, 0.01f);
+  EXPECT_GE((solver.GetPosition(right) - solver.GetPosition(left)).norm(), 0.59f);
+  EXPECT_NEAR(solver.GetPosition(box_id).y(), 0.2f, 0.01f);
+  EXPECT_NEAR(solver.GetPosition(on_box).y(), 0.7f, 0.01f);
+  EXPECT_NEAR(solver.GetPosition(lower).y(), 0.2f, 0.01f);
+  EXPECT_NEAR(solver.GetPosition(upper).y(), 0.6f, 0.01f);
+}
+
+TEST(Contradium, PBDSolverCapsuleAcrossBox) {
+  const float dt = 1.0f / 60.0f;
+  contradium::PBDSolver solver;
+  Quaternion<float> identity = Quaternion<float>::Identity();
+  Quaternion<float> along_x{Eigen::AngleAxis<float>(0.5f * PI<float>(), Vector3<float>::UnitZ())};
+  solver.AddEntity(contradium::CollisionShape::CreatePlane(), Vector3<float>::Zero(), identity, 0.0f, 0.0f);
+  // A narrow static box and a mesh cube, a long capsule lies across each with both ends hanging over.
+  auto capsule = contradium::CollisionShape::CreateCapsule(1.0f, 0.1f);
+  solver.AddEntity(contradium::CollisionShape::CreateBox(Vector3<float>{0.2f, 0.5f, 0.2f}),
+                   Vector3<float>{0.0f, 0.5f, 0.0f}, identity, 0.0f, 0.0f);
+  solver.AddEntity(Cube(0.2f), Vector3<float>{0.0f, 0.5f, 3.0f}, identity, 0.0f, 0.0f);
+  int on_box = solver.AddEntity(capsule, Vector3<float>{0.0f, 1.2f, 0.0f}, along_x);
+  int on_mesh = solver.AddEntity(capsule, Vector3<float>{0.0f, 0.8f, 3.0f}, along_x);
+  for (int step = 0; step < 60; step++) {
+    solver.Step(dt);
+  }
+  EXPECT_NEAR(solver.GetPosition(on_box).y(), 1.1f, 0.02f);
+  EXPECT_NEAR(solver.GetPosition(on_mesh).y(), 0.8f, 0.02f);
+}
+
+TEST(Contradium, PBDSolverBoxesCrossedEdgeToEdge) {
+  const float dt = 1.0f / 60.0f;
+  contradium::PBDSolver solver;
+  // Two long bars turned onto an edge, the upper one across the lower one. No corner of either gets inside the other,
+  // they only meet where the lower top edge crosses the upper bottom edge.
+  auto bar = contradium::CollisionShape::CreateBox(Vector3<float>{1.0f, 0.1f, 0.1f});
+  Quaternion<float> on_edge{Eigen::AngleAxis<float>(0.25f * PI<float>(), Vector3<float>::UnitX())};
+  Quaternion<float> across{Eigen::AngleAxis<float>(0.5f * PI<float>(), Vector3<float>::UnitY())};
+  solver.AddEntity(bar, Vector3<float>::Zero(), on_edge, 0.0f, 0.0f);
+  int upper = solver.AddEntity(bar, Vector3<float>{0.0f, 0.3f, 0.0f}, across * on_edge);
+  for (int step = 0; step < 60; step++) {
+    solver.Step(dt);
+  }
+  // Each edge is 0.1 * sqrt(2) off the center of its bar.
+  EXPECT_NEAR(solver.GetPosition(upper).y(), 0.2f * std::sqrt(2.0f), 0.01f);
+  EXPECT_GT(solver.GetStatistics().contacts, 0);
+}
+
+TEST(Contradium, PBDSolverSurfaceSamples) {
+  const float h = 0.25f;
+  const float spacing = 0.1f;
+  Mesh<float> mesh = TessellatedCube(h, 16);
+  auto shape = std::make_shared<const contradium::CollisionShape>(mesh);
+  const std::vector<Vector3<float>> &samples = shape->SamplePoints(spacing);
+  // Stored once with the shape.
+  EXPECT_EQ(&shape->SamplePoints(spacing), &samples);
+  EXPECT_LT(samples.size() * 5, mesh.NumVertices());
+
+  // The corners are kept, every sample lies on the surface and the surface is covered.
+  for (int corner = 0; corner < 8; corner++) {
+    Vector3<float> p{corner & 1 ? h : -h, corner & 2 ? h : -h, corner & 4 ? h : -h};
+    EXPECT_NE(std::find(samples.begin(), samples.end(), p), samples.end());
+  }
+  for (const Vector3<float> &sample : samples) {
+    EXPECT_NEAR(sample.cwiseAbs().maxCoeff(), h, 1e-5f);
+  }
+  float min_distance = std::numeric_limits<float>::max();
+  for (size_t i = 0; i < samples.size(); i++) {
+    for (size_t j = i + 1; j < samples.size(); j++) {
+      min_distance = std::min(min_distance, (samples[i] - samples[j]).norm());
+    }
+  }
+  EXPECT_GT(min_distance, 0.5f * spacing);
+  for (size_t v = 0; v < mesh.NumVertices(); v++) {
+    float nearest = std::numeric_limits<float>::max();
+    for (const Vector3<float> &sample : samples) {
+      nearest = std::min(nearest, (sample - mesh.Positions()[v]).norm());
+    }
+    EXPECT_LT(nearest, 1.5f * spacing);
+  }
+  // The bounds of the shape hold all of it, not just the samples.
+  for (size_t v = 0; v < mesh.NumVertices(); v++) {
+    EXPECT_TRUE(shape->Bounds().Contain(mesh.Positions()[v]));
+  }
+  // Zero area faces, here one along a row of a tessellated face, change nothing.
+  std::vector<uint32_t> indices(mesh.Indices(), mesh.Indices() + mesh.NumIndices());
+  indices.insert(indices.end(), {40, 41, 42, 50, 50, 51});
+  Mesh<float> degenerate(mesh.NumVertices(), indices.size(), indices.data(), mesh.Positions());
+  EXPECT_EQ(contradium::SampleSurface(degenerate, spacing), contradium::SampleSurface(mesh, spacing));
+
+  // A dense box tested with its samples rests on the floor like one tested with all its vertices.
+  const float dt = 1.0f / 60.0f;
+  contradium::PBDSolver solver;
+  solver.AddEntity(Cube(4.0f), Vector3<float>{0.0f, -4.0f, 0.0f}, Quaternion<float>::Identity(), 0.0f, 0.0f);
+  int sampled = solver.AddEntity(shape, Vector3<float>{0.0f, 0.3f, 0.0f});
+  int dense = solver.AddEntity(shape, Vector3<float>{1.0f, 0.3f, 0.0f});
+  solver.SetSampleSpacing(sampled, spacing);
+  for (int step = 0; step < 60; step++) {
+    solver.Step(dt);
+  }
+  EXPECT_NEAR(solver.GetPosition(sampled).y(), h, 0.01f);
+  EXPECT_NEAR(solver.GetPosition(dense).y(), solver.GetPosition(sampled).y(), 1e-3f);
+}
@@ -0,0 +1,89 @@
+#include "algorithm"
+#include "array"
+#include "gtest/gtest.h"
+#include "long_march.h"
+#include "random"
+#include "vector"
+
+using namespace long_march;
+
+namespace {
+
+Mesh<float> ShuffledGridMesh(int resolution) {
+  std::vector<Vector3<float>> positions;
+  std::vector<uint32_t> indices;
+  for (int i = 0; i <= resolution; i++) {
+    for (int j = 0; j <= resolution; j++) {
+      positions.emplace_back(static_cast<float>(i), static_cast<float>(j), 0.0f);
+    }
+  }
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (int i = 0; i < resolution; i++) {
+    for (int j = 0; j < resolution; j++) {
+      uint32_t v00 = i * (resolution + 1) + j;
+      uint32_t v01 = v00 + 1;
+      uint32_t v10 = v00 + resolution + 1;
+      uint32_t v11 = v10 + 1;
+      triangles.push_back({v00, v10, v11});
+      triangles.push_back({v00, v11, v01});
+    }
+  }
+  std::mt19937 gen(20240501);
+  std::shuffle(triangles.begin(), triangles.end(), gen);
+  for (auto &triangle : triangles) {
+    indices.insert(indices.end(), triangle.begin(), triangle.end());
+  }
+  return Mesh<float>(positions.size(), indices.size(), indices.data(), positions.data());
+}
+
+std::vector<std::array<float, 9>> SortedTriangles(const Mesh<float> &mesh) {
+  std::vector<std::array<float, 9>> triangles;
+  for (size_t i = 0; i < mesh.NumIndices(); i += 3) {
+    std::array<float, 9> triangle{};
+    for (int j = 0; j < 3; j++) {
+      const Vector3<float> &p = mesh.Positions()[mesh.Indices()[i + j]];
+      triangle[j * 3 + 0] = p[0];
+      triangle[j * 3 + 1] = p[1];
+      triangle[j * 3 + 2] = p[2];
+    }
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+}  // namespace
+
+TEST(Math, MeshOptimizerVertexCache) {
+  Mesh<float> mesh = ShuffledGridMesh(64);
+  VertexCacheStatistics before = AnalyzeVertexCache(mesh.Indices(), mesh.NumIndices(), mesh.NumVertices());
+
+  Mesh<float> optimized = mesh;
+  EXPECT_EQ(optimized.OptimizeVertexOrder(), 0);
+  VertexCacheStatistics after =
+      AnalyzeVertexCache(optimized.Indices(), optimized.NumIndices(), optimized.NumVertices());
+
+  EXPECT_GT(before.acmr, 2.0f);
+  EXPECT_LT(after.acmr, 1.0f);
+  EXPECT_LT(after.atvr, before.atvr);
+  EXPECT_GE(after.atvr, 1.0f);
+
+  // Same triangles with the same winding, only reordered and renumbered.
+  EXPECT_EQ(optimized.NumIndices(), mesh.NumIndices());
+  EXPECT_EQ(optimized.NumVertices(), mesh.NumVertices());
+  EXPECT_TRUE(SortedTriangles(optimized) == SortedTriangles(mesh));
+}
+
+TEST(Math, MeshOptimizerVertexFetch) {
+  Mesh<float> mesh = ShuffledGridMesh(16);
+  EXPECT_EQ(mesh.OptimizeVertexOrder(), 0);
+  uint32_t next_vertex = 0;
+  for (size_t i = 0; i < mesh.NumIndices(); i++) {
+    uint32_t v = mesh.Indices()[i];
+    EXPECT_LE(v, next_vertex);
+    if (v == next_vertex) {
+      next_vertex++;
+    }
+  }
+  EXPECT_EQ(next_vertex, mesh.NumVertices());
+}
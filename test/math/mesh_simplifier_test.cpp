@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+#include "long_march.h"
+#include "map"
+#include "set"
+#include "vector"
+
+using namespace long_march;
+
+namespace {
+
+void HeightFieldGrid(int resolution,
+                     float amplitude,
+                     std::vector<Vector3<float>> *positions,
+                     std::vector<uint32_t> *indices) {
+  for (int i = 0; i <= resolution; i++) {
+    for (int j = 0; j <= resolution; j++) {
+      float x = static_cast<float>(i) / resolution;
+      float y = static_cast<float>(j) / resolution;
+      positions->emplace_back(x, y, amplitude * std::sin(3.0f * x) * std::cos(2.0f * y));
+    }
+  }
+  for (int i = 0; i < resolution; i++) {
+    for (int j = 0; j < resolution; j++) {
+      uint32_t v00 = i * (resolution + 1) + j;
+      uint32_t v01 = v00 + 1;
+      uint32_t v10 = v00 + resolution + 1;
+      uint32_t v11 = v10 + 1;
+      indices->insert(indices->end(), {v00, v10, v11, v00, v11, v01});
+    }
+  }
+}
+
+void ExpectValidTriangles(const std::vector<uint32_t> &indices, size_t num_vertices) {
+  EXPECT_EQ(indices.size() % 3, 0);
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    EXPECT_LT(indices[i], num_vertices);
+    EXPECT_LT(indices[i + 1], num_vertices);
+    EXPECT_LT(indices[i + 2], num_vertices);
+    EXPECT_NE(indices[i], indices[i + 1]);
+    EXPECT_NE(indices[i + 1], indices[i + 2]);
+    EXPECT_NE(indices[i + 2], indices[i]);
+  }
+}
+
+}  // namespace
+
+TEST(Math, MeshSimplifierFlat) {
+  std::vector<Vector3<float>> positions;
+  std::vector<uint32_t> indices;
+  HeightFieldGrid(32, 0.0f, &positions, &indices);
+
+  float error = -1.0f;
+  std::vector<uint32_t> result =
+      SimplifyMesh(indices.data(), indices.size(), positions.data(), positions.size(), indices.size() / 4,
+                   std::numeric_limits<float>::max(), &error);
+  ExpectValidTriangles(result, positions.size());
+  EXPECT_LE(result.size(), indices.size() / 4);
+  EXPECT_NEAR(error, 0.0f, 1e-5f);
+}
+
+TEST(Math, MeshSimplifierErrorBound) {
+  std::vector<Vector3<float>> positions;
+  std::vector<uint32_t> indices;
+  HeightFieldGrid(32, 0.2f, &positions, &indices);
+
+  float loose_error = 0.0f;
+  std::vector<uint32_t> loose = SimplifyMesh(indices.data(), indices.size(), positions.data(), positions.size(), 0,
+                                             1e-2f, &loose_error);
+  float tight_error = 0.0f;
+  std::vector<uint32_t> tight = SimplifyMesh(indices.data(), indices.size(), positions.data(), positions.size(), 0,
+                                             1e-3f, &tight_error);
+  ExpectValidTriangles(loose, positions.size());
+  ExpectValidTriangles(tight, positions.size());
+  EXPECT_LE(loose_error, 1e-2f);
+  EXPECT_LE(tight_error, 1e-3f);
+  EXPECT_LT(loose.size(), tight.size());
+  EXPECT_LT(tight.size(), indices.size());
+}
+
+TEST(Math, MeshSimplifierSeam) {
+  // Two grids split along x = 1 with their own copies of the seam vertices, as a UV seam would leave them.
+  std::vector<Vector3<float>> positions;
+  std::vector<uint32_t> indices;
+  HeightFieldGrid(16, 0.0f, &positions, &indices);
+  size_t num_left = positions.size();
+  std::vector<Vector3<float>> right_positions;
+  std::vector<uint32_t> right_indices;
+  HeightFieldGrid(16, 0.0f, &right_positions, &right_indices);
+  for (auto &p : right_positions) {
+    positions.emplace_back(p.x() + 1.0f, p.y(), p.z());
+  }
+  for (uint32_t i : right_indices) {
+    indices.push_back(static_cast<uint32_t>(i + num_left));
+  }
+
+  float error = -1.0f;
+  std::vector<uint32_t> result =
+      SimplifyMesh(indices.data(), indices.size(), positions.data(), positions.size(), indices.size() / 16,
+                   std::numeric_limits<float>::max(), &error);
+  ExpectValidTriangles(result, positions.size());
+  EXPECT_LE(result.size(), indices.size() / 16);
+  EXPECT_NEAR(error, 0.0f, 1e-5f);
+
+  // Both sides keep the same seam edges, so no crack opens between them.
+  std::map<std::pair<uint32_t, uint32_t>, int> edge_counts;
+  for (size_t i = 0; i < result.size(); i += 3) {
+    for (int j = 0; j < 3; j++) {
+      uint32_t a = result[i + j];
+      uint32_t b = result[i + (j + 1) % 3];
+      edge_counts[{std::min(a, b), std::max(a, b)}]++;
+    }
+  }
+  std::set<std::pair<float, float>> left_seam, right_seam;
+  for (auto &[edge, count] : edge_counts) {
+    const Vector3<float> &a = positions[edge.first];
+    const Vector3<float> &b = positions[edge.second];
+    if (count == 1 && a.x() == 1.0f && b.x() == 1.0f) {
+      auto &seam = edge.first < num_left ? left_seam : right_seam;
+      seam.insert({std::min(a.y(), b.y()), std::max(a.y(), b.y())});
+    }
+  }
+  EXPECT_FALSE(left_seam.empty());
+  EXPECT_EQ(left_seam, right_seam);
+}
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+#include "long_march.h"
+#include "random"
+
+using namespace long_march;
+
+TEST(Math, QuantizationOctahedral) {
+  std::mt19937 gen(7);
+  std::normal_distribution<float> dis(0.0f, 1.0f);
+  float max_angle = 0.0f;
+  for (int i = 0; i < 10000; i++) {
+    Vector3<float> v{dis(gen), dis(gen), dis(gen)};
+    if (v.norm() < 1e-3f) {
+      continue;
+    }
+    v.normalize();
+    Vector3<float> decoded = DecodeOctahedral16(EncodeOctahedral16(v));
+    EXPECT_NEAR(decoded.norm(), 1.0f, 1e-5f);
+    max_angle = std::max(max_angle, std::acos(std::min(1.0f, v.dot(decoded))));
+  }
+  EXPECT_LT(max_angle, 1e-3f);
+
+  Vector3<float> axes[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+  for (auto &axis : axes) {
+    EXPECT_LT((DecodeOctahedral16(EncodeOctahedral16(axis)) - axis).norm(), 1e-4f);
+  }
+}
+
+TEST(Math, QuantizationHalf) {
+  float exact[] = {0.0f, -0.0f, 1.0f, -2.5f, 0.5f, 65504.0f, 6.103515625e-05f, 5.9604644775390625e-08f};
+  for (float x : exact) {
+    EXPECT_EQ(HalfToFloat(FloatToHalf(x)), x);
+  }
+  EXPECT_TRUE(std::isinf(HalfToFloat(FloatToHalf(1e6f))));
+  EXPECT_TRUE(std::isnan(HalfToFloat(FloatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+  EXPECT_EQ(FloatToHalf(1.0f + 1.0f / 2048.0f), FloatToHalf(1.0f));  // ties round to even
+
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<float> dis(-4.0f, 4.0f);
+  for (int i = 0; i < 10000; i++) {
+    float x = dis(gen);
+    EXPECT_NEAR(HalfToFloat(FloatToHalf(x)), x, std::abs(x) * (1.0f / 2048.0f) + 1e-7f);
+  }
+}
+
+TEST(Math, QuantizationUnorm16) {
+  EXPECT_EQ(QuantizeUnorm16(-1.0f), 0);
+  EXPECT_EQ(QuantizeUnorm16(2.0f), 65535);
+  for (int i = 0; i <= 100; i++) {
+    float x = i / 100.0f;
+    EXPECT_NEAR(DequantizeUnorm16(QuantizeUnorm16(x)), x, 0.5f / 65535.0f + 1e-7f);
+  }
+}
@@ -0,0 +1,134 @@
+#include "function_derivative_test.h"
+
+namespace {
+
+template <typename Func>
+void TestBatchEvaluator(const std::vector<Func> &functions,
+                        const std::vector<uint32_t> &indices,
+                        const std::vector<Vector3<typename Func::Scalar>> &positions,
+                        ThreadPool *thread_pool) {
+  using Real = typename Func::Scalar;
+  constexpr int kNumVertices = BatchEvaluator<Func>::kNumVertices;
+  constexpr int kInputDim = BatchEvaluator<Func>::kInputDim;
+  size_t n = functions.size();
+  BatchEvaluator<Func> evaluator(thread_pool, 64);
+  evaluator.SetElements(functions.data(), indices.data(), n);
+  std::vector<Real> values(n);
+  std::vector<Real> gradients(n * kInputDim);
+  std::vector<Real> hessians(n * kInputDim * kInputDim);
+  evaluator.Evaluate(positions.data(), values.data(), gradients.data(), hessians.data());
+
+  for (size_t e = 0; e < n; e++) {
+    typename Func::InputType x;
+    for (int v = 0; v < kNumVertices; v++) {
+      x.col(v) = positions[indices[e * kNumVertices + v]];
+    }
+    Real value = functions[e](x).value();
+    auto J = functions[e].Jacobian(x);
+    auto H = functions[e].Hessian(x);
+    Real scale = std::max(Real(1), H.m[0].cwiseAbs().maxCoeff());
+    EXPECT_NEAR(values[e], value, Real(1e-9) * std::max(Real(1), std::abs(value)));
+    for (int r = 0; r < kInputDim; r++) {
+      EXPECT_NEAR(gradients[r * n + e], J(0, r), Real(1e-9) * scale);
+      for (int c = 0; c < kInputDim; c++) {
+        EXPECT_NEAR(hessians[(r * kInputDim + c) * n + e], H.m[0](r, c), Real(1e-9) * scale);
+      }
+    }
+  }
+}
+
+std::vector<Vector3<double>> RandomPositions(size_t num_vertices, std::mt19937 &gen) {
+  std::uniform_real_distribution<double> dis(-1.0, 1.0);
+  std::vector<Vector3<double>> positions(num_vertices);
+  for (auto &p : positions) {
+    p = {dis(gen), dis(gen), dis(gen)};
+  }
+  return positions;
+}
+
+std::vector<uint32_t> RandomIndices(size_t num_elements, int num_vertices_per_element, size_t num_vertices,
+                                    std::mt19937 &gen) {
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> pool(num_vertices);
+  std::iota(pool.begin(), pool.end(), 0u);
+  for (size_t e = 0; e < num_elements; e++) {
+    std::shuffle(pool.begin(), pool.end(), gen);
+    indices.insert(indices.end(), pool.begin(), pool.begin() + num_vertices_per_element);
+  }
+  return indices;
+}
+
+}  // namespace
+
+TEST(Physics, BatchEvaluatorElasticNeoHookeanSimpleTriangle) {
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<double> dis(0.5, 2.0);
+  size_t num_elements = 1000;
+  auto positions = RandomPositions(300, gen);
+  auto indices = RandomIndices(num_elements, 3, positions.size(), gen);
+  std::vector<ElasticNeoHookeanSimpleTriangle<double>> functions(num_elements);
+  for (auto &function : functions) {
+    function.mu = dis(gen);
+    function.lambda = dis(gen);
+    do {
+      function.Dm << dis(gen), dis(gen) - 1.25, dis(gen) - 1.25, dis(gen);
+    } while (function.Dm.determinant() < 0.1);
+  }
+  ThreadPool thread_pool(3);
+  TestBatchEvaluator(functions, indices, positions, &thread_pool);
+  TestBatchEvaluator(functions, indices, positions, nullptr);
+}
+
+TEST(Physics, BatchEvaluatorDihedralEnergy) {
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<double> dis(-1.0, 1.0);
+  size_t num_elements = 500;
+  auto positions = RandomPositions(200, gen);
+  auto indices = RandomIndices(num_elements, 4, positions.size(), gen);
+  std::vector<DihedralEnergy<double>> functions(num_elements);
+  for (auto &function : functions) {
+    function.rest_angle = dis(gen);
+  }
+  ThreadPool thread_pool(3);
+  TestBatchEvaluator(functions, indices, positions, &thread_pool);
+  TestBatchEvaluator(functions, indices, positions, nullptr);
+}
+
+TEST(Physics, BatchEvaluatorConcurrentEvaluate) {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> dis(0.5, 2.0);
+  size_t num_elements = 1000;
+  auto indices = RandomIndices(num_elements, 3, 300, gen);
+  std::vector<ElasticNeoHookeanSimpleTriangle<double>> functions(num_elements);
+  for (auto &function : functions) {
+    function.mu = dis(gen);
+    function.lambda = dis(gen);
+    function.Dm << 1.0, 0.0, 0.0, 1.0;
+  }
+  BatchEvaluator<ElasticNeoHookeanSimpleTriangle<double>> evaluator(nullptr, 64);
+  evaluator.SetElements(functions.data(), indices.data(), num_elements);
+
+  // One evaluator shared by several threads, each with its own positions and outputs, gives the serial results.
+  const int kNumThreads = 4;
+  std::vector<std::vector<Vector3<double>>> positions(kNumThreads);
+  std::vector<std::vector<double>> expected(kNumThreads, std::vector<double>(num_elements * 9));
+  std::vector<std::vector<double>> gradients(kNumThreads, std::vector<double>(num_elements * 9));
+  for (int t = 0; t < kNumThreads; t++) {
+    positions[t] = RandomPositions(300, gen);
+    evaluator.Evaluate(positions[t].data(), nullptr, expected[t].data(), nullptr);
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t] {
+      for (int repeat = 0; repeat < 20; repeat++) {
+        evaluator.Evaluate(positions[t].data(), nullptr, gradients[t].data(), nullptr);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < kNumThreads; t++) {
+    EXPECT_EQ(gradients[t], expected[t]);
+  }
+}
@@ -177,6 +177,24 @@ void TestFunctionSetWithInput(
     }
   }
 
+  typename FunctionSet::OutputType y_all;
+  JacobiType J_all;
+  HessianType H_all;
+  EvaluateAll(f, InputVecToInputType(x), &y_all, &J_all, &H_all);
+  for (int j = 0; j < y.size(); j++) {
+    EXPECT_NEAR(y_all.data()[j], y(j), fmax(fabs(sqrt(eps) * y(j)), sqrt(eps)));
+  }
+  for (int j = 0; j < J.size(); j++) {
+    EXPECT_NEAR(J_all(j), J(j), fmax(fabs(sqrt(eps) * J(j)), sqrt(eps)));
+  }
+  for (int j = 0; j < OutputVec::SizeAtCompileTime; j++) {
+    for (int k = 0; k < InputVec::SizeAtCompileTime; k++) {
+      for (int l = 0; l < InputVec::SizeAtCompileTime; l++) {
+        EXPECT_NEAR(H_all.m[j](k, l), H.m[j](k, l), fmax(fabs(sqrt(eps) * H.m[j](k, l)), sqrt(eps)));
+      }
+    }
+  }
+
   if (diff) {
     std::cout << std::fixed;
     std::cout << "x:\n" << x << std::endl;
@@ -41,6 +41,15 @@ TEST(Physics, FunctionDerivativeCubeSDF) {
   }
 }
 
+TEST(Physics, FunctionDerivativeBoxSDF) {
+  for (int i = 0; i < 100; i++) {
+    BoxSDF<double> f;
+    f.center = Eigen::Vector3d::Random() * 0.1;
+    f.half_extent = {0.05, 0.1, 0.2};
+    TestFunctionSet<BoxSDF<double>>(f, 1);
+  }
+}
+
 TEST(Physics, FunctionDerivativePlaneSDF) {
   for (int i = 0; i < 100; i++) {
     PlaneSDF<double> f;
@@ -0,0 +1,114 @@
+#include "function_derivative_test.h"
+
+namespace {
+
+std::vector<uint32_t> RandomElements(size_t num_elements, int vertices_per_element, size_t num_vertices,
+                                     std::mt19937 &gen) {
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> pool(num_vertices);
+  std::iota(pool.begin(), pool.end(), 0u);
+  for (size_t e = 0; e < num_elements; e++) {
+    std::shuffle(pool.begin(), pool.end(), gen);
+    indices.insert(indices.end(), pool.begin(), pool.begin() + vertices_per_element);
+  }
+  return indices;
+}
+
+// Per-element Hessians in both layouts and the dense global matrix they sum up to.
+void RandomElementHessians(const std::vector<uint32_t> &indices,
+                           int vertices_per_element,
+                           std::mt19937 &gen,
+                           std::vector<double> *soa,
+                           std::vector<double> *element_major,
+                           Eigen::MatrixXd *dense) {
+  std::uniform_real_distribution<double> dis(-1.0, 1.0);
+  size_t n = indices.size() / vertices_per_element;
+  int dim = vertices_per_element * 3;
+  soa->resize(n * dim * dim);
+  element_major->resize(n * dim * dim);
+  for (size_t e = 0; e < n; e++) {
+    for (int r = 0; r < dim; r++) {
+      for (int c = 0; c < dim; c++) {
+        double value = dis(gen);
+        (*soa)[(r * dim + c) * n + e] = value;
+        (*element_major)[e * dim * dim + c * dim + r] = value;
+        (*dense)(indices[e * vertices_per_element + r / 3] * 3 + r % 3,
+                 indices[e * vertices_per_element + c / 3] * 3 + c % 3) += value;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(Physics, HessianAssemblerMatchesDenseAssembly) {
+  std::mt19937 gen(7);
+  size_t num_vertices = 120;
+  auto triangles = RandomElements(300, 3, num_vertices, gen);
+  auto quads = RandomElements(200, 4, num_vertices, gen);
+  Eigen::MatrixXd dense = Eigen::MatrixXd::Zero(num_vertices * 3, num_vertices * 3);
+  std::vector<double> triangle_soa, triangle_element_major, quad_soa, quad_element_major;
+  RandomElementHessians(triangles, 3, gen, &triangle_soa, &triangle_element_major, &dense);
+  RandomElementHessians(quads, 4, gen, &quad_soa, &quad_element_major, &dense);
+  std::vector<double> diagonal(num_vertices);
+  for (size_t v = 0; v < num_vertices; v++) {
+    diagonal[v] = 1.0 + v;
+    dense.block<3, 3>(v * 3, v * 3) += Eigen::Matrix3d::Identity() * diagonal[v];
+  }
+
+  ThreadPool thread_pool(3);
+  for (ThreadPool *pool : {static_cast<ThreadPool *>(nullptr), &thread_pool}) {
+    HessianAssembler<double> assembler(pool, 16);
+    int triangle_set = assembler.AddElementSet(triangles.data(), triangles.size() / 3, 3);
+    int quad_set = assembler.AddElementSet(quads.data(), quads.size() / 4, 4);
+    ASSERT_EQ(assembler.Build(num_vertices), 0);
+
+    for (auto layout : {ELEMENT_HESSIAN_LAYOUT_SOA, ELEMENT_HESSIAN_LAYOUT_ELEMENT_MAJOR}) {
+      bool soa = layout == ELEMENT_HESSIAN_LAYOUT_SOA;
+      assembler.SetZero();
+      assembler.Accumulate(triangle_set, soa ? triangle_soa.data() : triangle_element_major.data(), layout);
+      assembler.Accumulate(quad_set, soa ? quad_soa.data() : quad_element_major.data(), layout);
+      assembler.AddDiagonal(diagonal.data());
+
+      Eigen::SparseMatrix<double, Eigen::RowMajor> sparse;
+      assembler.ExportToEigen(&sparse);
+      EXPECT_NEAR((Eigen::MatrixXd(sparse) - dense).cwiseAbs().maxCoeff(), 0.0, 1e-12);
+      // A second export into the same matrix only rewrites the values.
+      const double *value_ptr = sparse.valuePtr();
+      assembler.ExportToEigen(&sparse);
+      EXPECT_EQ(sparse.valuePtr(), value_ptr);
+      EXPECT_NEAR((Eigen::MatrixXd(sparse) - dense).cwiseAbs().maxCoeff(), 0.0, 1e-12);
+      // A matrix with the same row lengths but other columns gets the pattern rebuilt.
+      Eigen::SparseMatrix<double, Eigen::RowMajor> other = sparse;
+      for (Eigen::Index row = 0; row < other.outerSize(); row++) {
+        for (int k = other.outerIndexPtr()[row]; k < other.outerIndexPtr()[row + 1]; k++) {
+          other.innerIndexPtr()[k] = k - other.outerIndexPtr()[row];
+        }
+      }
+      assembler.ExportToEigen(&other);
+      EXPECT_NEAR((Eigen::MatrixXd(other) - dense).cwiseAbs().maxCoeff(), 0.0, 1e-12);
+
+      Eigen::VectorXd x(num_vertices * 3);
+      for (Eigen::Index i = 0; i < x.size(); i++) {
+        x[i] = std::sin(0.1 * i);
+      }
+      Eigen::VectorXd y(num_vertices * 3);
+      assembler.Multiply(x.data(), y.data());
+      EXPECT_NEAR((y - dense * x).cwiseAbs().maxCoeff(), 0.0, 1e-10);
+    }
+
+    for (size_t v = 0; v < num_vertices; v++) {
+      EXPECT_GE(assembler.BlockIndex(v, v), 0);
+    }
+  }
+}
+
+TEST(Physics, HessianAssemblerRejectsOutOfRangeVertices) {
+  std::vector<uint32_t> triangles = {0, 1, 5};
+  HessianAssembler<float> assembler;
+  assembler.AddElementSet(triangles.data(), 1, 3);
+  EXPECT_EQ(assembler.Build(5), -1);
+  EXPECT_EQ(assembler.Build(6), 0);
+  EXPECT_EQ(assembler.NumBlocks(), 3 * 3 + 3);
+  EXPECT_EQ(assembler.BlockIndex(2, 0), -1);
+}
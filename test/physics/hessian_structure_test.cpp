@@ -0,0 +1,91 @@
+#include "function_derivative_test.h"
+
+namespace {
+
+template <typename Func>
+typename Func::InputType RandomInput(std::mt19937 &gen) {
+  std::uniform_real_distribution<typename Func::Scalar> dis(-0.2, 0.2);
+  typename Func::InputType x;
+  for (int c = 0; c < x.cols(); c++) {
+    for (int r = 0; r < x.rows(); r++) {
+      x(r, c) = (r + 1 == c ? 1 : 0) + dis(gen);
+    }
+  }
+  return x;
+}
+
+template <typename Func>
+void TestDeclaredHessianStructure(Func f = Func{}) {
+  std::mt19937 gen(17);
+  for (int trial = 0; trial < 20; trial++) {
+    auto x = RandomInput<Func>(gen);
+    if (!f.ValidInput(x)) {
+      continue;
+    }
+    auto H = f.Hessian(x);
+    for (int i = 0; i < Func::OutputType::SizeAtCompileTime; i++) {
+      double scale = std::max(1.0, static_cast<double>(H.m[i].cwiseAbs().maxCoeff()));
+      if (HessianStructureOf<Func>::value == HESSIAN_STRUCTURE_ZERO) {
+        EXPECT_EQ(H.m[i].cwiseAbs().maxCoeff(), 0);
+      } else if (HessianStructureOf<Func>::value == HESSIAN_STRUCTURE_SYMMETRIC) {
+        EXPECT_LE((H.m[i] - H.m[i].transpose()).cwiseAbs().maxCoeff(), 1e-9 * scale);
+      }
+    }
+  }
+}
+
+// The chain rule evaluated densely, without any structure.
+template <typename Func1, typename Func2>
+HessianType<Compose<Func1, Func2>> DenseComposeHessian(const Compose<Func1, Func2> &f,
+                                                       const typename Func1::InputType &x) {
+  auto y = f.f1(x);
+  return f.f2.Hessian(y) * f.f1.Jacobian(x) + f.f2.Jacobian(y) * f.f1.Hessian(x);
+}
+
+}  // namespace
+
+TEST(Physics, HessianStructureDeclarations) {
+  TestDeclaredHessianStructure<Determinant3<double>>();
+  TestDeclaredHessianStructure<LogDeterminant3<double>>();
+  TestDeclaredHessianStructure<Cross3<double>>();
+  TestDeclaredHessianStructure<CrossNorm<double>>();
+  TestDeclaredHessianStructure<Dot<double>>();
+  TestDeclaredHessianStructure<VecNormalized<double>>();
+  TestDeclaredHessianStructure<ElasticNeoHookean<double>>();
+  TestDeclaredHessianStructure<ElasticNeoHookeanSimpleF3x2<double>>();
+  TestDeclaredHessianStructure<ElasticNeoHookeanSimpleTriangle<double>>({1.0, 1.0, Eigen::Matrix2<double>::Identity()});
+  TestDeclaredHessianStructure<ElasticNeoHookeanTetrahedron<double>>({1.0, 1.0, Eigen::Matrix3<double>::Identity()});
+  TestDeclaredHessianStructure<FEMTetrahedronDeformationGradient<double>>({Eigen::Matrix3<double>::Identity()});
+  TestDeclaredHessianStructure<FEMTriangleDeformationGradient3x3<double>>({Eigen::Matrix2<double>::Identity()});
+  TestDeclaredHessianStructure<DihedralAngleAssistVerticesToEdges<double>>();
+  TestDeclaredHessianStructure<DihedralAngleAssistEdgesToNormalsAxis<double>>();
+  TestDeclaredHessianStructure<DihedralAngleAssistNormalsAxisToSinCosTheta<double>>();
+  TestDeclaredHessianStructure<DihedralAngleByVertices<double>>();
+  TestDeclaredHessianStructure<DihedralEnergy<double>>();
+}
+
+TEST(Physics, HessianStructureCompose) {
+  static_assert(DihedralAngleByVertices<double>::kHessianStructure == HESSIAN_STRUCTURE_SYMMETRIC);
+  static_assert(Compose<FEMTetrahedronDeformationGradient<double>, ElasticNeoHookean<double>>::kHessianStructure ==
+                HESSIAN_STRUCTURE_SYMMETRIC);
+  static_assert(Compose<DihedralAngleAssistVerticesToEdges<double>, FEMTetrahedronDeformationGradient<double>>::
+                    kHessianStructure == HESSIAN_STRUCTURE_ZERO);
+
+  std::mt19937 gen(23);
+  DihedralAngleByVertices<double> dihedral;
+  for (int trial = 0; trial < 20; trial++) {
+    auto x = RandomInput<DihedralAngleByVertices<double>>(gen);
+    auto H = dihedral.Hessian(x);
+    auto H_dense = DenseComposeHessian(dihedral, x);
+    EXPECT_LE((H.m[0] - H_dense.m[0]).cwiseAbs().maxCoeff(), 1e-9 * std::max(1.0, H_dense.m[0].cwiseAbs().maxCoeff()));
+  }
+
+  Compose<FEMTetrahedronDeformationGradient<double>, ElasticNeoHookean<double>> neo_hookean{
+      {Eigen::Matrix3<double>::Identity()}, {1.0, 2.0}};
+  for (int trial = 0; trial < 20; trial++) {
+    Eigen::Matrix<double, 3, 4> x = RandomInput<ElasticNeoHookeanTetrahedron<double>>(gen);
+    auto H = neo_hookean.Hessian(x);
+    auto H_dense = DenseComposeHessian(neo_hookean, x);
+    EXPECT_LE((H.m[0] - H_dense.m[0]).cwiseAbs().maxCoeff(), 1e-9 * std::max(1.0, H_dense.m[0].cwiseAbs().maxCoeff()));
+  }
+}
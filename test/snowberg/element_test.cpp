@@ -0,0 +1,78 @@
+#include <random>
+
+#include "snowberg_test.h"
+
+namespace {
+
+// Energy whose derivatives StretchingEnergy evaluates.
+float StretchingEnergyValue(const solver::StretchingRestState &rest_state, const Matrix3<float> &X) {
+  Matrix<float, 3, 2> F = X * rest_state.gradients;
+  float J = F.col(0).cross(F.col(1)).norm();
+  return 0.5f * rest_state.mu * F.squaredNorm() + 0.5f * rest_state.lambda * (J - rest_state.a) * (J - rest_state.a);
+}
+
+}  // namespace
+
+TEST(Snowberg, StretchingRestState) {
+  std::mt19937 rng(17);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  for (int trial = 0; trial < 100; trial++) {
+    solver::ElementStretching stretching;
+    stretching.mu = 2.0f + uniform(rng);
+    stretching.lambda = 5.0f + uniform(rng);
+    stretching.Dm << 1.0f + 0.3f * uniform(rng), 0.3f * uniform(rng), 0.0f, 1.0f + 0.3f * uniform(rng);
+    stretching.area = 0.5f * stretching.Dm.determinant();
+    solver::StretchingRestState rest_state = stretching.RestState();
+
+    Matrix3<float> X = Matrix3<float>::Identity() + 0.3f * Matrix3<float>::Random();
+    Matrix<float, 3, 2> Ds;
+    Ds << X.col(1) - X.col(0), X.col(2) - X.col(0);
+    EXPECT_LT((X * rest_state.gradients - Ds * stretching.Dm.inverse()).norm(), 1e-4f);
+
+    for (int self_index = 0; self_index < 3; self_index++) {
+      Vector3<float> jacobian;
+      Matrix3<float> hessian;
+      solver::vbd::StretchingEnergy(rest_state, X, self_index, jacobian, hessian);
+      const float h = 1e-3f;
+      for (int k = 0; k < 3; k++) {
+        Matrix3<float> X_plus = X;
+        Matrix3<float> X_minus = X;
+        X_plus(k, self_index) += h;
+        X_minus(k, self_index) -= h;
+        float difference = (StretchingEnergyValue(rest_state, X_plus) - StretchingEnergyValue(rest_state, X_minus)) /
+                           (2.0f * h);
+        EXPECT_NEAR(jacobian[k], difference, 2e-2f * (1.0f + std::abs(difference)));
+      }
+    }
+  }
+}
+
+TEST(Snowberg, SceneHostPlasticityUpdatesRestState) {
+  // A stretched cloth with a bounded singular value yields plastically, the cached rest states follow every new Dm.
+  const int n = 8;
+  solver::ObjectPack object_pack = GridCloth(n, 0.1f, Vector3<float>{0.0f, 1.0f, 0.0f}, 1.01f);
+  for (size_t i = 0; i < object_pack.x.size(); i++) {
+    object_pack.x[i] *= 1.1f;
+  }
+  solver::Scene scene;
+  scene.AddObject(object_pack);
+  solver::SceneHost scene_host(scene);
+  solver::SceneRef scene_ref = scene_host;
+  std::vector<solver::ElementStretching> initial(scene_ref.stretchings,
+                                                 scene_ref.stretchings + scene_ref.num_stretching);
+  for (int step = 0; step < 3; step++) {
+    solver::SceneHost::Update(scene_host, 1.0f / 120.0f);
+  }
+
+  int num_yielded = 0;
+  for (int i = 0; i < scene_ref.num_stretching; i++) {
+    num_yielded += (scene_ref.stretchings[i].Dm - initial[i].Dm).norm() > 1e-4f;
+    solver::StretchingRestState expected = scene_ref.stretchings[i].RestState();
+    const solver::StretchingRestState &cached = scene_ref.stretching_rest_states[i];
+    EXPECT_EQ(cached.gradients, expected.gradients);
+    EXPECT_EQ(cached.mu, expected.mu);
+    EXPECT_EQ(cached.lambda, expected.lambda);
+    EXPECT_EQ(cached.a, expected.a);
+  }
+  EXPECT_GT(num_yielded, 0);
+}
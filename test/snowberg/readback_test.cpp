@@ -0,0 +1,36 @@
+#include "snowberg_test.h"
+
+TEST(Snowberg, SceneHostReadPositionsAsync) {
+  const int n = 10;
+  const float dt = 1.0f / 120.0f;
+  solver::Scene scene = BuildClothScene(n, 0.02f, 0.05f);
+  // A subset of the particles out of id order.
+  std::vector<int> particle_ids;
+  for (int id = n * n - 1; id >= 0; id -= 3) {
+    particle_ids.push_back(id);
+  }
+
+  ThreadPool thread_pool(2);
+  for (ThreadPool *pool : {static_cast<ThreadPool *>(nullptr), &thread_pool}) {
+    solver::SceneHost scene_host(scene, pool);
+    solver::PositionReadback readback(particle_ids);
+    ASSERT_EQ(readback.NumBuffers(), 2);
+    std::vector<std::vector<Vector3<float>>> expected;
+    std::vector<solver::ReadbackFence> fences;
+    for (int frame = 0; frame < 6; frame++) {
+      // The readback of a frame overlaps the step of the next one and still holds the positions of its own frame.
+      fences.push_back(scene_host.ReadPositionsAsync(readback));
+      expected.push_back(scene_host.GetPositions(particle_ids));
+      solver::SceneHost::Update(scene_host, dt);
+      EXPECT_EQ(fences[frame].Buffer(), frame % 2);
+      const Vector3<float> *positions = fences[frame].Wait();
+      EXPECT_TRUE(fences[frame].Ready());
+      EXPECT_EQ(std::vector<Vector3<float>>(positions, positions + particle_ids.size()), expected[frame]);
+      if (frame > 0) {
+        const Vector3<float> *previous = fences[frame - 1].Wait();
+        EXPECT_NE(previous, positions);
+        EXPECT_EQ(std::vector<Vector3<float>>(previous, previous + particle_ids.size()), expected[frame - 1]);
+      }
+    }
+  }
+}
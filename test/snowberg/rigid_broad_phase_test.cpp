@@ -0,0 +1,144 @@
+#include <random>
+
+#include "snowberg_test.h"
+
+namespace {
+
+solver::RigidObjectRef BoxAt(const MeshSDF &mesh, const Vector3<float> &t, float scale, float angle = 0.0f) {
+  solver::RigidObjectRef rigid_object{};
+  rigid_object.mesh_sdf = mesh;
+  Vector3<float> axis = Vector3<float>{1.0f, 2.0f, 3.0f}.normalized();
+  rigid_object.state.R = Eigen::AngleAxis<float>(angle, axis).toRotationMatrix() * scale;
+  rigid_object.state.t = t;
+  rigid_object.state.v = Vector3<float>::Zero();
+  rigid_object.state.omega = Vector3<float>::Zero();
+  rigid_object.state.mass = 1.0f;
+  rigid_object.state.inertia = Matrix3<float>::Identity();
+  rigid_object.stiffness = 1e5f;
+  rigid_object.friction = 0.3f;
+  return rigid_object;
+}
+
+}  // namespace
+
+TEST(Snowberg, RigidBroadPhaseCandidates) {
+  const int num_rigid_object = 40;
+  const int num_particle = 2000;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+  std::uniform_real_distribution<float> motion(-0.2f, 0.2f);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  std::vector<MeshSDF> meshes(num_rigid_object, UnitCube());
+  std::vector<solver::RigidObjectRef> rigid_objects;
+  for (int i = 0; i < num_rigid_object; i++) {
+    rigid_objects.push_back(BoxAt(meshes[i], Vector3<float>{position(rng), position(rng), position(rng)},
+                                  0.1f + 0.2f * unit(rng), 6.0f * unit(rng)));
+  }
+  std::vector<Vector3<float>> x_prev(num_particle);
+  std::vector<Vector3<float>> x(num_particle);
+  for (int i = 0; i < num_particle; i++) {
+    x_prev[i] = Vector3<float>{position(rng), position(rng), position(rng)};
+    x[i] = x_prev[i] + Vector3<float>{motion(rng), motion(rng), motion(rng)};
+  }
+
+  ThreadPool thread_pool(3);
+  solver::RigidBroadPhase serial(meshes);
+  solver::RigidBroadPhase parallel(meshes);
+  serial.UpdateBounds(rigid_objects.data(), num_rigid_object);
+  parallel.UpdateBounds(rigid_objects.data(), num_rigid_object);
+  serial.UpdateCandidates(x_prev.data(), x.data(), num_particle);
+  parallel.UpdateCandidates(x_prev.data(), x.data(), num_particle, &thread_pool);
+  EXPECT_EQ(serial.Candidates().first, parallel.Candidates().first);
+  EXPECT_EQ(serial.Candidates().count, parallel.Candidates().count);
+  EXPECT_EQ(serial.Candidates().positions, parallel.Candidates().positions);
+
+  const std::vector<Vector3<float>> &bounds = serial.Bounds();
+  const solver::Directory &candidates = serial.Candidates();
+  int total_candidates = 0;
+  for (int p = 0; p < num_particle; p++) {
+    const Vector4<float> &sphere = serial.Spheres()[p];
+    std::vector<int> expected;
+    for (int i = 0; i < num_rigid_object; i++) {
+      if (DistancePointAABB<float>(sphere.head<3>(), bounds[i * 2], bounds[i * 2 + 1]) <= sphere[3]) {
+        expected.push_back(i);
+      }
+    }
+    std::vector<int> actual(candidates.positions.begin() + candidates.first[p],
+                            candidates.positions.begin() + candidates.first[p] + candidates.count[p]);
+    EXPECT_EQ(actual, expected);
+    total_candidates += candidates.count[p];
+
+    // Every object in contact with a point of the sphere is a candidate.
+    for (int sample = 0; sample < 4; sample++) {
+      Vector3<float> q = x_prev[p] + (x[p] - x_prev[p]) * (1.5f * unit(rng) - 0.25f);
+      for (int i = 0; i < num_rigid_object; i++) {
+        float sdf;
+        Vector3<float> jacobian;
+        Matrix3<float> hessian;
+        MeshSDFRef mesh_sdf = rigid_objects[i].mesh_sdf;
+        mesh_sdf.SDF(q, rigid_objects[i].state.R, rigid_objects[i].state.t, &sdf, &jacobian, &hessian);
+        if (sdf < solver::kRigidContactMargin) {
+          EXPECT_NE(std::find(actual.begin(), actual.end(), i), actual.end());
+        }
+      }
+    }
+  }
+  // Far from every object most particles have no candidate at all.
+  EXPECT_LT(total_candidates, num_particle);
+
+  // Particles without a color are free slots and get none either.
+  std::vector<int> particle_colors(num_particle);
+  for (int p = 0; p < num_particle; p++) {
+    particle_colors[p] = p % 2 ? -1 : 0;
+  }
+  parallel.UpdateCandidates(x_prev.data(), x.data(), num_particle, &thread_pool, particle_colors.data());
+  for (int p = 0; p < num_particle; p++) {
+    EXPECT_EQ(parallel.Candidates().count[p], p % 2 ? 0 : candidates.count[p]);
+  }
+}
+
+TEST(Snowberg, SceneHostRigidBroadPhase) {
+  // A cloth falling onto a row of boxes settles exactly as when every particle tests every box.
+  const int n = 16;
+  const float dt = 1.0f / 120.0f;
+  std::vector<Vector3<float>> pos_grid;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      pos_grid.emplace_back(i * 0.05f, 0.2f, j * 0.05f);
+    }
+  }
+  solver::Scene scene;
+  scene.AddObject(solver::ObjectPack::CreateGridCloth(pos_grid, n, n));
+  MeshSDF cube = UnitCube();
+  for (int i = 0; i < 12; i++) {
+    solver::RigidObjectRef box = BoxAt(cube, Vector3<float>{i * 0.08f, 0.0f, 0.4f}, 0.15f);
+    scene.AddRigidBody(solver::RigidObject{cube, box.state, box.stiffness, box.friction});
+  }
+
+  std::vector<int> particle_ids(n * n);
+  for (int i = 0; i < n * n; i++) {
+    particle_ids[i] = i;
+  }
+  std::vector<std::vector<Vector3<float>>> results;
+  for (bool rigid_broad_phase : {false, true}) {
+    solver::SolverSettings settings;
+    settings.rigid_broad_phase = rigid_broad_phase;
+    solver::SceneHost scene_host(scene);
+    scene_host.SetSolverSettings(settings);
+    for (int step = 0; step < 20; step++) {
+      solver::SceneHost::Update(scene_host, dt);
+    }
+    results.push_back(scene_host.GetPositions(particle_ids));
+  }
+  EXPECT_EQ(results[0], results[1]);
+  // The boxes form a bar with its top at y = 0.15 and 0.25 < z < 0.55. The cloth above it rests on it, the rest falls
+  // past it.
+  for (const auto &p : results[1]) {
+    if (std::abs(p.z() - 0.4f) < 0.12f) {
+      EXPECT_GT(p.y(), 0.15f);
+    } else if (std::abs(p.z() - 0.4f) > 0.3f) {
+      EXPECT_LT(p.y(), 0.15f);
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#include <memory>
+
+#include "snowberg_test.h"
+
+TEST(Snowberg, SceneHostBatch) {
+  const float dt = 1.0f / 120.0f;
+  const int num_steps = 8;
+  MeshSDF cube = UnitCube();
+  // Environments of different sizes, so their ranges in the arena and their color counts differ.
+  std::vector<int> sizes = {6, 9, 4, 7};
+  std::vector<solver::Scene> scenes;
+  for (int n : sizes) {
+    scenes.push_back(BuildClothOnBoxScene(n, cube, 0.01f * n));
+  }
+  std::vector<const solver::Scene *> scene_pointers;
+  std::vector<std::unique_ptr<solver::SceneHost>> scene_hosts;
+  std::vector<solver::SceneHost *> scene_host_pointers;
+  for (const solver::Scene &scene : scenes) {
+    scene_pointers.push_back(&scene);
+    scene_hosts.push_back(std::make_unique<solver::SceneHost>(scene));
+    scene_host_pointers.push_back(scene_hosts.back().get());
+  }
+
+  // Steps exactly as SceneHost::UpdateBatch does over separate scene hosts.
+  ThreadPool thread_pool;
+  solver::SceneHostBatch batch(scene_pointers, &thread_pool);
+  ASSERT_EQ(batch.NumEnvironments(), static_cast<int>(scenes.size()));
+  std::vector<std::vector<std::vector<Vector3<float>>>> trajectories(scenes.size());
+  for (int step = 0; step < num_steps; step++) {
+    solver::SceneHost::UpdateBatch(scene_host_pointers, dt);
+    solver::SceneHostBatch::Update(batch, dt);
+    for (size_t e = 0; e < scenes.size(); e++) {
+      std::vector<int> particle_ids = ParticleRange(0, sizes[e] * sizes[e]);
+      trajectories[e].push_back(batch.GetPositions(e, particle_ids));
+      EXPECT_EQ(trajectories[e].back(), scene_hosts[e]->GetPositions(particle_ids));
+      EXPECT_EQ(batch.GetRigidObjectState(e, 0).t, scene_hosts[e]->GetRigidObjectState(0).t);
+    }
+  }
+
+  // A reset environment replays its trajectory while the others carry on undisturbed.
+  batch.Reset(1);
+  solver::SceneHostBatch::Update(batch, dt);
+  solver::SceneHost::UpdateBatch(scene_host_pointers, dt);
+  std::vector<int> particle_ids = ParticleRange(0, sizes[1] * sizes[1]);
+  EXPECT_EQ(batch.GetPositions(1, particle_ids), trajectories[1][0]);
+  for (int e : {0, 2, 3}) {
+    std::vector<int> other_ids = ParticleRange(0, sizes[e] * sizes[e]);
+    EXPECT_EQ(batch.GetPositions(e, other_ids), scene_hosts[e]->GetPositions(other_ids));
+  }
+  for (int step = 1; step < num_steps; step++) {
+    solver::SceneHostBatch::Update(batch, dt);
+    EXPECT_EQ(batch.GetPositions(1, particle_ids), trajectories[1][step]);
+  }
+
+  // Replicas of one scene, without a thread pool, step like the original.
+  solver::SceneHostBatch replicas(scenes[2], 3);
+  solver::SceneHost single(scenes[2]);
+  for (int step = 0; step < num_steps; step++) {
+    solver::SceneHostBatch::Update(replicas, dt);
+    solver::SceneHost::UpdateBatch({&single}, dt);
+  }
+  particle_ids = ParticleRange(0, sizes[2] * sizes[2]);
+  for (int e = 0; e < replicas.NumEnvironments(); e++) {
+    EXPECT_EQ(replicas.GetPositions(e, particle_ids), single.GetPositions(particle_ids));
+  }
+  EXPECT_THROW(replicas.GetPositions(0, {sizes[2] * sizes[2]}), std::out_of_range);
+}
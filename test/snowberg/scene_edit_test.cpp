@@ -0,0 +1,221 @@
+#include <map>
+#include <random>
+#include <set>
+
+#include "snowberg_test.h"
+
+namespace {
+
+std::vector<Vector3<float>> Step(solver::SceneHost &scene_host, int num_steps, const std::vector<int> &particle_ids) {
+  for (int step = 0; step < num_steps; step++) {
+    solver::SceneHost::Update(scene_host, 1.0f / 120.0f);
+  }
+  return scene_host.GetPositions(particle_ids);
+}
+
+// The live particles are exactly those in the color directory, and no element joins two particles of one color.
+void ExpectValidColoring(solver::SceneRef scene_ref,
+                         const solver::Directory &colors,
+                         const std::vector<int> &live_particle_ids) {
+  std::vector<int> color_of(scene_ref.num_particle, -1);
+  for (size_t c = 0; c < colors.first.size(); c++) {
+    for (int i = 0; i < colors.count[c]; i++) {
+      int pidx = colors.positions[colors.first[c] + i];
+      EXPECT_EQ(color_of[pidx], -1);
+      color_of[pidx] = c;
+    }
+  }
+  int num_colored = 0;
+  for (int color : color_of) {
+    num_colored += color >= 0;
+  }
+  EXPECT_EQ(num_colored, static_cast<int>(live_particle_ids.size()));
+  for (int id : live_particle_ids) {
+    EXPECT_GE(color_of[scene_ref.ParticleIndex(id)], 0);
+  }
+  auto expect_distinct = [&](const int *indices, int size) {
+    if (indices[0] < 0) {
+      return;
+    }
+    for (int a = 0; a < size; a++) {
+      for (int b = a + 1; b < size; b++) {
+        EXPECT_NE(color_of[indices[a]], color_of[indices[b]]);
+      }
+    }
+  };
+  for (int s = 0; s < scene_ref.num_stretching; s++) {
+    expect_distinct(scene_ref.stretching_indices + s * 3, 3);
+  }
+  for (int b = 0; b < scene_ref.num_bending; b++) {
+    expect_distinct(scene_ref.bending_indices + b * 4, 4);
+  }
+}
+
+}  // namespace
+
+TEST(Snowberg, DynamicDirectory) {
+  std::mt19937 rng(29);
+  const int num_bucket = 12;
+  const int num_content = 400;
+  std::vector<int> initial(num_content / 2);
+  for (auto &bucket : initial) {
+    bucket = rng() % num_bucket;
+  }
+  solver::DynamicDirectory directory{solver::Directory(initial, num_bucket)};
+  std::map<int, int> reference;
+  for (int content = 0; content < static_cast<int>(initial.size()); content++) {
+    reference[content] = initial[content];
+  }
+
+  for (int edit = 0; edit < 20000; edit++) {
+    int content = rng() % num_content;
+    auto it = reference.find(content);
+    if (it != reference.end()) {
+      directory.Erase(content);
+      reference.erase(it);
+    } else {
+      // Occasionally opens buckets past the end.
+      int bucket = rng() % (edit % 1000 == 999 ? num_bucket * 2 : num_bucket);
+      directory.Insert(bucket, content);
+      reference[content] = bucket;
+    }
+  }
+
+  const solver::Directory &result = directory.GetDirectory();
+  std::vector<std::set<int>> expected(directory.NumBuckets());
+  for (const auto &[content, bucket] : reference) {
+    expected[bucket].insert(content);
+  }
+  for (int b = 0; b < directory.NumBuckets(); b++) {
+    std::set<int> actual(result.positions.begin() + result.first[b],
+                         result.positions.begin() + result.first[b] + result.count[b]);
+    EXPECT_EQ(actual, expected[b]);
+    EXPECT_EQ(result.count[b], static_cast<int>(expected[b].size()));
+  }
+  // Abandoned ranges are compacted away.
+  EXPECT_LT(result.positions.size(), 8 * num_content);
+}
+
+TEST(Snowberg, SceneHostAddRemoveObject) {
+  const int n = 8;
+  solver::ObjectPack cloth_a = GridCloth(n, 0.05f, Vector3<float>{0.0f, 1.0f, 0.0f});
+  solver::ObjectPack cloth_b = GridCloth(n, 0.05f, Vector3<float>{1.0f, 1.0f, 0.0f});
+  solver::ObjectPack cloth_c = GridCloth(n, 0.05f, Vector3<float>{0.0f, 1.0f, 1.0f});
+
+  solver::Scene scene_a;
+  solver::ObjectPackView view_a = scene_a.AddObject(cloth_a);
+  solver::Scene scene_ab = scene_a;
+  solver::ObjectPackView view_ab_b = scene_ab.AddObject(cloth_b);
+  solver::Scene scene_ac = scene_a;
+  solver::ObjectPackView view_ac_c = scene_ac.AddObject(cloth_c);
+
+  // Adding to a running scene colors and lays out the new object as a rebuild would.
+  solver::SceneHost edited(scene_a);
+  Step(edited, 3, view_a.particle_ids);
+  solver::ObjectPackView view_b = edited.AddObject(cloth_b);
+  std::vector<int> ab_ids = view_a.particle_ids;
+  ab_ids.insert(ab_ids.end(), view_b.particle_ids.begin(), view_b.particle_ids.end());
+  ExpectValidColoring(edited, edited.GetColorDirectory(), ab_ids);
+
+  solver::SceneHost fresh_b(scene_ab);
+  std::vector<Vector3<float>> expected_b = Step(fresh_b, 5, view_ab_b.particle_ids);
+  EXPECT_EQ(Step(edited, 5, view_b.particle_ids), expected_b);
+
+  // Removing an object leaves the rest untouched.
+  int num_slots = solver::SceneRef(edited).num_particle;
+  edited.RemoveObject(view_b);
+  ExpectValidColoring(edited, edited.GetColorDirectory(), view_a.particle_ids);
+  solver::SceneHost alone_a(scene_a);
+  EXPECT_EQ(Step(edited, 4, view_a.particle_ids), Step(alone_a, 12, view_a.particle_ids));
+  EXPECT_EQ(solver::SceneRef(edited).ParticleIndex(view_b.particle_ids[0]), -1);
+  EXPECT_THROW(edited.GetPositions({view_a.particle_ids[0], view_b.particle_ids[0]}), std::out_of_range);
+  EXPECT_THROW(edited.GetPositions({1 << 20}), std::out_of_range);
+  solver::PositionReadback removed_readback(view_b.particle_ids);
+  EXPECT_THROW(edited.ReadPositionsAsync(removed_readback), std::out_of_range);
+
+  // A new object takes over the freed slots.
+  solver::ObjectPackView view_c = edited.AddObject(cloth_c);
+  EXPECT_EQ(solver::SceneRef(edited).num_particle, num_slots);
+  std::vector<int> ac_ids = view_a.particle_ids;
+  ac_ids.insert(ac_ids.end(), view_c.particle_ids.begin(), view_c.particle_ids.end());
+  ExpectValidColoring(edited, edited.GetColorDirectory(), ac_ids);
+  solver::SceneHost fresh_c(scene_ac);
+  EXPECT_EQ(Step(edited, 5, view_c.particle_ids), Step(fresh_c, 5, view_ac_c.particle_ids));
+
+  // Snapshots follow the edited topology.
+  std::vector<uint8_t> snapshot = edited.Snapshot();
+  std::vector<Vector3<float>> expected_c = Step(edited, 2, view_c.particle_ids);
+  edited.Restore(snapshot);
+  EXPECT_EQ(Step(edited, 2, view_c.particle_ids), expected_c);
+  solver::SceneHost unedited(scene_ac);
+  EXPECT_THROW(unedited.Restore(snapshot), std::runtime_error);
+}
+
+TEST(Snowberg, SceneHostAddObjectWithoutElements) {
+  const int n = 8;
+  // A cloth without bendings and with one free particle, neither reaches the last particle slot in every directory.
+  solver::ObjectPack cloth_b = GridCloth(n, 0.05f, Vector3<float>{1.0f, 1.0f, 0.0f});
+  cloth_b.bendings.clear();
+  cloth_b.bending_indices.clear();
+  cloth_b.x.emplace_back(1.0f, 2.0f, 1.0f);
+  cloth_b.v.emplace_back(Vector3<float>::Zero());
+  cloth_b.m.push_back(0.01f);
+
+  solver::Scene scene_a;
+  solver::ObjectPackView view_a = scene_a.AddObject(GridCloth(n, 0.05f, Vector3<float>{0.0f, 1.0f, 0.0f}));
+  solver::Scene scene_ab = scene_a;
+  solver::ObjectPackView view_ab_b = scene_ab.AddObject(cloth_b);
+
+  solver::SceneHost edited(scene_a);
+  Step(edited, 3, view_a.particle_ids);
+  solver::ObjectPackView view_b = edited.AddObject(cloth_b);
+  std::vector<int> ab_ids = view_a.particle_ids;
+  ab_ids.insert(ab_ids.end(), view_b.particle_ids.begin(), view_b.particle_ids.end());
+  ExpectValidColoring(edited, edited.GetColorDirectory(), ab_ids);
+
+  solver::SceneHost fresh(scene_ab);
+  EXPECT_EQ(Step(edited, 5, view_b.particle_ids), Step(fresh, 5, view_ab_b.particle_ids));
+}
+
+TEST(Snowberg, SceneHostRemoveObjectSelfContact) {
+  const int n = 8;
+  solver::ObjectPack top = GridCloth(n, 0.05f, Vector3<float>{0.013f, 1.03f, 0.021f});
+  for (auto &v : top.v) {
+    v = Vector3<float>{0.0f, -1.0f, 0.0f};
+  }
+  solver::Scene scene;
+  solver::ObjectPackView view_bottom = scene.AddObject(GridCloth(n, 0.05f, Vector3<float>{0.0f, 1.0f, 0.0f}));
+  solver::ObjectPackView view_top = scene.AddObject(top);
+  solver::Scene scene_top;
+  solver::ObjectPackView view_alone = scene_top.AddObject(top);
+  solver::SolverSettings settings;
+  settings.self_contact = true;
+
+  // The freed slots of the bottom sheet stay where it was removed, and the top sheet falls through them as if the
+  // bottom sheet had never been there.
+  solver::SceneHost edited(scene);
+  edited.SetSolverSettings(settings);
+  edited.RemoveObject(view_bottom);
+  solver::SceneHost alone(scene_top);
+  alone.SetSolverSettings(settings);
+  std::vector<Vector3<float>> positions = Step(edited, 30, view_top.particle_ids);
+  std::vector<Vector3<float>> expected = Step(alone, 30, view_alone.particle_ids);
+  // Nothing else is near the falling sheet, it moves as without self contact. Its own primitives bound each step to
+  // less than it falls, so the contacts are detected again within the step.
+  solver::SceneHost free(scene_top);
+  std::vector<Vector3<float>> free_positions = Step(free, 30, view_alone.particle_ids);
+  for (int i = 0; i < n * n; i++) {
+    EXPECT_NEAR(expected[i].y(), free_positions[i].y(), 1e-3f);
+  }
+  EXPECT_LT(expected[0].y(), 0.5f);
+  EXPECT_GT(alone.GetSolverStatistics().contact_detections, 1);
+  for (int i = 0; i < n * n; i++) {
+    EXPECT_NEAR(positions[i].y(), expected[i].y(), 1e-4f);
+  }
+  solver::SceneRef scene_ref = edited;
+  int num_frozen = 0;
+  for (int pidx = 0; pidx < scene_ref.num_particle; pidx++) {
+    num_frozen += scene_ref.x[pidx] == scene_ref.x_prev[pidx] && scene_ref.x[pidx].y() == 1.0f;
+  }
+  EXPECT_EQ(num_frozen, n * n);
+}
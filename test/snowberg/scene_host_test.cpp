@@ -0,0 +1,161 @@
+#include "snowberg_test.h"
+
+TEST(Snowberg, SceneHostFreeFall) {
+  // A cloth at rest only feels gravity in its first step.
+  const int n = 8;
+  const float dt = 1.0f / 240.0f;
+  solver::Scene scene = BuildClothScene(n);
+  solver::SceneHost scene_host(scene);
+  solver::SceneHost::Update(scene_host, dt);
+  auto before = scene.GetPositions(ParticleRange(0, n * n));
+  auto after = scene_host.GetPositions(ParticleRange(0, n * n));
+  for (int i = 0; i < n * n; i++) {
+    EXPECT_NEAR(after[i].x(), before[i].x(), 1e-5f);
+    EXPECT_NEAR(after[i].y(), before[i].y() - 9.8f * dt * dt, 1e-5f);
+    EXPECT_NEAR(after[i].z(), before[i].z(), 1e-5f);
+  }
+}
+
+TEST(Snowberg, SceneHostThreadCountIndependent) {
+  // Particles of one color share no element, so the sweep gives the same result however it is split.
+  const int n = 12;
+  const float dt = 1.0f / 120.0f;
+  solver::Scene scene = BuildClothScene(n, 0.02f);
+  std::vector<int> particle_ids = ParticleRange(0, n * n);
+  ThreadPool thread_pool(3);
+  solver::SceneHost serial(scene);
+  solver::SceneHost parallel(scene, &thread_pool);
+  for (int step = 0; step < 5; step++) {
+    solver::SceneHost::Update(serial, dt);
+    solver::SceneHost::Update(parallel, dt);
+  }
+  auto serial_positions = serial.GetPositions(particle_ids);
+  auto parallel_positions = parallel.GetPositions(particle_ids);
+  for (int i = 0; i < n * n; i++) {
+    EXPECT_EQ(serial_positions[i], parallel_positions[i]);
+  }
+}
+
+TEST(Snowberg, SceneHostUpdateBatch) {
+  const int n = 6;
+  const float dt = 1.0f / 120.0f;
+  solver::Scene scene = BuildClothScene(n, 0.02f);
+  solver::Scene other_scene = BuildClothScene(n + 2, 0.02f);
+  ThreadPool thread_pool(2);
+  solver::SceneHost first(scene, &thread_pool);
+  solver::SceneHost second(other_scene, &thread_pool);
+  solver::SceneHost third(scene, &thread_pool);
+  for (int step = 0; step < 3; step++) {
+    solver::SceneHost::UpdateBatch({&first, &second, &third}, dt);
+  }
+  auto first_positions = first.GetPositions(ParticleRange(0, n * n));
+  auto third_positions = third.GetPositions(ParticleRange(0, n * n));
+  for (int i = 0; i < n * n; i++) {
+    EXPECT_EQ(first_positions[i], third_positions[i]);
+    EXPECT_LT(first_positions[i].y(), 1.0f + 0.02f);
+  }
+
+  // Settings the batch cannot follow are rejected before any scene moves.
+  solver::SolverSettings settings;
+  settings.self_contact = true;
+  third.SetSolverSettings(settings);
+  EXPECT_THROW(solver::SceneHost::UpdateBatch({&first, &third}, dt), std::invalid_argument);
+  settings = {};
+  settings.tolerance = 1e-4f;
+  third.SetSolverSettings(settings);
+  EXPECT_THROW(solver::SceneHost::UpdateBatch({&first, &third}, dt), std::invalid_argument);
+  EXPECT_EQ(first.GetPositions(ParticleRange(0, n * n)), first_positions);
+}
+
+TEST(Snowberg, SceneHostAdaptiveIterations) {
+  const int n = 8;
+  const float dt = 1.0f / 240.0f;
+  solver::SolverSettings settings;
+  settings.min_iterations = 2;
+  settings.max_iterations = 40;
+  settings.check_interval = 2;
+  settings.tolerance = 1e-6f;
+
+  // The inertial prediction of a cloth at rest is already the solution, so the first check stops the solve.
+  solver::SceneHost resting(BuildClothScene(n));
+  resting.SetSolverSettings(settings);
+  solver::SceneHost::Update(resting, dt);
+  EXPECT_EQ(resting.GetSolverStatistics().iterations, 2);
+  EXPECT_LT(resting.GetSolverStatistics().residual, settings.tolerance);
+
+  // Without a tolerance the solve always runs max_iterations sweeps and still reports the final residual.
+  settings.tolerance = 0.0f;
+  for (auto criterion :
+       {solver::CONVERGENCE_CRITERION_MAX_DISPLACEMENT, solver::CONVERGENCE_CRITERION_FORCE_RESIDUAL}) {
+    settings.criterion = criterion;
+    solver::SceneHost perturbed(BuildClothScene(n, 0.02f));
+    perturbed.SetSolverSettings(settings);
+    solver::SceneHost::Update(perturbed, dt);
+    EXPECT_EQ(perturbed.GetSolverStatistics().iterations, settings.max_iterations);
+    EXPECT_GT(perturbed.GetSolverStatistics().residual, 0.0f);
+  }
+
+  // A loose tolerance on the perturbed cloth stops between min_iterations and max_iterations.
+  settings.tolerance = 1e-2f;
+  settings.criterion = solver::CONVERGENCE_CRITERION_MAX_DISPLACEMENT;
+  solver::SceneHost perturbed(BuildClothScene(n, 0.02f));
+  perturbed.SetSolverSettings(settings);
+  solver::SceneHost::Update(perturbed, dt);
+  EXPECT_GE(perturbed.GetSolverStatistics().iterations, settings.min_iterations);
+  EXPECT_LE(perturbed.GetSolverStatistics().iterations, settings.max_iterations);
+  EXPECT_LT(perturbed.GetSolverStatistics().residual, settings.tolerance);
+}
+
+TEST(Snowberg, ChebyshevSchedule) {
+  solver::SolverSettings settings;
+  settings.chebyshev = true;
+  settings.chebyshev_delay = 3;
+  solver::vbd::ChebyshevSchedule schedule(settings, 0.0f);
+  EXPECT_EQ(schedule.Next(1.0f), 1.0f);
+  EXPECT_EQ(schedule.Next(0.5f), 1.0f);
+  EXPECT_EQ(schedule.Next(0.4f), 1.0f);
+  float rho = 0.8f;
+  float omega = schedule.Next(0.3f);
+  EXPECT_NEAR(omega, 2.0f / (2.0f - rho * rho), 1e-6f);
+  float next_omega = schedule.Next(0.2f);
+  EXPECT_NEAR(next_omega, 4.0f / (4.0f - rho * rho * omega), 1e-6f);
+  EXPECT_GT(next_omega, 1.0f);
+  EXPECT_LT(next_omega, 2.0f);
+  // An Update without restarts hands a larger estimate to the next one.
+  EXPECT_GT(schedule.SpectralRadius(), rho);
+
+  // A growing residual falls back to plain sweeps and backs off the estimate.
+  EXPECT_EQ(schedule.Next(0.25f), 1.0f);
+  EXPECT_EQ(schedule.Restarts(), 1);
+  EXPECT_LT(schedule.SpectralRadius(), rho);
+
+  // A spectral radius in the settings is never changed.
+  settings.spectral_radius = 0.5f;
+  solver::vbd::ChebyshevSchedule fixed(settings, 0.9f);
+  for (float residual : {1.0f, 0.1f, 0.2f, 0.3f, 0.05f, 0.5f}) {
+    fixed.Next(residual);
+  }
+  EXPECT_EQ(fixed.SpectralRadius(), 0.5f);
+}
+
+TEST(Snowberg, SceneHostChebyshevAcceleration) {
+  const int n = 12;
+  const float dt = 1.0f / 120.0f;
+  solver::SolverSettings settings;
+  settings.min_iterations = 1;
+  settings.max_iterations = 400;
+  settings.check_interval = 1;
+  settings.tolerance = 1e-6f;
+  int iterations[2] = {0, 0};
+  for (bool chebyshev : {false, true}) {
+    settings.chebyshev = chebyshev;
+    solver::SceneHost scene(BuildClothScene(n, 0.05f));
+    scene.SetSolverSettings(settings);
+    for (int step = 0; step < 10; step++) {
+      solver::SceneHost::Update(scene, dt);
+      EXPECT_LT(scene.GetSolverStatistics().residual, settings.tolerance);
+      iterations[chebyshev] += scene.GetSolverStatistics().iterations;
+    }
+  }
+  EXPECT_LT(iterations[1], iterations[0]);
+}
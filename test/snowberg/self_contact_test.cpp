@@ -0,0 +1,202 @@
+#include "snowberg_test.h"
+
+namespace {
+
+// Two sheets gap apart, offset in the plane so that no vertex lies right above another. The top one moves at vy.
+solver::Scene BuildStackedSheets(int n, float gap, float vy) {
+  solver::Scene scene;
+  solver::ObjectPack top = GridCloth(n, 0.05f, Vector3<float>{0.013f, 1.0f + gap, 0.021f});
+  for (auto &v : top.v) {
+    v = Vector3<float>{0.0f, vy, 0.0f};
+  }
+  scene.AddObject(GridCloth(n, 0.05f, Vector3<float>{0.0f, 1.0f, 0.0f}));
+  scene.AddObject(top);
+  return scene;
+}
+
+std::vector<int> TriangleIndices(int n, int first) {
+  std::vector<int> indices;
+  for (int i = 0; i + 1 < n; i++) {
+    for (int j = 0; j + 1 < n; j++) {
+      int v00 = first + i * n + j;
+      indices.insert(indices.end(), {v00, v00 + n, v00 + 1, v00 + 1, v00 + n, v00 + n + 1});
+    }
+  }
+  return indices;
+}
+
+}  // namespace
+
+TEST(Snowberg, ContactDetectorFindsCloseSheets) {
+  const int n = 6;
+  const float gap = 0.01f;
+  std::vector<Vector3<float>> x;
+  for (int sheet = 0; sheet < 2; sheet++) {
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        x.emplace_back(i * 0.1f + sheet * 0.013f, sheet * gap, j * 0.1f + sheet * 0.021f);
+      }
+    }
+  }
+  std::vector<int> triangles = TriangleIndices(n, 0);
+  std::vector<int> top_triangles = TriangleIndices(n, n * n);
+  triangles.insert(triangles.end(), top_triangles.begin(), top_triangles.end());
+
+  ThreadPool thread_pool(3);
+  solver::ContactDetector serial(triangles, x.data(), 2 * n * n);
+  solver::ContactDetector parallel(triangles, x.data(), 2 * n * n);
+  serial.Detect(x.data(), 0.005f, 0.03f, 0.4f);
+  parallel.Detect(x.data(), 0.005f, 0.03f, 0.4f, &thread_pool);
+  EXPECT_EQ(serial.VertexFaceIndices(), parallel.VertexFaceIndices());
+  EXPECT_EQ(serial.EdgeEdgeIndices(), parallel.EdgeEdgeIndices());
+  EXPECT_EQ(serial.Bounds(), parallel.Bounds());
+
+  // Pairs only connect the two sheets, the edges of one flat sheet are at least 0.1 * sin(45) apart.
+  EXPECT_GT(serial.VertexFaceIndices().size(), 0u);
+  EXPECT_GT(serial.EdgeEdgeIndices().size(), 0u);
+  for (const auto *indices : {&serial.VertexFaceIndices(), &serial.EdgeEdgeIndices()}) {
+    for (size_t i = 0; i < indices->size(); i += 4) {
+      bool first_in_bottom = (*indices)[i] < n * n;
+      bool last_in_bottom = (*indices)[i + 3] < n * n;
+      EXPECT_NE(first_in_bottom, last_in_bottom);
+    }
+  }
+  // Every vertex sees the other sheet at the gap, or slightly further past its border.
+  for (float bound : serial.Bounds()) {
+    EXPECT_GE(bound, 0.4f * gap - 1e-6f);
+    EXPECT_LE(bound, 0.4f * 0.03f);
+  }
+  for (int v = 0; v < n * n; v++) {
+    EXPECT_GT(serial.VertexFaceDirectory().count[v] + serial.EdgeEdgeDirectory().count[v], 0);
+  }
+}
+
+TEST(Snowberg, ContactDetectorSkipsCrossingDiagonals) {
+  // The stretching elements of a grid cloth cover every quad twice, once per diagonal.
+  const int n = 6;
+  solver::ObjectPack sheet = GridCloth(n, 0.1f, Vector3<float>::Zero());
+  std::vector<int> triangles(sheet.stretching_indices.begin(), sheet.stretching_indices.end());
+  solver::ContactDetector detector(triangles, sheet.x.data(), n * n);
+  EXPECT_EQ(detector.NumEdges(), 2 * n * (n - 1) + (n - 1) * (n - 1));
+  detector.Detect(sheet.x.data(), 0.005f, 0.03f, 0.4f);
+  EXPECT_TRUE(detector.VertexFaceIndices().empty());
+  EXPECT_TRUE(detector.EdgeEdgeIndices().empty());
+  for (float bound : detector.Bounds()) {
+    EXPECT_FLOAT_EQ(bound, 0.4f * 0.03f);
+  }
+}
+
+TEST(Snowberg, ContactDetectorTestsFreeParticles) {
+  // A particle in no triangle right above a sheet meets its faces, unless its color marks it as a free slot.
+  const int n = 4;
+  std::vector<Vector3<float>> x;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      x.emplace_back(i * 0.1f, 0.0f, j * 0.1f);
+    }
+  }
+  x.emplace_back(0.13f, 0.01f, 0.17f);
+  std::vector<int> triangles = TriangleIndices(n, 0);
+  solver::ContactDetector detector(triangles, x.data(), n * n + 1);
+  detector.Detect(x.data(), 0.005f, 0.03f, 0.4f);
+  EXPECT_GT(detector.VertexFaceDirectory().count[n * n], 0);
+  EXPECT_FLOAT_EQ(detector.Bounds()[n * n], 0.4f * 0.01f);
+
+  std::vector<int> particle_colors(n * n + 1, 0);
+  particle_colors[n * n] = -1;
+  detector.Detect(x.data(), 0.005f, 0.03f, 0.4f, nullptr, particle_colors.data());
+  EXPECT_TRUE(detector.VertexFaceIndices().empty());
+  EXPECT_FLOAT_EQ(detector.Bounds()[n * n], 0.4f * 0.03f);
+}
+
+TEST(Snowberg, ContactDetectorWidensByDisplacement) {
+  // A particle expected to move far looks further for pairs, its bound covers that motion unless something is nearer.
+  const int n = 4;
+  std::vector<Vector3<float>> x;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      x.emplace_back(i * 0.1f, 0.0f, j * 0.1f);
+    }
+  }
+  x.emplace_back(5.0f, 5.0f, 5.0f);
+  std::vector<int> triangles = TriangleIndices(n, 0);
+  solver::ContactDetector detector(triangles, x.data(), n * n + 1);
+  std::vector<float> displacements(n * n + 1, 0.0f);
+  displacements[0] = 0.1f;
+  displacements[n * n] = 0.1f;
+  detector.Detect(x.data(), 0.005f, 0.03f, 0.4f, nullptr, nullptr, displacements.data());
+  EXPECT_FLOAT_EQ(detector.Bounds()[n * n], 0.4f * 0.03f + 0.1f);
+  // The corner now reaches the diagonal of its quad.
+  EXPECT_FLOAT_EQ(detector.Bounds()[0], 0.4f * 0.1f * std::sqrt(0.5f));
+  EXPECT_FLOAT_EQ(detector.Bounds()[1], 0.4f * 0.03f);
+}
+
+TEST(Snowberg, SceneHostSelfContactStopsTunneling) {
+  const int n = 10;
+  const float dt = 1.0f / 120.0f;
+  const float gap = 0.03f;
+  solver::Scene scene = BuildStackedSheets(n, gap, -2.0f);
+  std::vector<int> bottom_ids = ParticleRange(0, n * n);
+  std::vector<int> top_ids = ParticleRange(n * n, n * n);
+
+  auto mean_height = [](const std::vector<Vector3<float>> &positions) {
+    float sum = 0.0f;
+    for (const auto &p : positions) {
+      sum += p.y();
+    }
+    return sum / positions.size();
+  };
+
+  solver::SolverSettings settings;
+  for (bool self_contact : {false, true}) {
+    settings.self_contact = self_contact;
+    solver::SceneHost scene_host(scene);
+    scene_host.SetSolverSettings(settings);
+    for (int step = 0; step < 20; step++) {
+      solver::SceneHost::Update(scene_host, dt);
+    }
+    auto bottom = scene_host.GetPositions(bottom_ids);
+    auto top = scene_host.GetPositions(top_ids);
+    if (!self_contact) {
+      // The faster sheet passes straight through the slower one.
+      EXPECT_LT(mean_height(top), mean_height(bottom));
+      continue;
+    }
+    // The top sheet closes the gap and pushes the bottom one along. The bottom sheet alone would fall to free_fall, the
+    // bounds must not hold it back there, the top sheet only pushes it further down.
+    float free_fall = 1.0f - 9.8f * dt * dt * 20 * 21 / 2;
+    EXPECT_LT(mean_height(bottom), free_fall + 1e-3f);
+    EXPECT_LT(mean_height(top), mean_height(bottom) + gap);
+    EXPECT_GT(mean_height(top), mean_height(bottom) + 0.5f * settings.contact_thickness);
+    // No vertex of the top sheet ends up below the bottom vertex closest to it in the plane.
+    for (const auto &p : top) {
+      const Vector3<float> *closest = &bottom[0];
+      for (const auto &q : bottom) {
+        if ((Vector2<float>{p.x() - q.x(), p.z() - q.z()}).squaredNorm() <
+            (Vector2<float>{p.x() - closest->x(), p.z() - closest->z()}).squaredNorm()) {
+          closest = &q;
+        }
+      }
+      EXPECT_GT(p.y(), closest->y());
+    }
+  }
+}
+
+TEST(Snowberg, SceneHostSelfContactThreadCountIndependent) {
+  const int n = 8;
+  const float dt = 1.0f / 120.0f;
+  solver::Scene scene = BuildStackedSheets(n, 0.02f, -1.5f);
+  solver::SolverSettings settings;
+  settings.self_contact = true;
+  ThreadPool thread_pool(3);
+  solver::SceneHost serial(scene);
+  solver::SceneHost parallel(scene, &thread_pool);
+  serial.SetSolverSettings(settings);
+  parallel.SetSolverSettings(settings);
+  for (int step = 0; step < 8; step++) {
+    solver::SceneHost::Update(serial, dt);
+    solver::SceneHost::Update(parallel, dt);
+  }
+  std::vector<int> particle_ids = ParticleRange(0, 2 * n * n);
+  EXPECT_EQ(serial.GetPositions(particle_ids), parallel.GetPositions(particle_ids));
+}
@@ -0,0 +1,109 @@
+#include <filesystem>
+#include <random>
+
+#include "snowberg_test.h"
+
+TEST(Snowberg, SnapshotCompression) {
+  std::mt19937 rng(23);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  std::vector<std::vector<uint8_t>> blobs;
+  blobs.emplace_back();
+  blobs.emplace_back(std::vector<uint8_t>(10007, 0));
+  std::vector<uint8_t> noise(4099);
+  for (auto &byte : noise) {
+    byte = rng() & 0xff;
+  }
+  blobs.push_back(noise);
+  // Positions of a smooth surface, the kind of data a snapshot mostly holds.
+  std::vector<float> positions;
+  for (int i = 0; i < 3000; i++) {
+    positions.push_back(0.01f * i + 0.001f * uniform(rng));
+  }
+  blobs.emplace_back(reinterpret_cast<uint8_t *>(positions.data()),
+                     reinterpret_cast<uint8_t *>(positions.data() + positions.size()));
+
+  for (const auto &blob : blobs) {
+    std::vector<uint8_t> compressed = solver::CompressSnapshot(blob);
+    EXPECT_EQ(solver::DecompressSnapshot(compressed), blob);
+  }
+  EXPECT_LT(solver::CompressSnapshot(blobs[1]).size(), 64u);
+  EXPECT_LT(solver::CompressSnapshot(blobs[3]).size(), blobs[3].size() * 3 / 4);
+
+  std::vector<uint8_t> truncated = solver::CompressSnapshot(blobs[3]);
+  truncated.resize(truncated.size() / 2);
+  EXPECT_THROW(solver::DecompressSnapshot(truncated), std::runtime_error);
+}
+
+TEST(Snowberg, SceneHostSnapshotRestore) {
+  const int n = 12;
+  const float dt = 1.0f / 120.0f;
+  MeshSDF cube = UnitCube();
+  solver::Scene scene = BuildClothOnBoxScene(n, cube);
+  std::vector<int> particle_ids = ParticleRange(0, n * n);
+
+  solver::SceneHost scene_host(scene);
+  for (int step = 0; step < 10; step++) {
+    solver::SceneHost::Update(scene_host, dt);
+  }
+  std::vector<uint8_t> snapshot = scene_host.Snapshot();
+  for (int step = 0; step < 10; step++) {
+    solver::SceneHost::Update(scene_host, dt);
+  }
+  std::vector<Vector3<float>> expected = scene_host.GetPositions(particle_ids);
+
+  // Back in place, after moving the box and changing the settings in between.
+  solver::RigidObjectState moved = scene_host.GetRigidObjectState(0);
+  moved.t.y() += 1.0f;
+  scene_host.SetRigidObjectState(0, moved);
+  solver::SolverSettings settings = scene_host.GetSolverSettings();
+  settings.max_iterations = 3;
+  scene_host.SetSolverSettings(settings);
+  scene_host.Restore(snapshot);
+  EXPECT_EQ(scene_host.GetSolverSettings().max_iterations, solver::SolverSettings{}.max_iterations);
+  for (int step = 0; step < 10; step++) {
+    solver::SceneHost::Update(scene_host, dt);
+  }
+  EXPECT_EQ(scene_host.GetPositions(particle_ids), expected);
+
+  // Into a fresh scene host through a compressed and a plain file.
+  std::string path = (std::filesystem::temp_directory_path() / "snowberg_snapshot_test.bin").string();
+  for (bool compress : {true, false}) {
+    solver::WriteSnapshotFile(path, snapshot, compress);
+    EXPECT_EQ(std::filesystem::file_size(path) < snapshot.size(), compress);
+    solver::SceneHost restored(scene);
+    restored.Restore(solver::ReadSnapshotFile(path));
+    for (int step = 0; step < 10; step++) {
+      solver::SceneHost::Update(restored, dt);
+    }
+    EXPECT_EQ(restored.GetPositions(particle_ids), expected);
+  }
+  std::filesystem::remove(path);
+
+  // A snapshot of another scene or a truncated one is rejected without touching the scene.
+  solver::SceneHost other(BuildClothOnBoxScene(n - 1, cube));
+  EXPECT_THROW(other.Restore(snapshot), std::runtime_error);
+  std::vector<uint8_t> truncated(snapshot.begin(), snapshot.end() - 4);
+  std::vector<Vector3<float>> before = scene_host.GetPositions(particle_ids);
+  EXPECT_THROW(scene_host.Restore(truncated), std::runtime_error);
+  EXPECT_EQ(scene_host.GetPositions(particle_ids), before);
+}
+
+TEST(Snowberg, SceneHostSnapshotBytesFollowTheState) {
+  const int n = 6;
+  MeshSDF cube = UnitCube();
+  solver::Scene scene = BuildClothOnBoxScene(n, cube);
+
+  // Equal settings, one copy taken from storage full of garbage, which stays in its padding.
+  alignas(solver::SolverSettings) uint8_t storage[sizeof(solver::SolverSettings)];
+  std::fill(std::begin(storage), std::end(storage), 0xab);
+  solver::SolverSettings *garbage = new (storage) solver::SolverSettings;
+  solver::SceneHost plain(scene);
+  solver::SceneHost dirty(scene);
+  plain.SetSolverSettings(solver::SolverSettings{});
+  dirty.SetSolverSettings(*garbage);
+  for (int step = 0; step < 3; step++) {
+    solver::SceneHost::Update(plain, 1.0f / 120.0f);
+    solver::SceneHost::Update(dirty, 1.0f / 120.0f);
+  }
+  EXPECT_EQ(plain.Snapshot(), dirty.Snapshot());
+}
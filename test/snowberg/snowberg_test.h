@@ -0,0 +1,62 @@
+#pragma once
+#include "cmath"
+#include "gtest/gtest.h"
+#include "long_march.h"
+
+using namespace long_march;
+
+// Closed cube mesh around the origin with half extent 1, outward facing triangles.
+inline MeshSDF UnitCube() {
+  std::vector<Vector3<float>> positions = {
+      {-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1}, {-1, -1, 1}, {1, -1, 1}, {1, 1, 1}, {-1, 1, 1},
+  };
+  std::vector<uint32_t> indices = {
+      1, 0, 2, 2, 0, 3, 5, 1, 6, 6, 1, 2, 4, 5, 7, 7, 5, 6, 0, 4, 3, 3, 4, 7, 2, 3, 6, 6, 3, 7, 4, 0, 5, 5, 0, 1,
+  };
+  VertexBufferView vbv = {positions.data()};
+  return MeshSDF(vbv, positions.size(), indices.data(), indices.size());
+}
+
+// Square grid cloth of n x n particles with the given spacing in the y = origin.y() plane, corner at origin. A
+// sigma_ub above 1 makes the stretchings yield plastically beyond that singular value.
+inline solver::ObjectPack GridCloth(int n, float spacing, const Vector3<float> &origin, float sigma_ub = -1.0f) {
+  return solver::ObjectPack::CreateSquareCloth(n, spacing, origin, 0.0f, sigma_ub);
+}
+
+// Grid cloth at rest in the y = 1 plane, perturbation displaces the vertices away from the rest shape. The benchmark
+// in demo/vbd_benchmark builds the same cloth with spacing 0.05f.
+inline solver::Scene BuildClothScene(int n, float perturbation = 0.0f, float spacing = 0.1f) {
+  solver::Scene scene;
+  scene.AddObject(solver::ObjectPack::CreateSquareCloth(n, spacing, Vector3<float>{0.0f, 1.0f, 0.0f}, perturbation));
+  return scene;
+}
+
+// A plastic cloth of n by n particles falling onto a box, shifted sideways by offset.
+inline solver::Scene BuildClothOnBoxScene(int n, const MeshSDF &cube, float offset = 0.0f) {
+  std::vector<Vector3<float>> pos_grid;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      pos_grid.emplace_back(i * 0.05f + offset, 0.2f, j * 0.05f);
+    }
+  }
+  solver::Scene scene;
+  scene.AddObject(solver::ObjectPack::CreateGridCloth(pos_grid, n, n, 1.0f, 3e3f, 0.2f, 0.03f, 1e-6f, -1.0f, 1.02f));
+  solver::RigidObjectState state{};
+  state.R = Matrix3<float>::Identity() * 0.2f;
+  state.t = Vector3<float>{0.3f, -0.1f, 0.3f};
+  state.v = Vector3<float>::Zero();
+  state.omega = Vector3<float>::Zero();
+  state.mass = 1.0f;
+  state.inertia = Matrix3<float>::Identity();
+  scene.AddRigidBody(solver::RigidObject{cube, state, 1e5f, 0.3f});
+  return scene;
+}
+
+// Ids first up to first + count, e.g. those of the particles of the objects added to a scene in order.
+inline std::vector<int> ParticleRange(int first, int count) {
+  std::vector<int> particle_ids(count);
+  for (int i = 0; i < count; i++) {
+    particle_ids[i] = first + i;
+  }
+  return particle_ids;
+}